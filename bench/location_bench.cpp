@@ -0,0 +1,129 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   location_bench.cpp                                 :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: bvieilhe <bvieilhe@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 16:41:05 by bvieilhe          #+#    #+#             */
+/*   Updated: 2026/10/18 16:41:05 by bvieilhe         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+// Location lookup time against the number of locations: the former linear longest-prefix scan
+// versus LocationMatcher's radix trie. The scan grows with the location count, the trie with the
+// path length only.
+//
+// Usage: ./bench_location [lookups] [locations ...]    (default: 200000 lookups, 10 100 1000 10000 locations)
+
+#include "../includes/http/LocationMatcher.hpp"
+#include "../includes/config/ServerStructures.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <cstdlib>
+#include <sys/time.h>
+
+namespace {
+	double nowUs() {
+		struct timeval tv;
+		gettimeofday(&tv, NULL);
+		return tv.tv_sec * 1e6 + tv.tv_usec;
+	}
+
+	// What RequestDispatcher::findMatchingLocation did before the trie: every location, every lookup.
+	const LocationConfig* linearMatch(const std::vector<LocationConfig>& locations, const std::string& path) {
+		const LocationConfig* best = NULL;
+		size_t longest = 0;
+		for (size_t i = 0; i < locations.size(); ++i) {
+			if (path.rfind(locations[i].path, 0) == 0 && locations[i].path.length() > longest) {
+				longest = locations[i].path.length();
+				best = &locations[i];
+			}
+		}
+		return best;
+	}
+
+	// Generated-config shape: one prefix location per service and API version, plus "/".
+	std::vector<LocationConfig> makeLocations(int count) {
+		std::vector<LocationConfig> locations(1);
+		for (int i = 1; i < count; ++i) {
+			std::ostringstream path;
+			path << "/svc" << (i / 4) << "/v" << (i % 4) << "/";
+			locations.push_back(LocationConfig());
+			locations.back().path = path.str();
+		}
+		return locations;
+	}
+
+	std::vector<std::string> makePaths(int count, int locations) {
+		std::vector<std::string> paths;
+		std::srand(42);
+		for (int i = 0; i < count; ++i) {
+			std::ostringstream path;
+			int target = std::rand() % (locations + locations / 8 + 1); // Some paths only match "/".
+			path << "/svc" << (target / 4) << "/v" << (target % 4) << "/items/" << std::rand() % 1000;
+			paths.push_back(path.str());
+		}
+		return paths;
+	}
+}
+
+int main(int argc, char** argv) {
+	int lookups = (argc > 1) ? std::atoi(argv[1]) : 200000;
+	std::vector<int> counts;
+	for (int i = 2; i < argc; ++i) {
+		counts.push_back(std::atoi(argv[i]));
+	}
+	if (counts.empty()) {
+		counts.push_back(10);
+		counts.push_back(100);
+		counts.push_back(1000);
+		counts.push_back(10000);
+	}
+
+	std::cout << std::setw(10) << "locations" << std::setw(16) << "linear (ns)"
+			  << std::setw(14) << "trie (ns)" << std::setw(14) << "compile (ms)" << std::endl;
+
+	for (size_t c = 0; c < counts.size(); ++c) {
+		std::vector<LocationConfig> locations = makeLocations(counts[c]);
+		std::vector<std::string> paths = makePaths(lookups, counts[c]);
+
+		double start = nowUs();
+		LocationMatcher matcher;
+		matcher.compile(locations);
+		double compileMs = (nowUs() - start) / 1000;
+
+		// Fewer linear lookups at large counts, or the run takes minutes; the average is what matters.
+		int linearLookups = lookups / (counts[c] >= 1000 ? counts[c] / 100 : 1);
+		start = nowUs();
+		size_t found = 0;
+		for (int i = 0; i < linearLookups; ++i) {
+			found += linearMatch(locations, paths[i]) != NULL;
+		}
+		double linearNs = (nowUs() - start) * 1000 / linearLookups;
+
+		start = nowUs();
+		for (int i = 0; i < lookups; ++i) {
+			found += matcher.match(paths[i]) != NULL;
+		}
+		double trieNs = (nowUs() - start) * 1000 / lookups;
+
+		// Every path matches at least "/", and both must agree on which location.
+		if (found != static_cast<size_t>(linearLookups + lookups)) {
+			std::cerr << "Lookups without a match" << std::endl;
+			return 1;
+		}
+		for (int i = 0; i < lookups; i += 97) {
+			if (matcher.match(paths[i]) != linearMatch(locations, paths[i])) {
+				std::cerr << "Mismatch for " << paths[i] << std::endl;
+				return 1;
+			}
+		}
+		std::cout << std::setw(10) << counts[c] << std::fixed << std::setprecision(1)
+				  << std::setw(16) << linearNs << std::setw(14) << trieNs << std::setw(14) << compileMs << std::endl;
+	}
+	return 0;
+}
@@ -0,0 +1,111 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   spawn_bench.cpp                                    :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: bvieilhe <bvieilhe@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 14:12:40 by bvieilhe          #+#    #+#             */
+/*   Updated: 2026/10/18 14:12:40 by bvieilhe         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+// Spawn latency against parent RSS: fork()+execve() versus posix_spawn().
+// fork() copies the page tables of the whole parent, so its cost grows with RSS; posix_spawn()
+// (clone with CLONE_VM|CLONE_VFORK on glibc) shares the parent's memory until exec and stays flat.
+//
+// Usage: ./bench_spawn [iterations] [rss_mb ...]    (default: 200 iterations, 0 64 256 1024 MB)
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include <spawn.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+
+extern char**	environ;
+
+namespace {
+	const char*	kChild = "/bin/true";
+
+	double nowUs() {
+		struct timeval tv;
+		gettimeofday(&tv, NULL);
+		return tv.tv_sec * 1e6 + tv.tv_usec;
+	}
+
+	// Average microseconds from launch to reaping the exited child.
+	double benchFork(int iterations) {
+		char* argv[] = { const_cast<char*>(kChild), NULL };
+		double start = nowUs();
+		for (int i = 0; i < iterations; ++i) {
+			pid_t pid = fork();
+			if (pid == 0) {
+				execve(kChild, argv, environ);
+				_exit(127);
+			}
+			waitpid(pid, NULL, 0);
+		}
+		return (nowUs() - start) / iterations;
+	}
+
+	double benchPosixSpawn(int iterations) {
+		char* argv[] = { const_cast<char*>(kChild), NULL };
+		double start = nowUs();
+		for (int i = 0; i < iterations; ++i) {
+			pid_t pid;
+			if (posix_spawn(&pid, kChild, NULL, NULL, argv, environ) != 0) {
+				std::cerr << "posix_spawn failed" << std::endl;
+				return -1;
+			}
+			waitpid(pid, NULL, 0);
+		}
+		return (nowUs() - start) / iterations;
+	}
+}
+
+int main(int argc, char** argv) {
+	int iterations = (argc > 1) ? std::atoi(argv[1]) : 200;
+	std::vector<long> sizes;
+	for (int i = 2; i < argc; ++i) {
+		sizes.push_back(std::atol(argv[i]));
+	}
+	if (sizes.empty()) {
+		sizes.push_back(0);
+		sizes.push_back(64);
+		sizes.push_back(256);
+		sizes.push_back(1024);
+	}
+
+	std::cout << std::setw(10) << "RSS (MB)" << std::setw(16) << "fork+exec (us)"
+			  << std::setw(18) << "posix_spawn (us)" << std::endl;
+
+	std::vector<char*> ballast;
+	long resident = 0;
+	for (size_t i = 0; i < sizes.size(); ++i) {
+		// Grow the parent to the target RSS; touching every page makes it resident.
+		if (sizes[i] > resident) {
+			size_t bytes = static_cast<size_t>(sizes[i] - resident) << 20;
+			char* block = static_cast<char*>(std::malloc(bytes));
+			if (!block) {
+				std::cerr << "Cannot allocate " << sizes[i] << " MB" << std::endl;
+				break;
+			}
+			std::memset(block, 1, bytes);
+			ballast.push_back(block);
+			resident = sizes[i];
+		}
+		double forkUs = benchFork(iterations);
+		double spawnUs = benchPosixSpawn(iterations);
+		std::cout << std::setw(10) << resident << std::fixed << std::setprecision(1)
+				  << std::setw(16) << forkUs << std::setw(18) << spawnUs << std::endl;
+	}
+
+	for (size_t i = 0; i < ballast.size(); ++i) {
+		std::free(ballast[i]);
+	}
+	return 0;
+}
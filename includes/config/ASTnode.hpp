@@ -22,7 +22,8 @@ class ASTnode {
 		virtual ~ASTnode() {}
 		ASTnode() : line(0), column(0) {}
 
-		int	line, column; // Line and column number for error reporting.
+		int			line, column; // Line and column number for error reporting.
+		std::string	file; // Included file a top-level node was read from, empty for the main file.
 };
 
 // Represents a directive in the configuration file (e.g., 'listen 8080;').
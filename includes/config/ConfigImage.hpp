@@ -0,0 +1,51 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   ConfigImage.hpp                                    :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: bvieilhe <bvieilhe@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 21:04:12 by bvieilhe          #+#    #+#             */
+/*   Updated: 2026/10/18 21:04:12 by bvieilhe         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef CONFIG_IMAGE_HPP
+# define CONFIG_IMAGE_HPP
+
+# include "ServerStructures.hpp"
+
+# include <map>
+# include <string>
+# include <vector>
+
+// A loaded configuration saved as one binary file ('webserv -c <file> -o <image>'): the server
+// blocks with their resolved locations, the MIME types, upstreams and cache paths. Loading it
+// (ConfigLoader::loadFile takes either form) maps the file and rebuilds the structures in one pass,
+// without lexing, parsing or resolving anything. Location matchers and virtual-host tables are not
+// stored; ConfigSnapshot builds them as for a text configuration.
+//
+// The image is tied to the binary that wrote it (version, byte order and word size are checked),
+// and holds paths resolved when it was built: rebuild it after editing the configuration.
+class ConfigImage {
+public:
+	// Whether 'path' starts with the image magic (a text configuration never does).
+	static bool		isImage(const std::string& path);
+	// Writes the image to 'path' (through a temporary file, so a running server never reads half
+	// of one). Returns its size in bytes; throws std::runtime_error on I/O failure.
+	static size_t	write(const std::string& path, const std::vector<ServerConfig>& servers,
+						const std::map<std::string, std::string>& mimeTypes,
+						const std::map<std::string, UpstreamConfig>& upstreams,
+						const std::vector<CachePathConfig>& cachePaths);
+	// Loads the image at 'path' into the given containers (replacing their contents). Throws
+	// ConfigLoadError if it is unreadable, corrupt or from another build.
+	static void		read(const std::string& path, std::vector<ServerConfig>& servers,
+						std::map<std::string, std::string>& mimeTypes,
+						std::map<std::string, UpstreamConfig>& upstreams,
+						std::vector<CachePathConfig>& cachePaths);
+
+private:
+	ConfigImage();
+};
+
+#endif
@@ -7,6 +7,7 @@
 #include <sstream>
 #include <algorithm>
 #include <limits>
+#include <map>
 
 #include "ASTnode.hpp"
 #include "ServerStructures.hpp"
@@ -19,11 +20,31 @@ public:
 	~ConfigLoader();
 
 	std::vector<ServerConfig>	loadConfig(const std::vector<ASTnode*>& astNodes);
+	std::vector<ServerConfig>	loadFile(const std::string& path);
+
+	const std::map<std::string, std::string>&	getMimeTypes() const;
+	const std::map<std::string, UpstreamConfig>&	getUpstreams() const;
+	const std::vector<CachePathConfig>&	getCachePaths() const;
 
 private:
-	ServerConfig	parseServerBlock(const BlockNode* serverBlockNode);
-	LocationConfig	parseLocationBlock(const BlockNode* locationBlockNode, const ServerConfig& parentServerDefaults);
-	LocationConfig	parseLocationBlock(const BlockNode* locationBlockNode, const LocationConfig& parentLocationDefaults);
+	std::map<std::string, std::string>	_mimeTypes;	// Extension (lowercase, no dot) -> MIME type, from 'types' blocks.
+	std::map<std::string, long>			_cacheZones;	// 'cgi_cache' zone name -> size, so every use agrees.
+	std::map<std::string, UpstreamConfig>	_upstreams;	// 'upstream' blocks and implicit 'proxy_pass host:port' groups, by name.
+	std::vector<CachePathConfig>			_cachePaths;	// 'proxy_cache_path' directives.
+
+	void	parseTypesBlock(const BlockNode* typesBlockNode);
+	void	parseUpstreamBlock(const BlockNode* upstreamBlockNode);
+	bool	parseUpstreamAddress(const std::string& address, UpstreamServerConfig& server) const;
+	void	resolveProxyPasses(const std::vector<LocationConfig>& locations);
+	void	parseCachePathDirective(const DirectiveNode* directive);
+	void	resolveProxyCaches(const std::vector<LocationConfig>& locations);
+	long	parseSeconds(const std::string& value) const;
+	void	parseServerBlock(const BlockNode* serverBlockNode, ServerConfig& serverConf);
+	void	parseLocationBlock(const BlockNode* locationBlockNode, const ServerConfig& parentServerDefaults, LocationConfig& locationConf);
+	void	parseLocationBlock(const BlockNode* locationBlockNode, const LocationConfig& parentLocationDefaults, LocationConfig& locationConf);
+	void	resolveCgiLocations(std::vector<LocationConfig>& locations, const ServerConfig& serverConfig) const;
+	void	resolveEffectiveLocations(ServerConfig& serverConfig) const;
+	void	resolveEffectiveLocations(std::vector<LocationConfig>& locations, const EffectiveLocation& serverDefaults) const;
 
 	void	processDirective(const DirectiveNode* directive, ServerConfig& serverConfig);
 	void	processDirective(const DirectiveNode* directive, LocationConfig& locationConfig);
@@ -32,12 +53,16 @@ private:
 	void	handleListenDirective(const DirectiveNode* directive, ServerConfig& serverConfig);
 	void	handleServerNameDirective(const DirectiveNode* directive, ServerConfig& serverConfig);
 	void	handleErrorLogDirective(const DirectiveNode* directive, ServerConfig& serverConfig);
+	void	handleKeepaliveRequestsDirective(const DirectiveNode* directive, ServerConfig& serverConfig);
+	void	handleKeepaliveTimeoutDirective(const DirectiveNode* directive, ServerConfig& serverConfig);
 	void	handleRootDirective(const DirectiveNode* directive, ServerConfig& serverConfig);
 	void	handleRootDirective(const DirectiveNode* directive, LocationConfig& locationConfig);
 	void	handleIndexDirective(const DirectiveNode* directive, ServerConfig& serverConfig);
 	void	handleIndexDirective(const DirectiveNode* directive, LocationConfig& locationConfig);
 	void	handleAutoindexDirective(const DirectiveNode* directive, ServerConfig& serverConfig);
 	void	handleAutoindexDirective(const DirectiveNode* directive, LocationConfig& locationConfig);
+	void	handleAutoindexFormatDirective(const DirectiveNode* directive, ServerConfig& serverConfig);
+	void	handleAutoindexFormatDirective(const DirectiveNode* directive, LocationConfig& locationConfig);
 	void	handleErrorPageDirective(const DirectiveNode* directive, ServerConfig& serverConfig);
 	void	handleErrorPageDirective(const DirectiveNode* directive, LocationConfig& locationConfig);
 	void	handleClientMaxBodySizeDirective(const DirectiveNode* directive, ServerConfig& serverConfig);
@@ -49,6 +74,13 @@ private:
 	void	handleCgiExtensionDirective(const DirectiveNode* directive, LocationConfig& locationConfig);
 	void	handleCgiPathDirective(const DirectiveNode* directive, LocationConfig& locationConfig);
 	void	handleReturnDirective(const DirectiveNode* directive, LocationConfig& locationConfig);
+	void	handleFastcgiPassDirective(const DirectiveNode* directive, LocationConfig& locationConfig);
+	void	handleCgiPoolDirective(const DirectiveNode* directive, LocationConfig& locationConfig);
+	void	handleCgiMaxConcurrentDirective(const DirectiveNode* directive, LocationConfig& locationConfig);
+	void	handleCgiQueueDirective(const DirectiveNode* directive, LocationConfig& locationConfig);
+	void	handleCgiCacheDirective(const DirectiveNode* directive, LocationConfig& locationConfig);
+	void	handleProxyPassDirective(const DirectiveNode* directive, LocationConfig& locationConfig);
+	void	handleProxyCacheDirective(const DirectiveNode* directive, LocationConfig& locationConfig);
 
 
 	HttpMethod	stringToHttpMethod(const std::string& methodStr) const;
@@ -36,37 +36,34 @@ class LexerError : public std::runtime_error {
 		int getColumn() const;
 };
 
-// Tokenizes the input configuration string into a stream of tokens.
+// Tokenizes the input configuration string, one token per call to next(): no token list is built,
+// and a token's text is written into the caller's token, whose storage is reused.
+// The input must outlive the lexer.
 class Lexer {
 	private:
 		const std::string&	_input;
 		size_t				_pos;
 		int					_line, _column;
-		std::vector<token>	_tokens;
 
-		token	nextToken();
-		
 		void	skipWhitespaceAndComments();
-		token	tokeniseIdentifier();
-		token	tokeniseNumber();
-		token	tokeniseString();
-		token	tokeniseSymbol();
-		
+		void	tokeniseIdentifier(token& out);
+		void	tokeniseNumber(token& out);
+		void	tokeniseString(token& out);
+		void	tokeniseSymbol(token& out);
+		void	tokeniseModifier(token& out);
+		void	readWord(std::string& out);
+
 		char	peek() const;
 		char	get();
 		bool	isAtEnd() const;
-
 		void	error(const std::string& msg) const;
 
 	public:
 		Lexer(const std::string &input);
 		~Lexer();
 
-		void				lexConf();
-		std::vector<token>	getTokens() const;
-
-		void				dumpTokens(); // utils
+		void	next(token& out);
+		void	dumpTokens(); // utils
 };
 
-
 #endif
\ No newline at end of file
@@ -23,6 +23,9 @@
 # include "ASTnode.hpp"
 # include "ServerStructures.hpp"
 
+# define MAX_INCLUDE_DEPTH 16	// Maximum nesting of 'include' directives.
+# define MAX_INCLUDE_THREADS 16	// Most worker threads parsing the files of one 'include' at once.
+
 // Custom exception class for parser errors.
 class ParseError : public std::runtime_error {
 	private:
@@ -35,35 +38,60 @@ class ParseError : public std::runtime_error {
 		int getColumn() const;
 };
 
-// Parses a stream of tokens into an Abstract Syntax Tree (AST).
+// One file named by an 'include' directive, lexed and parsed on its own (possibly on a worker thread).
+struct IncludedFile {
+	std::string				path;
+	std::vector<ASTnode*>	nodes;		// Its top-level nodes, once parsed.
+	bool					opened;
+	bool					failed;
+	std::string				error;		// Why parsing failed, with the position below (in this file).
+	int						line, column;
+
+	IncludedFile() : opened(false), failed(false), line(0), column(0) {}
+};
+
+// Parses the token stream of a lexer into an Abstract Syntax Tree (AST), pulling one token at a time.
 class Parser {
 	private :
-		std::vector<token>  _tokens;
-		size_t              _current;
+		Lexer&              _lexer;
+		token               _token;         // Current token (one-token lookahead), refilled by the lexer.
+		token               _previous;      // Last consumed token, valid until the next consume().
+		std::string         _baseDir;       // Directory relative 'include' paths are resolved from.
+		int                 _includeDepth;
 
-		token       peek(int offset) const;
-		token       consume();
+		const token&    peek() const;
+		const token&    consume();
 		bool        isAtEnd() const;
 		bool        checkCurrentType(tokenType type) const;
-		token       expectToken(tokenType type, const std::string& context);
+		const token&    expectToken(tokenType type, const std::string& context);
 
 		std::vector<ASTnode*>		parseConfig();
 		BlockNode *					parseServerBlock();
 		BlockNode *					parseLocationBlock();
+		BlockNode *					parseTypesBlock();
+		BlockNode *					parseUpstreamBlock();
+		void						parseInclude(std::vector<ASTnode*>& out);
+		void						expandIncludePath(const std::string& path, std::vector<IncludedFile>& files) const;
+		void						parseIncludedFiles(std::vector<IncludedFile>& files) const;
 		DirectiveNode *				parseDirective();
 		std::vector<std::string>	parseArgs();
 
 		void	validateDirectiveArguments(DirectiveNode* directive) const;
 		bool	isValidDirective(const std::string& name, const std::string& context) const;
 
+		struct IncludeQueue;
+		static void *	includeWorker(void* queue);
+		static void		parseIncludedFile(IncludedFile& file, const std::string& baseDir, int depth);
+
 		void	error(const std::string& msg) const;
 		void	unexpectedToken(const std::string& expected) const;
 
 	public :
-		Parser(const std::vector<token>& tokens);
+		Parser(Lexer& lexer);
 		~Parser();
 	
 		std::vector<ASTnode*>	parse();
+		void					setBaseDir(const std::string& baseDir);
 	
 		void	cleanupAST(std::vector<ASTnode*>& nodes);
 };
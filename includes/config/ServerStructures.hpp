@@ -19,6 +19,7 @@
 #include <stdexcept>
 
 #include "../http/HttpRequest.hpp"
+#include "../http/LocationMatcher.hpp"
 
 // Enum for log levels.
 enum LogLevel {
@@ -32,15 +33,58 @@ enum LogLevel {
 	DEFAULT_LOG
 };
 
+// Bit of an HttpMethod in EffectiveLocation::allowedMethods.
+# define HTTP_METHOD_BIT(method)	(1u << (method))
+
+// The settings request handling reads for one location (or for a server's requests that match no
+// location), with the fallbacks from location to server already applied. Filled in once by
+// ConfigLoader::resolveEffectiveLocations and read in place afterwards.
+struct EffectiveLocation {
+	std::string					root;				// Document root with a trailing '/', empty if none applies.
+	std::string					uploadStore;		// Upload directory with a trailing '/', empty if none.
+	long						clientMaxBodySize;	// LONG_MAX when unlimited.
+	std::map<int, std::string>	errorPages;
+	std::vector<std::string>	indexFiles;
+	bool						autoindex;
+	std::string					autoindexFormat;	// "html" or "json".
+	unsigned int				allowedMethods;		// HTTP_METHOD_BIT() flags.
+
+	EffectiveLocation() : clientMaxBodySize(0), autoindex(false), autoindexFormat("html"), allowedMethods(0) {}
+
+	bool	allows(HttpMethod method) const { return method != HTTP_UNKNOWN && (allowedMethods & HTTP_METHOD_BIT(method)); }
+};
+
 // Represents the configuration for a single 'location' block.
 struct LocationConfig {
 	std::string							root;				// Root directory for this location.
 	std::vector<HttpMethod>				allowedMethods;		// List of allowed HTTP methods.
 	std::vector<std::string>			indexFiles;			// Default files to serve if URI is a directory.
 	bool								autoindex;			// Enable/disable directory listing.
+	std::string							autoindexFormat;	// Directory listing format ("html" or "json").
 	bool								uploadEnabled;		// Enable/disable file uploads.
 	std::string							uploadStore;		// Directory to store uploaded files.
 	std::map<std::string, std::string>	cgiExecutables;		// Maps file extensions to CGI executable paths.
+	std::string							fastcgiPass;		// FastCGI backend ("unix:/path" or "host:port"), empty if unused.
+	int									cgiPoolSize;		// Pre-forked CGI workers per interpreter (0 = fork per request).
+	long								cgiPoolMaxRequests;	// Requests a worker serves before it is recycled (0 = unlimited).
+	std::string							cgiPoolWorker;		// Worker script run by the CGI interpreter in pool mode.
+	int									cgiMaxConcurrent;	// CGI requests running at once (0 = unlimited).
+	bool								cgiAdaptive;		// Adjust the CGI limit from observed latency (cgiMaxConcurrent is the ceiling).
+	long								cgiQueueSize;		// Requests waiting for a CGI slot before 503 (0 = refuse at once).
+	long								cgiQueueTimeout;	// Seconds a request may wait for a CGI slot.
+	std::string							cgiCacheZone;		// Cache zone for complete CGI responses ('cgi_cache'), empty when off.
+	long								cgiCacheSize;		// Zone size in bytes.
+	long								cgiCacheValid;		// Seconds a cached response is served as fresh.
+	long								cgiCacheStale;		// Seconds past 'valid' it may be served while one request refreshes it.
+	std::string							cgiCacheKey;		// Key template ($uri, $args, $request_uri, $host, $request_method).
+	std::string							proxyPass;			// Upstream requests are forwarded to ('proxy_pass http://name'), empty if unused.
+	std::string							proxyCacheZone;		// Disk cache for proxied and CGI responses ('proxy_cache'), empty when off.
+	long								proxyCacheValid;	// Seconds a response without Cache-Control/Expires is kept (0 = not stored).
+	std::string							proxyCacheKey;		// Key template ($uri, $args, $request_uri, $host, $request_method).
+	// Resolved once when the config is loaded (CGI locations only), so requests skip realpath()/access().
+	std::string							cgiRootPath;		// Absolute root without trailing slash, empty if unresolvable.
+	std::map<std::string, std::string>	cgiResolvedExecutables;	// Extension -> absolute interpreter path, empty if not executable.
+	std::string							cgiEnvPrefix;		// Request-independent meta-variables as "NAME=value\0" entries.
 	int									returnCode;			// HTTP status code for redirection.
 	std::string							returnUrlOrText;	// URL or text for redirection.
 	std::string							path;				// URI path for this location.
@@ -48,9 +92,14 @@ struct LocationConfig {
 	std::vector<LocationConfig>			nestedLocations;	// Nested location blocks.
     std::map<int, std::string>			errorPages;			// Custom error pages for this location.
     long								clientMaxBodySize;	// Maximum allowed size for client request bodies.
+	EffectiveLocation					effective;			// The above with the server fallbacks applied.
 
 	// Constructor to set sensible defaults.
-	LocationConfig() : root(""), autoindex(false), uploadEnabled(false), uploadStore(""),
+	LocationConfig() : root(""), autoindex(false), autoindexFormat("html"), uploadEnabled(false), uploadStore(""),
+					   cgiPoolSize(0), cgiPoolMaxRequests(0), cgiPoolWorker("www/cgi-worker/cgi_worker.py"),
+					   cgiMaxConcurrent(0), cgiAdaptive(false), cgiQueueSize(0), cgiQueueTimeout(10),
+					   cgiCacheSize(0), cgiCacheValid(5), cgiCacheStale(0), cgiCacheKey("$uri$args"),
+					   proxyCacheValid(0), proxyCacheKey("$host$request_uri"),
 					   returnCode(0), path("/"), matchType("") {}
 };
 
@@ -58,6 +107,7 @@ struct LocationConfig {
 struct ServerConfig {
 	std::string					host;				// Host to listen on.
 	int							port;				// Port to listen on.
+	bool						defaultServer;		// 'listen ... default_server': takes the unmatched Host headers of its address.
 	std::vector<std::string>	serverNames;		// List of server names.
 	std::map<int, std::string>	errorPages;			// Custom error pages for this server.
 	long						clientMaxBodySize;	// Maximum allowed size for client request bodies.
@@ -66,12 +116,50 @@ struct ServerConfig {
 	std::string					root;				// Default root directory for this server.
 	std::vector<std::string>	indexFiles;			// Default index files for this server.
 	bool						autoindex;			// Default autoindex setting for this server.
+	std::string					autoindexFormat;	// Default directory listing format for this server.
+	long						keepaliveRequests;	// Maximum requests served on one connection (0 disables keep-alive).
+	long						keepaliveTimeout;	// Seconds an idle keep-alive connection is kept open (0 disables keep-alive).
 	std::vector<LocationConfig>	locations;			// Location blocks within this server.
+	LocationMatcher				locationMatcher;	// 'locations' compiled for lookup, once the config is in place (see Server).
+	EffectiveLocation			effective;			// Settings for requests that match no location.
 
 	// Constructor to set sensible defaults.
-	ServerConfig() : host("0.0.0.0"), port(80), clientMaxBodySize(1048576),
+	ServerConfig() : host("0.0.0.0"), port(80), defaultServer(false), clientMaxBodySize(1048576),
 					 errorLogPath(""), errorLogLevel(DEFAULT_LOG),
-					 root(""), autoindex(false) {}
+					 root(""), autoindex(false), autoindexFormat("html"),
+					 keepaliveRequests(100), keepaliveTimeout(75) {}
+};
+
+// One 'server' entry of an 'upstream' block.
+struct UpstreamServerConfig {
+	std::string	host;
+	int			port;
+	int			weight;		// Share of the requests relative to the other servers of the group.
+
+	UpstreamServerConfig() : port(80), weight(1) {}
+};
+
+// Represents an 'upstream' block: a named group of HTTP backends for 'proxy_pass'. A 'proxy_pass'
+// to a plain "host:port" gets an implicit group of that one server.
+struct UpstreamConfig {
+	std::string							name;
+	std::vector<UpstreamServerConfig>	servers;
+	std::string							balance;	// "round_robin", "least_conn" or "hash".
+	std::string							hashKey;	// Key template for "hash" ($uri, $args, $request_uri, $host, $request_method).
+	int									keepalive;	// Idle connections kept open per server (0 = close after each response).
+
+	UpstreamConfig() : balance("round_robin"), keepalive(8) {}
+};
+
+// Represents a 'proxy_cache_path' directive: an on-disk response cache that locations select by zone name.
+struct CachePathConfig {
+	std::string	path;		// Cache directory; entries live in hashed subdirectories below it.
+	std::vector<int>	levels;		// Hex digits per subdirectory level, taken from the end of the key hash ("1:2").
+	std::string	zone;		// 'keys_zone' name used by 'proxy_cache'.
+	long		maxSize;	// Bytes on disk above which least recently used entries are evicted.
+	long		inactive;	// Seconds an unused entry is kept, fresh or not.
+
+	CachePathConfig() : maxSize(1024L * 1024 * 1024), inactive(600) {}
 };
 
 // Top-level configuration: a list of server blocks.
@@ -43,6 +43,20 @@ typedef enum tokenType {
 	T_UPLOAD_STORE,
 	T_LOCATION,
 	T_ERROR_LOG,
+	T_AUTOINDEX_FORMAT,
+	T_TYPES,
+	T_INCLUDE,
+	T_KEEPALIVE_REQUESTS,
+	T_KEEPALIVE_TIMEOUT,
+	T_FASTCGI_PASS,
+	T_CGI_POOL,
+	T_CGI_MAX_CONCURRENT,
+	T_CGI_QUEUE,
+	T_CGI_CACHE,
+	T_PROXY_PASS,
+	T_UPSTREAM,
+	T_PROXY_CACHE,
+	T_PROXY_CACHE_PATH,
 
 	// Other data/values.
 	T_IDENTIFIER,		// Generic identifier (e.g., variable names, unquoted strings).
@@ -50,12 +64,14 @@ typedef enum tokenType {
 	T_NUMBER			// Numeric value.
 } tokenType;
 
-// Represents a single token extracted by the lexer.
+// Represents a single token extracted by the lexer. The lexer refills the same token for each one
+// (see Lexer::next), so 'value' keeps its storage from token to token.
 typedef struct token {
 	tokenType	type;
 	std::string	value;
 	int			line, column;
 
+	token() : type(T_EOF), line(-1), column(-1) {}
 	token(tokenType type, std::string value, int line, int column)
 		: type(type), value(value), line(line), column(column)
 		{}
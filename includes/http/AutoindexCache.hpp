@@ -0,0 +1,64 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   AutoindexCache.hpp                                 :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: bvieilhe <bvieilhe@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 10:12:44 by bvieilhe          #+#    #+#             */
+/*   Updated: 2026/10/18 10:12:44 by bvieilhe         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef AUTOINDEX_CACHE_HPP
+# define AUTOINDEX_CACHE_HPP
+
+#include <string>
+#include <vector>
+#include <map>
+#include <utility>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+# define AUTOINDEX_CACHE_SLOTS	64		// Maximum number of directory listings kept in memory.
+# define AUTOINDEX_PAGE_SIZE	1000	// Number of entries rendered per autoindex page.
+
+// A single entry of a directory listing.
+struct AutoindexEntry {
+	std::string	name;
+	bool		isDirectory;
+
+	AutoindexEntry() : isDirectory(false) {}
+	AutoindexEntry(const std::string& n, bool dir) : name(n), isDirectory(dir) {}
+};
+
+// Caches sorted directory listings, keyed by directory (device, inode) and validated by mtime.
+class AutoindexCache {
+public:
+	// Returns the sorted listing of a directory, re-reading it only if it changed since last use.
+	// Returns NULL if the directory cannot be opened.
+	static const std::vector<AutoindexEntry>*	getListing(const std::string& directoryPath);
+
+private:
+	typedef std::pair<dev_t, ino_t>	Key;
+
+	struct Listing {
+		time_t						mtime;
+		long						mtimeNsec;
+		unsigned long				lastUsed;
+		std::vector<AutoindexEntry>	entries;
+
+		Listing() : mtime(0), mtimeNsec(0), lastUsed(0) {}
+	};
+
+	static std::map<Key, Listing>	_listings;
+	static unsigned long			_clock;
+
+	static bool	_readDirectory(const std::string& directoryPath, std::vector<AutoindexEntry>& out);
+	static void	_evictOldest();
+	static long	_mtimeNsec(const struct stat& st);
+
+	AutoindexCache();
+};
+
+#endif
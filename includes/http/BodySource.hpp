@@ -0,0 +1,73 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   BodySource.hpp                                     :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: bvieilhe <bvieilhe@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 11:02:17 by bvieilhe          #+#    #+#             */
+/*   Updated: 2026/10/18 11:02:17 by bvieilhe         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef BODY_SOURCE_HPP
+# define BODY_SOURCE_HPP
+
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+// Produces a response body piece by piece, so a connection only holds a bounded window of it.
+class BodySource {
+public:
+	virtual ~BodySource();
+
+	// Appends up to 'max' bytes to 'out'. Returns the number of bytes appended, or -1 on error.
+	virtual ssize_t	readInto(std::string& out, size_t max) = 0;
+	// True once every byte of the body has been produced.
+	virtual bool	isExhausted() const = 0;
+	// Whether sendTo() can write the body to a socket without copying it through user space.
+	virtual bool	canSendDirect() const;
+	// Writes up to 'max' bytes straight to a writable 'socket'. Returns the number of bytes sent, or -1 on error.
+	virtual ssize_t	sendTo(int socket, size_t max);
+};
+
+// Body already held in memory. The bytes are taken over (swapped in), not copied.
+class MemoryBodySource : public BodySource {
+public:
+	explicit MemoryBodySource(std::vector<char>& data);
+
+	ssize_t	readInto(std::string& out, size_t max);
+	bool	isExhausted() const;
+
+private:
+	std::vector<char>	_data;
+	size_t				_offset;
+
+	MemoryBodySource(const MemoryBodySource&);
+	MemoryBodySource& operator=(const MemoryBodySource&);
+};
+
+// A byte range of a file on disk, read only as the socket drains.
+class FileBodySource : public BodySource {
+public:
+	FileBodySource(const std::string& path, off_t offset, off_t length);
+	FileBodySource(int fd, off_t offset, off_t length);	// Takes over 'fd'.
+	~FileBodySource();
+
+	bool	isOpen() const;
+	ssize_t	readInto(std::string& out, size_t max);
+	bool	isExhausted() const;
+	bool	canSendDirect() const;
+	ssize_t	sendTo(int socket, size_t max);
+
+private:
+	int		_fd;
+	off_t	_offset;
+	off_t	_remaining;
+
+	FileBodySource(const FileBodySource&);
+	FileBodySource& operator=(const FileBodySource&);
+};
+
+#endif
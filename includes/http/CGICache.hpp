@@ -0,0 +1,98 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   CGICache.hpp                                       :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: bvieilhe <bvieilhe@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 09:52:10 by bvieilhe          #+#    #+#             */
+/*   Updated: 2026/10/18 09:52:10 by bvieilhe         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef CGICACHE_HPP
+# define CGICACHE_HPP
+
+#include <string>
+#include <list>
+#include <map>
+#include <set>
+#include <vector>
+#include <ctime>
+#include <cstddef>
+
+#include "HttpResponse.hpp"
+
+# define CGI_CACHE_MAX_PASS_KEYS 1024	// Pass entries kept before the expired ones are swept.
+
+struct LocationConfig;
+struct ServerConfig;
+class HttpRequest;
+
+// Microcache of complete CGI responses ('cgi_cache'). Entries live in named zones, shared by every
+// location naming the zone, bounded in bytes and evicted least recently used first.
+//
+// A lookup that finds nothing usable makes the request the key's filler: other requests missing the
+// same key meanwhile wait for its result (request collapsing) rather than run the script as well.
+// Once an entry is older than 'valid' it may still be served for 'stale' more seconds, but only to
+// requests arriving while one request is refreshing it. When the filler's response can't be stored
+// (Set-Cookie, no-store, an error status...), the key's requests run uncached for the next 'valid'
+// seconds (hit-for-pass), the waiting ones included, instead of filling it one after another.
+class CGICache {
+public:
+	enum Status {
+		HIT,		// Fresh entry copied into the response.
+		STALE,		// Expired entry copied into the response while another request refreshes it.
+		MISS,		// Nothing usable: the caller is now the filler and must store() or abandon().
+		FILLING,	// Another request is filling the key: wait and look again.
+		PASS		// The key's last response could not be stored: run the script uncached.
+	};
+
+	// Returns the zone used by this location, creating it on first use. NULL when caching is off.
+	static CGICache*	forLocation(const LocationConfig* location);
+	// Brings the zones already created in line with a (re)loaded configuration.
+	static void			configure(const std::vector<ServerConfig>& servers);
+
+	// Expands a 'key=' template ($uri, $args, $request_uri, $host, $request_method).
+	static std::string	buildKey(const std::string& keyTemplate, const HttpRequest& request);
+	// Returns the first unknown variable of a key template, or an empty string when all are known.
+	static std::string	unknownKeyVariable(const std::string& keyTemplate);
+	// Tells whether a complete CGI response may be stored (status and cache-related headers).
+	static bool			isCacheable(const HttpResponse& response);
+
+	Status	lookup(const std::string& key, long valid, long stale, HttpResponse& response);
+	void	store(const std::string& key, const HttpResponse& response);
+	void	abandon(const std::string& key);
+	void	pass(const std::string& key, long seconds);
+
+	// Largest body worth buffering for the cache; bigger responses are streamed uncached.
+	size_t	maxEntrySize() const;
+
+private:
+	struct Entry {
+		std::string		key;
+		HttpResponse	response;
+		time_t			storedAt;
+		size_t			bytes;
+	};
+	typedef std::list<Entry>	EntryList;
+
+	size_t									_maxBytes;
+	size_t									_bytes;
+	EntryList								_entries;	// Most recently used first.
+	std::map<std::string, EntryList::iterator>	_index;
+	std::set<std::string>					_filling;	// Keys with a request running the script for them.
+	std::map<std::string, time_t>			_passUntil;	// Keys whose requests run uncached until then.
+
+	static std::map<std::string, CGICache*>	_zones;
+
+	CGICache(size_t maxBytes);
+	CGICache(const CGICache&);
+	CGICache& operator=(const CGICache&);
+
+	void	_copyEntry(const Entry& entry, const char* status, HttpResponse& response) const;
+	void	_erase(EntryList::iterator it);
+	void	_resize(size_t maxBytes);
+};
+
+#endif
@@ -19,17 +19,24 @@
 #include <sstream>
 #include <algorithm>
 #include <cstdio>
+#include <sys/time.h>
+#include <sys/resource.h>
 
 #include "HttpRequest.hpp"
 #include "HttpResponse.hpp"
 #include "../config/ServerStructures.hpp"
 #include "HttpExceptions.hpp"
+#include "FastCGI.hpp"
+#include "CGIWorkerPool.hpp"
+#include "CGILimiter.hpp"
 
 class Server;
 
 namespace CGIState {
 	enum Type {
 		NOT_STARTED,
+		QUEUED,				// Waiting for a pooled worker to become free.
+		SPOOLING_INPUT,		// Collecting a large request body into a memfd; the script starts once it is complete.
 		FORK_FAILED,
 		WRITING_INPUT,
 		READING_OUTPUT,
@@ -57,6 +64,10 @@ public:
 	void				pollCGIProcess();
 	int					getReadFd() const;
 	int					getWriteFd() const;
+	int					getProcessFd() const;
+	short				getReadEvents() const;
+	int					getErrorStatus() const;
+	long				getRetryAfter() const;
 	CGIState::Type		getState() const;
 	void				setState(CGIState::Type newState);
 	bool				isFinished() const;
@@ -66,7 +77,22 @@ public:
 	void				setStartTime();
 	bool				checkTimeout() const;
 
+	// Incremental output access, used to stream the body before the script exits.
+	bool				hasParsedHeaders() const;
+	bool				isOutputComplete() const;
+	std::vector<char>&	getBodyBuffer();
+	void				setStreaming();
+	void				setOutputPaused(bool paused);
+
+	// Request body input, fed while the body is still arriving from the client.
+	void				setStreamingInput();
+	void				appendInput(const char* data, size_t len);
+	void				endInput();
+	size_t				getPendingInputSize() const;
+
 	void cleanup();
+	void abort();
+	static unsigned long	getAbortedCount();
 
 private:
 	const HttpRequest&		_request;
@@ -77,6 +103,8 @@ private:
 	std::string			_cgi_script_path;
 	std::string			_cgi_executable_path;
 	pid_t				_cgi_pid;
+	int					_pidfd;			// pidfd of the spawned script, readable once it exits (-1 if unsupported).
+	struct timeval		_spawn_time;	// When the script was spawned, for the per-request resource report.
 	int					_fd_stdin[2];
 	int					_fd_stdout[2];
 	std::vector<char>	_cgi_response_buffer;
@@ -86,17 +114,62 @@ private:
 	int					_cgi_exit_status;
 	time_t				_cgi_start_time;
 	bool				_cgi_stdout_eof_received;
+	bool				_cgi_exited;	// The child was reaped (its stdout may still hold unread output).
+	bool				_streaming;		// Body bytes are drained by the Connection instead of buffered into the response.
+	bool				_output_paused;	// Stdout is not polled (client backpressure); the timeout is suspended meanwhile.
+
+	// Request body bytes not yet handed to the script. With streaming input they are appended as the
+	// client sends them; otherwise the whole body is copied in up front and the input is complete.
+	std::vector<char>			_input_buffer;
+	size_t						_input_sent;
+	bool						_input_complete;	// No more body bytes will be appended.
+	bool						_input_closed;		// Stdin was closed (all sent, or the script stopped reading).
+	bool						_input_suspended;	// The stdin fd is out of the poll set until more input arrives.
+	bool						_input_end_encoded;	// FastCGI: the empty STDIN record is queued.
+
+	// FastCGI mode ('fastcgi_pass'): _fd_stdout[0] holds the backend socket, used for both directions.
+	// Pool mode ('cgi_pool') speaks the same records to a warm worker over its stdin/stdout pipes.
+	bool						_fastcgi;
+	CGIWorkerPool*				_worker_pool;
+	CGIWorker*					_worker;			// Worker serving this request, NULL when none is held.
+	std::string					_fcgi_out;			// Encoded BEGIN_REQUEST, PARAMS and STDIN records.
+	size_t						_fcgi_out_sent;
+	FastCGI::RecordDecoder		_fcgi_decoder;
+	int							_error_status;		// Status reported when the handler fails (502 for a broken backend).
+
+	// Concurrency limit of the location ('cgi_max_concurrent'), NULL when unlimited.
+	CGILimiter*					_limiter;
+	bool						_holds_slot;
+	bool						_queued_for_slot;
+	struct timeval				_slot_since;
 
-	const std::vector<char>*	_request_body_ptr;
-	size_t						_request_body_sent_bytes;
+	static unsigned long		_aborted_count;	// Requests aborted on client disconnect, since startup.
 
 	bool	_setNonBlocking(int fd);
-	char**	_createCGIEnvironment() const;
-	char**	_createCGIArguments() const;
-	void	_freeCGICharArrays(char** arr) const;
+	int		_createInputMemfd();
+	bool	_spoolInput();
+	long	_announcedLength() const;
+	void	_buildCGIEnvironment(std::string& env) const;
 	void	_closePipes();
+	void	_closeProcessFd();
+	bool	_stdoutHasWriters() const;
+	void	_logResourceUsage(int status, const struct rusage& usage) const;
 	void	_parseCGIOutput();
+	bool	_parseCGIHeaders();
 	bool	_initializeCGIPaths();
+	bool	_startFastCGI();
+	bool	_startPooledWorker();
+	void	_encodeFastCGIRequest();
+	void	_finishFastCGI();
+	void	_readFastCGI();
+	void	_writeFastCGI();
+	void	_failFastCGI(const std::string& reason);
+	void	_encodeFastCGIInput();
+	void	_wakeInputWriter();
+	void	_onInputDrained();
+	void	_closeInput();
+	bool	_acquireSlot();
+	void	_releaseSlot();
 };
 
 #endif
\ No newline at end of file
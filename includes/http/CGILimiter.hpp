@@ -0,0 +1,75 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   CGILimiter.hpp                                     :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: bvieilhe <bvieilhe@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 15:42:10 by bvieilhe          #+#    #+#             */
+/*   Updated: 2026/10/18 15:42:10 by bvieilhe         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef CGILIMITER_HPP
+# define CGILIMITER_HPP
+
+#include <map>
+#include <vector>
+#include <cstddef>
+
+struct LocationConfig;
+
+// Caps the CGI requests running at once for one location ('cgi_max_concurrent'), with a bounded
+// wait queue in front of it ('cgi_queue'). Requests over the limit are queued by the caller and
+// retried as slots are released; once the queue is full they are refused (503).
+//
+// In adaptive mode the configured limit is a ceiling and the effective limit follows observed
+// latency, AIMD style. It starts at one slot, so the latency baseline is taken uncontended, and
+// grows by one slot per 'limit' completions while latency stays within
+// twice the best recent latency, and shrinks by 10% (at most once per 'limit' completions) when
+// latency rises past that or a request fails or times out.
+class CGILimiter {
+public:
+	// Returns the limiter for this location, creating it on first use. NULL when the location is unlimited.
+	static CGILimiter*	forLocation(const LocationConfig* location);
+	// Frees the limiters of these locations (nested ones included), once their configuration is dropped.
+	static void			forget(const std::vector<LocationConfig>& locations);
+
+	// Takes a slot if one is free. A newcomer ('waiting' false) may not overtake queued requests.
+	bool	tryAcquire(bool waiting);
+	// Gives a slot back. 'seconds' is how long it was held; a negative value (request abandoned
+	// by the client) does not feed the adaptive limit.
+	void	release(double seconds, bool timedOut);
+
+	// Reserves a queue position. False when the queue is full.
+	bool	enqueue();
+	void	dequeue();
+
+	long	getQueueTimeout() const;
+
+private:
+	CGILimiter(const LocationConfig& location);
+	CGILimiter(const CGILimiter&);
+	CGILimiter& operator=(const CGILimiter&);
+
+	size_t	_maxConcurrent;		// Configured limit (ceiling in adaptive mode).
+	bool	_adaptive;
+	double	_limit;				// Effective limit.
+	size_t	_inFlight;
+	size_t	_queueMax;
+	size_t	_queued;
+	long	_queueTimeout;		// Seconds a request may wait for a slot.
+
+	// Latency baseline: the best latency over the current and the previous window of samples,
+	// so it can rise again when the workload itself gets slower.
+	double	_windowBest;
+	double	_previousBest;
+	size_t	_windowSamples;
+	size_t	_samplesSinceDecrease;
+
+	static std::map<const LocationConfig*, CGILimiter*>	_limiters;
+
+	void	_adapt(double seconds, bool succeeded);
+};
+
+#endif
@@ -0,0 +1,66 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   CGIWorkerPool.hpp                                  :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: bvieilhe <bvieilhe@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 13:05:27 by bvieilhe          #+#    #+#             */
+/*   Updated: 2026/10/18 13:05:27 by bvieilhe         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef CGIWORKERPOOL_HPP
+# define CGIWORKERPOOL_HPP
+
+#include <string>
+#include <vector>
+#include <map>
+#include <sys/types.h>
+
+// A warm interpreter process. It speaks the FastCGI record protocol over its stdin/stdout pipes
+// and runs one CGI script per request, in-process.
+struct CGIWorker {
+	pid_t	pid;
+	int		stdinFd;			// Parent's write end (non-blocking).
+	int		stdoutFd;			// Parent's read end (non-blocking).
+	long	requestsServed;
+};
+
+// Pre-forked workers for one interpreter/worker-script pair ('cgi_pool' directive).
+// Workers are spawned lazily up to 'size'; when all are busy, acquire() reports saturation and the
+// caller queues the request. A worker is recycled after 'max_requests' requests or when it fails.
+class CGIWorkerPool {
+public:
+	// Returns the pool for this interpreter and worker script, creating it on first use.
+	static CGIWorkerPool*	forInterpreter(const std::string& executable, const std::string& workerScript,
+										   int size, long maxRequests);
+
+	// Hands out an idle (or freshly spawned) worker. NULL with 'saturated' set when all workers are busy,
+	// NULL with 'saturated' clear when a worker could not be spawned.
+	CGIWorker*	acquire(bool& saturated);
+	// Returns a worker whose request completed cleanly; it is retired if it reached 'max_requests'.
+	void		release(CGIWorker* worker);
+	// Kills a worker left in an unknown state (crash, timeout, aborted request).
+	void		discard(CGIWorker* worker);
+
+private:
+	CGIWorkerPool(const std::string& executable, const std::string& workerScript, int size, long maxRequests);
+	CGIWorkerPool(const CGIWorkerPool&);
+	CGIWorkerPool& operator=(const CGIWorkerPool&);
+
+	std::string					_executable;
+	std::string					_workerScript;
+	int							_size;
+	long						_maxRequests;
+	std::vector<CGIWorker*>		_idle;
+	int							_busy;
+
+	static std::map<std::string, CGIWorkerPool*>	_pools;
+
+	CGIWorker*	_spawn();
+	bool		_isAlive(CGIWorker* worker) const;
+	void		_terminate(CGIWorker* worker);
+};
+
+#endif
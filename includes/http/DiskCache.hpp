@@ -0,0 +1,111 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   DiskCache.hpp                                      :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: bvieilhe <bvieilhe@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 15:12:40 by bvieilhe          #+#    #+#             */
+/*   Updated: 2026/10/18 15:12:40 by bvieilhe         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef DISKCACHE_HPP
+# define DISKCACHE_HPP
+
+#include <string>
+#include <list>
+#include <map>
+#include <vector>
+#include <ctime>
+#include <cstddef>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "HttpResponse.hpp"
+#include "../config/ServerStructures.hpp"
+
+# define DISK_CACHE_MANAGER_FILES	100		// Cache files the manager removes per zone and pass, so a sweep never stalls the loop.
+# define DISK_CACHE_MAX_HEADER_SIZE	65536	// Largest metadata and header section read back from a cache file.
+
+// On-disk cache of proxied and CGI responses ('proxy_cache_path' zones, selected with 'proxy_cache').
+// Each response is a file named by the hash of its key, below 'levels' of hashed subdirectories:
+// a metadata line and the key, the status line and headers, then the body as sent. Only a compact
+// index (key, expiry, size, file) is held in memory; it is rebuilt from the files at startup.
+//
+// A hit is answered straight from the file (its body goes out with sendfile()). A miss streams the
+// response to a temporary file as it is forwarded to the client, renamed into place once complete.
+// The cache manager, run from the server loop, removes entries unused for 'inactive' and, while the
+// zone is over 'max_size', the least recently used ones.
+class DiskCache {
+public:
+	// A response being written to the cache while it is sent.
+	struct Fill {
+		int			fd;
+		std::string	tempPath;
+		std::string	key;
+		time_t		stored;
+		time_t		expires;
+		off_t		headerBytes;
+		off_t		bodyBytes;
+		bool		failed;		// A write failed or the body outgrew the zone: abandoned at the end.
+	};
+
+	// Creates the zones and their directories and loads the entries already on disk. Called at startup
+	// and on each reload, where zones already loaded are kept as they are (new settings for an existing
+	// zone name take a restart). Throws std::runtime_error if a cache directory is unusable.
+	static void			configure(const std::vector<CachePathConfig>& configs);
+	// Returns the zone used by this location, NULL when 'proxy_cache' is off.
+	static DiskCache*	forLocation(const LocationConfig* location);
+	// Cache manager pass over every zone; does nothing if one already ran this second.
+	static void			runManager(time_t now);
+	// Seconds a response may be stored: Cache-Control (s-maxage, max-age) or Expires when present,
+	// else 'valid'. 0 when it must not be stored.
+	static long			freshness(const HttpResponse& response, long valid);
+
+	// Fills 'response' from a fresh entry (the body as a file range). Returns false on a miss.
+	bool	lookup(const std::string& key, HttpResponse& response);
+
+	// Starts storing 'response' (status and headers) under 'key'. NULL when it is not cacheable.
+	Fill*	beginFill(const std::string& key, const HttpResponse& response, long valid);
+	void	append(Fill* fill, const char* data, size_t len);
+	// Publishes a complete response: the temporary file replaces any previous entry for the key.
+	void	commit(Fill* fill);
+	// Drops an unfinished response (upstream or script failed, client gone).
+	void	abandon(Fill* fill);
+
+private:
+	struct Entry {
+		std::string	key;
+		std::string	name;		// Hash of the key, in hex: the file name.
+		time_t		stored;
+		time_t		expires;
+		time_t		lastUsed;
+		off_t		bodyOffset;	// Bytes of metadata and headers before the body.
+		off_t		size;		// Whole file.
+	};
+	typedef std::list<Entry>	EntryList;
+
+	CachePathConfig								_config;
+	off_t										_bytes;		// Size of all indexed files.
+	EntryList									_entries;	// Most recently used first.
+	std::map<std::string, EntryList::iterator>	_index;
+	unsigned long								_fillCount;	// Makes temporary file names unique.
+
+	static std::map<std::string, DiskCache*>	_zones;
+	static time_t								_lastManagerRun;
+
+	DiskCache(const CachePathConfig& config);
+	DiskCache(const DiskCache&);
+	DiskCache& operator=(const DiskCache&);
+
+	static std::string	_hashName(const std::string& key);
+
+	std::string	_pathFor(const std::string& name, bool create) const;
+	void		_load(const std::string& dir, int depth, std::vector<Entry>& found);
+	bool		_readHeader(int fd, std::string& header, struct stat& st) const;
+	void		_sweep(time_t now);
+	void		_erase(EntryList::iterator it, bool removeFile);
+};
+
+#endif
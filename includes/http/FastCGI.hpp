@@ -0,0 +1,86 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   FastCGI.hpp                                        :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: bvieilhe <bvieilhe@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 11:38:52 by bvieilhe          #+#    #+#             */
+/*   Updated: 2026/10/18 11:38:52 by bvieilhe         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef FASTCGI_HPP
+# define FASTCGI_HPP
+
+#include <string>
+#include <vector>
+#include <map>
+#include <sys/socket.h>
+
+# define FCGI_MAX_CONTENT_LEN		65535	// Largest content length a single record can carry.
+# define FCGI_MAX_IDLE_PER_BACKEND	8		// Idle keep-alive connections kept per backend address.
+
+// FastCGI 1.0 wire protocol: record encoding and decoding (non-blocking friendly, no I/O here).
+namespace FastCGI {
+	enum RecordType {
+		BEGIN_REQUEST = 1,
+		ABORT_REQUEST = 2,
+		END_REQUEST = 3,
+		PARAMS = 4,
+		STDIN = 5,
+		STDOUT = 6,
+		STDERR = 7
+	};
+
+	// A decoded record. Padding is already stripped.
+	struct Record {
+		unsigned char	type;
+		unsigned short	requestId;
+		std::string		content;
+	};
+
+	void	appendBeginRequest(std::string& out, unsigned short requestId, bool keepConn);
+	void	appendParam(std::string& params, const std::string& name, const std::string& value);
+	// Appends 'data' as one or more records of 'type'. An empty 'data' emits the empty end-of-stream record.
+	void	appendStream(std::string& out, unsigned char type, unsigned short requestId, const char* data, size_t len);
+
+	// Reassembles records from bytes arriving in arbitrary pieces.
+	class RecordDecoder {
+	public:
+		RecordDecoder();
+
+		void	feed(const char* data, size_t len);
+		bool	next(Record& record);	// Pops the next complete record, if any.
+		bool	hasPartialRecord() const;
+
+	private:
+		std::string	_buffer;
+		size_t		_offset;
+	};
+
+	// Parses "unix:/path" or "host:port" into a socket address. Returns false on a malformed address.
+	bool	parseAddress(const std::string& address, struct sockaddr_storage& addr, socklen_t& addrLen);
+	// Starts connecting a non-blocking, close-on-exec socket to 'addr'. Returns -1 (errno set) on failure.
+	// The socket helpers are shared with the 'proxy_pass' upstream pools.
+	int		connectNonBlocking(const struct sockaddr_storage& addr, socklen_t addrLen);
+	// Whether an idle pooled connection can carry another request.
+	bool	isIdleAlive(int fd);
+}
+
+// Keep-alive connections to FastCGI backends, shared by all requests. A connection carries one
+// request at a time; concurrent requests to the same backend use separate pooled connections.
+class FastCGIPool {
+public:
+	// Returns a connected (or connecting) non-blocking socket, reusing an idle one when possible. -1 on failure.
+	static int	acquire(const std::string& address, bool& reused);
+	// Hands a connection whose request completed cleanly back to the pool (or closes it if the pool is full).
+	static void	release(const std::string& address, int fd);
+
+private:
+	static std::map<std::string, std::vector<int> >	_idle;
+
+	static int	_connect(const std::string& address);
+};
+
+#endif
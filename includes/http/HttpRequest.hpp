@@ -43,6 +43,7 @@ public:
 	std::map<std::string, std::string>	headers;
 	std::vector<char>					body;
 	size_t								expectedBodyLength;
+	bool								chunked;	// Body sent with 'Transfer-Encoding: chunked' (length unknown).
 
 	// Parsing State.
 	typedef enum ParsingState {
@@ -56,6 +57,7 @@ public:
 
 	HttpRequest();
 	std::string	getHeader(const std::string& name) const;
+	bool		wantsKeepAlive() const;
 	void		print() const;
 };
 
@@ -8,6 +8,7 @@
 #include "../config/ServerStructures.hpp"
 #include "CGIHandler.hpp"
 #include "HttpExceptions.hpp"
+#include "AutoindexCache.hpp"
 
 #include <string>
 #include <vector>
@@ -44,12 +45,9 @@ private:
 	HttpResponse						_handleDelete(const HttpRequest& request,
 													const ServerConfig* serverConfig,
 													const LocationConfig* locationConfig);
-	std::string							_generateAutoindexPage(const std::string& directoryPath, const std::string& uriPath) const;
-	std::string							_getEffectiveRoot(const ServerConfig* server, const LocationConfig* location) const;
-	const std::map<int, std::string>&	_getEffectiveErrorPages(const ServerConfig* server, const LocationConfig* location) const;
-	std::string							_getEffectiveUploadStore(const ServerConfig* server, const LocationConfig* location) const;
-	long								_getEffectiveClientMaxBodySize(const ServerConfig* server, const LocationConfig* location) const;
-	std::string							_getMimeType(const std::string& filePath) const;
+	std::string							_generateAutoindexPage(const std::string& directoryPath, const HttpRequest& request,
+																const std::string& format) const;
+	static const EffectiveLocation&		_effective(const ServerConfig* server, const LocationConfig* location);
 	bool								_isRegularFile(const std::string& path) const;
 	bool								_isDirectory(const std::string& path) const;
 	bool								_fileExists(const std::string& path) const;
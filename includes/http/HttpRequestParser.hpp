@@ -24,12 +24,24 @@ const std::string DOUBLE_CRLF = "\r\n\r\n";
 // Parses raw HTTP request data into an HttpRequest object.
 class HttpRequestParser {
 private:
+	// Position inside a chunked body.
+	enum ChunkState {
+		CHUNK_SIZE,			// Expecting a "<hex-size>[;ext]" line.
+		CHUNK_DATA,			// Copying chunk data.
+		CHUNK_DATA_END,		// Expecting the CRLF closing a chunk.
+		CHUNK_TRAILER		// After the last chunk: trailer lines up to an empty line.
+	};
+
 	HttpRequest			_request;
 	std::vector<char>	_buffer;
+	size_t				_bodyReceived;		// Body bytes decoded so far (including drained ones).
+	ChunkState			_chunkState;
+	size_t				_chunkRemaining;
 
 	void	parseRequestLine();
 	void	parseHeaders();
 	void	parseBody();
+	void	parseChunkedBody();
 	void	decomposeURI();
 
 	size_t	findInVector(const std::string& pattern);
@@ -46,6 +58,14 @@ public:
 
 	bool	isComplete() const;
 	bool	hasError() const;
+	bool	isIdle() const;
+	bool	hasHeaders() const;
+	bool	expectsBody() const;
+	size_t	getBodyReceived() const;
+
+	// Moves the body bytes decoded so far into 'out' (replacing its content), so the body can be
+	// forwarded while it is still arriving instead of accumulating in the request.
+	void	drainBody(std::vector<char>& out);
 
 	HttpRequest&		getRequest();
 	const HttpRequest&	getRequest() const;
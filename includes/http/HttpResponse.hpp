@@ -18,22 +18,41 @@
 #include <map>
 #include <sstream>
 #include <ctime>
+#include <sys/types.h>
+
+#include "BodySource.hpp"
 
 std::string getHttpStatusMessage(int statusCode);
-std::string getMimeType(const std::string& filePath);
+const std::string& getMimeType(const std::string& filePath);
 
 // Represents an HTTP response to be sent back to a client.
 class HttpResponse {
 public:
 	HttpResponse();
+	HttpResponse(const HttpResponse& other);
+	HttpResponse& operator=(const HttpResponse& other);
 	~HttpResponse();
 
 	void	setStatus(int code);
+	void	setStatus(int code, const std::string& message);
 	void	addHeader(const std::string& name, const std::string& value);
+	void	appendHeader(const std::string& name, const std::string& value);
+	void	omitDefaultContentType();
 	void	setBody(const std::string& content);
 	void	setBody(const std::vector<char>& content);
+	void	takeBody(std::vector<char>& content);
+	void	setBodyFile(const std::string& path, off_t offset, off_t length);
+	void	setBodyFd(int fd, off_t offset, off_t length);
+	void	setChunked();
+
+	BodySource*	releaseBodySource();
 
 	std::string	toString() const;
+	std::string	headersToString() const;
+
+	// Chunked transfer-coding helpers (RFC 9112, section 7.1).
+	static void	appendChunk(std::string& out, const char* data, size_t len);
+	static void	appendLastChunk(std::string& out);
 
 	// Getters for Response Components.
 	int	getStatusCode() const { return _statusCode; }
@@ -41,13 +60,23 @@ public:
 	const std::string&	getProtocolVersion() const { return _protocolVersion; }
 	const std::map<std::string, std::string>&	getHeaders() const { return _headers; }
 	const std::vector<char>&	getBody() const { return _body; }
+	bool	isChunked() const { return _chunked; }
+	bool	hasFileBody() const { return !_bodyFilePath.empty() || _bodyFileFd != -1; }
+	bool	hasHeader(const std::string& name) const { return _headers.find(name) != _headers.end(); }
 
 private:
 	std::string							_protocolVersion;	// e.g., "HTTP/1.1".
 	int									_statusCode;		// e.g., 200, 404.
 	std::string							_statusMessage;		// e.g., "OK", "Not Found".
 	std::map<std::string, std::string>	_headers;			// Header names are typically canonical.
+	std::vector<std::pair<std::string, std::string> >	_repeatedHeaders;	// Further lines of a field already in _headers (Set-Cookie).
+	bool								_defaultContentType;	// Send application/octet-stream when no Content-Type is set.
 	std::vector<char>					_body;				// Use std::vector<char> for the body to handle binary data safely.
+	bool								_chunked;			// Body is sent with 'Transfer-Encoding: chunked' instead of Content-Length.
+	std::string							_bodyFilePath;		// When set, the body is this file range instead of _body.
+	int									_bodyFileFd;		// Or a range of this open file, owned (copies dup it).
+	off_t								_bodyFileOffset;
+	off_t								_bodyFileLength;
 
 	std::string	getCurrentGmTime() const;
 	void		setDefaultHeaders();
@@ -0,0 +1,73 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   LocationMatcher.hpp                                :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: bvieilhe <bvieilhe@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 16:03:11 by bvieilhe          #+#    #+#             */
+/*   Updated: 2026/10/18 16:03:11 by bvieilhe         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef LOCATION_MATCHER_HPP
+# define LOCATION_MATCHER_HPP
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <regex.h>
+
+struct LocationConfig;
+
+// Selects the location block for a request path, with nginx's precedence:
+//   1. an exact match ('location = /path') wins at once;
+//   2. otherwise the longest prefix ('location /path' or 'location ^~ /path') is remembered;
+//   3. unless that prefix is '^~', regex locations ('~', '~*') are tried in config order, first match wins;
+//   4. failing that, the longest prefix is used.
+// Nested locations take part like top-level ones (their paths extend their parent's).
+//
+// Exact and prefix paths are compiled into a radix trie, so a lookup walks at most the length of the
+// path whatever the number of locations. The compiled data points into the locations it was built
+// from: a copy starts empty and must be compiled again where the configuration finally lives.
+class LocationMatcher {
+public:
+	LocationMatcher();
+	LocationMatcher(const LocationMatcher& other);
+	LocationMatcher& operator=(const LocationMatcher& other);
+	~LocationMatcher();
+
+	// Builds the trie and regex list for 'locations' and their nested blocks, replacing any previous one.
+	// The first of several locations with the same path and kind is kept.
+	void	compile(const std::vector<LocationConfig>& locations);
+	bool	isCompiled() const;
+
+	// Returns the location serving 'path', NULL when none matches.
+	const LocationConfig*	match(const std::string& path) const;
+
+	// Compiles a regex location path, for validation at config load. Returns the regcomp() error
+	// message, or an empty string if the pattern is valid.
+	static std::string	checkRegex(const std::string& pattern, bool ignoreCase);
+
+private:
+	struct Node {
+		std::string								label;		// Bytes on the edge from the parent.
+		std::vector<std::pair<char, size_t> >	children;	// First label byte -> node, sorted.
+		const LocationConfig*					prefix;		// Prefix location ending here, if any.
+		bool									stop;		// 'prefix' is '^~': no regex search after it.
+		const LocationConfig*					exact;		// '=' location ending here, if any.
+
+		Node() : prefix(NULL), stop(false), exact(NULL) {}
+	};
+
+	std::vector<Node>											_nodes;		// _nodes[0] is the root (empty label).
+	std::vector<std::pair<regex_t*, const LocationConfig*> >	_regexes;	// In config order.
+	bool														_compiled;
+
+	void	_clear();
+	void	_add(const std::vector<LocationConfig>& locations);
+	void	_insert(const std::string& path, const LocationConfig* location);
+	size_t	_child(size_t node, char c) const;
+};
+
+#endif
@@ -0,0 +1,59 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   MimeTypes.hpp                                      :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: bvieilhe <bvieilhe@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 11:02:15 by bvieilhe          #+#    #+#             */
+/*   Updated: 2026/10/18 11:02:15 by bvieilhe         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef MIME_TYPES_HPP
+# define MIME_TYPES_HPP
+
+#include <string>
+#include <vector>
+#include <map>
+
+# define MIME_MAX_EXTENSION_LEN	32	// Longer extensions are never looked up.
+
+// Extension -> MIME type registry compiled into an open-addressing hash table.
+// Built once at startup (from the built-in list or the config 'types' blocks), then read-only.
+class MimeTypes {
+public:
+	static MimeTypes&	instance();
+
+	// Replaces the registry content with the given extension -> type map (extensions without the dot).
+	void				load(const std::map<std::string, std::string>& types);
+	// Replaces the registry content with the built-in list (a configuration without 'types' blocks).
+	void				loadDefaults();
+
+	// Returns the MIME type for a file path, or the default type if its extension is unknown.
+	const std::string&	lookup(const std::string& filePath) const;
+	size_t				size() const;
+
+private:
+	struct Slot {
+		unsigned int	hash;
+		bool			used;
+		std::string		extension;
+		std::string		type;
+
+		Slot() : hash(0), used(false) {}
+	};
+
+	std::vector<Slot>	_slots;		// Capacity is a power of two, kept at most half full.
+	size_t				_count;
+	std::string			_defaultType;
+
+	MimeTypes();
+	MimeTypes(const MimeTypes& other);
+	MimeTypes& operator=(const MimeTypes& other);
+
+	static unsigned int	_hash(const char* key, size_t len);
+	void				_insert(const std::string& extension, const std::string& type);
+};
+
+#endif
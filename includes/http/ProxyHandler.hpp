@@ -0,0 +1,117 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   ProxyHandler.hpp                                   :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: bvieilhe <bvieilhe@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 17:31:09 by bvieilhe          #+#    #+#             */
+/*   Updated: 2026/10/18 17:31:09 by bvieilhe         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef PROXYHANDLER_HPP
+# define PROXYHANDLER_HPP
+
+#include <string>
+#include <vector>
+#include <ctime>
+
+#include "HttpRequest.hpp"
+#include "HttpResponse.hpp"
+#include "Upstream.hpp"
+#include "../config/ServerStructures.hpp"
+
+class Server;
+class Connection;
+
+namespace ProxyState {
+	enum Type {
+		SENDING,			// Connecting to the upstream server and sending the request.
+		READING_HEADERS,
+		READING_BODY,
+		COMPLETE,
+		TIMEOUT,
+		FAILED
+	};
+}
+
+// Forwards one request to a 'proxy_pass' upstream over a non-blocking socket, polled by the Server
+// next to client and CGI fds. The response headers are parsed as soon as they are in; body bytes are
+// de-framed (Content-Length, chunked or until close) into a buffer the Connection drains as they arrive.
+// A connection whose response ended cleanly goes back to the upstream's keep-alive pool.
+class ProxyHandler {
+public:
+	ProxyHandler(const HttpRequest& request, const LocationConfig* location, Server* server, Connection* owner);
+	~ProxyHandler();
+
+	// Picks a server and registers the socket with the Server. False when none could be reached.
+	bool				start();
+	void				handleEvent(short revents);
+	int					getFd() const;
+	ProxyState::Type	getState() const;
+	bool				isFinished() const;
+	int					getErrorStatus() const;
+
+	// Incremental response access, used to stream the body as it arrives.
+	bool				hasParsedHeaders() const;
+	const HttpResponse&	getHttpResponse() const;
+	std::vector<char>&	getBodyBuffer();
+	void				setOutputPaused(bool paused);
+
+	bool				checkTimeout() const;
+	void				setTimeout();
+	void				cleanup();
+
+private:
+	enum Framing {
+		FRAMING_NONE,			// No body (HEAD request, 204, 304).
+		FRAMING_LENGTH,
+		FRAMING_CHUNKED,
+		FRAMING_UNTIL_CLOSE
+	};
+	enum ChunkState {
+		CHUNK_SIZE,
+		CHUNK_DATA,
+		CHUNK_DATA_END,
+		CHUNK_TRAILER
+	};
+
+	const HttpRequest&		_request;
+	const LocationConfig*	_location;
+	Server*					_server;
+	Connection*				_owner;
+	Upstream*				_upstream;
+	size_t					_peer;			// Upstream server of the current attempt.
+	int						_fd;
+	bool					_reused;		// The socket came from the keep-alive pool.
+	size_t					_attempts;
+	ProxyState::Type		_state;
+	int						_errorStatus;
+	time_t					_lastActivity;	// The timeout counts from the last byte exchanged.
+	bool					_outputPaused;	// Not polled while the client is slower (the timeout is suspended meanwhile).
+
+	std::string				_out;			// Encoded request.
+	size_t					_outSent;
+	std::string				_in;			// Response bytes not parsed yet.
+	bool					_receivedAny;	// Response bytes came back on this attempt (no more retries).
+	HttpResponse			_response;
+	std::vector<char>		_body;			// De-framed body bytes not yet taken by the Connection.
+	Framing					_framing;
+	ChunkState				_chunkState;
+	size_t					_remaining;		// Body (or current chunk) bytes still expected.
+	bool					_keepAlive;		// The server allows the connection to carry another request.
+
+	bool	_connect();
+	void	_encodeRequest();
+	void	_send();
+	void	_receive();
+	bool	_parseHeaders();
+	void	_parseBody();
+	bool	_decodeChunked();
+	void	_finish(bool reusable);
+	void	_retryOrFail(const std::string& reason);
+	void	_fail(int status, const std::string& reason);
+};
+
+#endif
@@ -15,6 +15,7 @@
 
 #include "../config/ServerStructures.hpp"
 #include "HttpRequest.hpp"
+#include "../server/VirtualHosts.hpp"
 #include "../config/ServerStructures.hpp"
 
 #include <string>
@@ -34,18 +35,12 @@ class RequestDispatcher {
 private:
 	const GlobalConfig&		_globalConfig;
 
-	const ServerConfig*		findMatchingServer(const HttpRequest& request,
-										   const std::string& clientHost, int clientPort) const;
-
-	std::string	getEffectiveRoot(const ServerConfig* server, const LocationConfig* location) const;
-	long		getEffectiveClientMaxBodySize(const ServerConfig* server, const LocationConfig* location) const;
-	const std::map<int, std::string>&	getEffectiveErrorPages(const ServerConfig* server, const LocationConfig* location) const;
-
 public:
+	static const ServerConfig*		findMatchingServer(const HttpRequest& request, const VirtualHosts& virtualHosts);
 	static const LocationConfig*	findMatchingLocation(const HttpRequest& request,
 														const ServerConfig& serverConfig); // No 'const' at the end
 	RequestDispatcher(const GlobalConfig& globalConfig);
-	MatchedConfig	dispatch(const HttpRequest& request, const std::string& clientHost, int clientPort) const;
+	MatchedConfig	dispatch(const HttpRequest& request, const VirtualHosts& virtualHosts) const;
 };
 
 #endif
\ No newline at end of file
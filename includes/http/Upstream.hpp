@@ -0,0 +1,90 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   Upstream.hpp                                       :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: bvieilhe <bvieilhe@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 17:04:31 by bvieilhe          #+#    #+#             */
+/*   Updated: 2026/10/18 17:04:31 by bvieilhe         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef UPSTREAM_HPP
+# define UPSTREAM_HPP
+
+#include <string>
+#include <vector>
+#include <map>
+#include <ctime>
+#include <sys/socket.h>
+
+#include "HttpRequest.hpp"
+#include "../config/ServerStructures.hpp"
+
+# define UPSTREAM_HASH_POINTS	160	// Points per unit of weight on the consistent-hash ring.
+# define UPSTREAM_FAIL_TIMEOUT	10	// Seconds a server that could not be reached is skipped.
+
+// A group of HTTP backends for 'proxy_pass' ('upstream' block), shared by all requests. It picks the
+// server for each request (weighted round-robin, least connections or consistent hash of a request key)
+// and keeps idle keep-alive connections per server. A connection carries one request at a time.
+class Upstream {
+public:
+	// Builds the groups from the loaded configuration, at startup and on each reload. A group whose
+	// configuration did not change keeps its state (idle connections, failed servers). A changed or
+	// removed one is retired: requests already on it finish there, its connections are closed as they
+	// come back, and it is freed by a later call once nothing uses it.
+	static void			configure(const std::map<std::string, UpstreamConfig>& configs);
+	static Upstream*	find(const std::string& name);
+
+	// Picks a server for 'request' and returns a connected (or connecting) non-blocking socket to it,
+	// reusing an idle connection when possible. Servers that recently failed are skipped while another
+	// one is up. -1 when no server could be reached.
+	int		acquire(const HttpRequest& request, size_t& server, bool& reused);
+	// Ends a request on 'server'. The socket is kept for the next request if 'reusable', else closed.
+	void	release(size_t server, int fd, bool reusable);
+	// Takes 'server' out of the rotation for UPSTREAM_FAIL_TIMEOUT seconds.
+	void	markFailed(size_t server);
+
+	size_t				size() const;
+	const std::string&	getName() const;
+	std::string			describe(size_t server) const;	// "name (host:port)", for logs.
+	bool				keepsConnections() const;
+
+private:
+	struct Peer {
+		UpstreamServerConfig	config;
+		struct sockaddr_storage	addr;
+		socklen_t				addrLen;	// 0 while the address is unresolved.
+		int						active;			// Requests in flight.
+		int						currentWeight;	// Smooth weighted round-robin state.
+		time_t					failedAt;		// Last failed connection attempt, 0 if none.
+		std::vector<int>		idle;			// Idle keep-alive connections, most recent last.
+	};
+
+	UpstreamConfig										_config;
+	std::vector<Peer>									_peers;
+	std::vector<std::pair<unsigned int, size_t> >		_ring;		// Consistent-hash points -> server, sorted.
+	size_t												_next;		// Where the least-connections scan starts.
+	bool												_retired;	// Replaced by a reload: connections are no longer kept.
+
+	static std::map<std::string, Upstream*>	_upstreams;
+	static std::vector<Upstream*>			_retiredGroups;	// Retired groups with requests still in flight.
+
+	Upstream(const UpstreamConfig& config);
+	~Upstream();
+	Upstream(const Upstream&);
+	Upstream& operator=(const Upstream&);
+
+	void	_retire();
+	bool	_inUse() const;
+
+	bool	_isAvailable(const Peer& peer, time_t now) const;
+	size_t	_pick(const HttpRequest& request, time_t now);
+	size_t	_pickRoundRobin(time_t now);
+	size_t	_pickLeastConn(time_t now);
+	size_t	_pickHash(const HttpRequest& request, time_t now);
+	int		_connect(Peer& peer);
+};
+
+#endif
@@ -0,0 +1,57 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   ConfigSnapshot.hpp                                 :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: bvieilhe <bvieilhe@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 18:12:40 by bvieilhe          #+#    #+#             */
+/*   Updated: 2026/10/18 18:12:40 by bvieilhe         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef CONFIG_SNAPSHOT_HPP
+# define CONFIG_SNAPSHOT_HPP
+
+# include "../config/ServerStructures.hpp"
+# include "VirtualHosts.hpp"
+
+# include <map>
+# include <string>
+# include <utility>
+# include <vector>
+
+typedef std::pair<std::string, int>	ListenAddress;	// (address, port) of a 'listen' directive.
+
+// One loaded configuration, read-only once built: the server blocks with their compiled location
+// matchers, and their virtual-host tables per listening address. The server holds the current one;
+// each connection holds the one its request started on, so a reload (SIGHUP) never changes the
+// configuration under a request. The last release() frees it.
+class ConfigSnapshot {
+public:
+	// Takes over 'servers' (left empty).
+	explicit ConfigSnapshot(std::vector<ServerConfig>& servers);
+
+	void	acquire();
+	void	release();
+
+	const std::vector<ServerConfig>&	getServers() const;
+	// Server blocks listening on 'address', NULL if this configuration has no such listener.
+	const VirtualHosts*					getVirtualHosts(const ListenAddress& address) const;
+	// The addresses needing a socket of their own. One that shares its port with a wildcard
+	// ("0.0.0.0") listener is reached through the wildcard socket instead.
+	std::vector<ListenAddress>			getListenAddresses() const;
+	bool								hasSharedAddresses() const;
+
+private:
+	std::vector<ServerConfig>					_servers;
+	std::map<ListenAddress, VirtualHosts>		_virtualHosts;	// Point into _servers.
+	bool										_sharedAddresses;
+	long										_refs;
+
+	~ConfigSnapshot();
+	ConfigSnapshot(const ConfigSnapshot&);
+	ConfigSnapshot& operator=(const ConfigSnapshot&);
+};
+
+#endif
@@ -4,12 +4,19 @@
 
 #include <vector>
 #include <string>
+#include <ctime>
 
 #include "Socket.hpp"
+#include "ConfigSnapshot.hpp"
 #include "../http/HttpRequest.hpp"
 #include "../http/HttpResponse.hpp"
 #include "../http/HttpRequestParser.hpp"
 #include "../http/CGIHandler.hpp"
+#include "../http/CGICache.hpp"
+#include "../http/DiskCache.hpp"
+#include "../http/ProxyHandler.hpp"
+#include "../http/BodySource.hpp"
+#include "../http/RequestDispatcher.hpp"
 #include "../config/ServerStructures.hpp" // For ServerConfig
 
 
@@ -18,9 +25,17 @@ class Server;
 // Represents a single client connection to the server.
 class Connection : public Socket {
 public:
+	// How this request's CGI cache fill ends (see _endCacheFill).
+	enum CacheFillEnd {
+		FILL_ANSWERED,		// _response is the script's answer (or the error standing for it).
+		FILL_UNCACHEABLE,	// The answer is streamed, as it is too large to store.
+		FILL_ABANDONED		// No answer (client gone, connection reset).
+	};
+
 	enum ConnectionState {
 		READING,         // Reading client request.
 		HANDLING_CGI,    // Waiting for CGI response.
+		PROXYING,        // Forwarding the request to a 'proxy_pass' upstream.
 		WRITING,         // Writing response to client.
 		CLOSING          // Connection needs to be closed and reaped.
 	};
@@ -31,7 +46,14 @@ public:
 	void	handleRead();
 	void	handleWrite();
 	void	executeCGI();
+	bool	resumeQueuedCGI();
 	void	finalizeCGI();
+	void	pumpCgiOutput();
+	void	pumpCgiInput();
+	void	abortCGI();
+	void	handleProxyEvent(short revents);
+	void	finalizeProxy();
+	void	abortProxy();
 
 	int	getCgiReadFd() const;
 	int	getCgiWriteFd() const;
@@ -41,7 +63,16 @@ public:
 	bool			isCGI() const;
 
 	CGIHandler*	getCgiHandler() const;
+	ProxyHandler*	getProxyHandler() const;
 	bool		hasActiveCGI() const;
+	bool		isWaitingForCgiWorker() const;
+
+	void		attachConfig(ConfigSnapshot* config, const ListenAddress& address);
+	bool		isIdle() const;
+	bool		isIdleExpired(time_t now);
+	bool		isRequestExpired(time_t now);
+	bool		isStreaming() const;
+	bool		isReceivingRequestBody() const;
 
 private:
 	HttpRequest			_request;		// The parsed HTTP request.
@@ -50,13 +81,66 @@ private:
 	std::vector<char>	_requestBuffer;	// Buffer for raw incoming request data.
 	ConnectionState		_state;			// Current state of the connection.
 	Server*				_server;		// Pointer to the parent server (for callbacks like updateFdEvents).
+	ConfigSnapshot*		_config;		// Configuration of the current request (held: a reload may replace the server's).
+	ListenAddress		_listenAddress;	// Address the connection came in on, to find its server blocks in _config.
 	CGIHandler*			_cgiHandler;	// Pointer to CGI handler if this is a CGI request.
 	bool				_isCgiRequest;	// Flag to indicate if the current request is for CGI.
+	ProxyHandler*		_proxyHandler;	// Forwards the current request to a 'proxy_pass' upstream, NULL otherwise.
+	const LocationConfig*	_location;		// Location of the current request, valid once _locationMatched.
+	bool				_locationMatched;
 
-	std::string			_rawResponseToSend;			// The complete raw HTTP response string.
+	std::string			_rawResponseToSend;			// Bytes queued for the socket: headers, then a window of the body.
 	size_t				_bytesSentFromRawResponse;	// Number of bytes sent from _rawResponseToSend.
+	BodySource*			_bodySource;				// Rest of the body, pulled into _rawResponseToSend as the socket drains.
+	bool				_responseStarted;			// Headers of the current response have been queued.
+	bool				_cgiOutputPaused;			// CGI stdout (or the upstream socket) is not polled because the send window is full.
+
+	long				_requestsServed;	// Responses fully sent on this connection.
+	bool				_keepAlive;			// Whether the connection stays open after the current response.
+	time_t				_lastActivity;		// Last time data was received or a response completed.
+	bool				_streaming;			// Response headers are out and the CGI body is forwarded as it arrives.
+	bool				_receivingCgiBody;	// The CGI runs while the request body is still being read and fed to it.
+	bool				_cgiInputPaused;	// The client socket is not read because the CGI input window is full.
+	std::vector<char>	_cgiBodyChunk;		// Body bytes taken from the parser on their way to the CGI.
+	CGICache*			_cache;				// Cache zone of the current CGI request ('cgi_cache'), NULL if uncached.
+	std::string			_cacheKey;
+	bool				_cacheFiller;		// This request runs the script for _cacheKey and must store, pass or abandon it.
+	long				_cacheValid;		// 'valid=' of the location, also how long an uncacheable key passes.
+	bool				_waitingForCache;	// Another request is running the script for _cacheKey.
+	time_t				_cacheWaitSince;
+	DiskCache*			_diskCache;			// 'proxy_cache' zone of the current GET request, NULL if uncached.
+	std::string			_diskCacheKey;
+	long				_diskCacheValid;	// 'valid=' of the location, for responses without their own lifetime.
+	DiskCache::Fill*	_diskFill;			// The response being written to _diskCache while it is sent, NULL if none.
 
 	void	_processRequest();
+	void	_selectServer();
+	void	_adoptCurrentConfig();
+	const LocationConfig*	_matchLocation();
+	bool	_routesToCgi(const LocationConfig* location) const;
+	void	_sendContinue();
+	void	_feedCgiBody();
+	void	_abortCgiBody();
+	void	_updateCgiSocketEvents();
+	void	_launchCGI(const MatchedConfig& matchedConfig);
+	void	_startProxy(const MatchedConfig& matchedConfig);
+	bool	_lookupCgiCache(const LocationConfig* location);
+	void	_endCacheFill(CacheFillEnd how);
+	bool	_lookupDiskCache(const LocationConfig* location);
+	void	_beginDiskCacheFill();
+	void	_endDiskCacheFill(bool commit);
+	void	_setCgiErrorResponse(const ServerConfig* serverConfig, const LocationConfig* locationConfig);
+	void	_applyConnectionHeaders();
+	bool	_beginResponse();
+	bool	_fillSendWindow();
+	bool	_sendsBodyDirect() const;
+	void	_sendBodyDirect();
+	void	_startStreaming();
+	void	_streamResponseHeaders();
+	void	_queueBody(std::vector<char>& body);
+	void	_pauseCgiOutput();
+	void	_resumeCgiOutput();
+	void	_onSendBufferDrained();
 	void	_resetForNextRequest();
 };
 
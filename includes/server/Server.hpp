@@ -4,46 +4,85 @@
 
 # include "../config/ServerStructures.hpp"
 # include "Socket.hpp"
+# include "ConfigSnapshot.hpp"
+# include "../config/ConfigLoader.hpp"
 # include "Connection.hpp"
 # include "divers.hpp"
 
 # include <vector>
 # include <map>
+# include <deque>
+# include <ctime>
 # include <stdexcept>
 # include <poll.h>
+# include <sys/types.h>
 
 class Connection;
 
 class Server {
 private:
-	std::vector<ServerConfig>	_serverConfigs;
+	std::string					_executable;		// Started again on SIGUSR2 (binary upgrade).
+	std::string					_configPath;		// Re-read on SIGHUP.
+	ConfigSnapshot*				_config;			// Current configuration, taken by new requests.
 	std::map<int, Socket*>		_listenSockets;
+	std::map<int, ListenAddress>	_listenAddresses;	// Listen socket -> the address it was bound for.
 	std::vector<struct pollfd>	_pfds;
 	std::map<int, Connection*>	_connections;
 	std::map<int, Connection*>	_cgiFdsToConnection;
+	std::map<int, Connection*>	_proxyFdsToConnection;	// Upstream sockets of proxied requests ('proxy_pass').
+	std::deque<int>				_cgiWaitQueue;		// Client fds whose CGI waits for a pooled worker or a concurrency slot, oldest first.
 
 	bool	_running;
 	int		_timeout_ms;
+	bool	_dispatching;			// Poll results are being handled: removals are deferred.
+	bool	_pollListHasHoles;		// _pfds holds blanked entries to drop after the round.
+	pid_t	_upgradePid;			// New binary started on SIGUSR2, until it takes over or exits.
+	pid_t	_previousPid;			// Binary we took the listeners over from, told to drain once we listen.
+	bool	_draining;				// No longer accepting: serving the open connections, then exiting.
+	time_t	_drainDeadline;			// Connections still open then are closed (DRAIN_TIMEOUT_SECONDS).
 
 	bool	_setupListeners();
+	std::map<ListenAddress, Socket*>	_inheritedListeners();
+	int		_openListener(const ListenAddress& address);
+	int		_addListener(Socket* listenSocket, const ListenAddress& address);
+	void	_closeListener(int listen_fd);
+	void	_reload();
+	void	_upgrade();
+	void	_checkUpgrade();
+	void	_startDraining();
 	void	_acceptNewConnection(int listen_fd);
+	ListenAddress	_listenAddressFor(int client_fd, int listen_fd) const;
 	void	_handleClientEvent(int client_fd, short revents);
 	void	_handleCgiEvent(int cgi_fd, short revents);
+	void	_handleProxyEvent(int proxy_fd, short revents);
+	void	_closeIdleConnections();
 	void	_reapClosedConnections();
+	void	_dispatchQueuedCgi();
+	void	_compactPollList();
 
 public:
-	Server(const std::vector<ServerConfig>& configs);
+	Server(std::vector<ServerConfig>& configs, const std::string& configPath, const std::string& executable);
 	~Server();
 
 	void run();
 
+	static void	applySharedConfig(const ConfigLoader& loader, const std::vector<ServerConfig>& servers);
+
 	const std::vector<ServerConfig>&	getConfigs() const;
+	ConfigSnapshot*	getConfigSnapshot() const;
+	bool	isDraining() const;
 	void	updateFdEvents(int fd, short events);
+	void	suspendFd(int fd);
+	void	resumeFd(int fd, short events);
 	void	_addFdToPoll(int fd, short events);
 	void	_removeFdFromPoll(int fd);
 
 	void	registerCgiFd(int fd, Connection* conn, short events);
-	void	unregisterCgiFd(int fd);
+	void	unregisterCgiFd(int fd, bool closeFd = true);
+	void	queueCgiRequest(int client_fd);
+
+	void	registerProxyFd(int fd, Connection* conn, short events);
+	void	unregisterProxyFd(int fd);
 };
 
 #endif
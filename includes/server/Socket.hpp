@@ -3,6 +3,7 @@
 
 # include "divers.hpp"
 # include "../config/ServerStructures.hpp"
+# include "VirtualHosts.hpp"
 # include <sys/socket.h>
 # include <netinet/in.h>
 # include <arpa/inet.h>
@@ -16,6 +17,7 @@ class Socket {
 		struct sockaddr_storage	_addr;			// Generic socket address structure.
 		std::string				_port;			// The port the socket is bound to.
 		const ServerConfig*		_server_block;	// Pointer to the associated server configuration.
+		const VirtualHosts*		_virtual_hosts;	// Server blocks of the listening address, chosen from by Host.
 
 	public:
 		Socket();
@@ -28,16 +30,20 @@ class Socket {
 		void	listenOnSocket(void);
 		int		acceptConnection(int listenSock);
 		void	printConnection(void);
-		bool	initListenSocket(const char* port);
+		bool	initListenSocket(const char* port, const char* host = NULL);
+		bool	adoptListenSocket(int fd);
+		static bool	localAddress(int fd, std::string& host, int& port);
 		void	closeSocket(void);
 
 		int					getSocketFD(void);
 		int					getPort(void);
 		const ServerConfig*	getServerBlock(void);
+		const VirtualHosts*	getVirtualHosts(void) const;
 
 		void	setSocketFD(int fd);
 		void	setPortFD(std::string port);
 		void	setServerBlock(const ServerConfig* sb);
+		void	setVirtualHosts(const VirtualHosts* vhosts);
 };
 
 #endif
\ No newline at end of file
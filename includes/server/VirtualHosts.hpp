@@ -0,0 +1,69 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   VirtualHosts.hpp                                   :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: bvieilhe <bvieilhe@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 17:05:12 by bvieilhe          #+#    #+#             */
+/*   Updated: 2026/10/18 17:05:12 by bvieilhe         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef VIRTUAL_HOSTS_HPP
+# define VIRTUAL_HOSTS_HPP
+
+# include "../config/ServerStructures.hpp"
+# include <string>
+# include <vector>
+
+# define VHOST_MAX_NAME_LEN	256	// Longer Host headers go to the default server.
+
+// The server blocks of one listening address (address, port), with their 'server_name's compiled into
+// hash tables: exact names, leading wildcards ("*.example.com", ".example.com") and trailing wildcards
+// ("www.example.*"). Built once at startup, then read-only. A request whose Host matches no name goes to
+// the default server: the one marked 'default_server', else the first one declared.
+class VirtualHosts {
+public:
+	VirtualHosts();
+
+	void				add(const ServerConfig* server);
+	const ServerConfig*	select(const std::string& host) const;
+	const ServerConfig*	defaultServer() const;
+
+	static bool			isValidName(const std::string& name);
+
+private:
+	// Lowercased name -> server, with open addressing (linear probing). The first server to claim a
+	// name keeps it.
+	class NameTable {
+	public:
+		NameTable();
+
+		void				insert(const std::string& name, const ServerConfig* server);
+		const ServerConfig*	find(const char* name, size_t len) const;
+		bool				empty() const;
+
+	private:
+		struct Slot {
+			unsigned int		hash;
+			const ServerConfig*	server;
+			std::string			name;
+
+			Slot() : hash(0), server(NULL) {}
+		};
+
+		std::vector<Slot>	_slots;		// Capacity is a power of two, kept at most half full.
+		size_t				_count;
+
+		void	_grow();
+	};
+
+	NameTable			_exact;
+	NameTable			_suffixes;	// ".example.com" for "*.example.com" and ".example.com".
+	NameTable			_prefixes;	// "www.example." for "www.example.*".
+	const ServerConfig*	_default;
+	bool				_explicitDefault;
+};
+
+#endif
@@ -3,6 +3,7 @@
 
 # define OK 200
 # define BACKLOG 25
+# define LISTEN_FDS_START 3	// First socket passed by a service manager (LISTEN_FDS, socket activation).
 
 # include <typeinfo>
 # include <poll.h>
@@ -32,6 +32,7 @@ namespace StringUtils {
     std::string longToString(long val);
     bool startsWith(const std::string& str, const std::string& prefix);
     bool endsWith(const std::string& str, const std::string& suffix);
+    void appendEnvEntry(std::string& env, const char* name, const std::string& value);
 }
 
 #endif
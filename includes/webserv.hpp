@@ -20,6 +20,9 @@
 # include <unistd.h>		// For POSIX operating system API (e.g., read, write, close, fork, chdir, _exit).
 # include <fcntl.h>			// For file control options (e.g., fcntl, O_NONBLOCK).
 # include <poll.h>			// For multiplexing I/O (e.g., poll, pollfd).
+# ifndef POLLRDHUP
+#  define POLLRDHUP 0		// Peer hangup is then only seen as POLLHUP or a failed read/write.
+# endif
 # include <sys/wait.h>		// For waitpid, WIFEXITED, WEXITSTATUS, WIFSIGNALED, WTERMSIG
 # include <cstdlib>			// For EXIT_FAILURE, realpath
 # include <limits.h>		// For PATH_MAX
@@ -27,8 +30,16 @@
 // Constants
 # define MAXEVENTS 1000			// Maximum number of events to handle in poll().
 # define BUFF_SIZE 8192			// Size of the buffer for reading/writing data.
+# define SEND_WINDOW_SIZE 65536	// Response bytes buffered per connection; the body source refills it as the socket drains.
+# define SENDFILE_CHUNK_SIZE 1048576	// Most file body bytes handed to one sendfile(); the socket usually takes less.
+# define CGI_INPUT_WINDOW_SIZE 65536	// Request body bytes buffered for a CGI's stdin before the client socket stops being read.
+# define CGI_STDIN_MEMFD_MIN_SIZE 65536	// Complete request bodies from this size reach a CGI as a memfd rather than a pipe.
 # define POLL_TIMEOUT_MS 5000	// Poll timeout in milliseconds (5 seconds).
 # define CGI_TIMEOUT_SECONDS 5	// CGI timeout in seconds (5 seconds).
+# define PROXY_TIMEOUT_SECONDS 60	// Upstream silence (connect, send or read) before a proxied request fails with 504.
+# define CLIENT_IDLE_TIMEOUT_SECONDS 60	// Idle limit for new connections when keep-alive is disabled.
+# define DRAIN_TIMEOUT_SECONDS 60	// Time a process that handed its listeners over gives its last connections.
+# define IDLE_SWEEP_MS 1000		// Poll timeout while connections are open, so idle keep-alive sockets are reaped on time.
 
 // Project-Specific Class Includes
 # include "config/ServerStructures.hpp"	// Defines structures for server and location configurations.
@@ -43,5 +54,8 @@
 
 # include <csignal>
 extern volatile sig_atomic_t stopSig;
+extern volatile sig_atomic_t reloadSig;
+extern volatile sig_atomic_t upgradeSig;
+extern volatile sig_atomic_t drainSig;
 
 #endif
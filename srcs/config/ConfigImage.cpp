@@ -0,0 +1,378 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   ConfigImage.cpp                                    :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: bvieilhe <bvieilhe@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 21:04:12 by bvieilhe          #+#    #+#             */
+/*   Updated: 2026/10/18 21:04:12 by bvieilhe         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "../../includes/config/ConfigImage.hpp"
+#include "../../includes/config/ConfigLoader.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const char			kMagic[8] = { 'W', 'S', 'C', 'O', 'N', 'F', 'I', 'G' };
+// Bump whenever a field is added to, removed from or reordered in what transfer() below covers.
+const unsigned int	kVersion = 1;
+const unsigned int	kByteOrder = 0x01020304u;
+
+struct ImageHeader {
+	char			magic[8];
+	unsigned int	version;
+	unsigned int	byteOrder;		// Reads back differently on a host of the other endianness.
+	unsigned int	longSize;		// Numbers are stored as native longs.
+	unsigned int	checksum;		// FNV-1a of the payload.
+	unsigned long	payloadSize;
+};
+
+unsigned int checksum(const char* data, size_t len) {
+	unsigned int hash = 2166136261u;
+	for (size_t i = 0; i < len; ++i) {
+		hash = (hash ^ static_cast<unsigned char>(data[i])) * 16777619u;
+	}
+	return hash;
+}
+
+// The payload is a flat sequence of native longs and length-prefixed byte strings. The same
+// transfer() functions write and read it, so both sides always agree on the field order.
+class ImageWriter {
+public:
+	static const bool	reading = false;
+
+	void	number(long& value) { _out.append(reinterpret_cast<const char*>(&value), sizeof(value)); }
+	void	bytes(std::string& value) {
+		long len = static_cast<long>(value.size());
+		number(len);
+		_out.append(value);
+	}
+	size_t	count(size_t size) {
+		long n = static_cast<long>(size);
+		number(n);
+		return size;
+	}
+	const std::string&	data() const { return _out; }
+
+private:
+	std::string	_out;
+};
+
+class ImageReader {
+public:
+	static const bool	reading = true;
+
+	ImageReader(const char* data, size_t len, const std::string& path) : _pos(data), _end(data + len), _path(path) {}
+
+	void	number(long& value) {
+		need(sizeof(value));
+		std::memcpy(&value, _pos, sizeof(value));
+		_pos += sizeof(value);
+	}
+	void	bytes(std::string& value) {
+		size_t len = count(0);
+		need(len);
+		value.assign(_pos, len);
+		_pos += len;
+	}
+	// Every element takes at least one long, which bounds a sane count by the bytes left.
+	size_t	count(size_t) {
+		long n;
+		number(n);
+		if (n < 0 || static_cast<size_t>(n) > static_cast<size_t>(_end - _pos)) {
+			corrupt();
+		}
+		return static_cast<size_t>(n);
+	}
+	bool	atEnd() const { return _pos == _end; }
+	void	corrupt() const { throw ConfigLoadError("Corrupt configuration image: " + _path); }
+
+private:
+	const char*			_pos;
+	const char*			_end;
+	const std::string&	_path;
+
+	void	need(size_t len) const {
+		if (len > static_cast<size_t>(_end - _pos)) {
+			corrupt();
+		}
+	}
+};
+
+template <class Archive> void transfer(Archive& ar, EffectiveLocation& value);
+template <class Archive> void transfer(Archive& ar, LocationConfig& value);
+template <class Archive> void transfer(Archive& ar, ServerConfig& value);
+template <class Archive> void transfer(Archive& ar, UpstreamServerConfig& value);
+template <class Archive> void transfer(Archive& ar, UpstreamConfig& value);
+template <class Archive> void transfer(Archive& ar, CachePathConfig& value);
+
+template <class Archive> void transfer(Archive& ar, std::string& value) {
+	ar.bytes(value);
+}
+
+template <class Archive> void transfer(Archive& ar, long& value) {
+	ar.number(value);
+}
+
+// Narrower scalars and enums go through a long.
+template <class Archive, class T> void transferAs(Archive& ar, T& value) {
+	long n = static_cast<long>(value);
+	ar.number(n);
+	value = static_cast<T>(n);
+}
+
+template <class Archive> void transfer(Archive& ar, int& value) { transferAs(ar, value); }
+template <class Archive> void transfer(Archive& ar, unsigned int& value) { transferAs(ar, value); }
+template <class Archive> void transfer(Archive& ar, HttpMethod& value) { transferAs(ar, value); }
+template <class Archive> void transfer(Archive& ar, LogLevel& value) { transferAs(ar, value); }
+
+template <class Archive> void transfer(Archive& ar, bool& value) {
+	long n = value ? 1 : 0;
+	ar.number(n);
+	value = (n != 0);
+}
+
+template <class Archive, class T> void transfer(Archive& ar, std::vector<T>& values) {
+	values.resize(ar.count(values.size()));
+	for (size_t i = 0; i < values.size(); ++i) {
+		transfer(ar, values[i]);
+	}
+}
+
+template <class Archive, class K, class V> void transfer(Archive& ar, std::map<K, V>& values) {
+	size_t n = ar.count(values.size());
+	if (!Archive::reading) {
+		for (typename std::map<K, V>::iterator it = values.begin(); it != values.end(); ++it) {
+			K key = it->first;
+			transfer(ar, key);
+			transfer(ar, it->second);
+		}
+		return;
+	}
+	values.clear();
+	for (size_t i = 0; i < n; ++i) {
+		K key = K();
+		transfer(ar, key);
+		transfer(ar, values[key]);
+	}
+}
+
+template <class Archive> void transfer(Archive& ar, EffectiveLocation& value) {
+	transfer(ar, value.root);
+	transfer(ar, value.uploadStore);
+	transfer(ar, value.clientMaxBodySize);
+	transfer(ar, value.errorPages);
+	transfer(ar, value.indexFiles);
+	transfer(ar, value.autoindex);
+	transfer(ar, value.autoindexFormat);
+	transfer(ar, value.allowedMethods);
+}
+
+template <class Archive> void transfer(Archive& ar, LocationConfig& value) {
+	transfer(ar, value.root);
+	transfer(ar, value.allowedMethods);
+	transfer(ar, value.indexFiles);
+	transfer(ar, value.autoindex);
+	transfer(ar, value.autoindexFormat);
+	transfer(ar, value.uploadEnabled);
+	transfer(ar, value.uploadStore);
+	transfer(ar, value.cgiExecutables);
+	transfer(ar, value.fastcgiPass);
+	transfer(ar, value.cgiPoolSize);
+	transfer(ar, value.cgiPoolMaxRequests);
+	transfer(ar, value.cgiPoolWorker);
+	transfer(ar, value.cgiMaxConcurrent);
+	transfer(ar, value.cgiAdaptive);
+	transfer(ar, value.cgiQueueSize);
+	transfer(ar, value.cgiQueueTimeout);
+	transfer(ar, value.cgiCacheZone);
+	transfer(ar, value.cgiCacheSize);
+	transfer(ar, value.cgiCacheValid);
+	transfer(ar, value.cgiCacheStale);
+	transfer(ar, value.cgiCacheKey);
+	transfer(ar, value.proxyPass);
+	transfer(ar, value.proxyCacheZone);
+	transfer(ar, value.proxyCacheValid);
+	transfer(ar, value.proxyCacheKey);
+	transfer(ar, value.cgiRootPath);
+	transfer(ar, value.cgiResolvedExecutables);
+	transfer(ar, value.cgiEnvPrefix);
+	transfer(ar, value.returnCode);
+	transfer(ar, value.returnUrlOrText);
+	transfer(ar, value.path);
+	transfer(ar, value.matchType);
+	transfer(ar, value.nestedLocations);
+	transfer(ar, value.errorPages);
+	transfer(ar, value.clientMaxBodySize);
+	transfer(ar, value.effective);
+}
+
+// 'locationMatcher' is left out: it points into 'locations' and is compiled once they are in place.
+template <class Archive> void transfer(Archive& ar, ServerConfig& value) {
+	transfer(ar, value.host);
+	transfer(ar, value.port);
+	transfer(ar, value.defaultServer);
+	transfer(ar, value.serverNames);
+	transfer(ar, value.errorPages);
+	transfer(ar, value.clientMaxBodySize);
+	transfer(ar, value.errorLogPath);
+	transfer(ar, value.errorLogLevel);
+	transfer(ar, value.root);
+	transfer(ar, value.indexFiles);
+	transfer(ar, value.autoindex);
+	transfer(ar, value.autoindexFormat);
+	transfer(ar, value.keepaliveRequests);
+	transfer(ar, value.keepaliveTimeout);
+	transfer(ar, value.locations);
+	transfer(ar, value.effective);
+}
+
+template <class Archive> void transfer(Archive& ar, UpstreamServerConfig& value) {
+	transfer(ar, value.host);
+	transfer(ar, value.port);
+	transfer(ar, value.weight);
+}
+
+template <class Archive> void transfer(Archive& ar, UpstreamConfig& value) {
+	transfer(ar, value.name);
+	transfer(ar, value.servers);
+	transfer(ar, value.balance);
+	transfer(ar, value.hashKey);
+	transfer(ar, value.keepalive);
+}
+
+template <class Archive> void transfer(Archive& ar, CachePathConfig& value) {
+	transfer(ar, value.path);
+	transfer(ar, value.levels);
+	transfer(ar, value.zone);
+	transfer(ar, value.maxSize);
+	transfer(ar, value.inactive);
+}
+
+template <class Archive> void transferAll(Archive& ar, std::vector<ServerConfig>& servers,
+										  std::map<std::string, std::string>& mimeTypes,
+										  std::map<std::string, UpstreamConfig>& upstreams,
+										  std::vector<CachePathConfig>& cachePaths) {
+	transfer(ar, servers);
+	transfer(ar, mimeTypes);
+	transfer(ar, upstreams);
+	transfer(ar, cachePaths);
+}
+
+bool writeAll(int fd, const char* data, size_t len) {
+	while (len > 0) {
+		ssize_t n = ::write(fd, data, len);
+		if (n <= 0) {
+			return false;
+		}
+		data += n;
+		len -= static_cast<size_t>(n);
+	}
+	return true;
+}
+
+}
+
+bool ConfigImage::isImage(const std::string& path) {
+	int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		return false;
+	}
+	char magic[sizeof(kMagic)];
+	ssize_t n = ::read(fd, magic, sizeof(magic));
+	close(fd);
+	return n == static_cast<ssize_t>(sizeof(magic)) && std::memcmp(magic, kMagic, sizeof(magic)) == 0;
+}
+
+// The writer only reads its inputs; transfer() takes them non-const so that one set of functions
+// serves both directions.
+size_t ConfigImage::write(const std::string& path, const std::vector<ServerConfig>& servers,
+						  const std::map<std::string, std::string>& mimeTypes,
+						  const std::map<std::string, UpstreamConfig>& upstreams,
+						  const std::vector<CachePathConfig>& cachePaths) {
+	ImageWriter writer;
+	transferAll(writer, const_cast<std::vector<ServerConfig>&>(servers),
+				const_cast<std::map<std::string, std::string>&>(mimeTypes),
+				const_cast<std::map<std::string, UpstreamConfig>&>(upstreams),
+				const_cast<std::vector<CachePathConfig>&>(cachePaths));
+	const std::string& payload = writer.data();
+
+	ImageHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, kMagic, sizeof(kMagic));
+	header.version = kVersion;
+	header.byteOrder = kByteOrder;
+	header.longSize = sizeof(long);
+	header.checksum = checksum(payload.data(), payload.size());
+	header.payloadSize = payload.size();
+
+	std::string tempPath = path + ".tmp";
+	int fd = open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd < 0) {
+		throw std::runtime_error("Could not create configuration image: " + tempPath);
+	}
+	bool ok = writeAll(fd, reinterpret_cast<const char*>(&header), sizeof(header))
+			  && writeAll(fd, payload.data(), payload.size());
+	ok = (close(fd) == 0) && ok;
+	if (!ok || rename(tempPath.c_str(), path.c_str()) != 0) {
+		unlink(tempPath.c_str());
+		throw std::runtime_error("Could not write configuration image: " + path);
+	}
+	return sizeof(header) + payload.size();
+}
+
+void ConfigImage::read(const std::string& path, std::vector<ServerConfig>& servers,
+					   std::map<std::string, std::string>& mimeTypes,
+					   std::map<std::string, UpstreamConfig>& upstreams,
+					   std::vector<CachePathConfig>& cachePaths) {
+	int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		throw ConfigLoadError("Could not open configuration image: " + path);
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(ImageHeader))) {
+		close(fd);
+		throw ConfigLoadError("Corrupt configuration image: " + path);
+	}
+	size_t size = static_cast<size_t>(st.st_size);
+	void* mapped = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (mapped == MAP_FAILED) {
+		throw ConfigLoadError("Could not map configuration image: " + path);
+	}
+	const char* data = static_cast<const char*>(mapped);
+
+	try {
+		ImageHeader header;
+		std::memcpy(&header, data, sizeof(header));
+		if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0) {
+			throw ConfigLoadError("Not a configuration image: " + path);
+		}
+		if (header.version != kVersion || header.byteOrder != kByteOrder || header.longSize != sizeof(long)) {
+			throw ConfigLoadError("Configuration image was built by another version of webserv, rebuild it: " + path);
+		}
+		const char* payload = data + sizeof(header);
+		size_t payloadSize = size - sizeof(header);
+		if (header.payloadSize != payloadSize || header.checksum != checksum(payload, payloadSize)) {
+			throw ConfigLoadError("Corrupt configuration image: " + path);
+		}
+		ImageReader reader(payload, payloadSize, path);
+		transferAll(reader, servers, mimeTypes, upstreams, cachePaths);
+		if (!reader.atEnd()) {
+			reader.corrupt();
+		}
+	} catch (...) {
+		munmap(mapped, size);
+		throw;
+	}
+	munmap(mapped, size);
+}
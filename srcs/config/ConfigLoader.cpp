@@ -11,54 +11,376 @@
 /* ************************************************************************** */
 
 #include "../../includes/config/ConfigLoader.hpp"
+#include "../../includes/config/ConfigImage.hpp"
+#include "../../includes/config/Lexer.hpp"
+#include "../../includes/config/Parser.hpp"
+#include "../../includes/http/CGICache.hpp"
+#include "../../includes/http/LocationMatcher.hpp"
+#include "../../includes/server/VirtualHosts.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <climits>
+#include <cstdlib>
+#include <set>
+#include <unistd.h>
 
 ConfigLoader::ConfigLoader() {}
 
 ConfigLoader::~ConfigLoader() {}
 
+// Counts the blocks named 'name' among 'nodes', to size the vector they are parsed into.
+static size_t countBlocks(const std::vector<ASTnode*>& nodes, const char* name) {
+	size_t count = 0;
+	for (size_t i = 0; i < nodes.size(); ++i) {
+		const BlockNode* block = dynamic_cast<const BlockNode*>(nodes[i]);
+		if (block && block->name == name) {
+			++count;
+		}
+	}
+	return count;
+}
+
 // Main function to load the entire server configuration from the AST.
 std::vector<ServerConfig>	ConfigLoader::loadConfig(const std::vector<ASTnode *> & astNodes)
 {
 	std::vector<ServerConfig>	loadedServers;
 
+	// Each server is parsed in place: reserved up front, so that no server (and its location tree) is
+	// copied into the vector or moved when it grows.
+	loadedServers.reserve(countBlocks(astNodes, "server"));
 	// Iterate through top-level AST nodes, expecting server blocks.
 	for (size_t i = 0; i < astNodes.size(); ++i) {
 		ASTnode * node = astNodes[i];
 		BlockNode * serverBlockNode = dynamic_cast<BlockNode *>(node);
 
-		if (serverBlockNode) {
-			// If it's a server block, parse it.
-			if (serverBlockNode->name == "server") {
-				loadedServers.push_back(parseServerBlock(serverBlockNode));
+		try {
+			if (serverBlockNode) {
+				// If it's a server block, parse it.
+				if (serverBlockNode->name == "server") {
+					loadedServers.push_back(ServerConfig());
+					parseServerBlock(serverBlockNode, loadedServers.back());
+				} else if (serverBlockNode->name == "types") {
+					parseTypesBlock(serverBlockNode);
+				} else if (serverBlockNode->name == "upstream") {
+					parseUpstreamBlock(serverBlockNode);
+				} else {
+					// Handle unexpected block types at the top level.
+					error("Unexpected block type '" + serverBlockNode->name + "' at top level. Expected 'server' block.",
+						  serverBlockNode->line, serverBlockNode->column);
+				}
 			} else {
-				// Handle unexpected block types at the top level.
-				error("Unexpected block type '" + serverBlockNode->name + "' at top level. Expected 'server' block.",
-					  serverBlockNode->line, serverBlockNode->column);
+				DirectiveNode* directiveNode = dynamic_cast<DirectiveNode *>(node);
+
+				// Handle unexpected directive nodes or unknown AST node types.
+				if (directiveNode && directiveNode->name == "proxy_cache_path") {
+					parseCachePathDirective(directiveNode);
+				} else if (directiveNode) {
+					error("Unexpected directive '" + directiveNode->name + "' at top level. Expected 'server' block.",
+						   directiveNode->line, directiveNode->column);
+				} else {
+					error("Unknown AST node type encountered at top level.", node->line, node->column);
+				}
 			}
-		} else {
-			DirectiveNode* directiveNode = dynamic_cast<DirectiveNode *>(node);
-
-			// Handle unexpected directive nodes or unknown AST node types.
-			if (directiveNode) {
-				error("Unexpected directive '" + directiveNode->name + "' at top level. Expected 'server' block.",
-					   directiveNode->line, directiveNode->column);
-			} else {
-				error("Unknown AST node type encountered at top level.", node->line, node->column);
+		} catch (const ConfigLoadError& e) {
+			// Line and column are in the included file the node came from: say which.
+			if (node->file.empty()) {
+				throw;
 			}
+			throw ConfigLoadError("In included file '" + node->file + "': " + e.what(), e.getLine(), e.getColumn());
 		}
 	}
 	// Safeguard: Ensure at least one server is defined if the config is not empty.
 	if (loadedServers.empty() && !astNodes.empty()) {
 		error("No valid server blocks found in configuration.", 0, 0);
 	}
+	// One 'default_server' per listening address.
+	std::set<std::pair<std::string, int> > defaults;
+	for (size_t i = 0; i < loadedServers.size(); ++i) {
+		const ServerConfig& server = loadedServers[i];
+		if (server.defaultServer && !defaults.insert(std::make_pair(server.host, server.port)).second) {
+			error("Duplicate 'default_server' for " + server.host + ":" + StringUtils::longToString(server.port) + ".", 0, 0);
+		}
+	}
+	// Upstream blocks may come after the servers using them.
+	for (size_t i = 0; i < loadedServers.size(); ++i) {
+		resolveProxyPasses(loadedServers[i].locations);
+		resolveProxyCaches(loadedServers[i].locations);
+	}
 	return loadedServers;
 }
 
-// Parses a single 'server' block from its AST node into a ServerConfig object.
-ServerConfig    ConfigLoader::parseServerBlock(const BlockNode * serverBlockNode)
+// Reads, tokenizes and parses a configuration file, then loads it (includes are relative to its directory).
+// A compiled image (see ConfigImage) is loaded as is.
+// Throws on any error, with nothing left allocated.
+std::vector<ServerConfig>	ConfigLoader::loadFile(const std::string& path)
+{
+	std::vector<ServerConfig> servers;
+	if (ConfigImage::isImage(path)) {
+		ConfigImage::read(path, servers, _mimeTypes, _upstreams, _cachePaths);
+		if (servers.empty()) {
+			throw std::runtime_error("No server configurations loaded.");
+		}
+		return servers;
+	}
+
+	std::string content;
+	if (!readFile(path, content)) {
+		throw std::runtime_error("Could not open configuration file: " + path);
+	}
+
+	Lexer lexer(content);
+	Parser parser(lexer);
+	size_t slashPos = path.rfind('/');
+	parser.setBaseDir(slashPos == std::string::npos ? "." : path.substr(0, slashPos));
+	std::vector<ASTnode*> ast = parser.parse();
+
+	try {
+		loadConfig(ast).swap(servers);
+	} catch (...) {
+		for (size_t i = 0; i < ast.size(); ++i) {
+			delete ast[i];
+		}
+		throw;
+	}
+	for (size_t i = 0; i < ast.size(); ++i) {
+		delete ast[i];
+	}
+	if (servers.empty()) {
+		throw std::runtime_error("No server configurations loaded.");
+	}
+	return servers;
+}
+
+const std::map<std::string, std::string>&	ConfigLoader::getMimeTypes() const
+{ return (_mimeTypes); }
+
+const std::map<std::string, UpstreamConfig>&	ConfigLoader::getUpstreams() const
+{ return (_upstreams); }
+
+const std::vector<CachePathConfig>&	ConfigLoader::getCachePaths() const
+{ return (_cachePaths); }
+
+// Parses 'proxy_cache_path <dir> keys_zone=name [levels=1:2] [max_size=S] [inactive=T]'.
+void	ConfigLoader::parseCachePathDirective(const DirectiveNode * directive)
+{
+	const std::vector<std::string>&	args = directive->args;
+	CachePathConfig					cachePath;
+
+	cachePath.path = args[0];
+	while (cachePath.path.length() > 1 && cachePath.path[cachePath.path.length() - 1] == '/') {
+		cachePath.path.erase(cachePath.path.length() - 1);
+	}
+	for (size_t i = 1; i < args.size(); ++i) {
+		size_t eq_pos = args[i].find('=');
+		if (eq_pos == std::string::npos) {
+			error("Invalid 'proxy_cache_path' parameter '" + args[i] + "'. Expected key=value.", directive->line, directive->column);
+		}
+		std::string key = args[i].substr(0, eq_pos);
+		std::string value = args[i].substr(eq_pos + 1);
+
+		if (key == "keys_zone") {
+			if (value.empty()) {
+				error("'proxy_cache_path' keys_zone needs a name.", directive->line, directive->column);
+			}
+			cachePath.zone = value;
+		} else if (key == "levels") {
+			std::vector<std::string> levels = StringUtils::split(value, ':');
+			cachePath.levels.clear();
+			for (size_t l = 0; l < levels.size(); ++l) {
+				if (levels[l] != "1" && levels[l] != "2") {
+					error("'proxy_cache_path' levels must be 1 to 3 fields of 1 or 2 (e.g. '1:2'), but got '" + value + "'.",
+						directive->line, directive->column);
+				}
+				cachePath.levels.push_back(levels[l][0] - '0');
+			}
+			if (cachePath.levels.empty() || cachePath.levels.size() > 3) {
+				error("'proxy_cache_path' levels must be 1 to 3 fields of 1 or 2 (e.g. '1:2'), but got '" + value + "'.",
+					directive->line, directive->column);
+			}
+		} else if (key == "max_size") {
+			try {
+				cachePath.maxSize = parseSizeToBytes(value);
+			} catch (const std::exception& e) {
+				error("Invalid 'proxy_cache_path' max_size: " + std::string(e.what()), directive->line, directive->column);
+			}
+			if (cachePath.maxSize <= 0) {
+				error("'proxy_cache_path' max_size must be positive, but got '" + value + "'.", directive->line, directive->column);
+			}
+		} else if (key == "inactive") {
+			cachePath.inactive = parseSeconds(value);
+			if (cachePath.inactive <= 0) {
+				error("'proxy_cache_path' inactive must be a positive time (e.g. '600', '10m', '1h'), but got '" + value + "'.",
+					directive->line, directive->column);
+			}
+		} else {
+			error("Unknown 'proxy_cache_path' parameter '" + key + "'.", directive->line, directive->column);
+		}
+	}
+	if (cachePath.zone.empty()) {
+		error("Directive 'proxy_cache_path' requires a 'keys_zone=name' parameter.", directive->line, directive->column);
+	}
+	for (size_t i = 0; i < _cachePaths.size(); ++i) {
+		if (_cachePaths[i].zone == cachePath.zone) {
+			error("Duplicate proxy cache zone '" + cachePath.zone + "'.", directive->line, directive->column);
+		}
+		if (_cachePaths[i].path == cachePath.path) {
+			error("Cache directory '" + cachePath.path + "' is used by two 'proxy_cache_path' zones.", directive->line, directive->column);
+		}
+	}
+	_cachePaths.push_back(cachePath);
+}
+
+// Checks that every 'proxy_cache' names a zone declared by 'proxy_cache_path' (which may come later in the file).
+void	ConfigLoader::resolveProxyCaches(const std::vector<LocationConfig>& locations)
 {
-	ServerConfig serverConf;
+	for (size_t i = 0; i < locations.size(); ++i) {
+		const LocationConfig& location = locations[i];
 
+		resolveProxyCaches(location.nestedLocations);
+		if (location.proxyCacheZone.empty()) {
+			continue;
+		}
+		size_t z = 0;
+		while (z < _cachePaths.size() && _cachePaths[z].zone != location.proxyCacheZone) {
+			++z;
+		}
+		if (z == _cachePaths.size()) {
+			error("'proxy_cache' in location '" + location.path + "' names unknown zone '" + location.proxyCacheZone
+				+ "' (declare it with 'proxy_cache_path').", 0, 0);
+		}
+	}
+}
+
+// Parses an 'upstream' block into an UpstreamConfig: 'server host[:port] [weight=N]' entries, an optional
+// balancing method ('least_conn' or 'hash <key>', round-robin otherwise) and 'keepalive N'.
+void	ConfigLoader::parseUpstreamBlock(const BlockNode * upstreamBlockNode)
+{
+	UpstreamConfig	upstream;
+
+	upstream.name = upstreamBlockNode->args[0];
+	if (_upstreams.count(upstream.name)) {
+		error("Duplicate upstream '" + upstream.name + "'.", upstreamBlockNode->line, upstreamBlockNode->column);
+	}
+	for (size_t i = 0; i < upstreamBlockNode->children.size(); ++i) {
+		const DirectiveNode * entry = dynamic_cast<const DirectiveNode *>(upstreamBlockNode->children[i]);
+
+		if (!entry) {
+			error("Unexpected block inside 'upstream'.", upstreamBlockNode->children[i]->line, upstreamBlockNode->children[i]->column);
+		}
+		const std::vector<std::string>& args = entry->args;
+		if (entry->name == "server") {
+			if (args.empty() || args.size() > 2) {
+				error("Upstream 'server' requires an address (host or host:port) and optionally 'weight=N'.", entry->line, entry->column);
+			}
+			UpstreamServerConfig server;
+			if (!parseUpstreamAddress(args[0], server)) {
+				error("Invalid upstream server address '" + args[0] + "'. Expected 'host' or 'host:port'.", entry->line, entry->column);
+			}
+			if (args.size() == 2) {
+				std::string weight = args[1].compare(0, 7, "weight=") == 0 ? args[1].substr(7) : "";
+				if (!StringUtils::isDigits(weight) || StringUtils::stringToLong(weight) < 1 || StringUtils::stringToLong(weight) > 100) {
+					error("Invalid upstream server parameter '" + args[1] + "'. Expected 'weight=N' (1-100).", entry->line, entry->column);
+				}
+				server.weight = static_cast<int>(StringUtils::stringToLong(weight));
+			}
+			upstream.servers.push_back(server);
+		} else if (entry->name == "least_conn") {
+			if (!args.empty()) {
+				error("Upstream 'least_conn' takes no arguments.", entry->line, entry->column);
+			}
+			upstream.balance = "least_conn";
+		} else if (entry->name == "hash") {
+			std::string unknown = args.size() == 1 ? CGICache::unknownKeyVariable(args[0]) : "";
+			if (args.size() != 1 || !unknown.empty()) {
+				error("Upstream 'hash' requires one key template ($uri, $args, $request_uri, $host, $request_method).", entry->line, entry->column);
+			}
+			upstream.balance = "hash";
+			upstream.hashKey = args[0];
+		} else if (entry->name == "keepalive") {
+			if (args.size() != 1 || !StringUtils::isDigits(args[0])) {
+				error("Upstream 'keepalive' requires the number of idle connections kept per server.", entry->line, entry->column);
+			}
+			upstream.keepalive = static_cast<int>(StringUtils::stringToLong(args[0]));
+		} else {
+			error("Unexpected entry '" + entry->name + "' in upstream '" + upstream.name + "'.", entry->line, entry->column);
+		}
+	}
+	if (upstream.servers.empty()) {
+		error("Upstream '" + upstream.name + "' has no 'server' entry.", upstreamBlockNode->line, upstreamBlockNode->column);
+	}
+	_upstreams[upstream.name] = upstream;
+}
+
+// Splits "host[:port]" into an upstream server (port 80 when omitted).
+bool	ConfigLoader::parseUpstreamAddress(const std::string& address, UpstreamServerConfig& server) const
+{
+	size_t colon = address.rfind(':');
+	server.host = address.substr(0, colon);
+	if (colon != std::string::npos) {
+		std::string port = address.substr(colon + 1);
+		if (!StringUtils::isDigits(port) || StringUtils::stringToLong(port) < 1 || StringUtils::stringToLong(port) > 65535) {
+			return false;
+		}
+		server.port = static_cast<int>(StringUtils::stringToLong(port));
+	}
+	return !server.host.empty();
+}
+
+// Checks that every 'proxy_pass' names an upstream block, or gives a plain "host:port" target an
+// implicit single-server upstream of that name.
+void	ConfigLoader::resolveProxyPasses(const std::vector<LocationConfig>& locations)
+{
+	for (size_t i = 0; i < locations.size(); ++i) {
+		const LocationConfig& location = locations[i];
+
+		resolveProxyPasses(location.nestedLocations);
+		if (location.proxyPass.empty() || _upstreams.count(location.proxyPass)) {
+			continue;
+		}
+		UpstreamConfig upstream;
+		UpstreamServerConfig server;
+		if (location.proxyPass.find(':') == std::string::npos || !parseUpstreamAddress(location.proxyPass, server)) {
+			error("'proxy_pass' in location '" + location.path + "' names unknown upstream '" + location.proxyPass + "'.", 0, 0);
+		}
+		upstream.name = location.proxyPass;
+		upstream.servers.push_back(server);
+		_upstreams[upstream.name] = upstream;
+	}
+}
+
+// Collects 'types' entries into the extension -> MIME type map. Later entries override earlier ones.
+void	ConfigLoader::parseTypesBlock(const BlockNode * typesBlockNode)
+{
+	for (size_t i = 0; i < typesBlockNode->children.size(); ++i) {
+		const DirectiveNode * entry = dynamic_cast<const DirectiveNode *>(typesBlockNode->children[i]);
+
+		if (!entry) {
+			error("Unexpected block inside 'types'.", typesBlockNode->children[i]->line, typesBlockNode->children[i]->column);
+		}
+		if (entry->name.find('/') == std::string::npos) {
+			error("Invalid MIME type '" + entry->name + "' in 'types' block.", entry->line, entry->column);
+		}
+		for (size_t j = 0; j < entry->args.size(); ++j) {
+			std::string ext = entry->args[j];
+
+			if (!ext.empty() && ext[0] == '.') {
+				ext.erase(0, 1);
+			}
+			if (ext.empty()) {
+				error("Empty file extension for MIME type '" + entry->name + "'.", entry->line, entry->column);
+			}
+			StringUtils::toLower(ext);
+			_mimeTypes[ext] = entry->name;
+		}
+	}
+}
+
+// Parses a single 'server' block from its AST node into 'serverConf' (default-constructed).
+void    ConfigLoader::parseServerBlock(const BlockNode * serverBlockNode, ServerConfig & serverConf)
+{
+	serverConf.locations.reserve(countBlocks(serverBlockNode->children, "location"));
 	// Iterate through child nodes of the server block.
 	for (size_t i = 0; i < serverBlockNode->children.size(); ++i) {
 		ASTnode * childNode = serverBlockNode->children[i];
@@ -70,7 +392,8 @@ ServerConfig    ConfigLoader::parseServerBlock(const BlockNode * serverBlockNode
 			processDirective(directive, serverConf);
 		} else if (nestedBlock && nestedBlock->name == "location") {
 			// Recursively parse nested location blocks.
-			serverConf.locations.push_back(parseLocationBlock(nestedBlock, serverConf));
+			serverConf.locations.push_back(LocationConfig());
+			parseLocationBlock(nestedBlock, serverConf, serverConf.locations.back());
 		} else {
 			// Handle unexpected child nodes.
 			error("Unexpected child node in server block. Expected a directive or 'location' block.",
@@ -87,18 +410,120 @@ ServerConfig    ConfigLoader::parseServerBlock(const BlockNode * serverBlockNode
 			error("Server block has no 'root' directive and no 'location' blocks defined. Cannot serve content.",
 			  serverBlockNode->line, serverBlockNode->column);
 	}
-	return (serverConf);
+	// Server name and port are final only now, and they are part of the CGI environment prefix.
+	resolveCgiLocations(serverConf.locations, serverConf);
+	resolveEffectiveLocations(serverConf);
 }
 
-// Parses a top-level 'location' block from its AST node into a LocationConfig object.
-LocationConfig    ConfigLoader::parseLocationBlock(const BlockNode * locationBlockNode, const ServerConfig & parentServerDefaults)
+// Returns a directory path with exactly one trailing '/', or "" for an empty path.
+static std::string directoryPath(const std::string& path) {
+	if (path.empty() || path[path.size() - 1] == '/') {
+		return path;
+	}
+	return path + "/";
+}
+
+// Fills in the settings of a server's requests that match no location, then those of its locations.
+void ConfigLoader::resolveEffectiveLocations(ServerConfig& serverConfig) const {
+	EffectiveLocation& effective = serverConfig.effective;
+
+	effective.root = directoryPath(serverConfig.root);
+	effective.clientMaxBodySize = serverConfig.clientMaxBodySize != 0 ? serverConfig.clientMaxBodySize : LONG_MAX;
+	effective.errorPages = serverConfig.errorPages;
+	effective.indexFiles = serverConfig.indexFiles;
+	effective.autoindex = serverConfig.autoindex;
+	effective.autoindexFormat = serverConfig.autoindexFormat;
+	effective.allowedMethods = HTTP_METHOD_BIT(HTTP_GET) | HTTP_METHOD_BIT(HTTP_POST) | HTTP_METHOD_BIT(HTTP_DELETE);
+	resolveEffectiveLocations(serverConfig.locations, effective);
+}
+
+// Each setting a location leaves unset falls back to the server's. Nested locations already start
+// from a copy of their parent (see parseLocationBlock).
+void ConfigLoader::resolveEffectiveLocations(std::vector<LocationConfig>& locations, const EffectiveLocation& serverDefaults) const {
+	for (size_t i = 0; i < locations.size(); ++i) {
+		LocationConfig& location = locations[i];
+		EffectiveLocation& effective = location.effective;
+
+		effective.root = location.root.empty() ? serverDefaults.root : directoryPath(location.root);
+		effective.uploadStore = directoryPath(location.uploadStore);
+		effective.clientMaxBodySize = location.clientMaxBodySize != 0 ? location.clientMaxBodySize : serverDefaults.clientMaxBodySize;
+		effective.errorPages = location.errorPages.empty() ? serverDefaults.errorPages : location.errorPages;
+		effective.indexFiles = location.indexFiles.empty() ? serverDefaults.indexFiles : location.indexFiles;
+		effective.autoindex = location.autoindex || serverDefaults.autoindex;
+		effective.autoindexFormat = location.autoindexFormat;
+		if (location.allowedMethods.empty()) {
+			effective.allowedMethods = serverDefaults.allowedMethods;
+		} else {
+			effective.allowedMethods = 0;
+			for (size_t m = 0; m < location.allowedMethods.size(); ++m) {
+				effective.allowedMethods |= HTTP_METHOD_BIT(location.allowedMethods[m]);
+			}
+		}
+		resolveEffectiveLocations(location.nestedLocations, serverDefaults);
+	}
+}
+
+// Resolves what every CGI request of these locations (and their nested ones) would otherwise
+// recompute: the absolute document root, absolute executable interpreters and the static
+// meta-variables. Paths that don't resolve are reported here and fail the request with a 500.
+void ConfigLoader::resolveCgiLocations(std::vector<LocationConfig>& locations, const ServerConfig& serverConfig) const {
+	for (size_t i = 0; i < locations.size(); ++i) {
+		LocationConfig& location = locations[i];
+		resolveCgiLocations(location.nestedLocations, serverConfig);
+		if (location.cgiExecutables.empty() && location.fastcgiPass.empty()) {
+			continue;
+		}
+
+		char resolved[PATH_MAX];
+		location.cgiRootPath.clear();
+		if (realpath(location.root.c_str(), resolved) != NULL) {
+			location.cgiRootPath = resolved;
+			if (location.cgiRootPath.length() > 1 && location.cgiRootPath[location.cgiRootPath.length() - 1] == '/') {
+				location.cgiRootPath.erase(location.cgiRootPath.length() - 1);
+			}
+		} else {
+			std::cerr << "WARNING: CGI root '" << location.root << "' of location " << location.path << " does not resolve." << std::endl;
+		}
+
+		// Relative interpreters are made absolute (the child changes directory before exec),
+		// but symlinks are kept: some interpreters look at the name they were run as.
+		location.cgiResolvedExecutables.clear();
+		std::map<std::string, std::string>::const_iterator it;
+		for (it = location.cgiExecutables.begin(); it != location.cgiExecutables.end(); ++it) {
+			std::string executable = it->second;
+			if (executable[0] != '/' && getcwd(resolved, sizeof(resolved)) != NULL) {
+				executable = std::string(resolved) + "/" + executable;
+			}
+			if (access(executable.c_str(), X_OK) == -1) {
+				std::cerr << "WARNING: CGI executable '" << it->second << "' for " << it->first << " is not executable." << std::endl;
+				executable.clear();
+			}
+			location.cgiResolvedExecutables[it->first] = executable;
+		}
+
+		location.cgiEnvPrefix.clear();
+		StringUtils::appendEnvEntry(location.cgiEnvPrefix, "REDIRECT_STATUS", "200");
+		StringUtils::appendEnvEntry(location.cgiEnvPrefix, "SERVER_NAME",
+					   serverConfig.serverNames.empty() ? std::string("localhost") : serverConfig.serverNames[0]);
+		StringUtils::appendEnvEntry(location.cgiEnvPrefix, "SERVER_PORT", StringUtils::longToString(serverConfig.port));
+		StringUtils::appendEnvEntry(location.cgiEnvPrefix, "DOCUMENT_ROOT",
+					   location.cgiRootPath.empty() ? location.root : location.cgiRootPath);
+		StringUtils::appendEnvEntry(location.cgiEnvPrefix, "REMOTE_ADDR", "127.0.0.1");
+		StringUtils::appendEnvEntry(location.cgiEnvPrefix, "REMOTE_PORT", "8080");
+	}
+}
+
+// Parses a top-level 'location' block from its AST node into 'locationConf' (default-constructed).
+void    ConfigLoader::parseLocationBlock(const BlockNode * locationBlockNode, const ServerConfig & parentServerDefaults,
+										 LocationConfig & locationConf)
 {
-	LocationConfig locationConf;
+	locationConf.nestedLocations.reserve(countBlocks(locationBlockNode->children, "location"));
 
 	// Initialize LocationConfig with inherited defaults from parentServerDefaults.
 	locationConf.root = parentServerDefaults.root;
 	locationConf.indexFiles = parentServerDefaults.indexFiles;
 	locationConf.autoindex = parentServerDefaults.autoindex;
+	locationConf.autoindexFormat = parentServerDefaults.autoindexFormat;
 	locationConf.errorPages = parentServerDefaults.errorPages;
 	locationConf.clientMaxBodySize = parentServerDefaults.clientMaxBodySize;
 
@@ -123,6 +548,13 @@ LocationConfig    ConfigLoader::parseLocationBlock(const BlockNode * locationBlo
 		error("Location block has too many arguments. Expected a path or a modifier and a path.",
 			  locationBlockNode->line, locationBlockNode->column);
 	}
+	if (locationConf.matchType == "~" || locationConf.matchType == "~*") {
+		std::string regexError = LocationMatcher::checkRegex(locationConf.path, locationConf.matchType == "~*");
+		if (!regexError.empty()) {
+			error("Invalid location regex '" + locationConf.path + "': " + regexError + ".",
+				  locationBlockNode->line, locationBlockNode->column);
+		}
+	}
 
 	// Iterate and process child directives and nested location blocks.
 	for (size_t i = 0; i < locationBlockNode->children.size(); ++i) {
@@ -134,7 +566,8 @@ LocationConfig    ConfigLoader::parseLocationBlock(const BlockNode * locationBlo
 			processDirective(directive, locationConf);
 		} else if (nestedBlock && nestedBlock->name == "location") {
 			// Recursively call the overload for nested locations.
-			locationConf.nestedLocations.push_back(parseLocationBlock(nestedBlock, locationConf));
+			locationConf.nestedLocations.push_back(LocationConfig());
+			parseLocationBlock(nestedBlock, locationConf, locationConf.nestedLocations.back());
 		} else {
 			error("Unexpected child node in location block. Expected a directive or a nested 'location' block.",
 				  childNode->line, childNode->column);
@@ -164,24 +597,42 @@ LocationConfig    ConfigLoader::parseLocationBlock(const BlockNode * locationBlo
 				  locationBlockNode->line, locationBlockNode->column);
 		}
 	}
-	return (locationConf);
 }
 
-// Parses a nested 'location' block from its AST node into a LocationConfig object.
-LocationConfig    ConfigLoader::parseLocationBlock(const BlockNode * locationBlockNode, const LocationConfig & parentLocationDefaults)
+// Parses a nested 'location' block from its AST node into 'locationConf' (default-constructed).
+void    ConfigLoader::parseLocationBlock(const BlockNode * locationBlockNode, const LocationConfig & parentLocationDefaults,
+										 LocationConfig & locationConf)
 {
-	LocationConfig locationConf;
+	locationConf.nestedLocations.reserve(countBlocks(locationBlockNode->children, "location"));
 
 	// Initialize LocationConfig with inherited defaults from parentLocationDefaults.
 	locationConf.root = parentLocationDefaults.root;
 	locationConf.indexFiles = parentLocationDefaults.indexFiles;
 	locationConf.autoindex = parentLocationDefaults.autoindex;
+	locationConf.autoindexFormat = parentLocationDefaults.autoindexFormat;
 	locationConf.errorPages = parentLocationDefaults.errorPages;
 	locationConf.clientMaxBodySize = parentLocationDefaults.clientMaxBodySize;
 	locationConf.allowedMethods = parentLocationDefaults.allowedMethods;
 	locationConf.uploadEnabled = parentLocationDefaults.uploadEnabled;
 	locationConf.uploadStore = parentLocationDefaults.uploadStore;
 	locationConf.cgiExecutables = parentLocationDefaults.cgiExecutables;
+	locationConf.fastcgiPass = parentLocationDefaults.fastcgiPass;
+	locationConf.cgiPoolSize = parentLocationDefaults.cgiPoolSize;
+	locationConf.cgiPoolMaxRequests = parentLocationDefaults.cgiPoolMaxRequests;
+	locationConf.cgiPoolWorker = parentLocationDefaults.cgiPoolWorker;
+	locationConf.cgiMaxConcurrent = parentLocationDefaults.cgiMaxConcurrent;
+	locationConf.cgiAdaptive = parentLocationDefaults.cgiAdaptive;
+	locationConf.cgiQueueSize = parentLocationDefaults.cgiQueueSize;
+	locationConf.cgiQueueTimeout = parentLocationDefaults.cgiQueueTimeout;
+	locationConf.cgiCacheZone = parentLocationDefaults.cgiCacheZone;
+	locationConf.cgiCacheSize = parentLocationDefaults.cgiCacheSize;
+	locationConf.cgiCacheValid = parentLocationDefaults.cgiCacheValid;
+	locationConf.cgiCacheStale = parentLocationDefaults.cgiCacheStale;
+	locationConf.cgiCacheKey = parentLocationDefaults.cgiCacheKey;
+	locationConf.proxyPass = parentLocationDefaults.proxyPass;
+	locationConf.proxyCacheZone = parentLocationDefaults.proxyCacheZone;
+	locationConf.proxyCacheValid = parentLocationDefaults.proxyCacheValid;
+	locationConf.proxyCacheKey = parentLocationDefaults.proxyCacheKey;
 	locationConf.returnCode = parentLocationDefaults.returnCode;
 	locationConf.returnUrlOrText = parentLocationDefaults.returnUrlOrText;
 
@@ -206,6 +657,24 @@ LocationConfig    ConfigLoader::parseLocationBlock(const BlockNode * locationBlo
 		error("Location block has too many arguments. Expected a path or a modifier and a path.",
 			  locationBlockNode->line, locationBlockNode->column);
 	}
+	if (locationConf.matchType == "~" || locationConf.matchType == "~*") {
+		std::string regexError = LocationMatcher::checkRegex(locationConf.path, locationConf.matchType == "~*");
+		if (!regexError.empty()) {
+			error("Invalid location regex '" + locationConf.path + "': " + regexError + ".",
+				  locationBlockNode->line, locationBlockNode->column);
+		}
+	}
+	// The trie matches nested locations by their full path, so it has to extend the parent's.
+	if (parentLocationDefaults.matchType == "=") {
+		error("Location '= " + parentLocationDefaults.path + "' cannot have nested locations.",
+			  locationBlockNode->line, locationBlockNode->column);
+	}
+	if ((parentLocationDefaults.matchType.empty() || parentLocationDefaults.matchType == "^~")
+		&& (locationConf.matchType.empty() || locationConf.matchType == "=" || locationConf.matchType == "^~")
+		&& locationConf.path.compare(0, parentLocationDefaults.path.length(), parentLocationDefaults.path) != 0) {
+		error("Nested location '" + locationConf.path + "' is outside location '" + parentLocationDefaults.path + "'.",
+			  locationBlockNode->line, locationBlockNode->column);
+	}
 
 	// Iterate and process child directives and further nested location blocks.
 	for (size_t i = 0; i < locationBlockNode->children.size(); ++i) {
@@ -217,7 +686,8 @@ LocationConfig    ConfigLoader::parseLocationBlock(const BlockNode * locationBlo
 			processDirective(directive, locationConf);
 		} else if (nestedBlock && nestedBlock->name == "location") {
 			// Recursively call this overload for deeper nested locations.
-			locationConf.nestedLocations.push_back(parseLocationBlock(nestedBlock, locationConf));
+			locationConf.nestedLocations.push_back(LocationConfig());
+			parseLocationBlock(nestedBlock, locationConf, locationConf.nestedLocations.back());
 		} else {
 			error("Unexpected child node in location block. Expected a directive or a nested 'location' block.",
 				  childNode->line, childNode->column);
@@ -247,7 +717,6 @@ LocationConfig    ConfigLoader::parseLocationBlock(const BlockNode * locationBlo
 				  locationBlockNode->line, locationBlockNode->column);
 		}
 	}
-	return (locationConf);
 }
 
 // Dispatches a DirectiveNode to the appropriate handler for ServerConfig.
@@ -261,7 +730,11 @@ void ConfigLoader::processDirective(const DirectiveNode* directive, ServerConfig
 		handleServerNameDirective(directive, serverConfig);
 	} else if (name == "error_log") {
 		handleErrorLogDirective(directive, serverConfig);
-	} 
+	} else if (name == "keepalive_requests") {
+		handleKeepaliveRequestsDirective(directive, serverConfig);
+	} else if (name == "keepalive_timeout") {
+		handleKeepaliveTimeoutDirective(directive, serverConfig);
+	}
 	// Directives common to both Server and Location contexts.
 	else if (name == "root") {
 		handleRootDirective(directive, serverConfig);
@@ -269,6 +742,8 @@ void ConfigLoader::processDirective(const DirectiveNode* directive, ServerConfig
 		handleIndexDirective(directive, serverConfig);
 	} else if (name == "autoindex") {
 		handleAutoindexDirective(directive, serverConfig);
+	} else if (name == "autoindex_format") {
+		handleAutoindexFormatDirective(directive, serverConfig);
 	} else if (name == "error_page") {
 		handleErrorPageDirective(directive, serverConfig);
 	} else if (name == "client_max_body_size") {
@@ -292,6 +767,8 @@ void ConfigLoader::processDirective(const DirectiveNode* directive, LocationConf
 		handleIndexDirective(directive, locationConfig);
 	} else if (name == "autoindex") {
 		handleAutoindexDirective(directive, locationConfig);
+	} else if (name == "autoindex_format") {
+		handleAutoindexFormatDirective(directive, locationConfig);
 	} else if (name == "error_page") {
 		handleErrorPageDirective(directive, locationConfig);
 	} else if (name == "client_max_body_size") {
@@ -310,6 +787,20 @@ void ConfigLoader::processDirective(const DirectiveNode* directive, LocationConf
 		handleCgiPathDirective(directive, locationConfig);
 	} else if (name == "return") {
 		handleReturnDirective(directive, locationConfig);
+	} else if (name == "fastcgi_pass") {
+		handleFastcgiPassDirective(directive, locationConfig);
+	} else if (name == "cgi_pool") {
+		handleCgiPoolDirective(directive, locationConfig);
+	} else if (name == "cgi_max_concurrent") {
+		handleCgiMaxConcurrentDirective(directive, locationConfig);
+	} else if (name == "cgi_queue") {
+		handleCgiQueueDirective(directive, locationConfig);
+	} else if (name == "cgi_cache") {
+		handleCgiCacheDirective(directive, locationConfig);
+	} else if (name == "proxy_pass") {
+		handleProxyPassDirective(directive, locationConfig);
+	} else if (name == "proxy_cache") {
+		handleProxyCacheDirective(directive, locationConfig);
 	}
 	// Handle unexpected directives.
 	else {
@@ -323,10 +814,11 @@ void ConfigLoader::handleListenDirective(const DirectiveNode* directive, ServerC
 	const std::vector<std::string>& args = directive->args;
 	
 	// Validate argument count.
-	if (args.size() != 1) {
-		error("Directive 'listen' requires exactly one argument (port or IP:port).",
+	if (args.size() != 1 && !(args.size() == 2 && args[1] == "default_server")) {
+		error("Directive 'listen' requires one argument (port or IP:port), optionally followed by 'default_server'.",
 			  directive->line, directive->column);
 	}
+	serverConfig.defaultServer = (args.size() == 2);
 
 	const std::string& listenArg = args[0];
 	size_t colon_pos = listenArg.find(':');
@@ -394,6 +886,12 @@ void ConfigLoader::handleServerNameDirective(const DirectiveNode* directive, Ser
 			  directive->line, directive->column);
 	}
 
+	for (size_t i = 0; i < args.size(); ++i) {
+		if (!VirtualHosts::isValidName(args[i])) {
+			error("Invalid server name '" + args[i] + "'. Expected a name, '*.example.com', '.example.com' or 'www.example.*'.",
+				  directive->line, directive->column);
+		}
+	}
 	// Assign all arguments as server names.
 	serverConfig.serverNames = args;
 }
@@ -426,6 +924,48 @@ void ConfigLoader::handleErrorLogDirective(const DirectiveNode* directive, Serve
 	}
 }
 
+// Handles the 'keepalive_requests' directive for a ServerConfig.
+void ConfigLoader::handleKeepaliveRequestsDirective(const DirectiveNode* directive, ServerConfig& serverConfig) {
+	const std::vector<std::string>& args = directive->args;
+
+	if (args.size() != 1) {
+		error("Directive 'keepalive_requests' requires exactly one argument (number of requests).",
+			  directive->line, directive->column);
+	}
+	try {
+		serverConfig.keepaliveRequests = StringUtils::stringToLong(args[0]);
+	} catch (const std::exception& e) {
+		error("Invalid keepalive_requests value: " + std::string(e.what()),
+			  directive->line, directive->column);
+	}
+	if (serverConfig.keepaliveRequests < 0) {
+		error("Argument for 'keepalive_requests' must be non-negative.", directive->line, directive->column);
+	}
+}
+
+// Handles the 'keepalive_timeout' directive for a ServerConfig. Accepts 'N' or 'Ns' (seconds).
+void ConfigLoader::handleKeepaliveTimeoutDirective(const DirectiveNode* directive, ServerConfig& serverConfig) {
+	const std::vector<std::string>& args = directive->args;
+
+	if (args.size() != 1) {
+		error("Directive 'keepalive_timeout' requires exactly one argument (seconds).",
+			  directive->line, directive->column);
+	}
+	std::string seconds = args[0];
+	if (!seconds.empty() && seconds[seconds.length() - 1] == 's') {
+		seconds.erase(seconds.length() - 1);
+	}
+	try {
+		serverConfig.keepaliveTimeout = StringUtils::stringToLong(seconds);
+	} catch (const std::exception& e) {
+		error("Invalid keepalive_timeout value: " + std::string(e.what()),
+			  directive->line, directive->column);
+	}
+	if (serverConfig.keepaliveTimeout < 0) {
+		error("Argument for 'keepalive_timeout' must be non-negative.", directive->line, directive->column);
+	}
+}
+
 // Handles the 'root' directive for a ServerConfig.
 void ConfigLoader::handleRootDirective(const DirectiveNode* directive, ServerConfig& serverConfig) {
 	const std::vector<std::string>& args = directive->args;
@@ -518,6 +1058,38 @@ void ConfigLoader::handleAutoindexDirective(const DirectiveNode* directive, Loca
 	}
 }
 
+// Handles the 'autoindex_format' directive for a ServerConfig.
+void ConfigLoader::handleAutoindexFormatDirective(const DirectiveNode* directive, ServerConfig& serverConfig) {
+	const std::vector<std::string>& args = directive->args;
+
+	// Validate argument count.
+	if (args.size() != 1) {
+		error("Directive 'autoindex_format' requires exactly one argument ('html' or 'json').",
+			  directive->line, directive->column);
+	}
+	// Validate argument value.
+	if (args[0] != "html" && args[0] != "json") {
+		error("Argument for 'autoindex_format' must be 'html' or 'json', but got '" + args[0] + "'.",
+			  directive->line, directive->column);
+	}
+	serverConfig.autoindexFormat = args[0];
+}
+
+// Handles the 'autoindex_format' directive for a LocationConfig.
+void ConfigLoader::handleAutoindexFormatDirective(const DirectiveNode* directive, LocationConfig& locationConfig) {
+	const std::vector<std::string>& args = directive->args;
+
+	if (args.size() != 1) {
+		error("Directive 'autoindex_format' requires exactly one argument ('html' or 'json').",
+			  directive->line, directive->column);
+	}
+	if (args[0] != "html" && args[0] != "json") {
+		error("Argument for 'autoindex_format' must be 'html' or 'json', but got '" + args[0] + "'.",
+			  directive->line, directive->column);
+	}
+	locationConfig.autoindexFormat = args[0];
+}
+
 // Handles the 'error_page' directive for a ServerConfig.
 void ConfigLoader::handleErrorPageDirective(const DirectiveNode* directive, ServerConfig& serverConfig) {
 	const std::vector<std::string>& args = directive->args;
@@ -811,6 +1383,29 @@ LogLevel ConfigLoader::stringToLogLevel(const std::string& levelStr) const {
 	throw std::invalid_argument("Unknown log level '" + levelStr + "'. Expected debug, info, warn, error, crit, alert, or emerg.");
 }
 
+// Parses a time ("30", "30s", "10m", "2h", "1d") into seconds. Returns -1 if malformed.
+long ConfigLoader::parseSeconds(const std::string& value) const {
+	std::string digits = value;
+	long unit = 1;
+	if (!digits.empty() && !std::isdigit(static_cast<unsigned char>(digits[digits.length() - 1]))) {
+		char suffix = digits[digits.length() - 1];
+		if (suffix == 'm') {
+			unit = 60;
+		} else if (suffix == 'h') {
+			unit = 3600;
+		} else if (suffix == 'd') {
+			unit = 86400;
+		} else if (suffix != 's') {
+			return -1;
+		}
+		digits.erase(digits.length() - 1);
+	}
+	if (!StringUtils::isDigits(digits) || digits.length() > 9) {
+		return -1;
+	}
+	return StringUtils::stringToLong(digits) * unit;
+}
+
 // Parses a size string (e.g., "10m", "512k", "2g") into bytes.
 long ConfigLoader::parseSizeToBytes(const std::string& sizeStr) const {
 	if (sizeStr.empty()) {
@@ -865,4 +1460,207 @@ void ConfigLoader::error(const std::string& msg, int line, int col) const {
 	std::ostringstream oss;
 	oss << "Config Load Error at line " << line << ", col " << col << ": " << msg;
 	throw ConfigLoadError(oss.str(), line, col);
-}
\ No newline at end of file
+}
+// Handles the 'fastcgi_pass' directive for a LocationConfig ('unix:/path' or 'host:port').
+void ConfigLoader::handleFastcgiPassDirective(const DirectiveNode* directive, LocationConfig& locationConfig) {
+	const std::vector<std::string>& args = directive->args;
+
+	if (args.size() != 1) {
+		error("Directive 'fastcgi_pass' requires exactly one argument ('unix:/path' or 'host:port').",
+			  directive->line, directive->column);
+	}
+	const std::string& address = args[0];
+	if (address.compare(0, 5, "unix:") == 0) {
+		if (address.length() == 5) {
+			error("Directive 'fastcgi_pass' has an empty unix socket path.", directive->line, directive->column);
+		}
+	} else {
+		size_t colon = address.rfind(':');
+		if (colon == std::string::npos || colon == 0 || !StringUtils::isDigits(address.substr(colon + 1))) {
+			error("Invalid 'fastcgi_pass' address '" + address + "'. Expected 'unix:/path' or 'host:port'.",
+				  directive->line, directive->column);
+		}
+	}
+	locationConfig.fastcgiPass = address;
+}
+
+// Handles the 'cgi_pool size=N [max_requests=M] [worker=path]' directive for a LocationConfig.
+void ConfigLoader::handleCgiPoolDirective(const DirectiveNode* directive, LocationConfig& locationConfig) {
+	const std::vector<std::string>& args = directive->args;
+	bool sizeSet = false;
+
+	for (size_t i = 0; i < args.size(); ++i) {
+		size_t eq_pos = args[i].find('=');
+		if (eq_pos == std::string::npos) {
+			error("Invalid 'cgi_pool' parameter '" + args[i] + "'. Expected key=value.", directive->line, directive->column);
+		}
+		std::string key = args[i].substr(0, eq_pos);
+		std::string value = args[i].substr(eq_pos + 1);
+
+		if (key == "worker") {
+			locationConfig.cgiPoolWorker = value;
+			continue;
+		}
+		if (key != "size" && key != "max_requests") {
+			error("Unknown 'cgi_pool' parameter '" + key + "'.", directive->line, directive->column);
+		}
+		if (!StringUtils::isDigits(value)) {
+			error("Value of 'cgi_pool' parameter '" + key + "' must be a non-negative integer.", directive->line, directive->column);
+		}
+		long number = StringUtils::stringToLong(value);
+		if (key == "size") {
+			if (number < 1 || number > 1024) {
+				error("'cgi_pool' size must be between 1 and 1024.", directive->line, directive->column);
+			}
+			locationConfig.cgiPoolSize = static_cast<int>(number);
+			sizeSet = true;
+		} else {
+			locationConfig.cgiPoolMaxRequests = number;
+		}
+	}
+	if (!sizeSet) {
+		error("Directive 'cgi_pool' requires a 'size=N' parameter.", directive->line, directive->column);
+	}
+}
+
+// Handles the 'cgi_max_concurrent N [adaptive]' directive for a LocationConfig.
+void ConfigLoader::handleCgiMaxConcurrentDirective(const DirectiveNode* directive, LocationConfig& locationConfig) {
+	const std::vector<std::string>& args = directive->args;
+
+	if (!StringUtils::isDigits(args[0])) {
+		error("Argument for 'cgi_max_concurrent' must be a positive integer, but got '" + args[0] + "'.",
+			  directive->line, directive->column);
+	}
+	long number = StringUtils::stringToLong(args[0]);
+	if (number < 1 || number > 65536) {
+		error("'cgi_max_concurrent' must be between 1 and 65536.", directive->line, directive->column);
+	}
+	locationConfig.cgiMaxConcurrent = static_cast<int>(number);
+	locationConfig.cgiAdaptive = (args.size() == 2);
+}
+
+// Handles the 'cgi_queue M [timeout=T]' directive for a LocationConfig (T in seconds, optional 's' suffix).
+void ConfigLoader::handleCgiQueueDirective(const DirectiveNode* directive, LocationConfig& locationConfig) {
+	const std::vector<std::string>& args = directive->args;
+
+	if (!StringUtils::isDigits(args[0])) {
+		error("Argument for 'cgi_queue' must be a non-negative integer, but got '" + args[0] + "'.",
+			  directive->line, directive->column);
+	}
+	locationConfig.cgiQueueSize = StringUtils::stringToLong(args[0]);
+	if (args.size() == 2) {
+		std::string seconds = args[1].substr(8);
+		if (!seconds.empty() && seconds[seconds.length() - 1] == 's') {
+			seconds.erase(seconds.length() - 1);
+		}
+		if (!StringUtils::isDigits(seconds) || StringUtils::stringToLong(seconds) < 1) {
+			error("'cgi_queue' timeout must be a positive number of seconds, but got '" + args[1].substr(8) + "'.",
+				  directive->line, directive->column);
+		}
+		locationConfig.cgiQueueTimeout = StringUtils::stringToLong(seconds);
+	}
+}
+
+// Handles 'proxy_pass http://upstream_name' (or 'http://host:port') for a LocationConfig. The request
+// URI is forwarded unchanged, so the target may not carry a path of its own.
+void ConfigLoader::handleProxyPassDirective(const DirectiveNode* directive, LocationConfig& locationConfig) {
+	std::string target = directive->args[0].substr(7);
+
+	if (target.find('/') != std::string::npos) {
+		error("'proxy_pass' target '" + directive->args[0] + "' may not include a URI path.", directive->line, directive->column);
+	}
+	locationConfig.proxyPass = target;
+}
+
+// Handles 'proxy_cache zone [valid=T] [key=K]' or 'proxy_cache off' for a LocationConfig. 'valid' only
+// applies to responses that carry neither Cache-Control max-age nor Expires.
+void ConfigLoader::handleProxyCacheDirective(const DirectiveNode* directive, LocationConfig& locationConfig) {
+	const std::vector<std::string>& args = directive->args;
+
+	if (args[0] == "off") {
+		locationConfig.proxyCacheZone.clear();
+		return;
+	}
+	for (size_t i = 1; i < args.size(); ++i) {
+		size_t eq_pos = args[i].find('=');
+		if (eq_pos == std::string::npos) {
+			error("Invalid 'proxy_cache' parameter '" + args[i] + "'. Expected key=value.", directive->line, directive->column);
+		}
+		std::string key = args[i].substr(0, eq_pos);
+		std::string value = args[i].substr(eq_pos + 1);
+
+		if (key == "valid") {
+			locationConfig.proxyCacheValid = parseSeconds(value);
+			if (locationConfig.proxyCacheValid < 0) {
+				error("'proxy_cache' valid must be a time (e.g. '60', '10m', '1h'), but got '" + value + "'.", directive->line, directive->column);
+			}
+		} else if (key == "key") {
+			std::string unknown = CGICache::unknownKeyVariable(value);
+			if (value.empty() || !unknown.empty()) {
+				error("'proxy_cache' key uses unknown variable '" + unknown + "'.", directive->line, directive->column);
+			}
+			locationConfig.proxyCacheKey = value;
+		} else {
+			error("Unknown 'proxy_cache' parameter '" + key + "'.", directive->line, directive->column);
+		}
+	}
+	locationConfig.proxyCacheZone = args[0];
+}
+
+// Handles 'cgi_cache zone size=S [valid=T] [stale=T] [key=K]' or 'cgi_cache off' for a LocationConfig
+// (T in seconds, optional 's' suffix). Locations naming the same zone share it, so they must agree on its size.
+void ConfigLoader::handleCgiCacheDirective(const DirectiveNode* directive, LocationConfig& locationConfig) {
+	const std::vector<std::string>& args = directive->args;
+
+	if (args[0] == "off") {
+		locationConfig.cgiCacheZone.clear();
+		return;
+	}
+	long size = 0;
+	for (size_t i = 1; i < args.size(); ++i) {
+		size_t eq_pos = args[i].find('=');
+		if (eq_pos == std::string::npos) {
+			error("Invalid 'cgi_cache' parameter '" + args[i] + "'. Expected key=value.", directive->line, directive->column);
+		}
+		std::string key = args[i].substr(0, eq_pos);
+		std::string value = args[i].substr(eq_pos + 1);
+
+		if (key == "size") {
+			try {
+				size = parseSizeToBytes(value);
+			} catch (const std::exception& e) {
+				error("Invalid 'cgi_cache' size: " + std::string(e.what()), directive->line, directive->column);
+			}
+			if (size <= 0) {
+				error("'cgi_cache' size must be positive, but got '" + value + "'.", directive->line, directive->column);
+			}
+		} else if (key == "valid" || key == "stale") {
+			std::string seconds = value;
+			if (!seconds.empty() && seconds[seconds.length() - 1] == 's') {
+				seconds.erase(seconds.length() - 1);
+			}
+			if (!StringUtils::isDigits(seconds) || (key == "valid" && StringUtils::stringToLong(seconds) < 1)) {
+				error("'cgi_cache' " + key + " must be a number of seconds, but got '" + value + "'.", directive->line, directive->column);
+			}
+			(key == "valid" ? locationConfig.cgiCacheValid : locationConfig.cgiCacheStale) = StringUtils::stringToLong(seconds);
+		} else if (key == "key") {
+			std::string unknown = CGICache::unknownKeyVariable(value);
+			if (value.empty() || !unknown.empty()) {
+				error("'cgi_cache' key uses unknown variable '" + unknown + "'.", directive->line, directive->column);
+			}
+			locationConfig.cgiCacheKey = value;
+		} else {
+			error("Unknown 'cgi_cache' parameter '" + key + "'.", directive->line, directive->column);
+		}
+	}
+	if (size == 0) {
+		error("Directive 'cgi_cache' requires a 'size=S' parameter.", directive->line, directive->column);
+	}
+	std::map<std::string, long>::iterator zone = _cacheZones.find(args[0]);
+	if (zone != _cacheZones.end() && zone->second != size) {
+		error("'cgi_cache' zone '" + args[0] + "' is declared with different sizes.", directive->line, directive->column);
+	}
+	_cacheZones[args[0]] = size;
+	locationConfig.cgiCacheZone = args[0];
+	locationConfig.cgiCacheSize = size;
+}
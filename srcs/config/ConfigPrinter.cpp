@@ -49,6 +49,7 @@ namespace ConfigPrinter {
         os << "]\n";
 
         os << indent << "    Autoindex: " << (loc.autoindex ? "on" : "off") << "\n";
+        os << indent << "    Autoindex Format: " << loc.autoindexFormat << "\n";
         
         os << indent << "    Allowed Methods: [";
         for (size_t i = 0; i < loc.allowedMethods.size(); ++i) {
@@ -71,6 +72,27 @@ namespace ConfigPrinter {
             }
         }
 
+        os << indent << "    FastCGI Pass: '" << loc.fastcgiPass << "'\n";
+        os << indent << "    CGI Pool: size=" << loc.cgiPoolSize << " max_requests=" << loc.cgiPoolMaxRequests
+           << " worker='" << loc.cgiPoolWorker << "'\n";
+        os << indent << "    CGI Max Concurrent: " << loc.cgiMaxConcurrent << (loc.cgiAdaptive ? " (adaptive)" : "")
+           << ", Queue: " << loc.cgiQueueSize << " (timeout " << loc.cgiQueueTimeout << "s)\n";
+        os << indent << "    CGI Cache: ";
+        if (loc.cgiCacheZone.empty()) {
+            os << "off\n";
+        } else {
+            os << "zone '" << loc.cgiCacheZone << "' size=" << loc.cgiCacheSize << " valid=" << loc.cgiCacheValid
+               << "s stale=" << loc.cgiCacheStale << "s key='" << loc.cgiCacheKey << "'\n";
+        }
+
+        os << indent << "    Proxy Pass: '" << loc.proxyPass << "'\n";
+        os << indent << "    Proxy Cache: ";
+        if (loc.proxyCacheZone.empty()) {
+            os << "off\n";
+        } else {
+            os << "zone '" << loc.proxyCacheZone << "' valid=" << loc.proxyCacheValid << "s key='" << loc.proxyCacheKey << "'\n";
+        }
+
         os << indent << "    Return: ";
         if (loc.returnCode != 0) {
             os << loc.returnCode;
@@ -106,7 +128,7 @@ namespace ConfigPrinter {
     void printServerConfig(std::ostream& os, const ServerConfig& server, int indentLevel) {
         std::string indent = getIndent(indentLevel);
         os << indent << "Server Block:\n";
-        os << indent << "    Listen: " << server.host << ":" << server.port << "\n";
+        os << indent << "    Listen: " << server.host << ":" << server.port << (server.defaultServer ? " (default_server)" : "") << "\n";
         
         os << indent << "    Server Names: [";
         for (size_t i = 0; i < server.serverNames.size(); ++i) {
@@ -125,6 +147,7 @@ namespace ConfigPrinter {
         os << "]\n";
 
         os << indent << "    Autoindex (Default): " << (server.autoindex ? "on" : "off") << "\n";
+        os << indent << "    Autoindex Format (Default): " << server.autoindexFormat << "\n";
 
         os << indent << "    Error Pages:\n";
         if (server.errorPages.empty()) {
@@ -140,6 +163,8 @@ namespace ConfigPrinter {
         os << indent << "    Client Max Body Size: " << server.clientMaxBodySize << " bytes\n";
         os << indent << "    Error Log Path: '" << server.errorLogPath << "'\n";
         os << indent << "    Error Log Level: " << logLevelToString(server.errorLogLevel) << "\n";
+        os << indent << "    Keepalive Requests: " << server.keepaliveRequests << "\n";
+        os << indent << "    Keepalive Timeout: " << server.keepaliveTimeout << " s\n";
 
         // Print locations within this server.
         if (!server.locations.empty()) {
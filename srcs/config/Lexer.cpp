@@ -15,13 +15,19 @@
 // Reads the content of a file into a string.
 bool    readFile(const std::string &fileName, std::string &out)
 {
-    std::ifstream   file(fileName.c_str());
-    std::string     buffer;
+    std::ifstream   file(fileName.c_str(), std::ios::in | std::ios::binary);
 
     if (!file)
         return false;
-    while (std::getline(file, buffer))
-        out += buffer + "\n";
+    // One read into a string sized from the file, rather than a line at a time.
+    file.seekg(0, std::ios::end);
+    std::streamoff  size = file.tellg();
+    file.seekg(0, std::ios::beg);
+    if (size < 0)
+        return false;
+    out.resize(static_cast<size_t>(size));
+    if (size > 0 && !file.read(&out[0], size))
+        return false;
     return true;
 }
 
@@ -35,7 +41,7 @@ int LexerError::getColumn() const
 { return (_col); }
 
 Lexer::Lexer(const std::string &input) : _input(input), _pos(0), _line(1), _column(1)
-{ lexConf(); }
+{ }
 
 Lexer::~Lexer()
 {}
@@ -76,60 +82,78 @@ void    Lexer::skipWhitespaceAndComments()
     }
 }
 
-// Tokenizes the next significant unit from the input.
-token   Lexer::nextToken()
+// Tokenizes the next significant unit from the input into 'out' (T_EOF at the end of the input).
+void    Lexer::next(token& out)
 {
     skipWhitespaceAndComments();
-    if (isAtEnd())
-        return (token(T_EOF, "", _line, _column + 1));
+    out.value.clear();
+    out.line = _line;
+    out.column = _column;
+    if (isAtEnd()) {
+        out.type = T_EOF;
+        out.column = _column + 1;
+        return;
+    }
 
     char    curr = peek();
     
     // Tokenize symbols, strings, identifiers, or numbers.
     if (curr == '{' || curr == '}' || curr == ';')
-        return tokeniseSymbol();
+        return tokeniseSymbol(out);
     if (curr == '"' || curr == '\'')
-        return tokeniseString();
-    if (std::isalpha(curr) || curr == '_' || curr == '.' || curr == '-' || curr == '/' || curr == '$')
-        return (tokeniseIdentifier());
+        return tokeniseString(out);
+    if (std::isalpha(curr) || curr == '_' || curr == '.' || curr == '-' || curr == '/' || curr == '$' || curr == '*')
+        return (tokeniseIdentifier(out));
     if (std::isdigit(curr))
-        return (tokeniseNumber());
+        return (tokeniseNumber(out));
+    if (curr == '=' || curr == '~' || curr == '^')
+        return (tokeniseModifier(out));
     
     // Handle unexpected characters.
     std::ostringstream oss;
-    oss << "Unexpected char: '" << get() << "' from Lexer::nextToken()";
+    oss << "Unexpected char: '" << get() << "' from Lexer::next()";
     error(oss.str());
-    return (token(T_EOF, "", -1, -1));
 }
 
-token   Lexer::tokeniseSymbol()
+void    Lexer::tokeniseSymbol(token& out)
 {
-    int         startLn = _line, startCol = _column;
     char    c = get();
 
+    out.value = c;
     if (c == '{')
-        return (token(T_LBRACE, "{", startLn, startCol));
-    if (c == '}')
-        return (token(T_RBRACE, "}", startLn, startCol));
-    if (c == ';')
-        return (token(T_SEMICOLON, ";", startLn, startCol));
-
-    std::ostringstream  oss;
-    oss << "Unexpected symbol '" << c << "' from Lexer::tokeniseSymbol().";
-    throw (LexerError(oss.str(), _line, _column + 1));
+        out.type = T_LBRACE;
+    else if (c == '}')
+        out.type = T_RBRACE;
+    else if (c == ';')
+        out.type = T_SEMICOLON;
+    else {
+        std::ostringstream  oss;
+        oss << "Unexpected symbol '" << c << "' from Lexer::tokeniseSymbol().";
+        throw (LexerError(oss.str(), _line, _column + 1));
+    }
+}
+
+// Reads a location match modifier ('=', '^~', '~', '~*'), which may be written against the path ("=/exact").
+void    Lexer::tokeniseModifier(token& out)
+{
+    while (!isAtEnd() && (peek() == '=' || peek() == '~' || peek() == '^' || peek() == '*'))
+        out.value += get();
+    out.type = T_IDENTIFIER;
 }
 
-token   Lexer::tokeniseString()
+void    Lexer::tokeniseString(token& out)
 {
-    int         startLn = _line, startCol = _column;
     char        quote = get();
-    std::string buffer;
+    std::string &buffer = out.value;
 
     // Read characters until the closing quote or end of input.
     while (!isAtEnd() && peek() != quote) {
         if (peek() == '\\') {
             get(); // Consume the backslash for escape sequences.
             if (!isAtEnd()) {
+                // Only the quote and the backslash are escaped; other pairs are kept (e.g. regex "\.py$").
+                if (peek() != quote && peek() != '\\')
+                    buffer += '\\';
                 buffer += get();
             } else {
                 error("Unterminated string (escape sequence incomplete)");
@@ -141,96 +165,125 @@ token   Lexer::tokeniseString()
     // Consume the closing quote.
     if (peek() == quote) {
         get();
-        return (token(T_STRING, buffer, startLn, startCol));
+        out.type = T_STRING;
+        return;
     }
 
     // Handle unterminated string error.
     error("Unterminated string (missing closing quote)");
-    return (token(T_EOF, "", -1, -1));
 }
 
-token   Lexer::tokeniseNumber()
+// Checks if a character can appear inside an unquoted word (identifier, path, number, MIME type).
+static bool isWordChar(char c)
 {
-    std::string buffer;
-    int         startLn = _line, startCol = _column;
-
-    // Read digits, dots, colons, and units.
-    while (!isAtEnd()) {
-        char c = peek();
-        if (std::isdigit(c) || c == '.' || c == ':') {
-            buffer += get();
-        } else {
-            char lower_c = std::tolower(c);
-            if (lower_c == 'k' || lower_c == 'm' || lower_c == 'g') {
-                buffer += get();
-                break;
-            } else {
-                break;
-            }
-        }
-    }
-
-    return (token(T_NUMBER, buffer, startLn, startCol));
+    return (std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '.' || c == '-'
+            || c == ':' || c == '/' || c == '$' || c == '+' || c == '=' || c == '*');
 }
 
-token Lexer::tokeniseIdentifier()
+// Appends the unquoted word at the current position to 'out'. A word never spans lines, so the
+// column is advanced once for the whole word.
+void    Lexer::readWord(std::string& out)
 {
-    std::string buffer;
-    int         startLn = _line, startCol = _column;
+    size_t  start = _pos;
 
-    // Read alphanumeric characters and specific symbols.
-    while (!isAtEnd() && (std::isalnum(peek()) || peek() == '_' || peek() == '.'
-                        || peek() == '-' || peek() == ':' || peek() == '/' || peek() == '$'))
-        buffer += get();
+    while (_pos < _input.size() && isWordChar(_input[_pos]))
+        ++_pos;
+    out.append(_input, start, _pos - start);
+    _column += static_cast<int>(_pos - start);
+}
 
-    // Check for keywords and return appropriate token type.
-    if (buffer == "server")                 return (token(T_SERVER, buffer, startLn, startCol));
-    if (buffer == "listen")                 return (token(T_LISTEN, buffer, startLn, startCol));
-    if (buffer == "server_name")            return (token(T_SERVER_NAME, buffer, startLn, startCol));
-    if (buffer == "error_page")             return (token(T_ERROR_PAGE, buffer, startLn, startCol));
-    if (buffer == "client_max_body_size")   return (token(T_CLIENT_MAX_BODY, buffer, startLn, startCol));
-    if (buffer == "index")                  return (token(T_INDEX, buffer, startLn, startCol));
-    if (buffer == "cgi_extension")          return (token(T_CGI_EXTENSION, buffer, startLn, startCol));
-    if (buffer == "cgi_path")               return (token(T_CGI_PATH, buffer, startLn, startCol));
-    if (buffer == "allowed_methods")        return (token(T_ALLOWED_METHODS, buffer, startLn, startCol));
-    if (buffer == "return")                 return (token(T_RETURN, buffer, startLn, startCol));
-    if (buffer == "root")                   return (token(T_ROOT, buffer, startLn, startCol));
-    if (buffer == "autoindex")              return (token(T_AUTOINDEX, buffer, startLn, startCol));
-    if (buffer == "upload_enabled")         return (token(T_UPLOAD_ENABLED, buffer, startLn, startCol));
-    if (buffer == "upload_store")           return (token(T_UPLOAD_STORE, buffer, startLn, startCol));
-    if (buffer == "location")               return (token(T_LOCATION, buffer, startLn, startCol));
-    if (buffer == "error_log")              return (token(T_ERROR_LOG, buffer, startLn, startCol));
+void    Lexer::tokeniseNumber(token& out)
+{
+    std::string &buffer = out.value;
+
+    // Read the whole word, then decide whether it is a number.
+    readWord(buffer);
+
+    // A number is digits, dots and colons, with an optional trailing size unit (k, m, g).
+    size_t  end = buffer.size();
+    char    last = std::tolower(static_cast<unsigned char>(buffer[end - 1]));
+    if (last == 'k' || last == 'm' || last == 'g')
+        --end;
+    out.type = T_NUMBER;
+    for (size_t i = 0; i < end; ++i) {
+        if (!std::isdigit(static_cast<unsigned char>(buffer[i])) && buffer[i] != '.' && buffer[i] != ':') {
+            out.type = T_IDENTIFIER; // e.g. "7z", "3gpp"
+            return;
+        }
+    }
+}
 
-    // Return as a generic identifier if not a keyword.
-    return (token(T_IDENTIFIER, buffer, startLn, startCol));
+namespace {
+    struct Keyword {
+        const char* name;
+        size_t      length;
+        tokenType   type;
+    };
+
+    const Keyword   keywords[] = {
+        { "server", 6, T_SERVER },
+        { "listen", 6, T_LISTEN },
+        { "server_name", 11, T_SERVER_NAME },
+        { "error_page", 10, T_ERROR_PAGE },
+        { "client_max_body_size", 20, T_CLIENT_MAX_BODY },
+        { "index", 5, T_INDEX },
+        { "cgi_extension", 13, T_CGI_EXTENSION },
+        { "cgi_path", 8, T_CGI_PATH },
+        { "allowed_methods", 15, T_ALLOWED_METHODS },
+        { "return", 6, T_RETURN },
+        { "root", 4, T_ROOT },
+        { "autoindex", 9, T_AUTOINDEX },
+        { "upload_enabled", 14, T_UPLOAD_ENABLED },
+        { "upload_store", 12, T_UPLOAD_STORE },
+        { "location", 8, T_LOCATION },
+        { "error_log", 9, T_ERROR_LOG },
+        { "autoindex_format", 16, T_AUTOINDEX_FORMAT },
+        { "types", 5, T_TYPES },
+        { "include", 7, T_INCLUDE },
+        { "upstream", 8, T_UPSTREAM },
+        { "keepalive_requests", 18, T_KEEPALIVE_REQUESTS },
+        { "keepalive_timeout", 17, T_KEEPALIVE_TIMEOUT },
+        { "fastcgi_pass", 12, T_FASTCGI_PASS },
+        { "cgi_pool", 8, T_CGI_POOL },
+        { "cgi_max_concurrent", 18, T_CGI_MAX_CONCURRENT },
+        { "cgi_queue", 9, T_CGI_QUEUE },
+        { "cgi_cache", 9, T_CGI_CACHE },
+        { "proxy_pass", 10, T_PROXY_PASS },
+        { "proxy_cache", 11, T_PROXY_CACHE },
+        { "proxy_cache_path", 16, T_PROXY_CACHE_PATH }
+    };
 }
 
-// Lexes the entire configuration file and stores tokens.
-void    Lexer::lexConf()
+void    Lexer::tokeniseIdentifier(token& out)
 {
-    token   t = nextToken();
+    // Read alphanumeric characters and specific symbols.
+    readWord(out.value);
 
-    while (t.type != T_EOF) {
-        _tokens.push_back(t);
-        t = nextToken();
+    // Check for keywords and return appropriate token type.
+    for (size_t i = 0; i < sizeof(keywords) / sizeof(keywords[0]); ++i) {
+        if (out.value.size() == keywords[i].length && out.value.compare(keywords[i].name) == 0) {
+            out.type = keywords[i].type;
+            return;
+        }
     }
-    _tokens.push_back(t); // Add EOF token at the end.
+    // Return as a generic identifier if not a keyword.
+    out.type = T_IDENTIFIER;
 }
 
-// Dumps all tokenized elements to standard output for debugging.
+// Dumps all remaining tokens to standard output for debugging.
 void    Lexer::dumpTokens()
 {
-    for (size_t i = 0; i < _tokens.size(); i++) {
-        std::cout   << tokenTypeToString(_tokens[i].type) << " : ["
-                    << _tokens[i].value << "] "
-                    << "Ln " << _tokens[i].line
-                    << ", Col " << _tokens[i].column
+    token   t;
+
+    do {
+        next(t);
+        std::cout   << tokenTypeToString(t.type) << " : ["
+                    << t.value << "] "
+                    << "Ln " << t.line
+                    << ", Col " << t.column
                     << std::endl;
-    }
+    } while (t.type != T_EOF);
 }
 
-std::vector<token>  Lexer::getTokens() const
-{ return (_tokens); }
-
 void    Lexer::error(const std::string& msg) const
 { throw (LexerError(msg, _line, _column + 1)); }
\ No newline at end of file
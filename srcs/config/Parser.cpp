@@ -12,6 +12,11 @@
 
 #include "../../includes/config/Parser.hpp"
 
+#include <algorithm>
+#include <glob.h>
+#include <pthread.h>
+#include <unistd.h>
+
 ParseError::ParseError(const std::string& msg, int line, int col) : std::runtime_error(msg), _line(line), _col(col)
 { }
 
@@ -24,27 +29,31 @@ int ParseError::getColumn() const
 
 // Parser
 	// constructor
-Parser::Parser(const std::vector<token>& tokens) : _tokens(tokens), _current(0)
-{ }
+Parser::Parser(Lexer& lexer) : _lexer(lexer), _includeDepth(0)
+{ _lexer.next(_token); }
 
 Parser::~Parser()
 { }
 
+void	Parser::setBaseDir(const std::string& baseDir)
+{ _baseDir = baseDir; }
+
 	// token management
-token   Parser::peek(int offset = 0) const
-{
-	if (offset < 0)
-		throw (std::invalid_argument("peek offset must be non-negative"));
-	if (_current + offset >= _tokens.size())
-		return (token(T_EOF, "", -1, -1));
-	return  (_tokens[_current + offset]);
-}
-		
-token   Parser::consume()
+const token&    Parser::peek() const
+{ return (_token); }
+
+// Moves to the next token. The consumed one stays readable until the next call: its text is swapped
+// into _previous rather than copied, so both buffers are reused from token to token.
+const token&    Parser::consume()
 {
-	if (_current < _tokens.size())
-		++_current;
-	return (_tokens[_current - 1]);
+	if (_token.type == T_EOF)
+		return (_token);
+	_previous.type = _token.type;
+	_previous.value.swap(_token.value);
+	_previous.line = _token.line;
+	_previous.column = _token.column;
+	_lexer.next(_token);
+	return (_previous);
 }
 
 bool    Parser::isAtEnd() const
@@ -53,7 +62,7 @@ bool    Parser::isAtEnd() const
 bool    Parser::checkCurrentType(tokenType type) const
 { return (peek().type == type); }
 
-token Parser::expectToken(tokenType type, const std::string& context) {
+const token& Parser::expectToken(tokenType type, const std::string& context) {
 	if (!checkCurrentType(type)) {
 		std::ostringstream oss;
 		oss << "Expected token type " << tokenTypeToString(type) << " in " << context 
@@ -79,15 +88,23 @@ std::vector<ASTnode *>  Parser::parseConfig()
 	std::vector<ASTnode *>  astNodes;
 
 	while (!isAtEnd()){
-		token   current = peek();
+		const token&    current = peek();
 
 		if (checkCurrentType(T_SERVER)) {
 			astNodes.push_back(parseServerBlock());
+		} else if (checkCurrentType(T_TYPES)) {
+			astNodes.push_back(parseTypesBlock());
+		} else if (checkCurrentType(T_UPSTREAM)) {
+			astNodes.push_back(parseUpstreamBlock());
+		} else if (checkCurrentType(T_PROXY_CACHE_PATH)) {
+			astNodes.push_back(parseDirective());
+		} else if (checkCurrentType(T_INCLUDE)) {
+			parseInclude(astNodes);
 		} else {
 			std::stringstream oss;
 			oss << "Unexpected token '" << current.value
 				<< "' (type: " << tokenTypeToString(current.type)
-				<< ") at top level. Expected 'server' block or end of file.";
+				<< ") at top level. Expected 'server', 'types', 'upstream', 'proxy_cache_path', 'include' or end of file.";
 			error(oss.str());
 		}
 	}
@@ -96,25 +113,28 @@ std::vector<ASTnode *>  Parser::parseConfig()
 		
 BlockNode * Parser::parseServerBlock()
 {
-	token   serverToken = expectToken(T_SERVER, "server block definition");
 	BlockNode* serverBlock = new BlockNode();
 
 	serverBlock->name = "server";
-	serverBlock->line = serverToken.line;
-	serverBlock->column = serverToken.column; 
+	serverBlock->line = peek().line;
+	serverBlock->column = peek().column; 
+	expectToken(T_SERVER, "server block definition");
 
 	expectToken(T_LBRACE, "server block opening brace");
 	
 	// loop through the scope
 	while (!checkCurrentType(T_RBRACE) && !isAtEnd()) {
-		token current = peek();
+		const token&    current = peek();
 		
 		if (checkCurrentType(T_LOCATION)) {
 			serverBlock->children.push_back(parseLocationBlock());
 		} else if (checkCurrentType(T_LISTEN) || checkCurrentType(T_SERVER_NAME) ||
 					checkCurrentType(T_ERROR_PAGE) || checkCurrentType(T_CLIENT_MAX_BODY) ||
 					checkCurrentType(T_INDEX) || checkCurrentType(T_ERROR_LOG) ||
-					checkCurrentType(T_ROOT) || checkCurrentType(T_AUTOINDEX)) {
+					checkCurrentType(T_ROOT) || checkCurrentType(T_AUTOINDEX) ||
+					checkCurrentType(T_AUTOINDEX_FORMAT) ||
+					checkCurrentType(T_KEEPALIVE_REQUESTS) ||
+					checkCurrentType(T_KEEPALIVE_TIMEOUT)) {
 			serverBlock->children.push_back(parseDirective());
 		} else {
 			std::ostringstream oss;
@@ -134,17 +154,21 @@ BlockNode * Parser::parseServerBlock()
 
 BlockNode * Parser::parseLocationBlock()
 {
-	token       locationToken = expectToken(T_LOCATION, "location block definition");
 	BlockNode * locationBlock = new BlockNode();
 	
 	locationBlock->name = "location";
-	locationBlock->line = locationToken.line;
-	locationBlock->column = locationToken.column;
+	locationBlock->line = peek().line;
+	locationBlock->column = peek().column;
+	expectToken(T_LOCATION, "location block definition");
 	
-	// get path
-	token   pathToken = peek();
+	// optional match modifier, then the path (or regex)
+	if (checkCurrentType(T_IDENTIFIER) && (peek().value == "=" || peek().value == "^~"
+			|| peek().value == "~" || peek().value == "~*")) {
+		locationBlock->args.push_back(peek().value);
+		consume();
+	}
 	if (checkCurrentType(T_IDENTIFIER) || checkCurrentType(T_STRING)) {
-		locationBlock->args.push_back(pathToken.value);
+		locationBlock->args.push_back(peek().value);
 		consume();
 	} else {
 		// Updated error message to be more specific
@@ -155,14 +179,22 @@ BlockNode * Parser::parseLocationBlock()
 
 		// loop through the scope
 	while (!isAtEnd() && !checkCurrentType(T_RBRACE)) {
-		token   current = peek();
+		const token&    current = peek();
 
 		if (checkCurrentType(T_LOCATION)) { // nested location blocks
 			locationBlock->children.push_back(parseLocationBlock());
 		} else if (checkCurrentType(T_ALLOWED_METHODS) || checkCurrentType(T_ROOT) || checkCurrentType(T_INDEX)
 					|| checkCurrentType(T_AUTOINDEX) || checkCurrentType(T_UPLOAD_ENABLED) || checkCurrentType(T_UPLOAD_STORE)
 					|| checkCurrentType(T_CGI_EXTENSION) || checkCurrentType(T_CGI_PATH) || checkCurrentType(T_RETURN)
-					|| checkCurrentType(T_ERROR_PAGE) || checkCurrentType(T_CLIENT_MAX_BODY) || checkCurrentType(T_ERROR_LOG)) { // Added ERROR_LOG
+					|| checkCurrentType(T_ERROR_PAGE) || checkCurrentType(T_CLIENT_MAX_BODY) || checkCurrentType(T_ERROR_LOG) // Added ERROR_LOG
+					|| checkCurrentType(T_AUTOINDEX_FORMAT)
+					|| checkCurrentType(T_FASTCGI_PASS)
+					|| checkCurrentType(T_CGI_POOL)
+					|| checkCurrentType(T_CGI_MAX_CONCURRENT)
+					|| checkCurrentType(T_CGI_QUEUE)
+					|| checkCurrentType(T_CGI_CACHE)
+					|| checkCurrentType(T_PROXY_PASS)
+					|| checkCurrentType(T_PROXY_CACHE)) {
 			locationBlock->children.push_back(parseDirective());
 		} else {
 			std::ostringstream oss;
@@ -180,9 +212,236 @@ BlockNode * Parser::parseLocationBlock()
 	return (locationBlock);
 }
 		
+// Parses a 'types { mime/type ext1 ext2; ... }' block. Each entry becomes a directive named after the MIME type.
+BlockNode * Parser::parseTypesBlock()
+{
+	BlockNode * typesBlock = new BlockNode();
+
+	typesBlock->name = "types";
+	typesBlock->line = peek().line;
+	typesBlock->column = peek().column;
+	expectToken(T_TYPES, "types block definition");
+
+	expectToken(T_LBRACE, "types block opening brace");
+
+	while (!isAtEnd() && !checkCurrentType(T_RBRACE)) {
+		if (!checkCurrentType(T_IDENTIFIER) && !checkCurrentType(T_STRING))
+			unexpectedToken("MIME type (identifier or string)");
+
+		const token&    typeToken = consume();
+		DirectiveNode * entry = new DirectiveNode();
+
+		entry->name = typeToken.value;
+		entry->line = typeToken.line;
+		entry->column = typeToken.column;
+		typesBlock->children.push_back(entry);
+
+		entry->args = parseArgs();
+		if (entry->args.empty())
+			error("MIME type '" + entry->name + "' requires at least one file extension.");
+		expectToken(T_SEMICOLON, "types entry ending");
+	}
+
+	if (isAtEnd() && !checkCurrentType(T_RBRACE))
+		error("Missing closing brace '}' for types block.");
+
+	expectToken(T_RBRACE, "types block closing brace");
+	return (typesBlock);
+}
+
+// Parses an 'upstream name { server host:port [weight=N]; least_conn; hash key; keepalive N; }' block.
+// Entries are kept as directives and checked by the ConfigLoader ('server' is a keyword token here).
+BlockNode * Parser::parseUpstreamBlock()
+{
+	BlockNode * upstreamBlock = new BlockNode();
+
+	upstreamBlock->name = "upstream";
+	upstreamBlock->line = peek().line;
+	upstreamBlock->column = peek().column;
+	expectToken(T_UPSTREAM, "upstream block definition");
+
+	if (!checkCurrentType(T_IDENTIFIER) && !checkCurrentType(T_STRING))
+		unexpectedToken("upstream name (identifier or string)");
+	upstreamBlock->args.push_back(consume().value);
+
+	expectToken(T_LBRACE, "upstream block opening brace");
+
+	while (!isAtEnd() && !checkCurrentType(T_RBRACE)) {
+		if (!checkCurrentType(T_SERVER) && !checkCurrentType(T_IDENTIFIER))
+			unexpectedToken("upstream entry ('server', 'least_conn', 'hash' or 'keepalive')");
+
+		const token&    entryToken = consume();
+		DirectiveNode * entry = new DirectiveNode();
+
+		entry->name = entryToken.value;
+		entry->line = entryToken.line;
+		entry->column = entryToken.column;
+		upstreamBlock->children.push_back(entry);
+
+		entry->args = parseArgs();
+		expectToken(T_SEMICOLON, "upstream entry ending");
+	}
+
+	if (isAtEnd() && !checkCurrentType(T_RBRACE))
+		error("Missing closing brace '}' for upstream block.");
+
+	expectToken(T_RBRACE, "upstream block closing brace");
+	return (upstreamBlock);
+}
+
+// Parses 'include <file>;', or 'include <pattern>;' for the files a glob pattern matches (in sorted
+// order), and splices the top-level nodes of each file into 'out' in that order.
+void    Parser::parseInclude(std::vector<ASTnode*>& out)
+{
+	expectToken(T_INCLUDE, "include directive");
+	if (!checkCurrentType(T_IDENTIFIER) && !checkCurrentType(T_STRING))
+		unexpectedToken("include file path (identifier or string)");
+
+	std::string path = consume().value;
+	expectToken(T_SEMICOLON, "directive ending");
+
+	if (!path.empty() && path[0] != '/' && !_baseDir.empty())
+		path = _baseDir + "/" + path;
+	if (_includeDepth >= MAX_INCLUDE_DEPTH)
+		error("Too many nested includes while including '" + path + "'.");
+
+	std::vector<IncludedFile> files;
+	expandIncludePath(path, files);
+	parseIncludedFiles(files);
+
+	// The first failure in file order is reported, whichever thread got to it first.
+	for (size_t i = 0; i < files.size(); ++i) {
+		if (files[i].opened && !files[i].failed)
+			continue;
+		IncludedFile failed = files[i];
+		for (size_t j = 0; j < files.size(); ++j)
+			cleanupAST(files[j].nodes);
+		if (!failed.opened)
+			error("Could not open included file '" + failed.path + "'.");
+		throw (ParseError("In included file '" + failed.path + "': " + failed.error, failed.line, failed.column));
+	}
+	for (size_t i = 0; i < files.size(); ++i) {
+		for (size_t j = 0; j < files[i].nodes.size(); ++j) {
+			if (files[i].nodes[j]->file.empty())
+				files[i].nodes[j]->file = files[i].path;
+		}
+		out.insert(out.end(), files[i].nodes.begin(), files[i].nodes.end());
+	}
+}
+
+// Lists the files an include path names: the path itself, or the sorted matches of a glob pattern.
+// A pattern matching nothing (an empty conf.d/, say) is not an error.
+void    Parser::expandIncludePath(const std::string& path, std::vector<IncludedFile>& files) const
+{
+	if (path.find_first_of("*?[") == std::string::npos) {
+		files.resize(1);
+		files[0].path = path;
+		return;
+	}
+	glob_t  matches;
+	int     status = glob(path.c_str(), 0, NULL, &matches);
+
+	if (status != 0) {
+		globfree(&matches);
+		if (status == GLOB_NOMATCH)
+			return;
+		error("Could not expand include pattern '" + path + "'.");
+	}
+	files.resize(matches.gl_pathc);
+	for (size_t i = 0; i < matches.gl_pathc; ++i)
+		files[i].path = matches.gl_pathv[i];
+	globfree(&matches);
+}
+
+// The files of one 'include', handed out to the parsing threads one at a time.
+struct Parser::IncludeQueue {
+	std::vector<IncludedFile>*  files;
+	size_t                      next;
+	std::string                 baseDir;
+	int                         depth;
+	pthread_mutex_t             lock;
+};
+
+// Parses the files, several at once on worker threads when there is more than one and this parser
+// reads the main file. Included files parse their own includes on the thread they run on.
+void    Parser::parseIncludedFiles(std::vector<IncludedFile>& files) const
+{
+	IncludeQueue    queue;
+	queue.files = &files;
+	queue.next = 0;
+	queue.baseDir = _baseDir;
+	queue.depth = _includeDepth + 1;
+
+	size_t  threads = 1;
+	if (_includeDepth == 0 && files.size() > 1) {
+		long    cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		threads = std::min(files.size(), static_cast<size_t>(std::min(std::max(cpus, 1L), static_cast<long>(MAX_INCLUDE_THREADS))));
+	}
+
+	pthread_mutex_init(&queue.lock, NULL);
+	// The calling thread works the queue too, so the files get parsed even if no worker can be started.
+	std::vector<pthread_t>  workers;
+	for (size_t i = 1; i < threads; ++i) {
+		pthread_t   worker;
+		if (pthread_create(&worker, NULL, includeWorker, &queue) != 0)
+			break;
+		workers.push_back(worker);
+	}
+	includeWorker(&queue);
+	for (size_t i = 0; i < workers.size(); ++i)
+		pthread_join(workers[i], NULL);
+	pthread_mutex_destroy(&queue.lock);
+}
+
+void *  Parser::includeWorker(void* arg)
+{
+	IncludeQueue*   queue = static_cast<IncludeQueue*>(arg);
+
+	for (;;) {
+		pthread_mutex_lock(&queue->lock);
+		size_t  index = queue->next++;
+		pthread_mutex_unlock(&queue->lock);
+		if (index >= queue->files->size())
+			return (NULL);
+		parseIncludedFile((*queue->files)[index], queue->baseDir, queue->depth);
+	}
+}
+
+// Reads, lexes and parses one included file. As this may run on a worker thread, errors are recorded
+// in 'file' (with their position in it) for parseInclude to report, rather than thrown.
+void    Parser::parseIncludedFile(IncludedFile& file, const std::string& baseDir, int depth)
+{
+	std::string content;
+	if (!readFile(file.path, content))
+		return;
+	file.opened = true;
+
+	try {
+		Lexer   lexer(content);
+		Parser  parser(lexer);
+
+		parser._baseDir = baseDir;
+		parser._includeDepth = depth;
+		file.nodes = parser.parseConfig();
+	} catch (const LexerError& e) {
+		file.failed = true;
+		file.error = e.what();
+		file.line = e.getLine();
+		file.column = e.getColumn();
+	} catch (const ParseError& e) {
+		file.failed = true;
+		file.error = e.what();
+		file.line = e.getLine();
+		file.column = e.getColumn();
+	} catch (const std::exception& e) {
+		file.failed = true;
+		file.error = e.what();
+	}
+}
+
 DirectiveNode * Parser::parseDirective()
 {
-	token   directiveToken = peek();
+	const token&    directiveToken = peek();
 	
 	DirectiveNode* directive = new DirectiveNode();
 	directive->name = directiveToken.value;
@@ -224,14 +483,24 @@ bool    Parser::isValidDirective(const std::string& name, const std::string& con
 	if (context == "server") {
 		return (name == "listen" || name == "server_name" || name == "error_page" ||
 				name == "client_max_body_size" || name == "index" || name == "error_log" ||
-				name == "root" || name == "autoindex");
+				name == "root" || name == "autoindex" || name == "autoindex_format" ||
+				name == "keepalive_requests" ||
+				name == "keepalive_timeout");
 	}
 
 	if (context == "location") {
 		return (name == "allowed_methods" || name == "root" || name == "index" ||
 				name == "autoindex" || name == "upload_enabled" || name == "upload_store" ||
 				name == "cgi_extension" || name == "cgi_path" || name == "return" ||
-				name == "error_page" || name == "client_max_body_size" || name == "error_log");
+				name == "error_page" || name == "client_max_body_size" || name == "error_log" ||
+				name == "autoindex_format" ||
+				name == "fastcgi_pass" ||
+				name == "cgi_pool" ||
+				name == "cgi_max_concurrent" ||
+				name == "cgi_queue" ||
+				name == "cgi_cache" ||
+				name == "proxy_pass" ||
+				name == "proxy_cache");
 	}
 
 	return (false);
@@ -240,11 +509,11 @@ bool    Parser::isValidDirective(const std::string& name, const std::string& con
 	// error management
 void    Parser::error(const std::string& msg) const
 {
-	token   current = peek();
+	const token&    current = peek();
 	int errorLine = (current.line != -1) ? current.line : 
-					(_current > 0 ? _tokens[_current - 1].line : 0);
+					(_previous.line != -1 ? _previous.line : 0);
 	int errorCol = (current.column != -1) ? current.column : 
-				   (_current > 0 ? _tokens[_current - 1].column : 0);
+				   (_previous.column != -1 ? _previous.column : 0);
 
 	throw (ParseError(msg, errorLine, errorCol));
 }
@@ -282,6 +551,10 @@ void Parser::validateDirectiveArguments(DirectiveNode* directive) const {
 			oss << "Listen directive: requires at least one argument (port or IP:port).";
 			error(oss.str());
 		}
+		if (args.size() > 2 || (args.size() == 2 && args[1] != "default_server")) {
+			oss << "Listen directive: expected 'listen [IP:]port [default_server]'.";
+			error(oss.str());
+		}
 		std::string host_str = "0.0.0.0"; // Default host, or parsed from args[0]
 		std::string port_str;
 
@@ -386,6 +659,15 @@ void Parser::validateDirectiveArguments(DirectiveNode* directive) const {
 			error(oss.str());
 		}
 		// This validation check is now better handled in ConfigLoader if cgi_path exists without cgi_extension
+	} else if (name == "fastcgi_pass") {
+		if (args.size() != 1) {
+			oss << "Directive 'fastcgi_pass' requires exactly one argument ('unix:/path' or 'host:port').";
+			error(oss.str());
+		}
+		if (args[0].compare(0, 5, "unix:") != 0 && args[0].rfind(':') == std::string::npos) {
+			oss << "Invalid 'fastcgi_pass' address '" << args[0] << "'. Expected 'unix:/path' or 'host:port'.";
+			error(oss.str());
+		}
 	} else if (name == "allowed_methods") {
 		if (args.empty()) {
 			oss << "Directive 'allowed_methods' requires at least one argument (HTTP method).";
@@ -441,6 +723,87 @@ void Parser::validateDirectiveArguments(DirectiveNode* directive) const {
 			oss << "Argument for 'autoindex' must be 'on' or 'off', but got '" << args[0] << "'.";
 			error(oss.str());
 		}
+	} else if (name == "autoindex_format") {
+		if (args.size() != 1) {
+			oss << "Directive 'autoindex_format' requires exactly one argument ('html' or 'json').";
+			error(oss.str());
+		} else if (args[0] != "html" && args[0] != "json") {
+			oss << "Argument for 'autoindex_format' must be 'html' or 'json', but got '" << args[0] << "'.";
+			error(oss.str());
+		}
+	} else if (name == "keepalive_requests") {
+		if (args.size() != 1) {
+			oss << "Directive 'keepalive_requests' requires exactly one argument (number of requests).";
+			error(oss.str());
+		}
+		for (size_t j = 0; j < args[0].length(); ++j) {
+			if (!std::isdigit(args[0][j])) {
+				oss << "Argument for 'keepalive_requests' must be a non-negative number, but got '" << args[0] << "'.";
+				error(oss.str());
+			}
+		}
+	} else if (name == "keepalive_timeout") {
+		if (args.size() != 1) {
+			oss << "Directive 'keepalive_timeout' requires exactly one argument (seconds, optional 's' suffix).";
+			error(oss.str());
+		}
+		std::string seconds = args[0];
+		if (!seconds.empty() && seconds[seconds.length() - 1] == 's')
+			seconds.erase(seconds.length() - 1);
+		if (seconds.empty()) {
+			oss << "Argument for 'keepalive_timeout' must be a number of seconds, but got '" << args[0] << "'.";
+			error(oss.str());
+		}
+		for (size_t j = 0; j < seconds.length(); ++j) {
+			if (!std::isdigit(seconds[j])) {
+				oss << "Argument for 'keepalive_timeout' must be a number of seconds, but got '" << args[0] << "'.";
+				error(oss.str());
+			}
+		}
+	} else if (name == "cgi_pool") {
+		if (args.empty() || args.size() > 3) {
+			oss << "Directive 'cgi_pool' requires 'size=N' and optionally 'max_requests=M' and 'worker=path'.";
+			error(oss.str());
+		}
+		for (size_t i = 0; i < args.size(); ++i) {
+			size_t eq_pos = args[i].find('=');
+			std::string key = args[i].substr(0, eq_pos);
+			if (eq_pos == std::string::npos || eq_pos + 1 == args[i].length()
+				|| (key != "size" && key != "max_requests" && key != "worker")) {
+				oss << "Invalid 'cgi_pool' parameter '" << args[i] << "'. Expected size=N, max_requests=M or worker=path.";
+				error(oss.str());
+			}
+		}
+	} else if (name == "cgi_max_concurrent") {
+		if (args.empty() || args.size() > 2 || (args.size() == 2 && args[1] != "adaptive")) {
+			oss << "Directive 'cgi_max_concurrent' requires a number and optionally 'adaptive'.";
+			error(oss.str());
+		}
+	} else if (name == "cgi_queue") {
+		if (args.empty() || args.size() > 2 || (args.size() == 2 && args[1].compare(0, 8, "timeout=") != 0)) {
+			oss << "Directive 'cgi_queue' requires a size and optionally 'timeout=T'.";
+			error(oss.str());
+		}
+	} else if (name == "cgi_cache") {
+		if (args.empty() || (args[0] == "off" && args.size() != 1)) {
+			oss << "Directive 'cgi_cache' requires a zone name and 'size=S' (optionally 'valid=T', 'stale=T', 'key=K'), or 'off'.";
+			error(oss.str());
+		}
+	} else if (name == "proxy_pass") {
+		if (args.size() != 1 || args[0].compare(0, 7, "http://") != 0 || args[0].size() == 7) {
+			oss << "Directive 'proxy_pass' requires exactly one argument ('http://upstream_name' or 'http://host:port').";
+			error(oss.str());
+		}
+	} else if (name == "proxy_cache") {
+		if (args.empty() || (args[0] == "off" && args.size() != 1)) {
+			oss << "Directive 'proxy_cache' requires a zone name (optionally 'valid=T', 'key=K'), or 'off'.";
+			error(oss.str());
+		}
+	} else if (name == "proxy_cache_path") {
+		if (args.size() < 2) {
+			oss << "Directive 'proxy_cache_path' requires a directory and 'keys_zone=name' (optionally 'levels=L', 'max_size=S', 'inactive=T').";
+			error(oss.str());
+		}
 	} else if (name == "upload_enabled") {
 		if (args.size() != 1) {
 			oss << "Directive 'upload_enabled' requires exactly one argument ('on' or 'off').";
@@ -41,6 +41,20 @@ const std::string       tokenTypeToString(tokenType type)
 		case T_UPLOAD_STORE: return "T_UPLOAD_STORE";
 		case T_LOCATION: return "T_LOCATION";
 		case T_ERROR_LOG: return "T_ERROR_LOG";
+		case T_AUTOINDEX_FORMAT: return "T_AUTOINDEX_FORMAT";
+		case T_TYPES: return "T_TYPES";
+		case T_INCLUDE: return "T_INCLUDE";
+		case T_KEEPALIVE_REQUESTS: return "T_KEEPALIVE_REQUESTS";
+		case T_KEEPALIVE_TIMEOUT: return "T_KEEPALIVE_TIMEOUT";
+		case T_FASTCGI_PASS: return "T_FASTCGI_PASS";
+		case T_CGI_POOL: return "T_CGI_POOL";
+		case T_CGI_MAX_CONCURRENT: return "T_CGI_MAX_CONCURRENT";
+		case T_CGI_QUEUE: return "T_CGI_QUEUE";
+		case T_CGI_CACHE: return "T_CGI_CACHE";
+		case T_PROXY_PASS: return "T_PROXY_PASS";
+		case T_UPSTREAM: return "T_UPSTREAM";
+		case T_PROXY_CACHE: return "T_PROXY_CACHE";
+		case T_PROXY_CACHE_PATH: return "T_PROXY_CACHE_PATH";
 
 		// Other values.
 		case T_IDENTIFIER: return "T_IDENTIFIER";
@@ -0,0 +1,124 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   AutoindexCache.cpp                                 :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: bvieilhe <bvieilhe@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 10:13:02 by bvieilhe          #+#    #+#             */
+/*   Updated: 2026/10/18 10:13:02 by bvieilhe         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "../../includes/http/AutoindexCache.hpp"
+
+#include <iostream>
+#include <algorithm>
+#include <dirent.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+
+std::map<AutoindexCache::Key, AutoindexCache::Listing>	AutoindexCache::_listings;
+unsigned long											AutoindexCache::_clock = 0;
+
+// Orders entries by name (byte order) so listings are stable across requests.
+static bool	entryNameLess(const AutoindexEntry& a, const AutoindexEntry& b) {
+	return a.name < b.name;
+}
+
+// Extracts the sub-second part of a directory mtime where the platform provides it.
+long AutoindexCache::_mtimeNsec(const struct stat& st) {
+#if defined(__APPLE__)
+	return st.st_mtimespec.tv_nsec;
+#elif defined(__linux__)
+	return st.st_mtim.tv_nsec;
+#else
+	(void)st;
+	return 0;
+#endif
+}
+
+// Reads a directory in one pass, using d_type and falling back to fstatat() only when the type is unknown.
+bool AutoindexCache::_readDirectory(const std::string& directoryPath, std::vector<AutoindexEntry>& out) {
+	DIR* dir = opendir(directoryPath.c_str());
+	if (!dir) {
+		std::cerr << "ERROR: AutoindexCache: Could not open directory '" << directoryPath << "', errno: " << strerror(errno) << "." << std::endl;
+		return false;
+	}
+
+	int dfd = dirfd(dir);
+	struct dirent* ent;
+	out.clear();
+	while ((ent = readdir(dir)) != NULL) {
+		const char* name = ent->d_name;
+		if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+			continue; // Skip current and parent directory entries.
+		}
+
+		bool isDir = false;
+#ifdef DT_DIR
+		if (ent->d_type == DT_DIR) {
+			isDir = true;
+		} else if (ent->d_type == DT_UNKNOWN || ent->d_type == DT_LNK) {
+			// Filesystem did not report a type, or it is a symlink whose target type we need.
+			struct stat st;
+			isDir = (fstatat(dfd, name, &st, 0) == 0 && S_ISDIR(st.st_mode));
+		}
+#else
+		struct stat st;
+		isDir = (fstatat(dfd, name, &st, 0) == 0 && S_ISDIR(st.st_mode));
+#endif
+		out.push_back(AutoindexEntry(name, isDir));
+	}
+	closedir(dir);
+
+	std::sort(out.begin(), out.end(), entryNameLess);
+	return true;
+}
+
+// Drops the least recently used listing once the cache is full.
+void AutoindexCache::_evictOldest() {
+	std::map<Key, Listing>::iterator oldest = _listings.end();
+	for (std::map<Key, Listing>::iterator it = _listings.begin(); it != _listings.end(); ++it) {
+		if (oldest == _listings.end() || it->second.lastUsed < oldest->second.lastUsed) {
+			oldest = it;
+		}
+	}
+	if (oldest != _listings.end()) {
+		_listings.erase(oldest);
+	}
+}
+
+const std::vector<AutoindexEntry>* AutoindexCache::getListing(const std::string& directoryPath) {
+	struct stat st;
+	if (stat(directoryPath.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) {
+		return NULL;
+	}
+
+	Key key(st.st_dev, st.st_ino);
+	long nsec = _mtimeNsec(st);
+	std::map<Key, Listing>::iterator it = _listings.find(key);
+
+	// Cached and unchanged since it was read: serve it as-is.
+	if (it != _listings.end() && it->second.mtime == st.st_mtime && it->second.mtimeNsec == nsec) {
+		it->second.lastUsed = ++_clock;
+		return &it->second.entries;
+	}
+
+	if (it == _listings.end()) {
+		if (_listings.size() >= AUTOINDEX_CACHE_SLOTS) {
+			_evictOldest();
+		}
+		it = _listings.insert(std::make_pair(key, Listing())).first;
+	}
+
+	if (!_readDirectory(directoryPath, it->second.entries)) {
+		_listings.erase(it);
+		return NULL;
+	}
+	it->second.mtime = st.st_mtime;
+	it->second.mtimeNsec = nsec;
+	it->second.lastUsed = ++_clock;
+	return &it->second.entries;
+}
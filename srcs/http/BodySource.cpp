@@ -0,0 +1,123 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   BodySource.cpp                                     :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: bvieilhe <bvieilhe@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 11:02:17 by bvieilhe          #+#    #+#             */
+/*   Updated: 2026/10/18 11:02:17 by bvieilhe         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "../../includes/http/BodySource.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/sendfile.h>
+
+BodySource::~BodySource() {}
+
+bool BodySource::canSendDirect() const {
+	return false;
+}
+
+ssize_t BodySource::sendTo(int, size_t) {
+	return -1;
+}
+
+// MemoryBodySource
+
+MemoryBodySource::MemoryBodySource(std::vector<char>& data) : _offset(0) {
+	_data.swap(data);
+}
+
+ssize_t MemoryBodySource::readInto(std::string& out, size_t max) {
+	size_t n = _data.size() - _offset;
+	if (n > max) {
+		n = max;
+	}
+	if (n > 0) {
+		out.append(&_data[_offset], n);
+		_offset += n;
+	}
+	return static_cast<ssize_t>(n);
+}
+
+bool MemoryBodySource::isExhausted() const {
+	return _offset >= _data.size();
+}
+
+// FileBodySource
+
+FileBodySource::FileBodySource(const std::string& path, off_t offset, off_t length)
+	: _fd(-1), _offset(offset), _remaining(length) {
+	_fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+}
+
+FileBodySource::FileBodySource(int fd, off_t offset, off_t length)
+	: _fd(fd), _offset(offset), _remaining(length) {}
+
+FileBodySource::~FileBodySource() {
+	if (_fd != -1) {
+		close(_fd);
+	}
+}
+
+bool FileBodySource::isOpen() const {
+	return _fd != -1;
+}
+
+// Reads straight into the tail of 'out'. A file shorter than announced is an error,
+// as the Content-Length has already been sent.
+ssize_t FileBodySource::readInto(std::string& out, size_t max) {
+	if (_fd == -1) {
+		return -1;
+	}
+	if (static_cast<off_t>(max) > _remaining) {
+		max = static_cast<size_t>(_remaining);
+	}
+	if (max == 0) {
+		return 0;
+	}
+
+	size_t oldSize = out.size();
+	out.resize(oldSize + max);
+	ssize_t n = pread(_fd, &out[oldSize], max, _offset);
+	if (n <= 0) {
+		out.resize(oldSize);
+		return -1;
+	}
+	out.resize(oldSize + n);
+	_offset += n;
+	_remaining -= n;
+	return n;
+}
+
+bool FileBodySource::isExhausted() const {
+	return _remaining <= 0;
+}
+
+bool FileBodySource::canSendDirect() const {
+	return _fd != -1;
+}
+
+// The kernel copies the range from the page cache to the socket. As with readInto(), a file that
+// turns out shorter than announced is an error.
+ssize_t FileBodySource::sendTo(int socket, size_t max) {
+	if (_fd == -1) {
+		return -1;
+	}
+	if (static_cast<off_t>(max) > _remaining) {
+		max = static_cast<size_t>(_remaining);
+	}
+	if (max == 0) {
+		return 0;
+	}
+	ssize_t n = sendfile(socket, _fd, &_offset, max);
+	if (n <= 0) {
+		return -1;
+	}
+	_remaining -= n;
+	return n;
+}
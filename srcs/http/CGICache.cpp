@@ -0,0 +1,255 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   CGICache.cpp                                       :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: bvieilhe <bvieilhe@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 09:52:31 by bvieilhe          #+#    #+#             */
+/*   Updated: 2026/10/18 09:52:31 by bvieilhe         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "../../includes/http/CGICache.hpp"
+#include "../../includes/http/HttpRequest.hpp"
+#include "../../includes/config/ServerStructures.hpp"
+#include "../../includes/utils/StringUtils.hpp"
+
+#include <iostream>
+#include <cctype>
+
+std::map<std::string, CGICache*>	CGICache::_zones;
+
+CGICache::CGICache(size_t maxBytes) : _maxBytes(maxBytes), _bytes(0) {}
+
+CGICache* CGICache::forLocation(const LocationConfig* location) {
+	if (!location || location->cgiCacheZone.empty()) {
+		return NULL;
+	}
+	std::map<std::string, CGICache*>::iterator it = _zones.find(location->cgiCacheZone);
+	if (it != _zones.end()) {
+		return it->second;
+	}
+	CGICache* zone = new CGICache(static_cast<size_t>(location->cgiCacheSize));
+	_zones[location->cgiCacheZone] = zone;
+	return zone;
+}
+
+// Collects the 'cgi_cache' zone sizes named by 'locations' and their nested locations.
+static void collectZones(const std::vector<LocationConfig>& locations, std::map<std::string, long>& sizes) {
+	for (size_t i = 0; i < locations.size(); ++i) {
+		if (!locations[i].cgiCacheZone.empty()) {
+			sizes[locations[i].cgiCacheZone] = locations[i].cgiCacheSize;
+		}
+		collectZones(locations[i].nestedLocations, sizes);
+	}
+}
+
+// A zone whose size changed is resized; one the configuration no longer names is emptied. Zones are
+// never deleted, as requests still running on the previous configuration may hold them; new ones
+// are created on first use.
+void CGICache::configure(const std::vector<ServerConfig>& servers) {
+	std::map<std::string, long> sizes;
+	for (size_t i = 0; i < servers.size(); ++i) {
+		collectZones(servers[i].locations, sizes);
+	}
+	for (std::map<std::string, CGICache*>::iterator it = _zones.begin(); it != _zones.end(); ++it) {
+		std::map<std::string, long>::iterator size = sizes.find(it->first);
+		it->second->_resize(size == sizes.end() ? 0 : static_cast<size_t>(size->second));
+	}
+}
+
+// Reads the variable name starting at 'pos' (just after '$').
+static std::string keyVariableAt(const std::string& keyTemplate, size_t pos) {
+	size_t end = pos;
+	while (end < keyTemplate.length() && (std::isalnum(static_cast<unsigned char>(keyTemplate[end])) || keyTemplate[end] == '_')) {
+		++end;
+	}
+	return keyTemplate.substr(pos, end - pos);
+}
+
+std::string CGICache::buildKey(const std::string& keyTemplate, const HttpRequest& request) {
+	std::string key;
+	size_t query_pos = request.uri.find('?');
+	for (size_t i = 0; i < keyTemplate.length(); ++i) {
+		if (keyTemplate[i] != '$') {
+			key += keyTemplate[i];
+			continue;
+		}
+		std::string name = keyVariableAt(keyTemplate, i + 1);
+		if (name == "uri") {
+			key += request.path;
+		} else if (name == "args") {
+			if (query_pos != std::string::npos) {
+				key.append(request.uri, query_pos + 1, std::string::npos);
+			}
+		} else if (name == "request_uri") {
+			key += request.uri;
+		} else if (name == "host") {
+			std::string host = request.getHeader("host");
+			StringUtils::toLower(host);
+			key += host;
+		} else if (name == "request_method") {
+			key += request.method;
+		}
+		i += name.length();
+	}
+	return key;
+}
+
+std::string CGICache::unknownKeyVariable(const std::string& keyTemplate) {
+	for (size_t i = 0; i < keyTemplate.length(); ++i) {
+		if (keyTemplate[i] != '$') {
+			continue;
+		}
+		std::string name = keyVariableAt(keyTemplate, i + 1);
+		if (name != "uri" && name != "args" && name != "request_uri" && name != "host" && name != "request_method") {
+			return "$" + name;
+		}
+		i += name.length();
+	}
+	return "";
+}
+
+// Like a shared proxy cache: only final answers meant for everyone (no cookies, no private data).
+bool CGICache::isCacheable(const HttpResponse& response) {
+	int status = response.getStatusCode();
+	if (status != 200 && status != 301 && status != 302) {
+		return false;
+	}
+	const std::map<std::string, std::string>& headers = response.getHeaders();
+	for (std::map<std::string, std::string>::const_iterator it = headers.begin(); it != headers.end(); ++it) {
+		if (StringUtils::ciCompare(it->first, "Set-Cookie")) {
+			return false;
+		}
+		if (StringUtils::ciCompare(it->first, "Cache-Control")) {
+			std::string value = it->second;
+			StringUtils::toLower(value);
+			if (value.find("no-store") != std::string::npos || value.find("no-cache") != std::string::npos
+				|| value.find("private") != std::string::npos) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+CGICache::Status CGICache::lookup(const std::string& key, long valid, long stale, HttpResponse& response) {
+	time_t now = time(NULL);
+	bool filling = _filling.count(key) != 0;
+	std::map<std::string, EntryList::iterator>::iterator found = _index.find(key);
+
+	if (found != _index.end()) {
+		EntryList::iterator entry = found->second;
+		_entries.splice(_entries.begin(), _entries, entry);
+		long age = static_cast<long>(now - entry->storedAt);
+		if (age < valid) {
+			_copyEntry(*entry, "HIT", response);
+			return HIT;
+		}
+		if (filling && age < valid + stale) {
+			_copyEntry(*entry, "STALE", response);
+			return STALE;
+		}
+	}
+	if (filling) {
+		return FILLING;
+	}
+	std::map<std::string, time_t>::iterator passing = _passUntil.find(key);
+	if (passing != _passUntil.end()) {
+		if (now < passing->second) {
+			return PASS;
+		}
+		_passUntil.erase(passing);
+	}
+	_filling.insert(key);
+	return MISS;
+}
+
+void CGICache::store(const std::string& key, const HttpResponse& response) {
+	_filling.erase(key);
+	_passUntil.erase(key);
+
+	size_t bytes = key.length() + response.getBody().size();
+	const std::map<std::string, std::string>& headers = response.getHeaders();
+	for (std::map<std::string, std::string>::const_iterator it = headers.begin(); it != headers.end(); ++it) {
+		bytes += it->first.length() + it->second.length();
+	}
+	std::map<std::string, EntryList::iterator>::iterator found = _index.find(key);
+	if (found != _index.end()) {
+		_erase(found->second);
+	}
+	if (bytes > maxEntrySize()) {
+		return;
+	}
+	while (_bytes + bytes > _maxBytes && !_entries.empty()) {
+		_erase(--_entries.end());
+	}
+
+	_entries.push_front(Entry());
+	Entry& entry = _entries.front();
+	entry.key = key;
+	entry.response = response;
+	entry.storedAt = time(NULL);
+	entry.bytes = bytes;
+	_index[key] = _entries.begin();
+	_bytes += bytes;
+}
+
+// The filler gave up without a response (client gone): the next lookup fills instead.
+void CGICache::abandon(const std::string& key) {
+	_filling.erase(key);
+}
+
+// The filler's response can't be stored: lookups of the key answer PASS for 'seconds' (at least one),
+// so the requests waiting for it and those that follow all run the script at once.
+void CGICache::pass(const std::string& key, long seconds) {
+	_filling.erase(key);
+	time_t now = time(NULL);
+	if (_passUntil.size() >= CGI_CACHE_MAX_PASS_KEYS) {
+		for (std::map<std::string, time_t>::iterator it = _passUntil.begin(); it != _passUntil.end();) {
+			if (it->second <= now) {
+				_passUntil.erase(it++);
+			} else {
+				++it;
+			}
+		}
+	}
+	_passUntil[key] = now + (seconds > 0 ? seconds : 1);
+}
+
+// One entry may use an eighth of the zone, so a single large response can't flush it.
+size_t CGICache::maxEntrySize() const {
+	return _maxBytes / 8;
+}
+
+// Rebuilds the response with a current Date and the cache status, as the stored copy is shared.
+void CGICache::_copyEntry(const Entry& entry, const char* status, HttpResponse& response) const {
+	response = HttpResponse();
+	response.setStatus(entry.response.getStatusCode());
+	const std::map<std::string, std::string>& headers = entry.response.getHeaders();
+	for (std::map<std::string, std::string>::const_iterator it = headers.begin(); it != headers.end(); ++it) {
+		if (it->first != "Date") {
+			response.addHeader(it->first, it->second);
+		}
+	}
+	response.setBody(entry.response.getBody());
+	response.addHeader("X-Cache-Status", status);
+}
+
+// Evicts least recently used entries down to the new size.
+void CGICache::_resize(size_t maxBytes) {
+	_maxBytes = maxBytes;
+	while (_bytes > _maxBytes && !_entries.empty()) {
+		_erase(--_entries.end());
+	}
+	if (_maxBytes == 0) {
+		_passUntil.clear();
+	}
+}
+
+void CGICache::_erase(EntryList::iterator it) {
+	_bytes -= it->bytes;
+	_index.erase(it->key);
+	_entries.erase(it);
+}
@@ -11,8 +11,13 @@
 /* ************************************************************************** */
 
 #include <signal.h>
+#include <spawn.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
 #include "../../includes/webserv.hpp" // Brings in all necessary headers and constants
 
+unsigned long CGIHandler::_aborted_count = 0;
+
 // Constructor: Initializes CGIHandler with request and configuration details.
 CGIHandler::CGIHandler(const HttpRequest& request,
 					   const ServerConfig* serverConfig,
@@ -25,6 +30,8 @@ CGIHandler::CGIHandler(const HttpRequest& request,
 	  _cgi_script_path(),
 	  _cgi_executable_path(),
 	  _cgi_pid(-1),
+	  _pidfd(-1),
+	  _spawn_time(),
 	  _fd_stdin(), // Default construction
 	  _fd_stdout(), // Default construction
 	  _cgi_response_buffer(),
@@ -34,8 +41,26 @@ CGIHandler::CGIHandler(const HttpRequest& request,
 	  _cgi_exit_status(-1),
 	  _cgi_start_time(0),
 	  _cgi_stdout_eof_received(false),
-	  _request_body_ptr(&request.body),
-	  _request_body_sent_bytes(0)
+	  _cgi_exited(false),
+	  _streaming(false),
+	  _output_paused(false),
+	  _input_buffer(request.body),
+	  _input_sent(0),
+	  _input_complete(true),
+	  _input_closed(false),
+	  _input_suspended(false),
+	  _input_end_encoded(false),
+	  _fastcgi(false),
+	  _worker_pool(NULL),
+	  _worker(NULL),
+	  _fcgi_out(),
+	  _fcgi_out_sent(0),
+	  _fcgi_decoder(),
+	  _error_status(500),
+	  _limiter(NULL),
+	  _holds_slot(false),
+	  _queued_for_slot(false),
+	  _slot_since()
 {
 	_fd_stdin[0] = -1;
 	_fd_stdin[1] = -1;
@@ -48,15 +73,12 @@ CGIHandler::CGIHandler(const HttpRequest& request,
 		// and constructor can just return.
 		return;
 	}
-
-	// Set _request_body_ptr to NULL if the request body is empty
-	if (request.body.empty()) {
-		_request_body_ptr = NULL;
-	}
+	_limiter = CGILimiter::forLocation(_locationConfig);
 }
 
 // Destructor: Cleans up any child processes. Pipe FDs are closed by Connection/Server.
 CGIHandler::~CGIHandler() {
+	_releaseSlot();
 	if (_cgi_pid != -1) {
 		int status;
 		pid_t result = waitpid(_cgi_pid, &status, WNOHANG);
@@ -78,6 +100,8 @@ CGIHandler::CGIHandler(const CGIHandler& other)
       _cgi_script_path(other._cgi_script_path),
       _cgi_executable_path(other._cgi_executable_path),
       _cgi_pid(-1),
+      _pidfd(-1),
+      _spawn_time(),
       _fd_stdin(),
       _fd_stdout(),
       _cgi_response_buffer(),
@@ -87,8 +111,26 @@ CGIHandler::CGIHandler(const CGIHandler& other)
       _cgi_exit_status(-1),
       _cgi_start_time(0),
       _cgi_stdout_eof_received(false),
-      _request_body_ptr(other._request_body_ptr),
-      _request_body_sent_bytes(0)
+      _cgi_exited(false),
+      _streaming(false),
+      _output_paused(false),
+      _input_buffer(other._input_buffer),
+      _input_sent(0),
+      _input_complete(other._input_complete),
+      _input_closed(false),
+      _input_suspended(false),
+      _input_end_encoded(false),
+      _fastcgi(other._fastcgi),
+      _worker_pool(other._worker_pool),
+      _worker(NULL),
+      _fcgi_out(),
+      _fcgi_out_sent(0),
+      _fcgi_decoder(),
+      _error_status(500),
+      _limiter(other._limiter),
+      _holds_slot(false),
+      _queued_for_slot(false),
+      _slot_since()
 {
     _fd_stdin[0] = -1; _fd_stdin[1] = -1;
     _fd_stdout[0] = -1; _fd_stdout[1] = -1;
@@ -105,45 +147,67 @@ CGIHandler& CGIHandler::operator=(const CGIHandler& other) {
 
 		_serverConfig = other._serverConfig;
 		_locationConfig = other._locationConfig;
-		_request_body_ptr = other._request_body_ptr;
+		_input_buffer = other._input_buffer;
+		_input_complete = other._input_complete;
 		_cgi_script_path = other._cgi_script_path;
 		_cgi_executable_path = other._cgi_executable_path;
 
 		_cgi_pid = -1;
+		_pidfd = -1;
 		_fd_stdin[0] = -1; _fd_stdin[1] = -1;
 		_fd_stdout[0] = -1; _fd_stdout[1] = -1;
-		_request_body_sent_bytes = 0;
+		_input_sent = 0;
+		_input_closed = false;
+		_input_suspended = false;
+		_input_end_encoded = false;
 		_cgi_response_buffer.clear();
 		_final_http_response = HttpResponse();
 		_state = CGIState::NOT_STARTED;
 		_cgi_headers_parsed = false;
 		_cgi_exit_status = -1;
 		_cgi_start_time = 0;
+		_cgi_stdout_eof_received = false;
+		_cgi_exited = false;
+		_streaming = false;
+		_output_paused = false;
+		_fastcgi = other._fastcgi;
+		_worker_pool = other._worker_pool;
+		_worker = NULL;
+		_fcgi_out.clear();
+		_fcgi_out_sent = 0;
+		_fcgi_decoder = FastCGI::RecordDecoder();
+		_error_status = 500;
+		_releaseSlot();
+		_limiter = other._limiter;
 	}
 	return *this;
 }
 
 // Private helper to determine CGI script and executable paths.
+// With 'fastcgi_pass' there is no executable: the backend runs whatever SCRIPT_FILENAME names.
 bool CGIHandler::_initializeCGIPaths() {
-	if (!_locationConfig || _locationConfig->root.empty() || _locationConfig->cgiExecutables.empty()) {
+	_fastcgi = _locationConfig && !_locationConfig->fastcgiPass.empty();
+	if (!_locationConfig || _locationConfig->root.empty() || (!_fastcgi && _locationConfig->cgiExecutables.empty())) {
 		std::cerr << "ERROR: CGIHandler: Incomplete location config for CGI setup (root or cgiExecutables empty)." << std::endl;
 		_state = CGIState::CGI_PROCESS_ERROR;
 		return false;
 	}
 
-	std::string document_root_relative = _locationConfig->root;
-
-	char abs_path_buffer[PATH_MAX];
-	if (realpath(document_root_relative.c_str(), abs_path_buffer) == NULL) {
-		std::cerr << "ERROR: CGIHandler constructor: Failed to get absolute path for document root: " << document_root_relative << ". Setting CGI_PROCESS_ERROR state." << std::endl;
+	// Resolved at config load (ConfigLoader::resolveCgiLocations).
+	const std::string& absoluteDocumentRoot = _locationConfig->cgiRootPath;
+	if (absoluteDocumentRoot.empty()) {
+		std::cerr << "ERROR: CGIHandler: Document root of location " << _locationConfig->path << " did not resolve at config load: " << _locationConfig->root << std::endl;
 		_state = CGIState::CGI_PROCESS_ERROR;
 		return false;
 	}
-	std::string absoluteDocumentRoot = abs_path_buffer;
 
-	// Ensure no trailing slash for consistent path concatenation
-	if (absoluteDocumentRoot.length() > 1 && absoluteDocumentRoot[absoluteDocumentRoot.length() - 1] == '/') {
-		absoluteDocumentRoot = absoluteDocumentRoot.substr(0, absoluteDocumentRoot.length() - 1);
+	if (_fastcgi) {
+		std::string normalizedRequestPath = _request.path;
+		if (normalizedRequestPath.empty() || normalizedRequestPath[0] != '/') {
+			normalizedRequestPath = "/" + normalizedRequestPath;
+		}
+		_cgi_script_path = absoluteDocumentRoot + normalizedRequestPath;
+		return true;
 	}
 
 	size_t dot_pos = _request.path.rfind('.');
@@ -154,12 +218,17 @@ bool CGIHandler::_initializeCGIPaths() {
 	}
 	std::string file_extension = _request.path.substr(dot_pos);
 
-	std::map<std::string, std::string>::const_iterator cgi_it = _locationConfig->cgiExecutables.find(file_extension);
-	if (cgi_it == _locationConfig->cgiExecutables.end()) {
+	std::map<std::string, std::string>::const_iterator cgi_it = _locationConfig->cgiResolvedExecutables.find(file_extension);
+	if (cgi_it == _locationConfig->cgiResolvedExecutables.end()) {
 		std::cerr << "ERROR: CGIHandler: No CGI executable configured for extension: " << file_extension << " in location: " << _locationConfig->path << std::endl;
 		_state = CGIState::CGI_PROCESS_ERROR;
 		return false;
 	}
+	if (cgi_it->second.empty()) {
+		std::cerr << "ERROR: CGI: Executable for " << file_extension << " was not found or not executable at config load." << std::endl;
+		_state = CGIState::CGI_PROCESS_ERROR;
+		return false;
+	}
 	_cgi_executable_path = cgi_it->second;
 
 	std::string normalizedRequestPath = _request.path;
@@ -169,6 +238,11 @@ bool CGIHandler::_initializeCGIPaths() {
 	}
 	_cgi_script_path = absoluteDocumentRoot + normalizedRequestPath;
 
+	if (_locationConfig->cgiPoolSize > 0) {
+		_worker_pool = CGIWorkerPool::forInterpreter(_cgi_executable_path, _locationConfig->cgiPoolWorker,
+													 _locationConfig->cgiPoolSize, _locationConfig->cgiPoolMaxRequests);
+		_fastcgi = true;
+	}
 	return true;
 }
 
@@ -189,33 +263,21 @@ bool CGIHandler::_setNonBlocking(int fd) {
 	return true;
 }
 
-// Creates environment variables for CGI execution.
-char** CGIHandler::_createCGIEnvironment() const {
-	std::vector<std::string> env_vars_vec;
+// Builds the CGI meta-variables as consecutive "NAME=value\0" entries in one block (environment
+// for CGI, PARAMS for FastCGI). It starts from the location's prebuilt request-independent prefix.
+void CGIHandler::_buildCGIEnvironment(std::string& env) const {
+	env.reserve(_locationConfig->cgiEnvPrefix.size() + _request.uri.size() * 3 + 1024);
+	env.assign(_locationConfig->cgiEnvPrefix);
 
-	env_vars_vec.push_back("REQUEST_METHOD=" + _request.method);
-	env_vars_vec.push_back("SERVER_PROTOCOL=" + _request.protocolVersion);
-	env_vars_vec.push_back("REDIRECT_STATUS=200");
-
-	if (_serverConfig) {
-		if (!_serverConfig->serverNames.empty()) {
-			env_vars_vec.push_back("SERVER_NAME=" + _serverConfig->serverNames[0]);
-		} else {
-			env_vars_vec.push_back("SERVER_NAME=localhost");
-		}
-		env_vars_vec.push_back("SERVER_PORT=" + StringUtils::longToString(_serverConfig->port));
-	} else {
-		env_vars_vec.push_back("SERVER_NAME=unknown");
-		env_vars_vec.push_back("SERVER_PORT=80");
-	}
-
-	env_vars_vec.push_back("SCRIPT_FILENAME=" + _cgi_script_path);
+	StringUtils::appendEnvEntry(env, "REQUEST_METHOD", _request.method);
+	StringUtils::appendEnvEntry(env, "SERVER_PROTOCOL", _request.protocolVersion);
+	StringUtils::appendEnvEntry(env, "SCRIPT_FILENAME", _cgi_script_path);
 
 	std::string script_name = _request.path;
 	if (script_name.empty() || script_name[0] != '/') {
 		script_name = "/" + script_name;
 	}
-	env_vars_vec.push_back("SCRIPT_NAME=" + script_name);
+	StringUtils::appendEnvEntry(env, "SCRIPT_NAME", script_name);
 
 	std::string path_info;
 	size_t script_path_len_in_uri = script_name.length();
@@ -227,109 +289,63 @@ char** CGIHandler::_createCGIEnvironment() const {
 	if (request_uri_path_only_len > script_path_len_in_uri) {
 		path_info = _request.uri.substr(script_path_len_in_uri, request_uri_path_only_len - script_path_len_in_uri);
 	}
-	env_vars_vec.push_back("PATH_INFO=" + path_info);
+	StringUtils::appendEnvEntry(env, "PATH_INFO", path_info);
 
-	env_vars_vec.push_back("REQUEST_URI=" + _request.uri);
+	StringUtils::appendEnvEntry(env, "REQUEST_URI", _request.uri);
 
 	size_t query_pos = _request.uri.find('?');
 	if (query_pos != std::string::npos) {
-		env_vars_vec.push_back("QUERY_STRING=" + _request.uri.substr(query_pos + 1));
+		StringUtils::appendEnvEntry(env, "QUERY_STRING", _request.uri.substr(query_pos + 1));
 	} else {
-		env_vars_vec.push_back("QUERY_STRING=");
+		StringUtils::appendEnvEntry(env, "QUERY_STRING", "");
 	}
 
 	if (_request.method == "POST") {
 		std::map<std::string, std::string>::const_iterator it_type = _request.headers.find("content-type");
 		if (it_type != _request.headers.end()) {
-			env_vars_vec.push_back("CONTENT_TYPE=" + it_type->second);
+			StringUtils::appendEnvEntry(env, "CONTENT_TYPE", it_type->second);
 		} else {
-			env_vars_vec.push_back("CONTENT_TYPE=");
+			StringUtils::appendEnvEntry(env, "CONTENT_TYPE", "");
 		}
 
 		std::map<std::string, std::string>::const_iterator it_len = _request.headers.find("content-length");
 		if (it_len != _request.headers.end()) {
-			env_vars_vec.push_back("CONTENT_LENGTH=" + it_len->second);
+			StringUtils::appendEnvEntry(env, "CONTENT_LENGTH", it_len->second);
+		} else if (_input_complete) {
+			StringUtils::appendEnvEntry(env, "CONTENT_LENGTH", StringUtils::longToString(_input_buffer.size()));
 		} else {
-			if (_request_body_ptr) {
-				 env_vars_vec.push_back("CONTENT_LENGTH=" + StringUtils::longToString(_request_body_ptr->size()));
-			} else {
-				 env_vars_vec.push_back("CONTENT_LENGTH=0");
-			}
+			// Chunked body still arriving: its length is unknown, the script reads stdin up to EOF.
+			StringUtils::appendEnvEntry(env, "CONTENT_LENGTH", "");
 		}
 	} else {
-		env_vars_vec.push_back("CONTENT_TYPE=");
-		env_vars_vec.push_back("CONTENT_LENGTH=");
-	}
-
-	std::string document_root_env;
-	std::string document_root_relative_for_env;
-	if (_locationConfig && !_locationConfig->root.empty()) {
-		document_root_relative_for_env = _locationConfig->root;
-	} else if (_serverConfig && !_serverConfig->root.empty()) {
-		document_root_relative_for_env = _serverConfig->root;
-	} else {
-		document_root_relative_for_env = "./";
-	}
-
-	char abs_doc_root_buffer[PATH_MAX];
-	if (realpath(document_root_relative_for_env.c_str(), abs_doc_root_buffer) == NULL) {
-		std::cerr << "WARNING: Failed to get absolute path for DOCUMENT_ROOT: " << document_root_relative_for_env << ". Using relative path." << std::endl;
-		document_root_env = document_root_relative_for_env;
-	} else {
-		document_root_env = abs_doc_root_buffer;
-	}
-	if (document_root_env.length() > 1 && document_root_env[document_root_env.length() - 1] == '/') {
-		document_root_env = document_root_env.substr(0, document_root_env.length() - 1);
+		StringUtils::appendEnvEntry(env, "CONTENT_TYPE", "");
+		StringUtils::appendEnvEntry(env, "CONTENT_LENGTH", "");
 	}
-	env_vars_vec.push_back("DOCUMENT_ROOT=" + document_root_env);
 
 	for (std::map<std::string, std::string>::const_iterator it = _request.headers.begin(); it != _request.headers.end(); ++it) {
-		std::string header_name = it->first;
+		const std::string& header_name = it->first;
 		if (StringUtils::ciCompare(header_name, "content-type") || StringUtils::ciCompare(header_name, "content-length") || StringUtils::ciCompare(header_name, "host")) {
 			continue;
 		}
-		std::transform(header_name.begin(), header_name.end(), header_name.begin(), static_cast<int(*)(int)>(std::toupper));
+		env.append("HTTP_");
 		for (size_t i = 0; i < header_name.length(); ++i) {
-			if (header_name[i] == '-') {
-				header_name[i] = '_';
-			}
+			env.push_back(header_name[i] == '-' ? '_' : static_cast<char>(std::toupper(static_cast<unsigned char>(header_name[i]))));
 		}
-		env_vars_vec.push_back("HTTP_" + header_name + "=" + it->second);
+		env.push_back('=');
+		env.append(it->second);
+		env.push_back('\0');
 	}
-
-	env_vars_vec.push_back("REMOTE_ADDR=127.0.0.1");
-	env_vars_vec.push_back("REMOTE_PORT=8080");
-
-	char** envp = new char*[env_vars_vec.size() + 1];
-	for (size_t i = 0; i < env_vars_vec.size(); ++i) {
-		envp[i] = new char[env_vars_vec[i].length() + 1];
-		strcpy(envp[i], env_vars_vec[i].c_str());
-	}
-	envp[env_vars_vec.size()] = NULL;
-	return envp;
 }
 
-// Creates argument list for execve.
-char** CGIHandler::_createCGIArguments() const {
-	char** argv = new char*[3];
-	argv[0] = new char[_cgi_executable_path.length() + 1];
-	strcpy(argv[0], _cgi_executable_path.c_str());
-
-	argv[1] = new char[_cgi_script_path.length() + 1];
-	strcpy(argv[1], _cgi_script_path.c_str());
-
-	argv[2] = NULL;
-	return argv;
-}
-
-// Frees char** arrays (for envp and argv).
-void CGIHandler::_freeCGICharArrays(char** arr) const {
-	if (arr) {
-		for (int i = 0; arr[i] != NULL; ++i) {
-			delete[] arr[i];
-		}
-		delete[] arr;
+// Fills 'envp' with pointers to the entries of an environment block, NULL-terminated.
+static void indexEnvironment(std::string& env, std::vector<char*>& envp) {
+	envp.clear();
+	size_t start = 0;
+	while (start < env.size()) {
+		envp.push_back(&env[start]);
+		start = env.find('\0', start) + 1;
 	}
+	envp.push_back(NULL);
 }
 
 // Cleans up CGI related file descriptors.
@@ -352,24 +368,70 @@ void CGIHandler::_closePipes() {
 	}
 }
 
-// Initiates the CGI process (fork, pipe, execve).
+// Initiates the CGI process (pipes, posix_spawn).
 bool CGIHandler::start() {
-	if (_state != CGIState::NOT_STARTED) {
+	if (_limiter && !_holds_slot) {
+		if (!_acquireSlot()) {
+			return _state == CGIState::QUEUED; // Still waiting, or refused with a full queue.
+		}
+		if (_state == CGIState::QUEUED) {
+			_state = CGIState::NOT_STARTED; // Waited for the slot: start as a fresh request.
+		}
+	}
+	if (_state == CGIState::QUEUED) {
+		return _startPooledWorker();
+	}
+	if (_state == CGIState::SPOOLING_INPUT && !_input_complete) {
+		return true; // Started again by the Connection once endInput() was called.
+	}
+	if (_state != CGIState::NOT_STARTED && _state != CGIState::SPOOLING_INPUT) {
 		std::cerr << "ERROR: CGI process already started or in an invalid state (" << _state << ")." << std::endl;
 		return false;
 	}
 
+	if (_worker_pool) {
+		return _startPooledWorker();
+	}
+	if (_fastcgi) {
+		return _startFastCGI();
+	}
+
 	if (_cgi_script_path.empty() || _cgi_executable_path.empty()) {
 		std::cerr << "ERROR: CGIHandler: Script or executable path not properly initialized (empty)." << std::endl;
 		_state = CGIState::CGI_PROCESS_ERROR;
 		return false;
 	}
 
-	// Initialize FDs to -1 before pipe calls
-	_fd_stdin[0] = -1; _fd_stdin[1] = -1;
+	// Initialize FDs to -1 before pipe calls (a spooled body already has its memfd in _fd_stdin[0])
+	if (_state != CGIState::SPOOLING_INPUT) {
+		_fd_stdin[0] = -1;
+	}
+	_fd_stdin[1] = -1;
 	_fd_stdout[0] = -1; _fd_stdout[1] = -1;
 
-	if (pipe(_fd_stdin) == -1) {
+	// A body larger than a pipe buffer is handed over as a file, so the script reads it at memory speed
+	// instead of one pipe-full per poll round trip. One announced by Content-Length is written to the
+	// file as it arrives, and the script only starts once it is complete; a chunked one that is still
+	// arriving is streamed through the pipe.
+	if (_state == CGIState::NOT_STARTED) {
+		if (_input_complete && _input_buffer.size() >= CGI_STDIN_MEMFD_MIN_SIZE) {
+			_fd_stdin[0] = _createInputMemfd();
+		} else if (!_input_complete && _announcedLength() >= CGI_STDIN_MEMFD_MIN_SIZE) {
+			_fd_stdin[0] = _createInputMemfd();
+			if (_fd_stdin[0] != -1) {
+				_state = CGIState::SPOOLING_INPUT;
+				setStartTime(); // Refreshed as the body arrives, so only a stalled upload times out.
+				return true;
+			}
+		}
+	}
+	if (_fd_stdin[0] != -1 && (!_spoolInput() || lseek(_fd_stdin[0], 0, SEEK_SET) == -1)) {
+		std::cerr << "ERROR: Failed to write the request body to the CGI stdin file." << std::endl;
+		_closePipes();
+		_state = CGIState::FORK_FAILED;
+		return false;
+	}
+	if (_fd_stdin[0] == -1 && pipe(_fd_stdin) == -1) {
 		std::cerr << "ERROR: Failed to create stdin pipe." << std::endl;
 		_state = CGIState::FORK_FAILED;
 		return false;
@@ -382,9 +444,9 @@ bool CGIHandler::start() {
 		return false;
 	}
 
-	// Set FD_CLOEXEC on all pipe ends in the parent
-	if (fcntl(_fd_stdin[0], F_SETFD, FD_CLOEXEC) == -1 ||
-		fcntl(_fd_stdin[1], F_SETFD, FD_CLOEXEC) == -1 ||
+	// Set FD_CLOEXEC on all pipe ends in the parent (a stdin memfd is created with it)
+	if ((_fd_stdin[1] != -1 && (fcntl(_fd_stdin[0], F_SETFD, FD_CLOEXEC) == -1 ||
+								 fcntl(_fd_stdin[1], F_SETFD, FD_CLOEXEC) == -1)) ||
 		fcntl(_fd_stdout[0], F_SETFD, FD_CLOEXEC) == -1 ||
 		fcntl(_fd_stdout[1], F_SETFD, FD_CLOEXEC) == -1) {
 		std::cerr << "ERROR: Failed to set FD_CLOEXEC on CGI pipes." << std::endl;
@@ -393,111 +455,398 @@ bool CGIHandler::start() {
 		return false;
 	}
 
-	if (!_setNonBlocking(_fd_stdin[1]) || !_setNonBlocking(_fd_stdout[0])) {
+	if ((_fd_stdin[1] != -1 && !_setNonBlocking(_fd_stdin[1])) || !_setNonBlocking(_fd_stdout[0])) {
 		_closePipes(); // Close all pipes if setting non-blocking fails
 		return false;
 	}
 
-	_cgi_pid = fork();
-	if (_cgi_pid == -1) {
-		std::cerr << "ERROR: Failed to fork CGI process." << std::endl;
-		_closePipes(); // Close all pipes if fork fails
+	// Everything the child needs is prepared here, so the child only execs: with posix_spawn the
+	// child shares the parent's memory until exec (vfork semantics) and must not do anything else.
+	if (access(_cgi_script_path.c_str(), F_OK | R_OK) == -1) {
+		std::cerr << "ERROR: CGI: Script not found or not readable: " << _cgi_script_path << std::endl;
+		_closePipes();
+		_state = CGIState::CGI_PROCESS_ERROR;
+		return false;
+	}
+
+	// The environment block and the pointer arrays only have to outlive posix_spawn.
+	std::string env_block;
+	std::vector<char*> envp;
+	_buildCGIEnvironment(env_block);
+	indexEnvironment(env_block, envp);
+	char* argv[] = { const_cast<char*>(_cgi_executable_path.c_str()), const_cast<char*>(_cgi_script_path.c_str()), NULL };
+
+	// The pipe ends are all FD_CLOEXEC; dup2 onto 0/1 clears the flag on the copies the child keeps.
+	posix_spawn_file_actions_t actions;
+	posix_spawn_file_actions_init(&actions);
+	posix_spawn_file_actions_adddup2(&actions, _fd_stdin[0], STDIN_FILENO);
+	posix_spawn_file_actions_adddup2(&actions, _fd_stdout[1], STDOUT_FILENO);
+	posix_spawn_file_actions_addchdir_np(&actions, _locationConfig->cgiRootPath.c_str());
+	// The script leads its own process group, so abort() also reaches the helpers it starts.
+	posix_spawnattr_t attr;
+	posix_spawnattr_init(&attr);
+	posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP);
+	posix_spawnattr_setpgroup(&attr, 0);
+
+	int spawn_res = posix_spawn(&_cgi_pid, _cgi_executable_path.c_str(), &actions, &attr, argv, &envp[0]);
+
+	posix_spawnattr_destroy(&attr);
+	posix_spawn_file_actions_destroy(&actions);
+
+	if (spawn_res != 0) {
+		std::cerr << "ERROR: Failed to spawn CGI process: " << _cgi_executable_path << " (" << strerror(spawn_res) << ")." << std::endl;
+		_cgi_pid = -1;
+		_closePipes();
 		_state = CGIState::FORK_FAILED;
 		return false;
 	}
 
-	if (_cgi_pid == 0) { // Child process.
-		close(_fd_stdin[1]); // Close parent's write end of stdin pipe
-		_fd_stdin[1] = -1; // Mark as closed
-		close(_fd_stdout[0]); // Close parent's read end of stdout pipe
-		_fd_stdout[0] = -1; // Mark as closed
+	close(_fd_stdin[0]); // Close child's read end in parent
+	_fd_stdin[0] = -1; // Mark as closed
+	close(_fd_stdout[1]); // Close child's write end in parent
+	_fd_stdout[1] = -1; // Mark as closed
+
+	// A pidfd becomes readable when the child exits, so the poll loop learns about it even if no pipe
+	// event follows (e.g. a daemonized grandchild keeps stdout open). Without it (kernel < 5.3),
+	// exit is only noticed on the next pipe event.
+	gettimeofday(&_spawn_time, NULL);
+#ifdef SYS_pidfd_open
+	_pidfd = syscall(SYS_pidfd_open, _cgi_pid, 0);
+#endif
+
+	// Without a body (none announced, or an empty one already complete), the script gets EOF on stdin at once.
+	// With a memfd it already has the whole body, and there is nothing left to write.
+	if (_fd_stdin[1] == -1) {
+		std::vector<char>().swap(_input_buffer);
+		_input_closed = true;
+		_state = CGIState::READING_OUTPUT;
+	} else if (_input_complete && _input_buffer.empty()) {
+		close(_fd_stdin[1]);
+		_fd_stdin[1] = -1;
+		_input_closed = true;
+		_state = CGIState::READING_OUTPUT;
+	} else {
+		_state = CGIState::WRITING_INPUT;
+	}
+	setStartTime(); // Record start time in parent
+	return true;
+}
 
-		if (dup2(_fd_stdin[0], STDIN_FILENO) == -1) {
-			std::cerr << "ERROR: dup2 STDIN_FILENO failed in CGI child. " << strerror(errno) << ". Exiting." << std::endl;
-			_exit(EXIT_FAILURE);
+// Creates the anonymous memory file that becomes the script's stdin, holding the body received so
+// far. Returns -1 when memfd_create is unavailable or the copy fails: the pipe is used then.
+int CGIHandler::_createInputMemfd() {
+#ifdef SYS_memfd_create
+	int fd = syscall(SYS_memfd_create, "cgi-stdin", MFD_CLOEXEC);
+	if (fd == -1) {
+		return -1;
+	}
+	size_t written = 0;
+	while (written < _input_buffer.size()) {
+		ssize_t n = write(fd, &_input_buffer[written], _input_buffer.size() - written);
+		if (n <= 0) {
+			close(fd);
+			return -1;
 		}
-		if (dup2(_fd_stdout[1], STDOUT_FILENO) == -1) {
-			std::cerr << "ERROR: dup2 STDOUT_FILENO failed in CGI child. " << strerror(errno) << ". Exiting." << std::endl;
-			_exit(EXIT_FAILURE);
+		written += n;
+	}
+	_input_buffer.clear();
+	return fd;
+#else
+	return -1;
+#endif
+}
+
+// Appends the buffered body bytes to the stdin memfd. Bytes a failed write left behind stay buffered.
+bool CGIHandler::_spoolInput() {
+	size_t written = 0;
+	while (written < _input_buffer.size()) {
+		ssize_t n = write(_fd_stdin[0], &_input_buffer[written], _input_buffer.size() - written);
+		if (n <= 0) {
+			break;
 		}
+		written += n;
+	}
+	_input_buffer.erase(_input_buffer.begin(), _input_buffer.begin() + written);
+	return _input_buffer.empty();
+}
 
-		close(_fd_stdin[0]); // Close child's read end of stdin pipe
-		_fd_stdin[0] = -1; // Mark as closed
-		close(_fd_stdout[1]); // Close child's write end of stdout pipe
-		_fd_stdout[1] = -1; // Mark as closed
+// The body length announced by Content-Length, -1 without one (chunked).
+long CGIHandler::_announcedLength() const {
+	std::map<std::string, std::string>::const_iterator it = _request.headers.find("content-length");
+	if (it == _request.headers.end()) {
+		return -1;
+	}
+	return std::strtol(it->second.c_str(), NULL, 10);
+}
 
-		std::string cgi_working_dir_relative;
-		if (_locationConfig && !_locationConfig->root.empty()) {
-			cgi_working_dir_relative = _locationConfig->root;
-		} else if (_serverConfig && !_serverConfig->root.empty()) {
-			cgi_working_dir_relative = _serverConfig->root;
-		} else {
-			cgi_working_dir_relative = "./";
-		}
+// Returns the read file descriptor for the CGI's stdout pipe (parent's read end).
+int CGIHandler::getReadFd() const {
+	return _fd_stdout[0];
+}
 
-		char abs_chdir_path[PATH_MAX];
-		if (realpath(cgi_working_dir_relative.c_str(), abs_chdir_path) == NULL) {
-			std::cerr << "ERROR: CGI child: Failed to get absolute path for chdir target '" << cgi_working_dir_relative << "'. " << strerror(errno) << ". Exiting." << std::endl;
-			_exit(EXIT_FAILURE);
-		}
-		std::string cgi_working_dir_absolute = abs_chdir_path;
+// Returns the pidfd of the spawned script (-1 if none), polled for POLLIN to learn about its exit.
+int CGIHandler::getProcessFd() const {
+	return _pidfd;
+}
+
+// Returns the write file descriptor for the CGI's stdin pipe (parent's write end).
+int CGIHandler::getWriteFd() const {
+	return _fd_stdin[1];
+}
+
+// Poll events for the read fd. A FastCGI socket also waits for writability until the request is sent.
+short CGIHandler::getReadEvents() const {
+	if (_fastcgi && _fcgi_out_sent < _fcgi_out.size()) {
+		return POLLIN | POLLOUT;
+	}
+	return POLLIN;
+}
+
+// HTTP status to answer with when the handler fails: 502 when a FastCGI backend misbehaved, 500 otherwise.
+int CGIHandler::getErrorStatus() const {
+	return _error_status;
+}
+
+// Seconds a client refused with 503 should wait before retrying: about how long a queued request may wait.
+long CGIHandler::getRetryAfter() const {
+	return _limiter ? _limiter->getQueueTimeout() : CGI_TIMEOUT_SECONDS;
+}
 
-		if (chdir(cgi_working_dir_absolute.c_str()) == -1) {
-			std::cerr << "ERROR: chdir failed in CGI child to " << cgi_working_dir_absolute << ". " << strerror(errno) << ". Exiting." << std::endl;
-			_exit(EXIT_FAILURE);
+// Takes a concurrency slot of the location. Without one the request is QUEUED (the Server retries
+// it as slots are released), or refused with a 503 when the location's queue is full.
+bool CGIHandler::_acquireSlot() {
+	if (_limiter->tryAcquire(_queued_for_slot)) {
+		if (_queued_for_slot) {
+			_limiter->dequeue();
+			_queued_for_slot = false;
 		}
+		_holds_slot = true;
+		gettimeofday(&_slot_since, NULL);
+		return true;
+	}
+	if (_queued_for_slot) {
+		return false;
+	}
+	if (!_limiter->enqueue()) {
+		std::cerr << "WARNING: CGI limit reached for location '" << _locationConfig->path << "' and its queue is full. Answering 503." << std::endl;
+		_error_status = 503;
+		_state = CGIState::CGI_PROCESS_ERROR;
+		return false;
+	}
+	_queued_for_slot = true;
+	_state = CGIState::QUEUED;
+	setStartTime(); // Measured against the queue timeout.
+	return false;
+}
+
+// Leaves the location's queue or gives its slot back, reporting how long the request ran.
+void CGIHandler::_releaseSlot() {
+	if (_queued_for_slot) {
+		_limiter->dequeue();
+		_queued_for_slot = false;
+	}
+	if (!_holds_slot) {
+		return;
+	}
+	double seconds = -1; // Abandoned before a verdict: no latency sample.
+	if (_state == CGIState::COMPLETE) {
+		struct timeval now;
+		gettimeofday(&now, NULL);
+		seconds = (now.tv_sec - _slot_since.tv_sec) + (now.tv_usec - _slot_since.tv_usec) / 1000000.0;
+	}
+	_limiter->release(seconds, _state == CGIState::TIMEOUT);
+	_holds_slot = false;
+}
+
+// Connects (or reuses a pooled connection) to the FastCGI backend and encodes the whole request.
+// The records are flushed by handleWrite() as the socket becomes writable.
+bool CGIHandler::_startFastCGI() {
+	bool reused = false;
+
+	_fd_stdout[0] = FastCGIPool::acquire(_locationConfig->fastcgiPass, reused);
+	if (_fd_stdout[0] == -1) {
+		_error_status = 502;
+		_state = CGIState::CGI_PROCESS_ERROR;
+		return false;
+	}
+	_encodeFastCGIRequest();
+	_state = CGIState::READING_OUTPUT;
+	setStartTime();
+	return true;
+}
+
+// Takes an idle pooled worker, or leaves the request QUEUED when all workers are busy
+// (the Server retries it when one is released). The request is written to the worker's stdin pipe.
+bool CGIHandler::_startPooledWorker() {
+	bool saturated = false;
 
-		// Check if executable exists and is executable
-		if (access(_cgi_executable_path.c_str(), X_OK) == -1) {
-			std::cerr << "ERROR: CGI child: Executable not found or not executable: " << _cgi_executable_path << ". " << strerror(errno) << ". Exiting." << std::endl;
-			_exit(EXIT_FAILURE);
+	_worker = _worker_pool->acquire(saturated);
+	if (!_worker) {
+		if (!saturated) {
+			_state = CGIState::FORK_FAILED;
+			return false;
 		}
+		if (_state != CGIState::QUEUED) {
+			_state = CGIState::QUEUED;
+			setStartTime(); // The wait in the queue counts towards the CGI timeout.
+		}
+		return true;
+	}
+	_fd_stdin[1] = _worker->stdinFd;
+	_fd_stdout[0] = _worker->stdoutFd;
+	_encodeFastCGIRequest();
+	_state = CGIState::WRITING_INPUT;
+	setStartTime();
+	return true;
+}
 
-		// Check if script exists and is readable
-		if (access(_cgi_script_path.c_str(), F_OK | R_OK) == -1) {
-			std::cerr << "ERROR: CGI child: Script not found or not readable: " << _cgi_script_path << ". " << strerror(errno) << ". Exiting." << std::endl;
-			_exit(EXIT_FAILURE);
+// Encodes the whole request (BEGIN_REQUEST, PARAMS, STDIN) into the outgoing record buffer.
+void CGIHandler::_encodeFastCGIRequest() {
+	std::string env_block;
+	_buildCGIEnvironment(env_block);
+	std::string params;
+	size_t start = 0;
+	while (start < env_block.size()) {
+		size_t end = env_block.find('\0', start);
+		size_t eq_pos = env_block.find('=', start);
+		FastCGI::appendParam(params, env_block.substr(start, eq_pos - start), env_block.substr(eq_pos + 1, end - eq_pos - 1));
+		start = end + 1;
+	}
+
+	_fcgi_out.clear();
+	_fcgi_out_sent = 0;
+	FastCGI::appendBeginRequest(_fcgi_out, 1, true);
+	FastCGI::appendStream(_fcgi_out, FastCGI::PARAMS, 1, params.data(), params.size());
+	FastCGI::appendStream(_fcgi_out, FastCGI::PARAMS, 1, NULL, 0);
+	_encodeFastCGIInput();
+}
+
+// Moves the buffered request body into STDIN records, and ends the stream once the input is complete.
+void CGIHandler::_encodeFastCGIInput() {
+	if (_fcgi_out_sent > 0) {
+		_fcgi_out.erase(0, _fcgi_out_sent);
+		_fcgi_out_sent = 0;
+	}
+	if (_input_sent < _input_buffer.size()) {
+		FastCGI::appendStream(_fcgi_out, FastCGI::STDIN, 1, &_input_buffer[_input_sent], _input_buffer.size() - _input_sent);
+	}
+	_input_buffer.clear();
+	_input_sent = 0;
+	if (_input_complete && !_input_end_encoded) {
+		FastCGI::appendStream(_fcgi_out, FastCGI::STDIN, 1, NULL, 0);
+		_input_end_encoded = true;
+	}
+}
+
+// Sends pending request records to the FastCGI backend (socket) or pooled worker (stdin pipe).
+void CGIHandler::_writeFastCGI() {
+	int fd = _worker ? _fd_stdin[1] : _fd_stdout[0];
+	if (fd < 0 || _fcgi_out_sent >= _fcgi_out.size()) {
+		return;
+	}
+	const char* data = _fcgi_out.data() + _fcgi_out_sent;
+	size_t len = _fcgi_out.size() - _fcgi_out_sent;
+	ssize_t bytes_sent = _worker ? write(fd, data, len) : send(fd, data, len, MSG_NOSIGNAL);
+	if (bytes_sent < 0) {
+		_failFastCGI("cannot send request to backend");
+		return;
+	}
+	_fcgi_out_sent += bytes_sent;
+	if (_fcgi_out_sent < _fcgi_out.size() || !_serverPtr) {
+		return;
+	}
+	_fcgi_out.clear();
+	_fcgi_out_sent = 0;
+	if (_worker) {
+		if (!_input_end_encoded) {
+			// More of the body is on its way: wait for it out of the poll set.
+			_serverPtr->suspendFd(fd);
+			_input_suspended = true;
+			return;
 		}
+		// The stdin pipe stays open with the worker; it only leaves the poll set.
+		_serverPtr->unregisterCgiFd(fd, false);
+		_fd_stdin[1] = -1;
+		if (_state == CGIState::WRITING_INPUT) {
+			_state = CGIState::READING_OUTPUT;
+		}
+	} else {
+		_serverPtr->updateFdEvents(fd, POLLIN); // Stays suspended if output is paused
+	}
+}
 
-		char** envp = _createCGIEnvironment();
-		char** argv = _createCGIArguments();
-
-		execve(_cgi_executable_path.c_str(), argv, envp);
-
-		// If execve fails, this code will be executed
-		std::cerr << "ERROR: execve failed for CGI: " << _cgi_executable_path << ". " << strerror(errno) << ". Exiting." << std::endl;
-		_freeCGICharArrays(envp);
-		_freeCGICharArrays(argv);
-		_exit(EXIT_FAILURE);
-	} else { // Parent process.
-		close(_fd_stdin[0]); // Close child's read end in parent
-		_fd_stdin[0] = -1; // Mark as closed
-		close(_fd_stdout[1]); // Close child's write end in parent
-		_fd_stdout[1] = -1; // Mark as closed
-
-		// If it's a GET request, we don't need to write to CGI stdin, so close the parent's write end.
-		if (_request.method != "POST" || !_request_body_ptr || _request_body_ptr->empty()) {
-			if (_fd_stdin[1] != -1) {
-				close(_fd_stdin[1]);
-				_fd_stdin[1] = -1;
+// Decodes FastCGI records: STDOUT feeds the same buffer a CGI pipe would, STDERR goes to the log,
+// and END_REQUEST finishes the response and returns the connection to the pool.
+void CGIHandler::_readFastCGI() {
+	if (_fd_stdout[0] < 0) {
+		return;
+	}
+
+	char buffer[BUFF_SIZE];
+	ssize_t bytes_read = read(_fd_stdout[0], buffer, sizeof(buffer));
+	if (bytes_read <= 0) {
+		_failFastCGI(bytes_read == 0 ? "backend closed the connection before END_REQUEST" : "cannot read from backend");
+		return;
+	}
+	_fcgi_decoder.feed(buffer, bytes_read);
+
+	FastCGI::Record record;
+	while (_fcgi_decoder.next(record)) {
+		if (record.requestId != 1) {
+			continue; // Management records (request id 0) are not used here.
+		}
+		if (record.type == FastCGI::STDOUT) {
+			_cgi_response_buffer.insert(_cgi_response_buffer.end(), record.content.begin(), record.content.end());
+			if (!_cgi_headers_parsed) {
+				_parseCGIHeaders();
 			}
-			_state = CGIState::READING_OUTPUT;
-		} else {
-			_state = CGIState::WRITING_INPUT;
+		} else if (record.type == FastCGI::STDERR) {
+			std::cerr << "FastCGI stderr: " << record.content;
+		} else if (record.type == FastCGI::END_REQUEST) {
+			_cgi_stdout_eof_received = true;
+			_parseCGIOutput();
+			if (_state == CGIState::CGI_PROCESS_ERROR) {
+				_error_status = 502;
+				return; // cleanup() closes the socket: the backend sent something unusable.
+			}
+			_finishFastCGI();
+			return;
 		}
-		setStartTime(); // Record start time in parent
 	}
-	return true;
 }
 
-// Returns the read file descriptor for the CGI's stdout pipe (parent's read end).
-int CGIHandler::getReadFd() const {
-	return _fd_stdout[0];
+// The request is over: hand the socket (or worker) back for the next request, unless the
+// exchange ended out of step (request not fully sent, or bytes past END_REQUEST).
+void CGIHandler::_finishFastCGI() {
+	bool reusable = _input_end_encoded && _fcgi_out_sent == _fcgi_out.size() && !_fcgi_decoder.hasPartialRecord();
+
+	if (_serverPtr) {
+		if (_fd_stdin[1] != -1) {
+			_serverPtr->unregisterCgiFd(_fd_stdin[1], false);
+		}
+		_serverPtr->unregisterCgiFd(_fd_stdout[0], false);
+	}
+	if (_worker) {
+		if (reusable) {
+			_worker_pool->release(_worker);
+		} else {
+			_worker_pool->discard(_worker);
+		}
+		_worker = NULL;
+	} else if (reusable) {
+		FastCGIPool::release(_locationConfig->fastcgiPass, _fd_stdout[0]);
+	} else {
+		close(_fd_stdout[0]);
+	}
+	_fd_stdin[1] = -1;
+	_fd_stdout[0] = -1;
 }
 
-// Returns the write file descriptor for the CGI's stdin pipe (parent's write end).
-int CGIHandler::getWriteFd() const {
-	return _fd_stdin[1];
+// Marks the FastCGI exchange as failed; the socket is closed by cleanup() rather than pooled.
+void CGIHandler::_failFastCGI(const std::string& reason) {
+	std::cerr << "ERROR: FastCGI backend '" << _locationConfig->fastcgiPass << "': " << reason << "." << std::endl;
+	_error_status = 502;
+	_state = CGIState::CGI_PROCESS_ERROR;
 }
 
 // Handles incoming data from the CGI's stdout pipe.
@@ -511,6 +860,11 @@ void CGIHandler::handleRead() {
 		return;
 	}
 
+	if (_fastcgi) {
+		_readFastCGI();
+		return;
+	}
+
 	char buffer[BUFF_SIZE];
 	ssize_t bytes_read = read(_fd_stdout[0], buffer, sizeof(buffer));
 
@@ -518,6 +872,9 @@ void CGIHandler::handleRead() {
 
 	if (bytes_read > 0) {
 		_cgi_response_buffer.insert(_cgi_response_buffer.end(), buffer, buffer + bytes_read);
+		if (!_cgi_headers_parsed) {
+			_parseCGIHeaders(); // Headers are parsed as soon as they are complete, so the body can be streamed.
+		}
 	} else if (bytes_read == 0) { // EOF received
 		_cgi_stdout_eof_received = true;
 	} else { // bytes_read == -1
@@ -528,99 +885,154 @@ void CGIHandler::handleRead() {
 
 // Handles sending data to the CGI's stdin pipe (for POST requests).
 void CGIHandler::handleWrite() {
+	if (_fastcgi) {
+		if (!isFinished()) {
+			_writeFastCGI();
+		}
+		return;
+	}
 	if (_state != CGIState::WRITING_INPUT) {
 		std::cerr << "WARNING: CGIHandler::handleWrite called in unexpected state: " << _state << std::endl;
 		return;
 	}
 
-	if (_fd_stdin[1] == -1 || _fd_stdin[1] == -2) {
+	if (_fd_stdin[1] == -1) {
 		_state = CGIState::READING_OUTPUT;
 		return;
 	}
 
-	if (!_request_body_ptr || _request_body_ptr->empty()) {
-		if (_fd_stdin[1] != -1) {
-			_fd_stdin[1] = -2;
-		}
-		_state = CGIState::READING_OUTPUT;
+	size_t remaining_bytes = _input_buffer.size() - _input_sent;
+	if (remaining_bytes == 0) {
+		_onInputDrained();
 		return;
 	}
 
-	size_t remaining_bytes = _request_body_ptr->size() - _request_body_sent_bytes;
-	if (remaining_bytes == 0) {
-		if (_fd_stdin[1] != -1) {
-			_fd_stdin[1] = -2;
-		}
-		_state = CGIState::READING_OUTPUT;
+	ssize_t bytes_written = write(_fd_stdin[1], &_input_buffer[_input_sent], remaining_bytes);
+	if (bytes_written < 0) {
+		// The script closed its stdin (or exited) without reading the whole body: its output still decides the response.
+		std::cerr << "WARNING: CGIHandler::handleWrite: CGI stdin pipe (FD: " << _fd_stdin[1] << ") no longer accepts the request body. Discarding the rest." << std::endl;
+		_closeInput();
 		return;
 	}
+	_input_sent += bytes_written;
+	if (_input_sent == _input_buffer.size()) {
+		_onInputDrained();
+	}
+}
 
-	ssize_t bytes_written = write(_fd_stdin[1],
-								  &(*_request_body_ptr)[_request_body_sent_bytes],
-								  remaining_bytes);
+// Everything received so far was written: close stdin if the body is complete, otherwise stop polling
+// it until appendInput() brings more.
+void CGIHandler::_onInputDrained() {
+	_input_buffer.clear();
+	_input_sent = 0;
+	if (_input_complete) {
+		_closeInput();
+	} else if (!_input_suspended && _serverPtr) {
+		_serverPtr->suspendFd(_fd_stdin[1]);
+		_input_suspended = true;
+	}
+}
 
-	if (bytes_written > 0) {
-		_request_body_sent_bytes += bytes_written;
+// Closes the script's stdin (EOF) and drops whatever input is left or still to come.
+void CGIHandler::_closeInput() {
+	if (_fd_stdin[1] != -1) {
+		if (_serverPtr) {
+			_serverPtr->unregisterCgiFd(_fd_stdin[1]); // This closes the FD
+		} else {
+			close(_fd_stdin[1]);
+		}
+		_fd_stdin[1] = -1;
+	}
+	_input_buffer.clear();
+	_input_sent = 0;
+	_input_closed = true;
+	_input_suspended = false;
+	if (_state == CGIState::WRITING_INPUT) {
+		_state = CGIState::READING_OUTPUT;
+	}
+}
 
-		if (_request_body_sent_bytes == _request_body_ptr->size()) {
-			if (_fd_stdin[1] != -1) {
-				_fd_stdin[1] = -2;
+// Checks the status of the CGI child process (non-blocking wait4). The response completes once the
+// child has exited AND its stdout reached EOF, whichever comes last; the remaining output is left to
+// the poll loop rather than drained here, so backpressure keeps applying to it. A stdout that is
+// drained but held open by something other than the exited child counts as EOF.
+void CGIHandler::pollCGIProcess() {
+	if (_cgi_pid != -1 && !isFinished()) {
+		int status = 0;
+		struct rusage usage;
+		pid_t result = wait4(_cgi_pid, &status, WNOHANG, &usage);
+
+		if (result == _cgi_pid) {
+			_logResourceUsage(status, usage);
+			_cgi_pid = -1; // Reaped: nothing left to signal or wait for.
+			_cgi_exited = true;
+			_closeProcessFd();
+			if (WIFEXITED(status)) {
+				_cgi_exit_status = WEXITSTATUS(status);
+			} else if (WIFSIGNALED(status)) {
+				_cgi_exit_status = WTERMSIG(status);
+				std::cerr << "ERROR: CGI process terminated by signal: " << _cgi_exit_status << std::endl;
+				_state = CGIState::CGI_PROCESS_ERROR;
+			} else {
+				// Process ended abnormally (e.g., stopped, continued, core dump)
+				std::cerr << "ERROR: CGI process ended abnormally (not exited/signaled). Status: " << status << std::endl;
+				_cgi_exit_status = -2; // Custom value to indicate abnormal termination
+				_state = CGIState::CGI_PROCESS_ERROR;
 			}
-			_state = CGIState::READING_OUTPUT;
-		}
-	} else { // bytes_written <= 0
-		if (bytes_written == 0) {
-			// This case means write() returned 0 bytes.
-			// For non-blocking, this implies the pipe is full or not ready.
-			// It's not an error that should terminate the CGI process.
-			// Do nothing, just return. The poll loop will re-poll for POLLOUT.
-		} else { // bytes_written == -1
-			std::cerr << "ERROR: CGIHandler::handleWrite: Fatal error writing to CGI stdin pipe (FD: " << _fd_stdin[1] << "). Throwing 500." << std::endl;
-			throw Http500Exception("Fatal error writing to CGI stdin pipe.");
+		} else if (result == -1) { // wait4 itself failed
+			std::cerr << "ERROR: wait4 failed for CGI process " << _cgi_pid << "." << std::endl;
+			_state = CGIState::CGI_PROCESS_ERROR;
 		}
 	}
+	if (_cgi_exited && !_cgi_stdout_eof_received && !_fastcgi && !_stdoutHasWriters()) {
+		std::cerr << "WARNING: CGI script exited but a descendant keeps its stdout open. Ending the response." << std::endl;
+		_cgi_stdout_eof_received = true;
+	}
+	if (_cgi_exited && _cgi_stdout_eof_received && !isFinished()) {
+		_parseCGIOutput();
+	}
 }
 
-// Checks the status of the CGI child process (non-blocking waitpid).
-void CGIHandler::pollCGIProcess() {
-    if (_cgi_pid != -1 && !isFinished()) {
-        int status = 0; // Initialize status to 0
-        pid_t result = waitpid(_cgi_pid, &status, WNOHANG);
+// After the script exited, tells whether its stdout may still deliver anything: unread data is
+// reported as POLLIN and a closed write end as POLLHUP. Neither means the write end lives on in a
+// process the script left behind, which the response should not wait for.
+bool CGIHandler::_stdoutHasWriters() const {
+	if (_fd_stdout[0] < 0) {
+		return false;
+	}
+	struct pollfd pfd;
+	pfd.fd = _fd_stdout[0];
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+	return poll(&pfd, 1, 0) != 0;
+}
 
-        if (result == _cgi_pid) {
-            if (WIFEXITED(status)) {
-                _cgi_exit_status = WEXITSTATUS(status);
-            } else if (WIFSIGNALED(status)) {
-                _cgi_exit_status = WTERMSIG(status);
-                std::cerr << "ERROR: CGI process terminated by signal: " << _cgi_exit_status << std::endl;
-                _state = CGIState::CGI_PROCESS_ERROR;
-            } else {
-                // Process ended abnormally (e.g., stopped, continued, core dump)
-                std::cerr << "ERROR: CGI process ended abnormally (not exited/signaled). Status: " << status << std::endl;
-                _cgi_exit_status = -2; // Custom value to indicate abnormal termination
-                _state = CGIState::CGI_PROCESS_ERROR;
-            }
-
-            // If CGI process exited, ensure all output is read before parsing
-            while (!_cgi_stdout_eof_received) {
-                handleRead(); // This will set _cgi_stdout_eof_received to true on EOF
-                if (_cgi_stdout_eof_received) {
-                    break;
-                }
-            }
-
-            if (!_cgi_headers_parsed) {
-                _parseCGIOutput();
-            }
-
-            if (_state != CGIState::CGI_PROCESS_ERROR && _state != CGIState::TIMEOUT && _state != CGIState::COMPLETE) {
-                _state = CGIState::COMPLETE;
-            }
-        } else if (result == -1) { // waitpid itself failed
-            std::cerr << "ERROR: waitpid failed for CGI process " << _cgi_pid << "." << std::endl;
-            _state = CGIState::CGI_PROCESS_ERROR;
-        }
-    }
+// Closes the pidfd once the child is reaped.
+void CGIHandler::_closeProcessFd() {
+	if (_pidfd == -1) {
+		return;
+	}
+	if (_serverPtr) {
+		_serverPtr->unregisterCgiFd(_pidfd); // This closes the FD
+	} else {
+		close(_pidfd);
+	}
+	_pidfd = -1;
+}
+
+// One line per CGI run with what the child cost (wait4 rusage), for capacity planning.
+void CGIHandler::_logResourceUsage(int status, const struct rusage& usage) const {
+	struct timeval now;
+	gettimeofday(&now, NULL);
+	long wall_us = (now.tv_sec - _spawn_time.tv_sec) * 1000000L + (now.tv_usec - _spawn_time.tv_usec);
+	long user_us = usage.ru_utime.tv_sec * 1000000L + usage.ru_utime.tv_usec;
+	long sys_us = usage.ru_stime.tv_sec * 1000000L + usage.ru_stime.tv_usec;
+
+	std::cout << "CGI usage: pid=" << _cgi_pid << " script=" << _cgi_script_path
+		<< " status=" << (WIFEXITED(status) ? WEXITSTATUS(status) : -1)
+		<< " wall_ms=" << wall_us / 1000 << " user_ms=" << user_us / 1000 << " sys_ms=" << sys_us / 1000
+		<< " maxrss_kb=" << usage.ru_maxrss << " minflt=" << usage.ru_minflt << " majflt=" << usage.ru_majflt
+		<< " nvcsw=" << usage.ru_nvcsw << " nivcsw=" << usage.ru_nivcsw << std::endl;
 }
 
 // Returns the current state of the CGI execution.
@@ -644,7 +1056,7 @@ const HttpResponse& CGIHandler::getHttpResponse() const {
 	return _final_http_response;
 }
 
-// Returns the PID of the forked CGI process.
+// Returns the PID of the spawned CGI process.
 pid_t CGIHandler::getCGIPid() const {
 	return _cgi_pid;
 }
@@ -659,8 +1071,11 @@ bool CGIHandler::checkTimeout() const {
 	if (_state == CGIState::COMPLETE || _state == CGIState::TIMEOUT || _state == CGIState::CGI_PROCESS_ERROR) {
 		return false; // Already finished or in an error state
 	}
-	if (_cgi_start_time == 0) {
-		return false; // Not started yet
+	if (_cgi_start_time == 0 || _output_paused) {
+		return false; // Not started yet, or waiting on a slow client rather than on the script
+	}
+	if (_queued_for_slot) {
+		return (time(NULL) - _cgi_start_time) > _limiter->getQueueTimeout();
 	}
 	return (time(NULL) - _cgi_start_time) > CGI_TIMEOUT_SECONDS;
 }
@@ -670,6 +1085,10 @@ void CGIHandler::setTimeout() {
 	if (isFinished()) return;
 
 	std::cerr << "WARNING: CGI process " << _cgi_pid << " timed out." << std::endl;
+	_error_status = (_state == CGIState::QUEUED) ? 503 : 504; // 503: never got a pooled worker or a concurrency slot.
+	if (_state == CGIState::SPOOLING_INPUT) {
+		_error_status = 408; // The client stopped sending the body before the script was started.
+	}
 	_state = CGIState::TIMEOUT;
 	if (_cgi_pid != -1) {
 		kill(_cgi_pid, SIGTERM);
@@ -681,64 +1100,90 @@ void CGIHandler::setTimeout() {
 	_final_http_response.setBody("<html><body><h1>504 Gateway Timeout</h1><p>The CGI script did not respond in time.</p></body></html>");
 }
 
-// Parses the CGI's raw output into headers and body.
-void CGIHandler::_parseCGIOutput() {
-	if (_cgi_headers_parsed) {
-		return;
+// Stops a request whose client disconnected: the script's process group is killed and reaped, and
+// its pipes, pidfd, worker and concurrency slot are released at once instead of when it would finish.
+void CGIHandler::abort() {
+	++_aborted_count;
+	if (_cgi_pid != -1) {
+		if (kill(-_cgi_pid, SIGKILL) == -1) {
+			kill(_cgi_pid, SIGKILL);
+		}
+		int status;
+		struct rusage usage;
+		if (wait4(_cgi_pid, &status, 0, &usage) == _cgi_pid) {
+			_logResourceUsage(status, usage);
+		}
+		_cgi_pid = -1;
 	}
+	_state = CGIState::CGI_PROCESS_ERROR;
+	cleanup();
+	std::cout << "CGI aborted: " << _cgi_script_path << " (" << _aborted_count << " aborted so far)" << std::endl;
+}
 
-	std::string raw_output(_cgi_response_buffer.begin(), _cgi_response_buffer.end());
+// Number of CGI requests aborted because their client went away, since startup.
+unsigned long CGIHandler::getAbortedCount() {
+	return _aborted_count;
+}
 
-	size_t header_end_pos = raw_output.find("\r\n\r\n");
-	bool crlf_crlf_used = true;
-	if (header_end_pos == std::string::npos) {
-		header_end_pos = raw_output.find("\n\n");
-		crlf_crlf_used = false;
+// Parses the CGI header section once it is complete in the output buffer.
+// The header bytes are consumed; whatever follows stays in the buffer as body data.
+bool CGIHandler::_parseCGIHeaders() {
+	if (_cgi_headers_parsed) {
+		return true;
 	}
 
-	if (header_end_pos == std::string::npos) {
-		std::cerr << "ERROR: CGI output did not contain valid HTTP header termination (no double CRLF/LF found). Assuming full output is body or malformed." << std::endl;
-		_final_http_response.setStatus(500);
-		_final_http_response.addHeader("Content-Type", "text/plain");
-		_final_http_response.setBody("Internal Server Error: Malformed CGI output (no header termination).\nRaw output:\n" + raw_output);
-		_cgi_headers_parsed = true;
-		_state = CGIState::CGI_PROCESS_ERROR;
-		return;
+	const char crlfcrlf[] = "\r\n\r\n";
+	const char lflf[] = "\n\n";
+	std::vector<char>::iterator crlf_it = std::search(_cgi_response_buffer.begin(), _cgi_response_buffer.end(), crlfcrlf, crlfcrlf + 4);
+	std::vector<char>::iterator lf_it = std::search(_cgi_response_buffer.begin(), _cgi_response_buffer.end(), lflf, lflf + 2);
+
+	// Use whichever terminator comes first.
+	std::vector<char>::iterator header_end = crlf_it;
+	size_t terminator_len = 4;
+	if (lf_it < crlf_it) {
+		header_end = lf_it;
+		terminator_len = 2;
+	}
+	if (header_end == _cgi_response_buffer.end()) {
+		return false; // Not enough data yet.
 	}
 
-	std::string headers_str = raw_output.substr(0, header_end_pos);
-	std::string body_str = raw_output.substr(header_end_pos + (crlf_crlf_used ? 4 : 2));
+	std::string headers_str(_cgi_response_buffer.begin(), header_end);
+	_cgi_response_buffer.erase(_cgi_response_buffer.begin(), header_end + terminator_len);
 
 	std::istringstream iss_headers(headers_str);
 	std::string line;
 	int status_code = 200;
 	bool content_type_set = false;
 
-	while (std::getline(iss_headers, line) && !line.empty()) {
-		// Corrected: Create a temporary variable, trim in place, then use it.
-		StringUtils::trim(line); // trim line itself
+	while (std::getline(iss_headers, line)) {
+		StringUtils::trim(line);
 		if (line.empty()) continue;
 
 		size_t colon_pos = line.find(':');
 		if (colon_pos != std::string::npos) {
 			std::string name_temp = line.substr(0, colon_pos);
-			StringUtils::trim(name_temp); // Trim in place
+			StringUtils::trim(name_temp);
 			std::string value_temp = line.substr(colon_pos + 1);
-			StringUtils::trim(value_temp); // Trim in place
+			StringUtils::trim(value_temp);
 
-			if (StringUtils::ciCompare(name_temp, "Status")) { // Use trimmed name
-				std::istringstream status_stream(value_temp); // Use trimmed value
+			if (StringUtils::ciCompare(name_temp, "Status")) {
+				std::istringstream status_stream(value_temp);
 				status_stream >> status_code;
 				if (status_stream.fail() || status_code < 100 || status_code >= 600) {
 					std::cerr << "WARNING: Invalid Status header from CGI: '" << value_temp << "'. Using default 200." << std::endl;
 					status_code = 200;
 				}
-			} else if (StringUtils::ciCompare(name_temp, "Content-Type")) { // Use trimmed name
-				_final_http_response.addHeader("Content-Type", value_temp); // Use trimmed value
+			} else if (StringUtils::ciCompare(name_temp, "Content-Type")) {
+				_final_http_response.addHeader("Content-Type", value_temp);
 				content_type_set = true;
-			}
-			else {
-				_final_http_response.addHeader(name_temp, value_temp); // Use trimmed name and value
+			} else if (StringUtils::ciCompare(name_temp, "Content-Length")) {
+				_final_http_response.addHeader("Content-Length", value_temp);
+			} else if (StringUtils::ciCompare(name_temp, "Transfer-Encoding") || StringUtils::ciCompare(name_temp, "Connection")) {
+				// Framing and persistence are decided by the server, not the script.
+				continue;
+			} else {
+				_final_http_response.addHeader(name_temp, value_temp);
 			}
 		} else {
 			std::cerr << "WARNING: Malformed CGI header line: '" << line << "'" << std::endl;
@@ -746,20 +1191,138 @@ void CGIHandler::_parseCGIOutput() {
 	}
 
 	_final_http_response.setStatus(status_code);
-	_final_http_response.setBody(body_str);
-
 	if (!content_type_set) {
 		_final_http_response.addHeader("Content-Type", "application/octet-stream");
 		std::cerr << "WARNING: CGI did not provide Content-Type header. Defaulting to application/octet-stream." << std::endl;
 	}
-	_final_http_response.addHeader("Content-Length", StringUtils::longToString(body_str.length()));
-
 	_cgi_headers_parsed = true;
-	_state = CGIState::COMPLETE;
+	return true;
+}
+
+// Finishes the response once the CGI has exited: the remaining output becomes the body,
+// unless the Connection is already streaming it.
+void CGIHandler::_parseCGIOutput() {
+	if (!_cgi_headers_parsed && !_parseCGIHeaders()) {
+		std::string raw_output(_cgi_response_buffer.begin(), _cgi_response_buffer.end());
+
+		std::cerr << "ERROR: CGI output did not contain valid HTTP header termination (no double CRLF/LF found). Assuming full output is body or malformed." << std::endl;
+		_final_http_response.setStatus(500);
+		_final_http_response.addHeader("Content-Type", "text/plain");
+		_final_http_response.setBody("Internal Server Error: Malformed CGI output (no header termination).\nRaw output:\n" + raw_output);
+		_state = CGIState::CGI_PROCESS_ERROR;
+		return;
+	}
+
+	if (!_streaming) {
+		_final_http_response.takeBody(_cgi_response_buffer); // Swapped in, not copied.
+	}
+	if (_state != CGIState::CGI_PROCESS_ERROR && _state != CGIState::TIMEOUT) {
+		_state = CGIState::COMPLETE;
+	}
+}
+
+// Tells whether the CGI header section has been received and parsed.
+bool CGIHandler::hasParsedHeaders() const {
+	return _cgi_headers_parsed;
+}
+
+// Tells whether the CGI closed its stdout.
+bool CGIHandler::isOutputComplete() const {
+	return _cgi_stdout_eof_received;
+}
+
+// Body bytes received after the header section and not yet taken by the Connection.
+std::vector<char>& CGIHandler::getBodyBuffer() {
+	return _cgi_response_buffer;
+}
+
+// Marks the body as streamed: the Connection drains getBodyBuffer() itself.
+void CGIHandler::setStreaming() {
+	_streaming = true;
+}
+
+// Suspends the timeout while stdout is not polled; it restarts from zero on resume.
+void CGIHandler::setOutputPaused(bool paused) {
+	_output_paused = paused;
+	if (!paused) {
+		setStartTime();
+	}
+}
+
+// The request body will be fed through appendInput()/endInput() while it arrives; call before start().
+void CGIHandler::setStreamingInput() {
+	_input_complete = false;
+}
+
+// Queues request body bytes for the script. Arriving input also counts as activity for the CGI timeout,
+// as a script may legitimately wait on a slow upload.
+void CGIHandler::appendInput(const char* data, size_t len) {
+	if (len == 0 || _input_closed || _input_complete) {
+		return;
+	}
+	if (_input_sent > 0) {
+		_input_buffer.erase(_input_buffer.begin(), _input_buffer.begin() + _input_sent);
+		_input_sent = 0;
+	}
+	_input_buffer.insert(_input_buffer.end(), data, data + len);
+	if (_cgi_start_time != 0) {
+		setStartTime();
+	}
+	if (_state == CGIState::SPOOLING_INPUT) {
+		_spoolInput(); // Anything left over is retried when the script starts.
+		return;
+	}
+	_wakeInputWriter();
+}
+
+// Marks the end of the request body; stdin is closed once the buffered part is written.
+void CGIHandler::endInput() {
+	if (_input_complete) {
+		return;
+	}
+	_input_complete = true;
+	_wakeInputWriter();
+}
+
+// Body bytes received but not yet delivered to the script (or backend), for the caller's flow control.
+size_t CGIHandler::getPendingInputSize() const {
+	return (_input_buffer.size() - _input_sent) + (_fcgi_out.size() - _fcgi_out_sent);
+}
+
+// Polls the stdin side again after appendInput()/endInput(). Nothing to do before start() (or while
+// queued for a worker): the input is written once the script is there.
+void CGIHandler::_wakeInputWriter() {
+	if (!_serverPtr || isFinished() || _input_closed
+		|| (_state != CGIState::WRITING_INPUT && _state != CGIState::READING_OUTPUT)) {
+		return;
+	}
+	if (_fastcgi) {
+		_encodeFastCGIInput();
+		if (!_worker) {
+			_serverPtr->updateFdEvents(_fd_stdout[0], getReadEvents()); // Stays suspended if output is paused
+			return;
+		}
+	}
+	if (_input_suspended && _fd_stdin[1] != -1) {
+		_serverPtr->resumeFd(_fd_stdin[1], POLLOUT);
+		_input_suspended = false;
+	}
 }
 
 void CGIHandler::cleanup() {
 
+    // A pooled worker still held here was interrupted mid-request: its pipes go with it.
+    if (_worker) {
+        if (_serverPtr) {
+            if (_fd_stdin[1] != -1) _serverPtr->unregisterCgiFd(_fd_stdin[1], false);
+            if (_fd_stdout[0] != -1) _serverPtr->unregisterCgiFd(_fd_stdout[0], false);
+        }
+        _fd_stdin[1] = -1;
+        _fd_stdout[0] = -1;
+        _worker_pool->discard(_worker);
+        _worker = NULL;
+    }
+
     // Unregister and close parent's ends of the pipes
     if (_fd_stdin[1] != -1) { // Parent's write end to CGI stdin
         if (_serverPtr) {
@@ -778,9 +1341,16 @@ void CGIHandler::cleanup() {
         _fd_stdout[0] = -1;
     }
 
+    _closeProcessFd();
+    _releaseSlot();
+
     // The child's ends (_fd_stdin[0] and _fd_stdout[1]) are closed in the parent
-    // immediately after fork, and in the child process itself. So, no need to close them here again.
+    // immediately after the spawn, and in the child process itself. So, no need to close them here again.
     // Just ensure they are marked as closed in case of error paths where they might not have been.
+    // Only the memfd of a body still being spooled (no script yet) is open and closed here.
+    if (_fd_stdin[0] != -1) {
+        close(_fd_stdin[0]);
+    }
     _fd_stdin[0] = -1;
     _fd_stdout[1] = -1;
 
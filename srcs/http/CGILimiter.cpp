@@ -0,0 +1,121 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   CGILimiter.cpp                                     :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: bvieilhe <bvieilhe@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 15:42:10 by bvieilhe          #+#    #+#             */
+/*   Updated: 2026/10/18 15:42:10 by bvieilhe         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "../../includes/http/CGILimiter.hpp"
+#include "../../includes/config/ServerStructures.hpp"
+
+#include <iostream>
+#include <algorithm>
+
+#define LATENCY_WINDOW_SAMPLES 200	// Samples per latency baseline window.
+#define LATENCY_TOLERANCE 2.0		// Latency above this multiple of the baseline counts as congestion.
+#define LIMIT_DECREASE_FACTOR 0.9
+
+std::map<const LocationConfig*, CGILimiter*>	CGILimiter::_limiters;
+
+CGILimiter::CGILimiter(const LocationConfig& location)
+	: _maxConcurrent(location.cgiMaxConcurrent), _adaptive(location.cgiAdaptive),
+	  _limit(location.cgiAdaptive ? 1.0 : static_cast<double>(location.cgiMaxConcurrent)), _inFlight(0),
+	  _queueMax(location.cgiQueueSize), _queued(0), _queueTimeout(location.cgiQueueTimeout),
+	  _windowBest(0), _previousBest(0), _windowSamples(0), _samplesSinceDecrease(0) {}
+
+CGILimiter* CGILimiter::forLocation(const LocationConfig* location) {
+	if (!location || location->cgiMaxConcurrent <= 0) {
+		return NULL;
+	}
+	std::map<const LocationConfig*, CGILimiter*>::iterator it = _limiters.find(location);
+	if (it != _limiters.end()) {
+		return it->second;
+	}
+	CGILimiter* limiter = new CGILimiter(*location);
+	_limiters[location] = limiter;
+	return limiter;
+}
+
+void CGILimiter::forget(const std::vector<LocationConfig>& locations) {
+	for (size_t i = 0; i < locations.size(); ++i) {
+		forget(locations[i].nestedLocations);
+		std::map<const LocationConfig*, CGILimiter*>::iterator it = _limiters.find(&locations[i]);
+		if (it != _limiters.end()) {
+			delete it->second;
+			_limiters.erase(it);
+		}
+	}
+}
+
+bool CGILimiter::tryAcquire(bool waiting) {
+	if ((!waiting && _queued > 0) || static_cast<double>(_inFlight) + 1 > _limit) {
+		return false;
+	}
+	++_inFlight;
+	return true;
+}
+
+void CGILimiter::release(double seconds, bool timedOut) {
+	if (_inFlight > 0) {
+		--_inFlight;
+	}
+	if (_adaptive && (seconds >= 0 || timedOut)) {
+		_adapt(seconds, !timedOut);
+	}
+}
+
+bool CGILimiter::enqueue() {
+	if (_queued >= _queueMax) {
+		return false;
+	}
+	++_queued;
+	return true;
+}
+
+void CGILimiter::dequeue() {
+	if (_queued > 0) {
+		--_queued;
+	}
+}
+
+long CGILimiter::getQueueTimeout() const {
+	return _queueTimeout;
+}
+
+// Additive increase while latency stays near the baseline, multiplicative decrease on congestion.
+void CGILimiter::_adapt(double seconds, bool succeeded) {
+	if (succeeded) {
+		if (_windowSamples == 0 || seconds < _windowBest) {
+			_windowBest = seconds;
+		}
+		if (++_windowSamples >= LATENCY_WINDOW_SAMPLES) {
+			_previousBest = _windowBest;
+			_windowSamples = 0;
+		}
+	}
+	double baseline = _windowBest;
+	if (_previousBest > 0 && (_windowSamples == 0 || _previousBest < baseline)) {
+		baseline = _previousBest;
+	}
+
+	++_samplesSinceDecrease;
+	bool congested = !succeeded || (baseline > 0 && seconds > baseline * LATENCY_TOLERANCE);
+	if (congested) {
+		if (_samplesSinceDecrease >= static_cast<size_t>(_limit)) {
+			double previous = _limit;
+			_limit = std::max(1.0, _limit * LIMIT_DECREASE_FACTOR);
+			_samplesSinceDecrease = 0;
+			if (static_cast<size_t>(previous) != static_cast<size_t>(_limit)) {
+				std::cout << "CGI limit lowered to " << static_cast<size_t>(_limit) << " (latency "
+						  << static_cast<long>(seconds * 1000) << " ms, baseline " << static_cast<long>(baseline * 1000) << " ms)." << std::endl;
+			}
+		}
+	} else if (_limit < static_cast<double>(_maxConcurrent)) {
+		_limit = std::min(static_cast<double>(_maxConcurrent), _limit + 1.0 / _limit);
+	}
+}
@@ -0,0 +1,167 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   CGIWorkerPool.cpp                                  :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: bvieilhe <bvieilhe@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 13:05:27 by bvieilhe          #+#    #+#             */
+/*   Updated: 2026/10/18 13:05:27 by bvieilhe         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "../../includes/http/CGIWorkerPool.hpp"
+
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <climits>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <spawn.h>
+
+extern char**	environ;
+
+std::map<std::string, CGIWorkerPool*>	CGIWorkerPool::_pools;
+
+CGIWorkerPool::CGIWorkerPool(const std::string& executable, const std::string& workerScript, int size, long maxRequests)
+	: _executable(executable), _workerScript(workerScript), _size(size), _maxRequests(maxRequests), _idle(), _busy(0) {}
+
+CGIWorkerPool* CGIWorkerPool::forInterpreter(const std::string& executable, const std::string& workerScript,
+											 int size, long maxRequests) {
+	std::string key = executable + '\0' + workerScript;
+	std::map<std::string, CGIWorkerPool*>::iterator it = _pools.find(key);
+	if (it != _pools.end()) {
+		return it->second;
+	}
+	// Locations sharing an interpreter share its workers; the first location to use it sets the limits.
+	CGIWorkerPool* pool = new CGIWorkerPool(executable, workerScript, size, maxRequests);
+	_pools[key] = pool;
+	return pool;
+}
+
+CGIWorker* CGIWorkerPool::acquire(bool& saturated) {
+	saturated = false;
+	while (!_idle.empty()) {
+		CGIWorker* worker = _idle.back();
+		_idle.pop_back();
+		if (!_isAlive(worker)) {
+			std::cerr << "WARNING: CGI worker " << worker->pid << " died while idle, replacing it." << std::endl;
+			_terminate(worker);
+			continue;
+		}
+		++_busy;
+		return worker;
+	}
+	if (_busy >= _size) {
+		saturated = true;
+		return NULL;
+	}
+	CGIWorker* worker = _spawn();
+	if (worker) {
+		++_busy;
+	}
+	return worker;
+}
+
+void CGIWorkerPool::release(CGIWorker* worker) {
+	--_busy;
+	++worker->requestsServed;
+	if (_maxRequests > 0 && worker->requestsServed >= _maxRequests) {
+		_terminate(worker);
+		return;
+	}
+	_idle.push_back(worker);
+}
+
+void CGIWorkerPool::discard(CGIWorker* worker) {
+	--_busy;
+	_terminate(worker);
+}
+
+// Starts '<interpreter> <worker script>' with its stdin/stdout connected to non-blocking pipes.
+CGIWorker* CGIWorkerPool::_spawn() {
+	char abs_worker[PATH_MAX];
+	if (realpath(_workerScript.c_str(), abs_worker) == NULL) {
+		std::cerr << "ERROR: CGI worker script not found: " << _workerScript << std::endl;
+		return NULL;
+	}
+
+	int to_child[2];
+	int from_child[2];
+	if (pipe(to_child) == -1) {
+		std::cerr << "ERROR: Failed to create CGI worker stdin pipe." << std::endl;
+		return NULL;
+	}
+	if (pipe(from_child) == -1) {
+		std::cerr << "ERROR: Failed to create CGI worker stdout pipe." << std::endl;
+		close(to_child[0]);
+		close(to_child[1]);
+		return NULL;
+	}
+
+	// All four ends are close-on-exec; the child keeps only the dup2'ed copies on 0 and 1.
+	if (fcntl(to_child[0], F_SETFD, FD_CLOEXEC) == -1 || fcntl(to_child[1], F_SETFD, FD_CLOEXEC) == -1
+		|| fcntl(from_child[0], F_SETFD, FD_CLOEXEC) == -1 || fcntl(from_child[1], F_SETFD, FD_CLOEXEC) == -1
+		|| fcntl(to_child[1], F_SETFL, O_NONBLOCK) == -1 || fcntl(from_child[0], F_SETFL, O_NONBLOCK) == -1) {
+		std::cerr << "ERROR: Failed to configure CGI worker pipes." << std::endl;
+		close(to_child[0]); close(to_child[1]);
+		close(from_child[0]); close(from_child[1]);
+		return NULL;
+	}
+
+	char* argv[3];
+	argv[0] = const_cast<char*>(_executable.c_str());
+	argv[1] = abs_worker;
+	argv[2] = NULL;
+
+	posix_spawn_file_actions_t actions;
+	posix_spawn_file_actions_init(&actions);
+	posix_spawn_file_actions_adddup2(&actions, to_child[0], STDIN_FILENO);
+	posix_spawn_file_actions_adddup2(&actions, from_child[1], STDOUT_FILENO);
+
+	pid_t pid = -1;
+	int spawn_res = posix_spawn(&pid, _executable.c_str(), &actions, NULL, argv, environ);
+	posix_spawn_file_actions_destroy(&actions);
+	close(to_child[0]);
+	close(from_child[1]);
+
+	if (spawn_res != 0) {
+		std::cerr << "ERROR: Failed to spawn CGI worker " << _executable << " (" << strerror(spawn_res) << ")." << std::endl;
+		close(to_child[1]);
+		close(from_child[0]);
+		return NULL;
+	}
+
+	CGIWorker* worker = new CGIWorker;
+	worker->pid = pid;
+	worker->stdinFd = to_child[1];
+	worker->stdoutFd = from_child[0];
+	worker->requestsServed = 0;
+	std::cout << "CGI worker " << pid << " started (" << _executable << " " << abs_worker << ")." << std::endl;
+	return worker;
+}
+
+// Reaps the worker if it exited; an exited worker is marked with pid -1.
+bool CGIWorkerPool::_isAlive(CGIWorker* worker) const {
+	if (worker->pid == -1) {
+		return false;
+	}
+	if (waitpid(worker->pid, NULL, WNOHANG) == 0) {
+		return true;
+	}
+	worker->pid = -1;
+	return false;
+}
+
+void CGIWorkerPool::_terminate(CGIWorker* worker) {
+	close(worker->stdinFd);
+	close(worker->stdoutFd);
+	if (worker->pid != -1) {
+		kill(worker->pid, SIGKILL);
+		waitpid(worker->pid, NULL, 0);
+	}
+	delete worker;
+}
@@ -0,0 +1,458 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   DiskCache.cpp                                      :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: bvieilhe <bvieilhe@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 15:12:58 by bvieilhe          #+#    #+#             */
+/*   Updated: 2026/10/18 15:12:58 by bvieilhe         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "../../includes/http/DiskCache.hpp"
+#include "../../includes/http/CGICache.hpp"
+#include "../../includes/utils/StringUtils.hpp"
+
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cctype>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+
+std::map<std::string, DiskCache*>	DiskCache::_zones;
+time_t								DiskCache::_lastManagerRun = 0;
+
+// Creates 'path' and its missing parents (like 'mkdir -p'). Returns false if it is not a writable directory.
+static bool makeDirectories(const std::string& path) {
+	for (size_t slash = path.find('/', 1); slash != std::string::npos; slash = path.find('/', slash + 1)) {
+		mkdir(path.substr(0, slash).c_str(), 0700);
+	}
+	mkdir(path.c_str(), 0700);
+	struct stat st;
+	return stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode) && access(path.c_str(), W_OK | X_OK) == 0;
+}
+
+// Headers that describe one transfer rather than the response, and are set anew when a hit is sent.
+static bool isTransferHeader(const std::string& name) {
+	static const char* const names[] = { "Connection", "Keep-Alive", "Transfer-Encoding", "Content-Length",
+		"Date", "Server", "Age", "X-Cache-Status", NULL };
+	for (size_t i = 0; names[i]; ++i) {
+		if (StringUtils::ciCompare(name, names[i])) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static std::string headerValue(const HttpResponse& response, const char* name) {
+	const std::map<std::string, std::string>& headers = response.getHeaders();
+	for (std::map<std::string, std::string>::const_iterator it = headers.begin(); it != headers.end(); ++it) {
+		if (StringUtils::ciCompare(it->first, name)) {
+			return it->second;
+		}
+	}
+	return "";
+}
+
+// Value of a "name=N" Cache-Control directive (lowercased header), -1 when absent or malformed.
+static long cacheControlSeconds(const std::string& cacheControl, const std::string& name) {
+	for (size_t pos = cacheControl.find(name); pos != std::string::npos; pos = cacheControl.find(name, pos + 1)) {
+		size_t value = pos + name.length();
+		if ((pos > 0 && cacheControl[pos - 1] != ' ' && cacheControl[pos - 1] != ',')
+			|| value >= cacheControl.length() || cacheControl[value] != '=') {
+			continue;
+		}
+		size_t end = value + 1;
+		while (end < cacheControl.length() && std::isdigit(static_cast<unsigned char>(cacheControl[end]))) {
+			++end;
+		}
+		if (end == value + 1 || end - value > 10) {
+			return -1;
+		}
+		return StringUtils::stringToLong(cacheControl.substr(value + 1, end - value - 1));
+	}
+	return -1;
+}
+
+// Reads the metadata line ("WSCACHE1 <stored> <expires>") and the key line of a cache file header.
+// 'pos' is left at the status line.
+static bool parseMetadata(const std::string& header, time_t& stored, time_t& expires, std::string& key, size_t& pos) {
+	long storedAt = 0;
+	long expiresAt = 0;
+	size_t keyLine = header.find('\n');
+	if (keyLine == std::string::npos || sscanf(header.c_str(), "WSCACHE1 %ld %ld\n", &storedAt, &expiresAt) != 2
+		|| header.compare(keyLine + 1, 5, "KEY: ") != 0) {
+		return false;
+	}
+	size_t keyEnd = header.find('\n', keyLine + 1);
+	if (keyEnd == std::string::npos) {
+		return false;
+	}
+	stored = static_cast<time_t>(storedAt);
+	expires = static_cast<time_t>(expiresAt);
+	key = header.substr(keyLine + 6, keyEnd - keyLine - 6);
+	pos = keyEnd + 1;
+	return true;
+}
+
+static bool newerFirst(const std::pair<time_t, size_t>& a, const std::pair<time_t, size_t>& b) {
+	return a.first > b.first;
+}
+
+DiskCache::DiskCache(const CachePathConfig& config) : _config(config), _bytes(0), _fillCount(0) {}
+
+void DiskCache::configure(const std::vector<CachePathConfig>& configs) {
+	for (size_t i = 0; i < configs.size(); ++i) {
+		const CachePathConfig& config = configs[i];
+		if (_zones.count(config.zone)) {
+			continue;
+		}
+		if (!makeDirectories(config.path) || !makeDirectories(config.path + "/tmp")) {
+			throw std::runtime_error("Cache directory '" + config.path + "' of zone '" + config.zone + "' is not a writable directory.");
+		}
+		DiskCache* zone = new DiskCache(config);
+		_zones[config.zone] = zone;
+
+		// Temporary files are fills cut short by a previous shutdown.
+		DIR* tmp = opendir((config.path + "/tmp").c_str());
+		if (tmp) {
+			for (struct dirent* ent = readdir(tmp); ent; ent = readdir(tmp)) {
+				if (ent->d_name[0] != '.') {
+					unlink((config.path + "/tmp/" + ent->d_name).c_str());
+				}
+			}
+			closedir(tmp);
+		}
+
+		// Rebuild the index, most recently written first as the best guess at recency of use.
+		std::vector<Entry> found;
+		zone->_load(config.path, 0, found);
+		std::vector<std::pair<time_t, size_t> > order;
+		for (size_t e = 0; e < found.size(); ++e) {
+			order.push_back(std::make_pair(found[e].lastUsed, e));
+		}
+		std::sort(order.begin(), order.end(), newerFirst);
+		for (size_t e = 0; e < order.size(); ++e) {
+			const Entry& entry = found[order[e].second];
+			if (zone->_index.count(entry.key)) {
+				continue;
+			}
+			zone->_entries.push_back(entry);
+			zone->_index[entry.key] = --zone->_entries.end();
+			zone->_bytes += entry.size;
+		}
+		std::cout << "Proxy cache '" << config.zone << "': " << zone->_entries.size() << " entries ("
+			<< zone->_bytes << " bytes) loaded from " << config.path << std::endl;
+	}
+}
+
+DiskCache* DiskCache::forLocation(const LocationConfig* location) {
+	if (!location || location->proxyCacheZone.empty()) {
+		return NULL;
+	}
+	std::map<std::string, DiskCache*>::iterator it = _zones.find(location->proxyCacheZone);
+	return it != _zones.end() ? it->second : NULL;
+}
+
+void DiskCache::runManager(time_t now) {
+	if (now == _lastManagerRun) {
+		return;
+	}
+	_lastManagerRun = now;
+	for (std::map<std::string, DiskCache*>::iterator it = _zones.begin(); it != _zones.end(); ++it) {
+		it->second->_sweep(now);
+	}
+}
+
+// Like a shared proxy cache (see CGICache::isCacheable), with the response's own lifetime taking
+// precedence: s-maxage, then max-age, then Expires (a malformed date counts as already expired).
+long DiskCache::freshness(const HttpResponse& response, long valid) {
+	if (!CGICache::isCacheable(response)) {
+		return 0;
+	}
+	std::string cacheControl = headerValue(response, "Cache-Control");
+	if (!cacheControl.empty()) {
+		StringUtils::toLower(cacheControl);
+		long maxAge = cacheControlSeconds(cacheControl, "s-maxage");
+		if (maxAge < 0) {
+			maxAge = cacheControlSeconds(cacheControl, "max-age");
+		}
+		if (maxAge >= 0) {
+			return maxAge;
+		}
+	}
+	std::string expires = headerValue(response, "Expires");
+	if (!expires.empty()) {
+		struct tm tm;
+		std::memset(&tm, 0, sizeof(tm));
+		if (!strptime(expires.c_str(), "%a, %d %b %Y %H:%M:%S GMT", &tm)) {
+			return 0;
+		}
+		time_t at = timegm(&tm);
+		time_t now = time(NULL);
+		return at > now ? static_cast<long>(at - now) : 0;
+	}
+	return valid;
+}
+
+bool DiskCache::lookup(const std::string& key, HttpResponse& response) {
+	std::map<std::string, EntryList::iterator>::iterator found = _index.find(key);
+	if (found == _index.end()) {
+		return false;
+	}
+	EntryList::iterator entry = found->second;
+	time_t now = time(NULL);
+	if (now >= entry->expires) {
+		_erase(entry, true);
+		return false;
+	}
+
+	// The file may have been replaced by an entry of a colliding key, or removed behind our back.
+	// The body is then sent from the fd checked here: a later commit() renaming another response
+	// over the path, or an unlink once the entry expires, can't mix in bytes of another file.
+	std::string path = _pathFor(entry->name, false);
+	std::string header;
+	struct stat st;
+	time_t stored;
+	time_t expires;
+	std::string fileKey;
+	size_t pos;
+	int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd == -1 || !_readHeader(fd, header, st) || st.st_size != entry->size
+		|| !parseMetadata(header, stored, expires, fileKey, pos) || fileKey != key) {
+		if (fd != -1) {
+			close(fd);
+		}
+		_erase(entry, false);
+		return false;
+	}
+
+	response = HttpResponse();
+	response.omitDefaultContentType(); // The stored header section is replayed as it was received.
+	size_t lineEnd = header.find('\n', pos);
+	std::string statusLine = header.substr(pos, lineEnd - pos);
+	size_t space = statusLine.find(' ');
+	response.setStatus(static_cast<int>(StringUtils::stringToLong(statusLine.substr(0, space))),
+		space == std::string::npos ? "" : statusLine.substr(space + 1));
+	for (pos = lineEnd + 1; pos < header.length() && header[pos] != '\n'; pos = lineEnd + 1) {
+		lineEnd = header.find('\n', pos);
+		size_t colon = header.find(": ", pos);
+		if (colon != std::string::npos && colon < lineEnd) {
+			response.addHeader(header.substr(pos, colon - pos), header.substr(colon + 2, lineEnd - colon - 2));
+		}
+	}
+	response.setBodyFd(fd, entry->bodyOffset, entry->size - entry->bodyOffset);
+	response.addHeader("Age", StringUtils::longToString(static_cast<long>(now - entry->stored)));
+	response.addHeader("X-Cache-Status", "HIT");
+
+	_entries.splice(_entries.begin(), _entries, entry);
+	entry->lastUsed = now;
+	return true;
+}
+
+DiskCache::Fill* DiskCache::beginFill(const std::string& key, const HttpResponse& response, long valid) {
+	long seconds = freshness(response, valid);
+	if (seconds <= 0) {
+		return NULL;
+	}
+	time_t now = time(NULL);
+	std::ostringstream header;
+	header << "WSCACHE1 " << static_cast<long>(now) << " " << static_cast<long>(now + seconds) << "\n"
+		<< "KEY: " << key << "\n"
+		<< response.getStatusCode() << " " << response.getStatusMessage() << "\n";
+	const std::map<std::string, std::string>& headers = response.getHeaders();
+	for (std::map<std::string, std::string>::const_iterator it = headers.begin(); it != headers.end(); ++it) {
+		if (!isTransferHeader(it->first)) {
+			header << it->first << ": " << it->second << "\n";
+		}
+	}
+	header << "\n";
+	std::string bytes = header.str();
+	if (bytes.length() > DISK_CACHE_MAX_HEADER_SIZE) {
+		return NULL;
+	}
+
+	Fill* fill = new Fill();
+	fill->tempPath = _config.path + "/tmp/" + _hashName(key) + "." + StringUtils::longToString(static_cast<long>(++_fillCount));
+	fill->key = key;
+	fill->stored = now;
+	fill->expires = now + seconds;
+	fill->headerBytes = static_cast<off_t>(bytes.length());
+	fill->bodyBytes = 0;
+	fill->failed = false;
+	fill->fd = open(fill->tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+	if (fill->fd == -1 || write(fill->fd, bytes.data(), bytes.length()) != static_cast<ssize_t>(bytes.length())) {
+		std::cerr << "WARNING: Could not write cache file " << fill->tempPath << "; response not cached." << std::endl;
+		abandon(fill);
+		return NULL;
+	}
+	return fill;
+}
+
+// Bodies bigger than an eighth of the zone are not kept, so a single large response can't flush it.
+void DiskCache::append(Fill* fill, const char* data, size_t len) {
+	if (fill->failed || len == 0) {
+		return;
+	}
+	if (fill->headerBytes + fill->bodyBytes + static_cast<off_t>(len) > _config.maxSize / 8
+		|| write(fill->fd, data, len) != static_cast<ssize_t>(len)) {
+		fill->failed = true;
+		return;
+	}
+	fill->bodyBytes += static_cast<off_t>(len);
+}
+
+void DiskCache::commit(Fill* fill) {
+	if (fill->failed) {
+		abandon(fill);
+		return;
+	}
+	close(fill->fd);
+	fill->fd = -1;
+
+	Entry entry;
+	entry.key = fill->key;
+	entry.name = _hashName(fill->key);
+	entry.stored = fill->stored;
+	entry.expires = fill->expires;
+	entry.lastUsed = time(NULL);
+	entry.bodyOffset = fill->headerBytes;
+	entry.size = fill->headerBytes + fill->bodyBytes;
+	if (rename(fill->tempPath.c_str(), _pathFor(entry.name, true).c_str()) != 0) {
+		std::cerr << "WARNING: Could not move cache file into " << _pathFor(entry.name, false) << "; response not cached." << std::endl;
+		abandon(fill);
+		return;
+	}
+	delete fill;
+
+	// The rename replaced the previous file of the key, if any.
+	std::map<std::string, EntryList::iterator>::iterator previous = _index.find(entry.key);
+	if (previous != _index.end()) {
+		_erase(previous->second, false);
+	}
+	_entries.push_front(entry);
+	_index[entry.key] = _entries.begin();
+	_bytes += entry.size;
+}
+
+void DiskCache::abandon(Fill* fill) {
+	if (fill->fd != -1) {
+		close(fill->fd);
+	}
+	unlink(fill->tempPath.c_str());
+	delete fill;
+}
+
+// Two 32-bit FNV-1a hashes (different offset bases) as 16 hex digits: wide enough that colliding
+// keys are rare, and those are caught by the key stored in the file.
+std::string DiskCache::_hashName(const std::string& key) {
+	unsigned int low = 2166136261u;
+	unsigned int high = 3735928559u;
+	for (size_t i = 0; i < key.length(); ++i) {
+		low = (low ^ static_cast<unsigned char>(key[i])) * 16777619u;
+		high = (high ^ static_cast<unsigned char>(key[i])) * 16777619u;
+	}
+	char name[17];
+	snprintf(name, sizeof(name), "%08x%08x", high, low);
+	return name;
+}
+
+// "<path>/<c>/<ba>/<hash>" for levels=1:2: each level takes its digits from the end of the hash.
+std::string DiskCache::_pathFor(const std::string& name, bool create) const {
+	std::string path = _config.path;
+	size_t end = name.length();
+	for (size_t i = 0; i < _config.levels.size(); ++i) {
+		end -= _config.levels[i];
+		path += "/" + name.substr(end, _config.levels[i]);
+		if (create) {
+			mkdir(path.c_str(), 0700);
+		}
+	}
+	return path + "/" + name;
+}
+
+// Collects the cache files below 'dir' ('depth' levels down). Expired or unreadable files are removed.
+void DiskCache::_load(const std::string& dir, int depth, std::vector<Entry>& found) {
+	DIR* handle = opendir(dir.c_str());
+	if (!handle) {
+		return;
+	}
+	time_t now = time(NULL);
+	bool leaf = static_cast<size_t>(depth) == _config.levels.size();
+	for (struct dirent* ent = readdir(handle); ent; ent = readdir(handle)) {
+		std::string name = ent->d_name;
+		std::string path = dir + "/" + name;
+		if (!leaf) {
+			if (name.length() == static_cast<size_t>(_config.levels[depth]) && name.find_first_not_of("0123456789abcdef") == std::string::npos) {
+				_load(path, depth + 1, found);
+			}
+			continue;
+		}
+		if (name.length() != 16 || name.find_first_not_of("0123456789abcdef") != std::string::npos) {
+			continue;
+		}
+		std::string header;
+		struct stat st;
+		Entry entry;
+		size_t pos;
+		int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		bool valid = fd != -1 && _readHeader(fd, header, st);
+		if (fd != -1) {
+			close(fd);
+		}
+		if (!valid || !parseMetadata(header, entry.stored, entry.expires, entry.key, pos)
+			|| entry.expires <= now || _hashName(entry.key) != name) {
+			unlink(path.c_str());
+			continue;
+		}
+		entry.name = name;
+		entry.lastUsed = st.st_mtime;
+		entry.bodyOffset = static_cast<off_t>(header.length());
+		entry.size = st.st_size;
+		found.push_back(entry);
+	}
+	closedir(handle);
+}
+
+// Reads the metadata and header section of an open cache file, up to and including the blank line.
+bool DiskCache::_readHeader(int fd, std::string& header, struct stat& st) const {
+	bool ok = false;
+	if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+		size_t len = static_cast<size_t>(std::min(st.st_size, static_cast<off_t>(DISK_CACHE_MAX_HEADER_SIZE)));
+		header.resize(len);
+		ssize_t n = len > 0 ? pread(fd, &header[0], len, 0) : 0;
+		size_t end = n > 0 ? header.find("\n\n") : std::string::npos;
+		if (end != std::string::npos && end + 2 <= static_cast<size_t>(n)) {
+			header.resize(end + 2);
+			ok = true;
+		}
+	}
+	return ok;
+}
+
+// Cache manager pass: entries unused for 'inactive' go first, then least recently used ones while
+// the zone is over 'max_size'. Expired entries still in use are dropped by lookup() instead.
+void DiskCache::_sweep(time_t now) {
+	for (size_t removed = 0; !_entries.empty() && removed < DISK_CACHE_MANAGER_FILES; ++removed) {
+		EntryList::iterator oldest = --_entries.end();
+		if (now - oldest->lastUsed < _config.inactive && _bytes <= _config.maxSize) {
+			break;
+		}
+		_erase(oldest, true);
+	}
+}
+
+void DiskCache::_erase(EntryList::iterator it, bool removeFile) {
+	if (removeFile) {
+		unlink(_pathFor(it->name, false).c_str());
+	}
+	_bytes -= it->size;
+	_index.erase(it->key);
+	_entries.erase(it);
+}
@@ -0,0 +1,236 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   FastCGI.cpp                                        :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: bvieilhe <bvieilhe@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 11:38:52 by bvieilhe          #+#    #+#             */
+/*   Updated: 2026/10/18 11:38:52 by bvieilhe         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "../../includes/http/FastCGI.hpp"
+
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/un.h>
+
+# define FCGI_VERSION_1		1
+# define FCGI_RESPONDER		1
+# define FCGI_KEEP_CONN		1
+# define FCGI_HEADER_LEN	8
+
+namespace {
+	// Writes the fixed 8-byte record header.
+	void appendHeader(std::string& out, unsigned char type, unsigned short requestId, size_t contentLen, unsigned char paddingLen) {
+		char header[FCGI_HEADER_LEN];
+
+		header[0] = FCGI_VERSION_1;
+		header[1] = static_cast<char>(type);
+		header[2] = static_cast<char>((requestId >> 8) & 0xFF);
+		header[3] = static_cast<char>(requestId & 0xFF);
+		header[4] = static_cast<char>((contentLen >> 8) & 0xFF);
+		header[5] = static_cast<char>(contentLen & 0xFF);
+		header[6] = static_cast<char>(paddingLen);
+		header[7] = 0;
+		out.append(header, FCGI_HEADER_LEN);
+	}
+
+	// Name/value lengths use 1 byte below 128, otherwise 4 bytes with the high bit set.
+	void appendLength(std::string& out, size_t len) {
+		if (len < 128) {
+			out += static_cast<char>(len);
+			return;
+		}
+		out += static_cast<char>(((len >> 24) & 0x7F) | 0x80);
+		out += static_cast<char>((len >> 16) & 0xFF);
+		out += static_cast<char>((len >> 8) & 0xFF);
+		out += static_cast<char>(len & 0xFF);
+	}
+}
+
+void FastCGI::appendBeginRequest(std::string& out, unsigned short requestId, bool keepConn) {
+	char body[8];
+
+	std::memset(body, 0, sizeof(body));
+	body[1] = FCGI_RESPONDER;
+	body[2] = keepConn ? FCGI_KEEP_CONN : 0;
+	appendHeader(out, BEGIN_REQUEST, requestId, sizeof(body), 0);
+	out.append(body, sizeof(body));
+}
+
+void FastCGI::appendParam(std::string& params, const std::string& name, const std::string& value) {
+	appendLength(params, name.length());
+	appendLength(params, value.length());
+	params += name;
+	params += value;
+}
+
+// Records are padded to a multiple of 8 bytes, as recommended by the specification.
+void FastCGI::appendStream(std::string& out, unsigned char type, unsigned short requestId, const char* data, size_t len) {
+	static const char padding[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+
+	if (len == 0) {
+		appendHeader(out, type, requestId, 0, 0);
+		return;
+	}
+	while (len > 0) {
+		size_t			chunk = len > FCGI_MAX_CONTENT_LEN ? FCGI_MAX_CONTENT_LEN : len;
+		unsigned char	paddingLen = static_cast<unsigned char>((8 - (chunk % 8)) % 8);
+
+		appendHeader(out, type, requestId, chunk, paddingLen);
+		out.append(data, chunk);
+		out.append(padding, paddingLen);
+		data += chunk;
+		len -= chunk;
+	}
+}
+
+// RecordDecoder
+
+FastCGI::RecordDecoder::RecordDecoder() : _offset(0) {}
+
+void FastCGI::RecordDecoder::feed(const char* data, size_t len) {
+	// Drop consumed bytes before growing, so the buffer stays around one record in size.
+	if (_offset > 0) {
+		_buffer.erase(0, _offset);
+		_offset = 0;
+	}
+	_buffer.append(data, len);
+}
+
+bool FastCGI::RecordDecoder::next(Record& record) {
+	if (_buffer.length() - _offset < FCGI_HEADER_LEN) {
+		return false;
+	}
+	const unsigned char* header = reinterpret_cast<const unsigned char*>(_buffer.data() + _offset);
+	size_t contentLen = (static_cast<size_t>(header[4]) << 8) | header[5];
+	size_t paddingLen = header[6];
+
+	if (_buffer.length() - _offset < FCGI_HEADER_LEN + contentLen + paddingLen) {
+		return false;
+	}
+	record.type = header[1];
+	record.requestId = static_cast<unsigned short>((header[2] << 8) | header[3]);
+	record.content.assign(_buffer, _offset + FCGI_HEADER_LEN, contentLen);
+	_offset += FCGI_HEADER_LEN + contentLen + paddingLen;
+	return true;
+}
+
+bool FastCGI::RecordDecoder::hasPartialRecord() const {
+	return _buffer.length() > _offset;
+}
+
+bool FastCGI::parseAddress(const std::string& address, struct sockaddr_storage& addr, socklen_t& addrLen) {
+	std::memset(&addr, 0, sizeof(addr));
+
+	if (address.compare(0, 5, "unix:") == 0) {
+		struct sockaddr_un* un = reinterpret_cast<struct sockaddr_un*>(&addr);
+		std::string path = address.substr(5);
+
+		if (path.empty() || path.length() >= sizeof(un->sun_path)) {
+			return false;
+		}
+		un->sun_family = AF_UNIX;
+		std::memcpy(un->sun_path, path.c_str(), path.length() + 1);
+		addrLen = sizeof(struct sockaddr_un);
+		return true;
+	}
+
+	size_t colon = address.rfind(':');
+	if (colon == std::string::npos || colon == 0 || colon + 1 >= address.length()) {
+		return false;
+	}
+	std::string host = address.substr(0, colon);
+	std::string port = address.substr(colon + 1);
+
+	struct addrinfo hints;
+	struct addrinfo* result = NULL;
+	std::memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	if (getaddrinfo(host.c_str(), port.c_str(), &hints, &result) != 0 || !result) {
+		return false;
+	}
+	std::memcpy(&addr, result->ai_addr, result->ai_addrlen);
+	addrLen = result->ai_addrlen;
+	freeaddrinfo(result);
+	return true;
+}
+
+int FastCGI::connectNonBlocking(const struct sockaddr_storage& addr, socklen_t addrLen) {
+	int fd = socket(addr.ss_family, SOCK_STREAM, 0);
+	if (fd == -1) {
+		return -1;
+	}
+	// Non-blocking connect: completion (or refusal) shows up as writability on the first poll.
+	if (fcntl(fd, F_SETFL, O_NONBLOCK) == -1 || fcntl(fd, F_SETFD, FD_CLOEXEC) == -1
+		|| (connect(fd, reinterpret_cast<const struct sockaddr*>(&addr), addrLen) == -1 && errno != EINPROGRESS)) {
+		int error = errno;
+		close(fd);
+		errno = error;
+		return -1;
+	}
+	return fd;
+}
+
+// An idle connection must have nothing to read yet: EOF, stray bytes or a socket error
+// (ECONNRESET, EPIPE...) mean the peer dropped it or it is out of step.
+bool FastCGI::isIdleAlive(int fd) {
+	char probe;
+	return recv(fd, &probe, 1, MSG_PEEK | MSG_DONTWAIT) == -1 && (errno == EAGAIN || errno == EWOULDBLOCK);
+}
+
+// FastCGIPool
+
+std::map<std::string, std::vector<int> >	FastCGIPool::_idle;
+
+int FastCGIPool::acquire(const std::string& address, bool& reused) {
+	std::vector<int>& idle = _idle[address];
+
+	while (!idle.empty()) {
+		int fd = idle.back();
+		idle.pop_back();
+
+		if (!FastCGI::isIdleAlive(fd)) {
+			close(fd);
+			continue;
+		}
+		reused = true;
+		return fd;
+	}
+	reused = false;
+	return _connect(address);
+}
+
+void FastCGIPool::release(const std::string& address, int fd) {
+	std::vector<int>& idle = _idle[address];
+
+	if (idle.size() >= FCGI_MAX_IDLE_PER_BACKEND) {
+		close(fd);
+		return;
+	}
+	idle.push_back(fd);
+}
+
+int FastCGIPool::_connect(const std::string& address) {
+	struct sockaddr_storage	addr;
+	socklen_t				addrLen;
+
+	if (!FastCGI::parseAddress(address, addr, addrLen)) {
+		std::cerr << "ERROR: FastCGI: invalid backend address '" << address << "'." << std::endl;
+		return -1;
+	}
+
+	int fd = FastCGI::connectNonBlocking(addr, addrLen);
+	if (fd == -1) {
+		std::cerr << "ERROR: FastCGI: cannot connect to backend '" << address << "': " << strerror(errno) << std::endl;
+	}
+	return fd;
+}
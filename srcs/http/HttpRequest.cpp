@@ -13,7 +13,7 @@
 #include "../../includes/http/HttpRequest.hpp"
 #include <cctype> // For std::isprint
 
-HttpRequest::HttpRequest() : expectedBodyLength(0), currentState(RECV_REQUEST_LINE)
+HttpRequest::HttpRequest() : expectedBodyLength(0), chunked(false), currentState(RECV_REQUEST_LINE)
 {}
 
 // Retrieves the value of a specified HTTP header (case-insensitive).
@@ -31,6 +31,32 @@ std::string HttpRequest::getHeader(const std::string& name) const
 	return (""); // Return empty string if header not found.
 }
 
+// Tells whether the client asked for a persistent connection.
+// HTTP/1.1 defaults to keep-alive unless 'Connection: close' is sent; HTTP/1.0 requires 'Connection: keep-alive'.
+bool HttpRequest::wantsKeepAlive() const
+{
+	std::string			connection = getHeader("connection");
+	bool				keepAlive = (protocolVersion == "HTTP/1.1");
+	std::istringstream	iss(connection);
+	std::string			option;
+
+	// The header is a comma-separated list of case-insensitive options.
+	while (std::getline(iss, option, ',')) {
+		size_t start = option.find_first_not_of(" \t");
+		size_t end = option.find_last_not_of(" \t");
+		if (start == std::string::npos)
+			continue;
+		option = option.substr(start, end - start + 1);
+		for (size_t i = 0; i < option.length(); ++i)
+			option[i] = static_cast<char>(std::tolower(static_cast<unsigned char>(option[i])));
+		if (option == "close")
+			return (false);
+		if (option == "keep-alive")
+			keepAlive = true;
+	}
+	return (keepAlive);
+}
+
 // Prints the details of the HTTP request to standard output for debugging.
 void HttpRequest::print() const
 {
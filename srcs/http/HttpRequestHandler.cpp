@@ -21,7 +21,6 @@
 #include <fstream>
 #include <dirent.h>
 #include <sys/time.h>
-#include <limits>
 #include <errno.h>
 #include <string.h>
 
@@ -61,66 +60,16 @@ bool HttpRequestHandler::_canWrite(const std::string& path) const {
 	return access(path.c_str(), W_OK) == 0;
 }
 
-std::string HttpRequestHandler::_getEffectiveRoot(const ServerConfig* server, const LocationConfig* location) const {
-	if (location && !location->root.empty()) {
-		return location->root;
-	}
-	if (server && !server->root.empty()) {
-		return server->root;
-	}
-	return "";
-}
-
-std::string HttpRequestHandler::_getEffectiveUploadStore(const ServerConfig* server, const LocationConfig* location) const {
-	(void)server;
-	if (location && !location->uploadStore.empty()) {
-		return location->uploadStore;
-	}
-	return "";
-}
-
-long HttpRequestHandler::_getEffectiveClientMaxBodySize(const ServerConfig* server, const LocationConfig* location) const {
-	if (location && location->clientMaxBodySize != 0) {
-		return location->clientMaxBodySize;
-	}
-	if (server && server->clientMaxBodySize != 0) {
-		return server->clientMaxBodySize;
-	}
-	return std::numeric_limits<long>::max(); // Default to a very large size if not specified
-}
-
-const std::map<int, std::string>& HttpRequestHandler::_getEffectiveErrorPages(const ServerConfig* server, const LocationConfig* location) const {
-	if (location && !location->errorPages.empty()) {
-		return location->errorPages;
+// Settings of the request's location, or of its server when no location matched, as resolved at config load.
+const EffectiveLocation& HttpRequestHandler::_effective(const ServerConfig* server, const LocationConfig* location) {
+	if (location) {
+		return location->effective;
 	}
 	if (server) {
-		return server->errorPages;
+		return server->effective;
 	}
-	static const std::map<int, std::string> emptyMap; // Return an empty map if no config
-	return emptyMap;
-}
-
-std::string HttpRequestHandler::_getMimeType(const std::string& filePath) const {
-	size_t dotPos = filePath.rfind('.');
-	if (dotPos == std::string::npos) {
-		return "application/octet-stream"; // Default for unknown or no extension
-	}
-	std::string ext = filePath.substr(dotPos);
-	std::transform(ext.begin(), ext.end(), ext.begin(), static_cast<int(*)(int)>(std::tolower));
-
-	if (ext == ".html" || ext == ".htm") return "text/html";
-	if (ext == ".css") return "text/css";
-	if (ext == ".js") return "application/javascript";
-	if (ext == ".json") return "application/json";
-	if (ext == ".txt") return "text/plain";
-	if (ext == ".jpg" || ext == ".jpeg") return "image/jpeg";
-	if (ext == ".png") return "image/png";
-	if (ext == ".gif") return "image/gif";
-	if (ext == ".ico") return "image/x-icon";
-	if (ext == ".svg") return "image/svg+xml";
-	if (ext == ".pdf") return "application/pdf";
-	if (ext == ".xml") return "application/xml";
-	return "application/octet-stream";
+	static const EffectiveLocation none;
+	return none;
 }
 
 HttpResponse HttpRequestHandler::_generateErrorResponse(int statusCode,
@@ -130,28 +79,21 @@ HttpResponse HttpRequestHandler::_generateErrorResponse(int statusCode,
 	response.setStatus(statusCode);
 	response.addHeader("Content-Type", "text/html");
 
-	const std::map<int, std::string>& errorPages = _getEffectiveErrorPages(serverConfig, locationConfig);
+	const std::map<int, std::string>& errorPages = _effective(serverConfig, locationConfig).errorPages;
 	std::map<int, std::string>::const_iterator it = errorPages.find(statusCode);
 
 	if (it != errorPages.end() && !it->second.empty()) {
-		std::string effectiveRootForError = _getEffectiveRoot(serverConfig, NULL); // Use server root for error pages unless location specifies one
-		std::string customErrorPagePath = effectiveRootForError;
-		
-		// Ensure only one slash between root and error page path
-		if (!customErrorPagePath.empty() && customErrorPagePath[customErrorPagePath.length() - 1] == '/' && it->second[0] == '/') {
-			customErrorPagePath += it->second.substr(1);
-		} else if (!customErrorPagePath.empty() && customErrorPagePath[customErrorPagePath.length() - 1] != '/' && it->second[0] != '/') {
-			customErrorPagePath += "/" + it->second;
-		} else {
-			customErrorPagePath += it->second;
-		}
+		// Error pages live under the server root, whichever location failed. The root ends with a slash.
+		const std::string& errorRoot = _effective(serverConfig, NULL).root;
+		std::string customErrorPagePath = errorRoot;
+		customErrorPagePath.append(it->second, (!errorRoot.empty() && it->second[0] == '/') ? 1 : 0, std::string::npos);
 
 		if (_isRegularFile(customErrorPagePath) && _canRead(customErrorPagePath)) {
 			std::ifstream file(customErrorPagePath.c_str(), std::ios::in | std::ios::binary);
 			if (file.is_open()) {
 				std::vector<char> fileContent((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
 				response.setBody(fileContent);
-				response.addHeader("Content-Type", _getMimeType(customErrorPagePath));
+				response.addHeader("Content-Type", getMimeType(customErrorPagePath));
 				file.close();
 				return response;
 			} else {
@@ -177,48 +119,37 @@ HttpResponse HttpRequestHandler::_generateErrorResponse(int statusCode,
 std::string HttpRequestHandler::_resolvePath(const std::string& uriPath,
 											 const ServerConfig* serverConfig,
 											 const LocationConfig* locationConfig) const {
-	std::string effectiveRoot = _getEffectiveRoot(serverConfig, locationConfig);
+	const std::string& effectiveRoot = _effective(serverConfig, locationConfig).root;
 
 	if (effectiveRoot.empty()) {
 		std::cerr << "ERROR: _resolvePath: Effective root is empty." << std::endl;
 		return "";
 	}
 
-	// Ensure effectiveRoot ends with a slash for consistent path building
-	if (effectiveRoot.length() > 0 && effectiveRoot[effectiveRoot.length() - 1] != '/') {
-		effectiveRoot += "/";
-	}
-
-	std::string normalizedUriPath = uriPath;
-	// Remove leading slash from uriPath if present, as effectiveRoot already has one
-	if (normalizedUriPath.length() > 0 && normalizedUriPath[0] == '/') {
-		normalizedUriPath = normalizedUriPath.substr(1);
-	}
-
-	std::vector<std::string> segments;
-	std::istringstream iss(normalizedUriPath);
-	std::string segment;
-
-	while (std::getline(iss, segment, '/')) {
-		if (segment == "" || segment == ".") {
-			// Ignore empty segments (e.g., //) and current directory segments
-			continue;
-		} else if (segment == "..") {
-			// Go up one level, but not above the effective root
-			if (!segments.empty()) {
-				segments.pop_back();
+	// Segments are appended to the root (which ends with a slash) one at a time: empty and "."
+	// segments are skipped, and ".." drops the last one but never climbs above the root.
+	std::string fullPath;
+	fullPath.reserve(effectiveRoot.length() + uriPath.length());
+	fullPath = effectiveRoot;
+	size_t pos = 0;
+	while (pos < uriPath.length()) {
+		size_t end = uriPath.find('/', pos);
+		if (end == std::string::npos) {
+			end = uriPath.length();
+		}
+		size_t len = end - pos;
+		if (len == 2 && uriPath[pos] == '.' && uriPath[pos + 1] == '.') {
+			if (fullPath.length() > effectiveRoot.length()) {
+				fullPath.erase(fullPath.rfind('/', fullPath.length() - 2) + 1);
 			}
-		} else {
-			segments.push_back(segment);
+		} else if (len != 0 && !(len == 1 && uriPath[pos] == '.')) {
+			fullPath.append(uriPath, pos, len);
+			fullPath += '/';
 		}
+		pos = end + 1;
 	}
-
-	std::string fullPath = effectiveRoot;
-	for (size_t i = 0; i < segments.size(); ++i) {
-		fullPath += segments[i];
-		if (i < segments.size() - 1) {
-			fullPath += "/";
-		}
+	if (fullPath.length() > effectiveRoot.length()) {
+		fullPath.erase(fullPath.length() - 1); // No trailing slash after the last segment.
 	}
 
 	return fullPath;
@@ -246,12 +177,8 @@ HttpResponse HttpRequestHandler::_handleGet(const HttpRequest& request,
 			throw Http403Exception("Cannot read directory: " + fullPath);
 		}
 
-		std::vector<std::string> indexFiles;
-		if (locationConfig && !locationConfig->indexFiles.empty()) {
-			indexFiles = locationConfig->indexFiles;
-		} else if (serverConfig && !serverConfig->indexFiles.empty()) {
-			indexFiles = serverConfig->indexFiles;
-		}
+		const EffectiveLocation& effective = _effective(serverConfig, locationConfig);
+		const std::vector<std::string>& indexFiles = effective.indexFiles;
 
 		for (size_t i = 0; i < indexFiles.size(); ++i) {
 			std::string indexPath = fullPath;
@@ -261,35 +188,27 @@ HttpResponse HttpRequestHandler::_handleGet(const HttpRequest& request,
 			indexPath += indexFiles[i];
 			
 			if (_isRegularFile(indexPath) && _canRead(indexPath)) {
-				std::ifstream file(indexPath.c_str(), std::ios::in | std::ios::binary);
-				if (file.is_open()) {
+				struct stat st;
+				if (stat(indexPath.c_str(), &st) == 0) {
+					// The file is streamed from disk by the connection, not loaded here.
 					HttpResponse response;
 					response.setStatus(200);
-					std::vector<char> fileContent((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
-					response.setBody(fileContent);
-					response.addHeader("Content-Type", _getMimeType(indexPath));
-					file.close();
+					response.setBodyFile(indexPath, 0, st.st_size);
+					response.addHeader("Content-Type", getMimeType(indexPath));
 					return response;
 				} else {
-					std::cerr << "ERROR: _handleGet: Found index file '" << indexPath << "' but failed to open it, throwing 500. errno: " << strerror(errno) << std::endl;
+					std::cerr << "ERROR: _handleGet: Found index file '" << indexPath << "' but failed to stat it, throwing 500. errno: " << strerror(errno) << std::endl;
 					throw Http500Exception("Failed to open index file: " + indexPath);
 				}
 			}
 		}
 		
-		bool autoindexEnabled = false;
-		if (locationConfig && locationConfig->autoindex) {
-			autoindexEnabled = true;
-		} else if (serverConfig && serverConfig->autoindex) {
-			autoindexEnabled = true;
-		}
-
-
-		if (autoindexEnabled) {
+		if (effective.autoindex) {
+			const std::string& format = effective.autoindexFormat;
 			HttpResponse response;
 			response.setStatus(200);
-			response.addHeader("Content-Type", "text/html");
-			response.setBody(_generateAutoindexPage(fullPath, request.path));
+			response.addHeader("Content-Type", format == "json" ? "application/json" : "text/html");
+			response.setBody(_generateAutoindexPage(fullPath, request, format));
 			return response;
 		} else {
 			std::cerr << "ERROR: _handleGet: Directory '" << fullPath << "' has no index file and autoindex is off, throwing 403." << std::endl;
@@ -301,17 +220,16 @@ HttpResponse HttpRequestHandler::_handleGet(const HttpRequest& request,
 			throw Http403Exception("Cannot read regular file: " + fullPath);
 		}
 		
-		std::ifstream file(fullPath.c_str(), std::ios::in | std::ios::binary);
-		if (file.is_open()) {
+		struct stat st;
+		if (stat(fullPath.c_str(), &st) == 0) {
+			// The file is streamed from disk by the connection, not loaded here.
 			HttpResponse response;
 			response.setStatus(200);
-			std::vector<char> fileContent((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
-			response.setBody(fileContent);
-			response.addHeader("Content-Type", _getMimeType(fullPath));
-			file.close();
+			response.setBodyFile(fullPath, 0, st.st_size);
+			response.addHeader("Content-Type", getMimeType(fullPath));
 			return response;
 		} else {
-			std::cerr << "ERROR: _handleGet: Regular file '" << fullPath << "' exists but failed to open it, throwing 500. errno: " << strerror(errno) << std::endl;
+			std::cerr << "ERROR: _handleGet: Regular file '" << fullPath << "' exists but failed to stat it, throwing 500. errno: " << strerror(errno) << std::endl;
 			throw Http500Exception("Failed to open regular file: " + fullPath);
 		}
 	} else {
@@ -323,8 +241,9 @@ HttpResponse HttpRequestHandler::_handleGet(const HttpRequest& request,
 HttpResponse HttpRequestHandler::_handlePost(const HttpRequest& request,
 											 const ServerConfig* serverConfig,
 											 const LocationConfig* locationConfig) {
-	std::string uploadStore = _getEffectiveUploadStore(serverConfig, locationConfig);
-	long maxBodySize = _getEffectiveClientMaxBodySize(serverConfig, locationConfig);
+	const EffectiveLocation& effective = _effective(serverConfig, locationConfig);
+	const std::string& uploadStore = effective.uploadStore;
+	long maxBodySize = effective.clientMaxBodySize;
 
 	if (uploadStore.empty()) {
 		std::cerr << "ERROR: _handlePost: upload_store not configured, throwing 500." << std::endl;
@@ -405,11 +324,7 @@ HttpResponse HttpRequestHandler::_handlePost(const HttpRequest& request,
 	uniqueNameStream << tv.tv_sec << "_" << tv.tv_usec << "_" << originalFilename;
 	std::string uniqueFilename = uniqueNameStream.str();
 
-	std::string fullUploadPath = uploadStore;
-	if (fullUploadPath[fullUploadPath.length() - 1] != '/') {
-		fullUploadPath += "/";
-	}
-	fullUploadPath += uniqueFilename;
+	std::string fullUploadPath = uploadStore + uniqueFilename; // The store ends with a slash.
 
 	std::ofstream outputFile(fullUploadPath.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
 	if (!outputFile.is_open()) {
@@ -451,19 +366,13 @@ HttpResponse HttpRequestHandler::_handleDelete(const HttpRequest& request,
 											   const LocationConfig* locationConfig) {
 	std::string fullPath;
 
-	if (locationConfig && !locationConfig->uploadStore.empty() && StringUtils::startsWith(request.path, locationConfig->path)) {
-		std::string relativePath = request.path.substr(locationConfig->path.length());
-		
-		std::string baseUploadPath = locationConfig->uploadStore;
-		if (!baseUploadPath.empty() && baseUploadPath[baseUploadPath.length() - 1] != '/') {
-			baseUploadPath += "/";
+	if (locationConfig && !locationConfig->effective.uploadStore.empty() && StringUtils::startsWith(request.path, locationConfig->path)) {
+		size_t relativeStart = locationConfig->path.length();
+		if (relativeStart < request.path.length() && request.path[relativeStart] == '/') {
+			++relativeStart;
 		}
-
-		if (!relativePath.empty() && relativePath[0] == '/') {
-			relativePath = relativePath.substr(1);
-		}
-		fullPath = baseUploadPath + relativePath;
-
+		fullPath = locationConfig->effective.uploadStore; // Ends with a slash.
+		fullPath.append(request.path, relativeStart, std::string::npos);
 	} else {
 		fullPath = _resolvePath(request.path, serverConfig, locationConfig);
 	}
@@ -521,68 +430,166 @@ HttpResponse HttpRequestHandler::_handleDelete(const HttpRequest& request,
 	return response;
 }
 
-std::string HttpRequestHandler::_generateAutoindexPage(const std::string& directoryPath, const std::string& uriPath) const {
-	std::ostringstream oss;
-	oss << "<html><head><title>Index of " << uriPath << "</title>"
-		<< "<style>"
-		<< "body { font-family: sans-serif; background-color: #f0f0f0; margin: 2em; }"
-		<< "h1 { color: #333; }"
-		<< "ul { list-style-type: none; padding: 0; }"
-		<< "li { margin-bottom: 0.5em; }"
-		<< "a { text-decoration: none; color: #007bff; }"
-		<< "a:hover { text-decoration: underline; }"
-		<< ".parent-dir { font-weight: bold; color: #dc3545; }"
-		<< "</style>"
-		<< "</head><body>"
-		<< "<h1>Index of " << uriPath << "</h1><ul>";
-
-	DIR *dir;
-	struct dirent *ent;
-
-	if ((dir = opendir(directoryPath.c_str())) != NULL) {
-		// Add parent directory link unless at the true root "/"
-		if (uriPath != "/") {
-			size_t lastSlash = uriPath.rfind('/', uriPath.length() - 2); // Find the slash before the last one
-			std::string parentUri = uriPath.substr(0, lastSlash + 1);
-			oss << "<li><a href=\"" << parentUri << "\" class=\"parent-dir\">.. (Parent Directory)</a></li>";
+// Escapes characters that are significant in HTML text and attribute values.
+static void appendHtmlEscaped(std::string& out, const std::string& in) {
+	for (size_t i = 0; i < in.size(); ++i) {
+		switch (in[i]) {
+			case '&': out += "&amp;"; break;
+			case '<': out += "&lt;"; break;
+			case '>': out += "&gt;"; break;
+			case '"': out += "&quot;"; break;
+			default: out += in[i];
 		}
+	}
+}
 
-		while ((ent = readdir(dir)) != NULL) {
-			std::string name = ent->d_name;
-			if (name == "." || name == "..") {
-				continue; // Skip current and parent directory entries as separate links
-			}
+// Percent-encodes a path segment for use inside an href.
+static void appendUriEscaped(std::string& out, const std::string& in) {
+	static const char hex[] = "0123456789ABCDEF";
+	for (size_t i = 0; i < in.size(); ++i) {
+		unsigned char c = static_cast<unsigned char>(in[i]);
+		if (std::isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~') {
+			out += static_cast<char>(c);
+		} else {
+			out += '%';
+			out += hex[c >> 4];
+			out += hex[c & 0x0F];
+		}
+	}
+}
 
-			std::string fullEntryPath = directoryPath;
-			if (fullEntryPath[fullEntryPath.length() - 1] != '/') {
-				fullEntryPath += "/";
-			}
-			fullEntryPath += name;
+// Escapes a string for inclusion in a JSON string literal.
+static void appendJsonEscaped(std::string& out, const std::string& in) {
+	static const char hex[] = "0123456789abcdef";
+	for (size_t i = 0; i < in.size(); ++i) {
+		unsigned char c = static_cast<unsigned char>(in[i]);
+		if (c == '"' || c == '\\') {
+			out += '\\';
+			out += static_cast<char>(c);
+		} else if (c < 0x20) {
+			out += "\\u00";
+			out += hex[c >> 4];
+			out += hex[c & 0x0F];
+		} else {
+			out += static_cast<char>(c);
+		}
+	}
+}
 
-			std::string entryUri = uriPath;
-			if (entryUri[entryUri.length() - 1] != '/') {
-				entryUri += "/";
-			}
-			entryUri += name;
+// Renders one page of a (cached, sorted) directory listing as HTML or JSON.
+std::string HttpRequestHandler::_generateAutoindexPage(const std::string& directoryPath, const HttpRequest& request,
+														const std::string& format) const {
+	const std::vector<AutoindexEntry>* entries = AutoindexCache::getListing(directoryPath);
+	if (!entries) {
+		throw Http500Exception("Could not open directory: " + directoryPath);
+	}
 
-			oss << "<li><a href=\"" << entryUri;
-			if (_isDirectory(fullEntryPath)) {
-				oss << "/"; // Append slash for directories in URI
-			}
-			oss << "\">" << name;
-			if (_isDirectory(fullEntryPath)) {
-				oss << "/"; // Append slash for directories in display
+	// Resolve the requested page (1-based). Missing '?page=' means the first page.
+	size_t page = 1;
+	std::map<std::string, std::string>::const_iterator pageIt = request.queryParams.find("page");
+	if (pageIt != request.queryParams.end()) {
+		if (!StringUtils::isDigits(pageIt->second) || pageIt->second.size() > 9) {
+			throw Http400Exception("Invalid autoindex page: " + pageIt->second);
+		}
+		page = static_cast<size_t>(StringUtils::stringToLong(pageIt->second));
+		if (page == 0) {
+			throw Http400Exception("Invalid autoindex page: " + pageIt->second);
+		}
+	}
+	size_t total = entries->size();
+	size_t pageCount = (total + AUTOINDEX_PAGE_SIZE - 1) / AUTOINDEX_PAGE_SIZE;
+	if (pageCount == 0) {
+		pageCount = 1;
+	}
+	if (page > pageCount) {
+		throw Http404Exception("Autoindex page out of range.");
+	}
+	size_t first = (page - 1) * AUTOINDEX_PAGE_SIZE;
+	size_t last = std::min(total, first + AUTOINDEX_PAGE_SIZE);
+
+	const std::string& uriPath = request.path;
+	std::string baseUri = uriPath;
+	if (baseUri.empty() || baseUri[baseUri.length() - 1] != '/') {
+		baseUri += "/";
+	}
+
+	std::string out;
+	out.reserve(256 + (last - first) * 64);
+
+	if (format == "json") {
+		out += "{\"path\":\"";
+		appendJsonEscaped(out, uriPath);
+		out += "\",\"page\":" + StringUtils::longToString(page);
+		out += ",\"pages\":" + StringUtils::longToString(pageCount);
+		out += ",\"total\":" + StringUtils::longToString(total);
+		out += ",\"entries\":[";
+		for (size_t i = first; i < last; ++i) {
+			const AutoindexEntry& e = (*entries)[i];
+			if (i != first) {
+				out += ',';
 			}
-			oss << "</a></li>";
+			out += "{\"name\":\"";
+			appendJsonEscaped(out, e.name);
+			out += e.isDirectory ? "\",\"type\":\"directory\"}" : "\",\"type\":\"file\"}";
 		}
-		closedir(dir);
-	} else {
-		std::cerr << "ERROR: _generateAutoindexPage: Could not open directory '" << directoryPath << "', errno: " << strerror(errno) << "." << std::endl;
-		oss << "<li>Error: Could not open directory.</li>";
+		out += "]}";
+		return out;
+	}
+
+	out += "<html><head><title>Index of ";
+	appendHtmlEscaped(out, uriPath);
+	out += "</title>"
+		"<style>"
+		"body { font-family: sans-serif; background-color: #f0f0f0; margin: 2em; }"
+		"h1 { color: #333; }"
+		"ul { list-style-type: none; padding: 0; }"
+		"li { margin-bottom: 0.5em; }"
+		"a { text-decoration: none; color: #007bff; }"
+		"a:hover { text-decoration: underline; }"
+		".parent-dir { font-weight: bold; color: #dc3545; }"
+		"</style>"
+		"</head><body><h1>Index of ";
+	appendHtmlEscaped(out, uriPath);
+	out += "</h1><ul>";
+
+	// Add parent directory link unless at the true root "/"
+	if (uriPath != "/") {
+		size_t lastSlash = uriPath.rfind('/', uriPath.length() - 2); // Find the slash before the last one
+		out += "<li><a href=\"";
+		appendHtmlEscaped(out, uriPath.substr(0, lastSlash + 1));
+		out += "\" class=\"parent-dir\">.. (Parent Directory)</a></li>";
+	}
+
+	for (size_t i = first; i < last; ++i) {
+		const AutoindexEntry& e = (*entries)[i];
+		out += "<li><a href=\"";
+		appendHtmlEscaped(out, baseUri);
+		appendUriEscaped(out, e.name);
+		if (e.isDirectory) {
+			out += '/'; // Append slash for directories in URI
+		}
+		out += "\">";
+		appendHtmlEscaped(out, e.name);
+		if (e.isDirectory) {
+			out += '/'; // Append slash for directories in display
+		}
+		out += "</a></li>";
 	}
+	out += "</ul>";
 
-	oss << "</ul></body></html>";
-	return oss.str();
+	if (pageCount > 1) {
+		out += "<p>";
+		if (page > 1) {
+			out += "<a href=\"?page=" + StringUtils::longToString(page - 1) + "\">&laquo; Previous</a> ";
+		}
+		out += "Page " + StringUtils::longToString(page) + " of " + StringUtils::longToString(pageCount);
+		if (page < pageCount) {
+			out += " <a href=\"?page=" + StringUtils::longToString(page + 1) + "\">Next &raquo;</a>";
+		}
+		out += "</p>";
+	}
+	out += "</body></html>";
+	return out;
 }
 
 HttpResponse HttpRequestHandler::handleRequest(const HttpRequest& request, const MatchedConfig& matchedConfig) {
@@ -603,29 +610,13 @@ HttpResponse HttpRequestHandler::handleRequest(const HttpRequest& request, const
 		return response;
 	}
 
-	// Determine allowed methods
-	std::vector<HttpMethod> allowedMethods;
-	if (locationConfig && !locationConfig->allowedMethods.empty()) {
-		allowedMethods = locationConfig->allowedMethods;
-	} else {
-		// Default methods if not specified (common for a basic webserv)
-		allowedMethods.push_back(HTTP_GET);
-		allowedMethods.push_back(HTTP_POST);
-		allowedMethods.push_back(HTTP_DELETE);
-	}
-
-	bool methodAllowed = false;
+	// Allowed methods (GET, POST and DELETE unless the location lists its own), as a bitmask.
 	HttpMethod reqMethodEnum = HTTP_UNKNOWN;
 	if (request.method == "GET") reqMethodEnum = HTTP_GET;
 	else if (request.method == "POST") reqMethodEnum = HTTP_POST;
 	else if (request.method == "DELETE") reqMethodEnum = HTTP_DELETE;
 
-	for (size_t i = 0; i < allowedMethods.size(); ++i) {
-		if (allowedMethods[i] == reqMethodEnum) {
-			methodAllowed = true;
-			break;
-		}
-	}
+	bool methodAllowed = _effective(serverConfig, locationConfig).allows(reqMethodEnum);
 
 	// Dispatch based on method
 	try {
@@ -16,6 +16,8 @@
 #include <iostream>
 #include <sstream>
 #include <cctype>
+#include <cstdlib>
+#include <algorithm>
 
 // Converts an HttpMethod enum to its string representation.
 std::string httpMethodToString(HttpMethod method) {
@@ -29,7 +31,7 @@ std::string httpMethodToString(HttpMethod method) {
 }
 
 // Default constructor: Initializes the parser and request state.
-HttpRequestParser::HttpRequestParser() : _request() {
+HttpRequestParser::HttpRequestParser() : _request(), _bodyReceived(0), _chunkState(CHUNK_SIZE), _chunkRemaining(0) {
     _request.currentState = HttpRequest::RECV_REQUEST_LINE;
 }
 
@@ -115,8 +117,8 @@ void HttpRequestParser::parseRequestLine() {
         setError("Malformed request line: Empty component.");
         return;
     }
-    if (_request.protocolVersion != "HTTP/1.1") {
-        setError("Unsupported protocol version. Only HTTP/1.1 is supported.");
+    if (_request.protocolVersion != "HTTP/1.1" && _request.protocolVersion != "HTTP/1.0") {
+        setError("Unsupported protocol version. Only HTTP/1.0 and HTTP/1.1 are supported.");
         return;
     }
 
@@ -176,9 +178,17 @@ void HttpRequestParser::parseHeaders() {
         _request.headers[canonicalName] = value;
     }
 
-    // Process Content-Length header to determine expected body size.
+    // Process Transfer-Encoding / Content-Length to determine how the body is delimited.
+    std::string transferEncoding = _request.getHeader("transfer-encoding");
+    StringUtils::toLower(transferEncoding);
     std::string contentLengthStr = _request.getHeader("content-length");
-    if (!contentLengthStr.empty()) {
+    if (!transferEncoding.empty()) {
+        if (transferEncoding != "chunked") {
+            setError("Unsupported Transfer-Encoding: " + transferEncoding);
+            return;
+        }
+        _request.chunked = true; // Takes precedence over any Content-Length (RFC 9112, 6.3).
+    } else if (!contentLengthStr.empty()) {
         try {
             _request.expectedBodyLength = StringUtils::stringToLong(contentLengthStr);
         } catch (const std::exception& e) {
@@ -196,7 +206,7 @@ void HttpRequestParser::parseHeaders() {
     consumeBuffer(double_crlf_pos + DOUBLE_CRLF.length());
 
     // Transition to body parsing or complete state.
-    if (_request.method == "POST" && _request.expectedBodyLength > 0) {
+    if (_request.chunked || (_request.method == "POST" && _request.expectedBodyLength > 0)) {
         _request.currentState = HttpRequest::RECV_BODY;
     } else {
         _request.currentState = HttpRequest::COMPLETE;
@@ -209,18 +219,21 @@ void HttpRequestParser::parseHeaders() {
     }
 }
 
-// Parses the HTTP request body.
+// Parses the HTTP request body. Bytes are moved into the request as they arrive, so a consumer
+// may drain them (drainBody()) before the body is complete.
 void HttpRequestParser::parseBody() {
-    // Check if the entire body is available in the buffer.
-    if (_buffer.size() < _request.expectedBodyLength) {
-        return; // Not enough data yet.
+    if (_request.chunked) {
+        parseChunkedBody();
+        return;
     }
 
-    // Copy the body data from the buffer to the HttpRequest object.
-    _request.body.insert(_request.body.end(), _buffer.begin(), _buffer.begin() + _request.expectedBodyLength);
-    
-    // Consume the parsed body data from the buffer.
-    consumeBuffer(_request.expectedBodyLength);
+    size_t take = std::min(_buffer.size(), _request.expectedBodyLength - _bodyReceived);
+    _request.body.insert(_request.body.end(), _buffer.begin(), _buffer.begin() + take);
+    consumeBuffer(take);
+    _bodyReceived += take;
+    if (_bodyReceived < _request.expectedBodyLength) {
+        return; // Not enough data yet.
+    }
 
     // Update parsing state to complete.
     _request.currentState = HttpRequest::COMPLETE;
@@ -232,6 +245,57 @@ void HttpRequestParser::parseBody() {
     }
 }
 
+// Decodes as much of a chunked body as is buffered.
+void HttpRequestParser::parseChunkedBody() {
+    while (!_buffer.empty()) {
+        if (_chunkState == CHUNK_DATA) {
+            size_t take = std::min(_buffer.size(), _chunkRemaining);
+            _request.body.insert(_request.body.end(), _buffer.begin(), _buffer.begin() + take);
+            consumeBuffer(take);
+            _bodyReceived += take;
+            _chunkRemaining -= take;
+            if (_chunkRemaining == 0) {
+                _chunkState = CHUNK_DATA_END;
+            }
+            continue;
+        }
+
+        size_t crlf_pos = findInVector(CRLF);
+        if (crlf_pos == std::string::npos) {
+            if (_buffer.size() > 4096) {
+                setError("Chunk size or trailer line too long.");
+            }
+            return; // Not enough data yet.
+        }
+        std::string line(_buffer.begin(), _buffer.begin() + crlf_pos);
+        consumeBuffer(crlf_pos + CRLF.length());
+
+        if (_chunkState == CHUNK_DATA_END) {
+            if (!line.empty()) {
+                setError("Missing CRLF after chunk data.");
+                return;
+            }
+            _chunkState = CHUNK_SIZE;
+        } else if (_chunkState == CHUNK_SIZE) {
+            std::string sizeStr = line.substr(0, line.find(';')); // Chunk extensions are ignored.
+            StringUtils::trim(sizeStr);
+            if (sizeStr.empty() || sizeStr.length() > 15 || sizeStr.find_first_not_of("0123456789abcdefABCDEF") != std::string::npos) {
+                setError("Invalid chunk size line.");
+                return;
+            }
+            _chunkRemaining = std::strtoul(sizeStr.c_str(), NULL, 16);
+            _chunkState = (_chunkRemaining == 0) ? CHUNK_TRAILER : CHUNK_DATA;
+        } else if (line.empty()) { // CHUNK_TRAILER: the empty line ends the message.
+            _request.currentState = HttpRequest::COMPLETE;
+            if (!_buffer.empty()) {
+                setError("Extraneous data after end of body.");
+            }
+            return;
+        }
+        // Trailer fields are accepted and ignored.
+    }
+}
+
 // Decomposes the URI into path and query parameters.
 void HttpRequestParser::decomposeURI() {
     // Check for presence of query string.
@@ -297,6 +361,32 @@ bool HttpRequestParser::isComplete() const {
     return _request.currentState == HttpRequest::COMPLETE;
 }
 
+// Checks if no byte of a new request has been received yet (e.g., between keep-alive requests).
+bool HttpRequestParser::isIdle() const {
+    return _request.currentState == HttpRequest::RECV_REQUEST_LINE && _buffer.empty();
+}
+
+// Checks if the header section has been parsed (the body, if any, may still be arriving).
+bool HttpRequestParser::hasHeaders() const {
+    return _request.currentState == HttpRequest::RECV_BODY
+        || (_request.currentState == HttpRequest::COMPLETE && !_request.method.empty());
+}
+
+// Checks if the request carries a body (Content-Length > 0 or chunked).
+bool HttpRequestParser::expectsBody() const {
+    return _request.chunked || _request.expectedBodyLength > 0;
+}
+
+// Returns the number of body bytes decoded so far.
+size_t HttpRequestParser::getBodyReceived() const {
+    return _bodyReceived;
+}
+
+void HttpRequestParser::drainBody(std::vector<char>& out) {
+    out.clear();
+    out.swap(_request.body);
+}
+
 // Checks if an error occurred during HTTP request parsing.
 bool HttpRequestParser::hasError() const {
     return _request.currentState == HttpRequest::ERROR;
@@ -316,4 +406,7 @@ const HttpRequest& HttpRequestParser::getRequest() const {
 void HttpRequestParser::reset() {
     _request = HttpRequest();
     _buffer.clear();
+    _bodyReceived = 0;
+    _chunkState = CHUNK_SIZE;
+    _chunkRemaining = 0;
 }
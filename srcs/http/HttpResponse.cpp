@@ -11,10 +11,12 @@
 /* ************************************************************************** */
 
 #include "../../includes/http/HttpResponse.hpp"
+#include "../../includes/http/MimeTypes.hpp"
 #include <iomanip>
 #include <cstdio>
 #include <vector>
 #include <algorithm>
+#include <unistd.h>
 
 // Maps HTTP status codes to their standard messages.
 std::string getHttpStatusMessage(int statusCode) {
@@ -28,46 +30,61 @@ std::string getHttpStatusMessage(int statusCode) {
         case 403: return "Forbidden";
         case 404: return "Not Found";
         case 405: return "Method Not Allowed";
+        case 408: return "Request Timeout";
         case 413: return "Payload Too Large";
         case 500: return "Internal Server Error";
         case 501: return "Not Implemented";
+        case 502: return "Bad Gateway";
         case 503: return "Service Unavailable";
+        case 504: return "Gateway Timeout";
         default: return "Unknown Status";
     }
 }
 
-// Determines the MIME type based on file extension.
-std::string getMimeType(const std::string& filePath) {
-    size_t dotPos = filePath.rfind('.');
-    if (dotPos == std::string::npos) {
-        return "application/octet-stream";
-    }
-    std::string ext = filePath.substr(dotPos);
-    std::transform(ext.begin(), ext.end(), ext.begin(), static_cast<int(*)(int)>(std::tolower));
-
-    if (ext == ".html" || ext == ".htm") return "text/html";
-    if (ext == ".css") return "text/css";
-    if (ext == ".js") return "application/javascript";
-    if (ext == ".json") return "application/json";
-    if (ext == ".txt") return "text/plain";
-    if (ext == ".jpg" || ext == ".jpeg") return "image/jpeg";
-    if (ext == ".png") return "image/png";
-    if (ext == ".gif") return "image/gif";
-    if (ext == ".ico") return "image/x-icon";
-    if (ext == ".svg") return "image/svg+xml";
-    if (ext == ".pdf") return "application/pdf";
-    if (ext == ".xml") return "application/xml";
-    return "application/octet-stream";
+// Determines the MIME type based on file extension (single hash probe in the MIME registry).
+const std::string& getMimeType(const std::string& filePath) {
+    return MimeTypes::instance().lookup(filePath);
 }
 
 
 // Constructor: Initializes with default HTTP/1.1 protocol and common headers.
-HttpResponse::HttpResponse() : _protocolVersion("HTTP/1.1"), _statusCode(200), _statusMessage("OK") {
+HttpResponse::HttpResponse() : _protocolVersion("HTTP/1.1"), _statusCode(200), _statusMessage("OK"), _defaultContentType(true), _chunked(false),
+                               _bodyFileFd(-1), _bodyFileOffset(0), _bodyFileLength(0) {
     setDefaultHeaders();
 }
 
+// Copies share nothing: a body fd is duplicated, so each copy closes its own.
+HttpResponse::HttpResponse(const HttpResponse& other) : _bodyFileFd(-1) {
+    *this = other;
+}
+
+HttpResponse& HttpResponse::operator=(const HttpResponse& other) {
+    if (this != &other) {
+        _protocolVersion = other._protocolVersion;
+        _statusCode = other._statusCode;
+        _statusMessage = other._statusMessage;
+        _headers = other._headers;
+        _repeatedHeaders = other._repeatedHeaders;
+        _defaultContentType = other._defaultContentType;
+        _body = other._body;
+        _chunked = other._chunked;
+        _bodyFilePath = other._bodyFilePath;
+        if (_bodyFileFd != -1) {
+            close(_bodyFileFd);
+        }
+        _bodyFileFd = other._bodyFileFd != -1 ? dup(other._bodyFileFd) : -1;
+        _bodyFileOffset = other._bodyFileOffset;
+        _bodyFileLength = other._bodyFileLength;
+    }
+    return *this;
+}
+
 // Destructor: Cleans up HttpResponse resources.
-HttpResponse::~HttpResponse() {}
+HttpResponse::~HttpResponse() {
+    if (_bodyFileFd != -1) {
+        close(_bodyFileFd);
+    }
+}
 
 // Sets the HTTP status code and updates the status message accordingly.
 void HttpResponse::setStatus(int code) {
@@ -75,11 +92,32 @@ void HttpResponse::setStatus(int code) {
     _statusMessage = getHttpStatusMessage(code);
 }
 
+// Sets the status code with a reason phrase of the producer's own (e.g. relayed from an upstream).
+void HttpResponse::setStatus(int code, const std::string& message) {
+    _statusCode = code;
+    _statusMessage = message;
+}
+
 // Adds or updates a header in the response.
 void HttpResponse::addHeader(const std::string& name, const std::string& value) {
     _headers[name] = value;
 }
 
+// Adds a header line even if the field is already set, for fields that cannot be combined into one
+// comma-separated line (Set-Cookie, RFC 6265 section 3). The first value stays visible in getHeaders().
+void HttpResponse::appendHeader(const std::string& name, const std::string& value) {
+    if (_headers.find(name) == _headers.end()) {
+        _headers[name] = value;
+    } else {
+        _repeatedHeaders.push_back(std::make_pair(name, value));
+    }
+}
+
+// Sends no Content-Type at all when none is set, for relayed responses whose producer sent none.
+void HttpResponse::omitDefaultContentType() {
+    _defaultContentType = false;
+}
+
 // Sets the response body from a string and updates Content-Length.
 void HttpResponse::setBody(const std::string& content) {
     _body.assign(content.begin(), content.end());
@@ -96,6 +134,92 @@ void HttpResponse::setBody(const std::vector<char>& content) {
     addHeader("Content-Length", oss.str());
 }
 
+// Sets the response body by taking over 'content' (left empty) instead of copying it.
+void HttpResponse::takeBody(std::vector<char>& content) {
+    _body.clear();
+    _body.swap(content);
+    std::ostringstream oss;
+    oss << _body.size();
+    addHeader("Content-Length", oss.str());
+}
+
+// Sets the body to a byte range of a file, read only when it is sent.
+void HttpResponse::setBodyFile(const std::string& path, off_t offset, off_t length) {
+    _body.clear();
+    if (_bodyFileFd != -1) {
+        close(_bodyFileFd);
+        _bodyFileFd = -1;
+    }
+    _bodyFilePath = path;
+    _bodyFileOffset = offset;
+    _bodyFileLength = length;
+    std::ostringstream oss;
+    oss << length;
+    addHeader("Content-Length", oss.str());
+}
+
+// Sets the body to a byte range of a file already open, taking over 'fd'. Unlike a path, the fd
+// keeps the bytes that were checked even if the file is replaced or removed before it is sent.
+void HttpResponse::setBodyFd(int fd, off_t offset, off_t length) {
+    _body.clear();
+    _bodyFilePath.clear();
+    if (_bodyFileFd != -1) {
+        close(_bodyFileFd);
+    }
+    _bodyFileFd = fd;
+    _bodyFileOffset = offset;
+    _bodyFileLength = length;
+    std::ostringstream oss;
+    oss << length;
+    addHeader("Content-Length", oss.str());
+}
+
+// Hands the body over to the sender as a BodySource (caller owns it). Returns NULL when there is
+// no body, or when the body file can no longer be opened (check hasFileBody() to tell them apart).
+BodySource* HttpResponse::releaseBodySource() {
+    if (_bodyFileFd != -1) {
+        FileBodySource* source = new FileBodySource(_bodyFileFd, _bodyFileOffset, _bodyFileLength);
+        _bodyFileFd = -1;
+        return source;
+    }
+    if (!_bodyFilePath.empty()) {
+        FileBodySource* source = new FileBodySource(_bodyFilePath, _bodyFileOffset, _bodyFileLength);
+        if (!source->isOpen()) {
+            delete source;
+            return NULL;
+        }
+        return source;
+    }
+    if (_body.empty()) {
+        return NULL;
+    }
+    return new MemoryBodySource(_body);
+}
+
+// Switches the response to chunked framing, for producers that don't know the body length up front.
+void HttpResponse::setChunked() {
+    _chunked = true;
+    _headers.erase("Content-Length");
+    addHeader("Transfer-Encoding", "chunked");
+}
+
+// Appends one chunk (hex size line, data, CRLF) to 'out'. Empty data is skipped, as a zero-size chunk ends the body.
+void HttpResponse::appendChunk(std::string& out, const char* data, size_t len) {
+    if (len == 0) {
+        return;
+    }
+    char sizeLine[32];
+    int n = snprintf(sizeLine, sizeof(sizeLine), "%lx\r\n", static_cast<unsigned long>(len));
+    out.append(sizeLine, n);
+    out.append(data, len);
+    out.append("\r\n", 2);
+}
+
+// Appends the last-chunk marker and the empty trailer section that terminate a chunked body.
+void HttpResponse::appendLastChunk(std::string& out) {
+    out.append("0\r\n\r\n", 5);
+}
+
 // Generates the current GMT date/time string for the "Date" header.
 std::string HttpResponse::getCurrentGmTime() const {
     char buf[100];
@@ -116,8 +240,8 @@ void HttpResponse::setDefaultHeaders() {
     addHeader("Date", getCurrentGmTime());
 }
 
-// Generates the complete raw HTTP response string.
-std::string HttpResponse::toString() const {
+// Generates the status line and header section, up to and including the blank line.
+std::string HttpResponse::headersToString() const {
     std::ostringstream oss;
 
     // 1. Status Line.
@@ -125,7 +249,7 @@ std::string HttpResponse::toString() const {
 
     // 2. Headers.
     // If Content-Type is not set by handler, provide a default.
-    if (_headers.find("Content-Type") == _headers.end()) {
+    if (_defaultContentType && _headers.find("Content-Type") == _headers.end()) {
         oss << "Content-Type: application/octet-stream\r\n";
     }
 
@@ -134,13 +258,28 @@ std::string HttpResponse::toString() const {
     for (it = _headers.begin(); it != _headers.end(); ++it) {
         oss << it->first << ": " << it->second << "\r\n";
     }
+    for (size_t i = 0; i < _repeatedHeaders.size(); ++i) {
+        oss << _repeatedHeaders[i].first << ": " << _repeatedHeaders[i].second << "\r\n";
+    }
     
     oss << "\r\n"; // End of headers.
 
+    return oss.str();
+}
+
+// Generates the complete raw HTTP response string (in-memory bodies only; file bodies go through releaseBodySource()).
+std::string HttpResponse::toString() const {
+    std::string raw = headersToString();
+
     // 3. Body.
-    for (size_t i = 0; i < _body.size(); ++i) {
-        oss << _body[i];
+    if (_chunked) {
+        if (!_body.empty()) {
+            appendChunk(raw, &_body[0], _body.size());
+        }
+        appendLastChunk(raw);
+    } else {
+        raw.append(_body.begin(), _body.end());
     }
 
-    return oss.str();
+    return raw;
 }
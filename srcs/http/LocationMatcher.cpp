@@ -0,0 +1,193 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   LocationMatcher.cpp                                :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: bvieilhe <bvieilhe@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 16:03:29 by bvieilhe          #+#    #+#             */
+/*   Updated: 2026/10/18 16:03:29 by bvieilhe         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "../../includes/http/LocationMatcher.hpp"
+#include "../../includes/config/ServerStructures.hpp"
+
+#include <iostream>
+#include <algorithm>
+
+LocationMatcher::LocationMatcher() : _compiled(false) {
+	_nodes.push_back(Node());
+}
+
+LocationMatcher::LocationMatcher(const LocationMatcher&) : _compiled(false) {
+	_nodes.push_back(Node());
+}
+
+LocationMatcher& LocationMatcher::operator=(const LocationMatcher& other) {
+	if (this != &other) {
+		_clear();
+	}
+	return *this;
+}
+
+LocationMatcher::~LocationMatcher() {
+	_clear();
+}
+
+void LocationMatcher::compile(const std::vector<LocationConfig>& locations) {
+	_clear();
+	_add(locations);
+	_compiled = true;
+}
+
+bool LocationMatcher::isCompiled() const {
+	return _compiled;
+}
+
+const LocationConfig* LocationMatcher::match(const std::string& path) const {
+	const LocationConfig* best = NULL;
+	bool stop = false;
+	size_t node = 0;
+	size_t pos = 0;
+
+	for (;;) {
+		const Node& current = _nodes[node];
+		if (current.prefix) {
+			best = current.prefix;
+			stop = current.stop;
+		}
+		if (pos == path.length()) {
+			if (current.exact) {
+				return current.exact;
+			}
+			break;
+		}
+		size_t next = _child(node, path[pos]);
+		if (next == 0 || path.compare(pos, _nodes[next].label.length(), _nodes[next].label) != 0) {
+			break;
+		}
+		pos += _nodes[next].label.length();
+		node = next;
+	}
+	if (!stop) {
+		for (size_t i = 0; i < _regexes.size(); ++i) {
+			if (regexec(_regexes[i].first, path.c_str(), 0, NULL, 0) == 0) {
+				return _regexes[i].second;
+			}
+		}
+	}
+	return best;
+}
+
+std::string LocationMatcher::checkRegex(const std::string& pattern, bool ignoreCase) {
+	regex_t regex;
+	int rc = regcomp(&regex, pattern.c_str(), REG_EXTENDED | REG_NOSUB | (ignoreCase ? REG_ICASE : 0));
+	if (rc != 0) {
+		char message[256];
+		regerror(rc, &regex, message, sizeof(message));
+		return message;
+	}
+	regfree(&regex);
+	return "";
+}
+
+void LocationMatcher::_clear() {
+	for (size_t i = 0; i < _regexes.size(); ++i) {
+		regfree(_regexes[i].first);
+		delete _regexes[i].first;
+	}
+	_regexes.clear();
+	_nodes.clear();
+	_nodes.push_back(Node());
+	_compiled = false;
+}
+
+// Adds the locations in config order, each before its nested blocks.
+void LocationMatcher::_add(const std::vector<LocationConfig>& locations) {
+	for (size_t i = 0; i < locations.size(); ++i) {
+		const LocationConfig& location = locations[i];
+
+		if (location.matchType == "~" || location.matchType == "~*") {
+			regex_t* regex = new regex_t;
+			int flags = REG_EXTENDED | REG_NOSUB | (location.matchType == "~*" ? REG_ICASE : 0);
+			if (regcomp(regex, location.path.c_str(), flags) != 0) {
+				// Patterns are checked at config load; this only guards against a config built elsewhere.
+				std::cerr << "WARNING: Skipping location with invalid regex '" << location.path << "'." << std::endl;
+				delete regex;
+			} else {
+				_regexes.push_back(std::make_pair(regex, &location));
+			}
+		} else {
+			_insert(location.path, &location);
+		}
+		_add(location.nestedLocations);
+	}
+}
+
+// Walks down the trie along 'path', splitting the edge where it diverges, and records the location
+// on the node where the path ends.
+void LocationMatcher::_insert(const std::string& path, const LocationConfig* location) {
+	size_t node = 0;
+	size_t pos = 0;
+
+	while (pos < path.length()) {
+		size_t next = _child(node, path[pos]);
+		if (next == 0) {
+			Node leaf;
+			leaf.label = path.substr(pos);
+			_nodes.push_back(leaf);
+			next = _nodes.size() - 1;
+			std::vector<std::pair<char, size_t> >& children = _nodes[node].children;
+			children.insert(std::lower_bound(children.begin(), children.end(), std::make_pair(path[pos], static_cast<size_t>(0))),
+				std::make_pair(path[pos], next));
+			node = next;
+			pos = path.length();
+			break;
+		}
+		const std::string& label = _nodes[next].label;
+		size_t common = 0;
+		while (common < label.length() && pos + common < path.length() && label[common] == path[pos + common]) {
+			++common;
+		}
+		if (common < label.length()) {
+			// Split the edge: a new node for the shared part takes the existing one as its only child.
+			Node middle;
+			middle.label = label.substr(0, common);
+			middle.children.push_back(std::make_pair(label[common], next));
+			_nodes[next].label.erase(0, common);
+			_nodes.push_back(middle);
+			size_t middleIndex = _nodes.size() - 1;
+			std::vector<std::pair<char, size_t> >& children = _nodes[node].children;
+			for (size_t i = 0; i < children.size(); ++i) {
+				if (children[i].second == next) {
+					children[i].second = middleIndex;
+				}
+			}
+			next = middleIndex;
+		}
+		node = next;
+		pos += common;
+	}
+
+	Node& target = _nodes[node];
+	if (location->matchType == "=") {
+		if (!target.exact) {
+			target.exact = location;
+		}
+	} else if (!target.prefix) {
+		target.prefix = location;
+		target.stop = location->matchType == "^~";
+	}
+}
+
+// Index of the child of 'node' whose label starts with 'c', or 0 (the root is nobody's child).
+size_t LocationMatcher::_child(size_t node, char c) const {
+	const std::vector<std::pair<char, size_t> >& children = _nodes[node].children;
+	std::vector<std::pair<char, size_t> >::const_iterator it =
+		std::lower_bound(children.begin(), children.end(), std::make_pair(c, static_cast<size_t>(0)));
+	if (it == children.end() || it->first != c) {
+		return 0;
+	}
+	return it->second;
+}
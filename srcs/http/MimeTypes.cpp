@@ -0,0 +1,137 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   MimeTypes.cpp                                      :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: bvieilhe <bvieilhe@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 11:02:40 by bvieilhe          #+#    #+#             */
+/*   Updated: 2026/10/18 11:02:40 by bvieilhe         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "../../includes/http/MimeTypes.hpp"
+
+#include <cctype>
+#include <cstring>
+
+// Fallback table used when the configuration does not declare any 'types' block.
+static const char* const	builtinTypes[][2] = {
+	{ "html", "text/html" },
+	{ "htm", "text/html" },
+	{ "css", "text/css" },
+	{ "js", "application/javascript" },
+	{ "json", "application/json" },
+	{ "txt", "text/plain" },
+	{ "jpg", "image/jpeg" },
+	{ "jpeg", "image/jpeg" },
+	{ "png", "image/png" },
+	{ "gif", "image/gif" },
+	{ "ico", "image/x-icon" },
+	{ "svg", "image/svg+xml" },
+	{ "pdf", "application/pdf" },
+	{ "xml", "application/xml" }
+};
+
+MimeTypes::MimeTypes() : _count(0), _defaultType("application/octet-stream") {
+	loadDefaults();
+}
+
+void MimeTypes::loadDefaults() {
+	std::map<std::string, std::string> types;
+	for (size_t i = 0; i < sizeof(builtinTypes) / sizeof(builtinTypes[0]); ++i) {
+		types[builtinTypes[i][0]] = builtinTypes[i][1];
+	}
+	load(types);
+}
+
+// Returns the process-wide registry.
+MimeTypes& MimeTypes::instance() {
+	static MimeTypes registry;
+	return registry;
+}
+
+// FNV-1a over the (already lowercased) extension bytes.
+unsigned int MimeTypes::_hash(const char* key, size_t len) {
+	unsigned int h = 2166136261u;
+	for (size_t i = 0; i < len; ++i) {
+		h ^= static_cast<unsigned char>(key[i]);
+		h *= 16777619u;
+	}
+	return h;
+}
+
+// Inserts or replaces an entry using linear probing. The table must have a free slot.
+void MimeTypes::_insert(const std::string& extension, const std::string& type) {
+	unsigned int h = _hash(extension.data(), extension.size());
+	size_t mask = _slots.size() - 1;
+	size_t i = h & mask;
+
+	while (_slots[i].used) {
+		if (_slots[i].hash == h && _slots[i].extension == extension) {
+			_slots[i].type = type;
+			return;
+		}
+		i = (i + 1) & mask;
+	}
+	_slots[i].used = true;
+	_slots[i].hash = h;
+	_slots[i].extension = extension;
+	_slots[i].type = type;
+	++_count;
+}
+
+void MimeTypes::load(const std::map<std::string, std::string>& types) {
+	size_t capacity = 16;
+	while (capacity < types.size() * 2) {
+		capacity <<= 1;
+	}
+	_slots.assign(capacity, Slot());
+	_count = 0;
+
+	for (std::map<std::string, std::string>::const_iterator it = types.begin(); it != types.end(); ++it) {
+		std::string ext = it->first;
+		for (size_t i = 0; i < ext.size(); ++i) {
+			ext[i] = static_cast<char>(std::tolower(static_cast<unsigned char>(ext[i])));
+		}
+		if (!ext.empty() && ext.size() < MIME_MAX_EXTENSION_LEN) {
+			_insert(ext, it->second);
+		}
+	}
+}
+
+const std::string& MimeTypes::lookup(const std::string& filePath) const {
+	size_t dotPos = filePath.rfind('.');
+	if (dotPos == std::string::npos) {
+		return _defaultType;
+	}
+	size_t slashPos = filePath.rfind('/');
+	if (slashPos != std::string::npos && slashPos > dotPos) {
+		return _defaultType; // The dot belongs to a directory name, not to the file.
+	}
+
+	size_t len = filePath.size() - dotPos - 1;
+	if (len == 0 || len >= MIME_MAX_EXTENSION_LEN) {
+		return _defaultType;
+	}
+
+	// Lowercase into a stack buffer: no allocation on the lookup path.
+	char key[MIME_MAX_EXTENSION_LEN];
+	for (size_t i = 0; i < len; ++i) {
+		key[i] = static_cast<char>(std::tolower(static_cast<unsigned char>(filePath[dotPos + 1 + i])));
+	}
+
+	unsigned int h = _hash(key, len);
+	size_t mask = _slots.size() - 1;
+	for (size_t i = h & mask; _slots[i].used; i = (i + 1) & mask) {
+		const Slot& slot = _slots[i];
+		if (slot.hash == h && slot.extension.size() == len && std::memcmp(slot.extension.data(), key, len) == 0) {
+			return slot.type;
+		}
+	}
+	return _defaultType;
+}
+
+size_t MimeTypes::size() const {
+	return _count;
+}
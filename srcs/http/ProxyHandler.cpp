@@ -0,0 +1,434 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   ProxyHandler.cpp                                   :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: bvieilhe <bvieilhe@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 17:31:09 by bvieilhe          #+#    #+#             */
+/*   Updated: 2026/10/18 17:31:09 by bvieilhe         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "../../includes/http/ProxyHandler.hpp"
+#include "../../includes/server/Server.hpp"
+#include "../../includes/utils/StringUtils.hpp"
+#include "../../includes/webserv.hpp"
+
+#include <iostream>
+#include <cstdlib>
+#include <sys/socket.h>
+
+# define PROXY_MAX_HEADER_SIZE 16384	// Response header section (or chunk-size line) accepted from an upstream.
+
+namespace {
+	// Hop-by-hop fields (RFC 9110, 7.6.1) describe one connection and are never forwarded.
+	bool isHopByHop(const std::string& lowerName) {
+		return lowerName == "connection" || lowerName == "keep-alive" || lowerName == "proxy-connection"
+			|| lowerName == "te" || lowerName == "trailer" || lowerName == "transfer-encoding" || lowerName == "upgrade";
+	}
+
+	// "content-type" -> "Content-Type", so upstream fields replace the response defaults of the same name.
+	std::string canonicalHeaderName(const std::string& name) {
+		std::string canonical = name;
+		bool upper = true;
+		for (size_t i = 0; i < canonical.size(); ++i) {
+			canonical[i] = upper ? std::toupper(static_cast<unsigned char>(canonical[i]))
+				: std::tolower(static_cast<unsigned char>(canonical[i]));
+			upper = canonical[i] == '-';
+		}
+		return canonical;
+	}
+}
+
+ProxyHandler::ProxyHandler(const HttpRequest& request, const LocationConfig* location, Server* server, Connection* owner)
+	: _request(request), _location(location), _server(server), _owner(owner),
+	  _upstream(location ? Upstream::find(location->proxyPass) : NULL), _peer(0), _fd(-1), _reused(false),
+	  _attempts(0), _state(ProxyState::SENDING), _errorStatus(502), _lastActivity(time(NULL)), _outputPaused(false),
+	  _outSent(0), _receivedAny(false), _framing(FRAMING_NONE), _chunkState(CHUNK_SIZE), _remaining(0),
+	  _keepAlive(true) {}
+
+ProxyHandler::~ProxyHandler() {
+	cleanup();
+}
+
+bool ProxyHandler::start() {
+	if (!_upstream) {
+		_fail(502, "no upstream named '" + (_location ? _location->proxyPass : std::string()) + "'");
+		return false;
+	}
+	_encodeRequest();
+	if (!_connect()) {
+		_fail(502, "no server could be reached");
+		return false;
+	}
+	return true;
+}
+
+// Takes a connection from the upstream, trying the next server while connecting fails outright.
+// Each server gets one attempt, plus one for a pooled connection the server had dropped meanwhile.
+bool ProxyHandler::_connect() {
+	while (_fd == -1 && _attempts < _upstream->size() + 1) {
+		++_attempts;
+		_fd = _upstream->acquire(_request, _peer, _reused);
+	}
+	if (_fd == -1) {
+		return false;
+	}
+	_state = ProxyState::SENDING;
+	_outSent = 0;
+	_in.clear();
+	_receivedAny = false;
+	_lastActivity = time(NULL);
+	_server->registerProxyFd(_fd, _owner, POLLOUT);
+	return true;
+}
+
+// Request line, end-to-end header fields and body. The request URI is forwarded as received; the
+// framing is ours (the body is complete by now) and so is the persistence of the upstream connection.
+void ProxyHandler::_encodeRequest() {
+	_out = _request.method + " " + _request.uri + " HTTP/1.1\r\n";
+	for (std::map<std::string, std::string>::const_iterator it = _request.headers.begin(); it != _request.headers.end(); ++it) {
+		if (isHopByHop(it->first) || it->first == "content-length" || it->first == "expect") {
+			continue;
+		}
+		_out += canonicalHeaderName(it->first) + ": " + it->second + "\r\n";
+	}
+	_out += _upstream->keepsConnections() ? "Connection: keep-alive\r\n" : "Connection: close\r\n";
+	if (!_request.body.empty() || _request.method == "POST") {
+		_out += "Content-Length: " + StringUtils::longToString(static_cast<long>(_request.body.size())) + "\r\n";
+	}
+	_out += "\r\n";
+	_out.append(_request.body.begin(), _request.body.end());
+}
+
+void ProxyHandler::handleEvent(short revents) {
+	if (isFinished()) {
+		return;
+	}
+	// A refused or reset connection shows up as POLLERR/POLLHUP: the send() or recv() then reports it.
+	if (_state == ProxyState::SENDING) {
+		if (revents & (POLLOUT | POLLERR | POLLHUP)) {
+			_send();
+		}
+	} else if (revents & (POLLIN | POLLERR | POLLHUP)) {
+		_receive();
+	}
+}
+
+void ProxyHandler::_send() {
+	ssize_t bytes_sent = send(_fd, _out.data() + _outSent, _out.size() - _outSent, MSG_NOSIGNAL);
+	if (bytes_sent < 0) {
+		_retryOrFail("cannot send the request");
+		return;
+	}
+	_outSent += bytes_sent;
+	_lastActivity = time(NULL);
+	if (_outSent == _out.size()) {
+		_state = ProxyState::READING_HEADERS;
+		_server->updateFdEvents(_fd, POLLIN);
+	}
+}
+
+void ProxyHandler::_receive() {
+	char buffer[BUFF_SIZE];
+	ssize_t bytes_read = recv(_fd, buffer, sizeof(buffer), 0);
+	if (bytes_read < 0) {
+		_retryOrFail("cannot read the response");
+		return;
+	}
+	if (bytes_read == 0) {
+		if (_state == ProxyState::READING_BODY && _framing == FRAMING_UNTIL_CLOSE) {
+			_finish(false);
+		} else {
+			_retryOrFail("connection closed before the end of the response");
+		}
+		return;
+	}
+	_receivedAny = true;
+	_lastActivity = time(NULL);
+	_in.append(buffer, bytes_read);
+	if (_state == ProxyState::READING_HEADERS && !_parseHeaders()) {
+		return;
+	}
+	if (_state == ProxyState::READING_BODY) {
+		_parseBody();
+	}
+}
+
+// Parses the status line and header fields once the header section is complete. Interim (1xx)
+// responses are skipped. Returns false while the final header section is not in yet, or on error.
+bool ProxyHandler::_parseHeaders() {
+	size_t header_end = _in.find("\r\n\r\n");
+	if (header_end == std::string::npos) {
+		if (_in.size() > PROXY_MAX_HEADER_SIZE) {
+			_fail(502, "response header section too large");
+		}
+		return false;
+	}
+	std::string head = _in.substr(0, header_end);
+	_in.erase(0, header_end + 4);
+
+	size_t line_end = head.find("\r\n");
+	std::string status_line = head.substr(0, line_end);
+	size_t first_space = status_line.find(' ');
+	std::string version = status_line.substr(0, first_space);
+	std::string code = first_space == std::string::npos ? "" : status_line.substr(first_space + 1, 3);
+	if (version.compare(0, 7, "HTTP/1.") != 0 || version.size() != 8 || code.size() != 3 || !StringUtils::isDigits(code)) {
+		_fail(502, "malformed status line '" + status_line + "'");
+		return false;
+	}
+	int status = static_cast<int>(StringUtils::stringToLong(code));
+	if (status < 200) {
+		return _parseHeaders(); // 100 Continue and friends: the final response follows.
+	}
+	std::string reason = status_line.size() > first_space + 5 ? status_line.substr(first_space + 5) : getHttpStatusMessage(status);
+	_response.setStatus(status, reason);
+	_response.omitDefaultContentType();
+	_keepAlive = version == "HTTP/1.1";
+
+	bool chunked = false;
+	bool has_length = false;
+	size_t start = line_end == std::string::npos ? head.size() : line_end + 2;
+	while (start < head.size()) {
+		size_t end = head.find("\r\n", start);
+		if (end == std::string::npos) {
+			end = head.size();
+		}
+		std::string line = head.substr(start, end - start);
+		start = end + 2;
+
+		size_t colon_pos = line.find(':');
+		if (colon_pos == std::string::npos) {
+			std::cerr << "WARNING: Upstream " << _upstream->describe(_peer) << ": malformed header line '" << line << "'." << std::endl;
+			continue;
+		}
+		std::string name = line.substr(0, colon_pos);
+		std::string value = line.substr(colon_pos + 1);
+		StringUtils::trim(name);
+		StringUtils::trim(value);
+		std::string lower_name = name;
+		StringUtils::toLower(lower_name);
+
+		if (lower_name == "connection") {
+			std::string lower_value = value;
+			StringUtils::toLower(lower_value);
+			_keepAlive = _keepAlive && lower_value.find("close") == std::string::npos;
+		} else if (lower_name == "transfer-encoding") {
+			std::string lower_value = value;
+			StringUtils::toLower(lower_value);
+			chunked = lower_value.find("chunked") != std::string::npos;
+		} else if (lower_name == "content-length") {
+			if (!StringUtils::isDigits(value)) {
+				_fail(502, "invalid Content-Length '" + value + "'");
+				return false;
+			}
+			_remaining = static_cast<size_t>(std::strtoul(value.c_str(), NULL, 10));
+			has_length = true;
+		} else if (!isHopByHop(lower_name) && lower_name != "server") {
+			std::string canonical = canonicalHeaderName(name);
+			// Each Set-Cookie is its own line: its values contain commas, so they can't be combined.
+			if (lower_name == "set-cookie") {
+				_response.appendHeader(canonical, value);
+				continue;
+			}
+			const std::map<std::string, std::string>& headers = _response.getHeaders();
+			std::map<std::string, std::string>::const_iterator existing = headers.find(canonical);
+			// Other repeated fields are combined into one list (RFC 9110 section 5.3).
+			if (existing != headers.end() && canonical != "Date") {
+				value = existing->second + ", " + value;
+			}
+			_response.addHeader(canonical, value);
+		}
+	}
+
+	if (_request.method == "HEAD" || status == 204 || status == 304) {
+		_framing = FRAMING_NONE;
+	} else if (chunked) {
+		_framing = FRAMING_CHUNKED;
+		_chunkState = CHUNK_SIZE;
+	} else if (has_length) {
+		_framing = FRAMING_LENGTH;
+	} else {
+		_framing = FRAMING_UNTIL_CLOSE;
+		_keepAlive = false;
+	}
+	// A known length is passed on; otherwise the Connection picks the framing for its client.
+	if (_framing == FRAMING_LENGTH || (_framing == FRAMING_NONE && has_length)) {
+		_response.addHeader("Content-Length", StringUtils::longToString(static_cast<long>(_remaining)));
+	}
+	_state = ProxyState::READING_BODY;
+	if (_framing == FRAMING_NONE || (_framing == FRAMING_LENGTH && _remaining == 0)) {
+		_finish(true);
+	}
+	return true;
+}
+
+// Moves the body bytes received so far into the buffer, without their framing.
+void ProxyHandler::_parseBody() {
+	if (_framing == FRAMING_CHUNKED) {
+		if (_decodeChunked()) {
+			_finish(true);
+		}
+		return;
+	}
+	size_t take = _in.size();
+	if (_framing == FRAMING_LENGTH && take > _remaining) {
+		take = _remaining; // Bytes past the body: the connection is out of step and not reused.
+	}
+	_body.insert(_body.end(), _in.begin(), _in.begin() + take);
+	_in.erase(0, take);
+	if (_framing == FRAMING_LENGTH) {
+		_remaining -= take;
+		if (_remaining == 0) {
+			_finish(true);
+		}
+	}
+}
+
+// Decodes chunks into the body buffer. Returns true once the last chunk and the trailer section
+// are in; false while more bytes are needed, or on a framing error (the handler then failed).
+bool ProxyHandler::_decodeChunked() {
+	while (true) {
+		if (_chunkState == CHUNK_DATA) {
+			size_t take = std::min(_remaining, _in.size());
+			_body.insert(_body.end(), _in.begin(), _in.begin() + take);
+			_in.erase(0, take);
+			_remaining -= take;
+			if (_remaining > 0) {
+				return false;
+			}
+			_chunkState = CHUNK_DATA_END;
+			continue;
+		}
+		if (_chunkState == CHUNK_DATA_END) {
+			if (_in.size() < 2) {
+				return false;
+			}
+			if (_in.compare(0, 2, "\r\n") != 0) {
+				_fail(502, "malformed chunk");
+				return false;
+			}
+			_in.erase(0, 2);
+			_chunkState = CHUNK_SIZE;
+			continue;
+		}
+		size_t line_end = _in.find("\r\n");
+		if (line_end == std::string::npos) {
+			if (_in.size() > PROXY_MAX_HEADER_SIZE) {
+				_fail(502, "chunk line too long");
+			}
+			return false;
+		}
+		std::string line = _in.substr(0, line_end);
+		_in.erase(0, line_end + 2);
+		if (_chunkState == CHUNK_TRAILER) {
+			if (line.empty()) {
+				return true; // Trailer fields are dropped.
+			}
+			continue;
+		}
+		char* end = NULL;
+		unsigned long size = std::strtoul(line.c_str(), &end, 16);
+		if (end == line.c_str() || (*end != '\0' && *end != ';' && *end != ' ')) {
+			_fail(502, "malformed chunk size '" + line + "'");
+			return false;
+		}
+		_remaining = size;
+		_chunkState = size == 0 ? CHUNK_TRAILER : CHUNK_DATA;
+	}
+}
+
+// The response is complete: the socket leaves the poll set and goes back to the pool if the
+// exchange ended cleanly (whole request sent, nothing past the response, server keeps it open).
+void ProxyHandler::_finish(bool reusable) {
+	_state = ProxyState::COMPLETE;
+	reusable = reusable && _keepAlive && _outSent == _out.size() && _in.empty();
+	_server->unregisterProxyFd(_fd);
+	_upstream->release(_peer, _fd, reusable);
+	_fd = -1;
+}
+
+// Before any response byte came back the request can go to a server again: a pooled connection the
+// server had closed, a server that refused the connection, or (for GET and HEAD, which are safe to
+// repeat) one that dropped it. Otherwise the request fails with 502.
+void ProxyHandler::_retryOrFail(const std::string& reason) {
+	bool repeatable = _state == ProxyState::SENDING || _reused || _request.method == "GET" || _request.method == "HEAD";
+	if (_receivedAny || !repeatable || _attempts >= _upstream->size() + 1) {
+		_fail(502, reason);
+		return;
+	}
+	std::cerr << "WARNING: Upstream " << _upstream->describe(_peer) << ": " << reason << ". Retrying." << std::endl;
+	if (!_reused) {
+		_upstream->markFailed(_peer);
+	}
+	_server->unregisterProxyFd(_fd);
+	_upstream->release(_peer, _fd, false);
+	_fd = -1;
+	if (!_connect()) {
+		_fail(502, "no server could be reached");
+	}
+}
+
+void ProxyHandler::_fail(int status, const std::string& reason) {
+	std::cerr << "ERROR: Upstream " << (_upstream ? _upstream->describe(_peer) : std::string("(none)")) << ": " << reason << "." << std::endl;
+	_errorStatus = status;
+	_state = ProxyState::FAILED;
+}
+
+int ProxyHandler::getFd() const {
+	return _fd;
+}
+
+ProxyState::Type ProxyHandler::getState() const {
+	return _state;
+}
+
+bool ProxyHandler::isFinished() const {
+	return _state == ProxyState::COMPLETE || _state == ProxyState::TIMEOUT || _state == ProxyState::FAILED;
+}
+
+int ProxyHandler::getErrorStatus() const {
+	return _errorStatus;
+}
+
+bool ProxyHandler::hasParsedHeaders() const {
+	return _state == ProxyState::READING_BODY || _state == ProxyState::COMPLETE;
+}
+
+const HttpResponse& ProxyHandler::getHttpResponse() const {
+	return _response;
+}
+
+std::vector<char>& ProxyHandler::getBodyBuffer() {
+	return _body;
+}
+
+void ProxyHandler::setOutputPaused(bool paused) {
+	_outputPaused = paused;
+	_lastActivity = time(NULL);
+}
+
+bool ProxyHandler::checkTimeout() const {
+	return !isFinished() && !_outputPaused && time(NULL) - _lastActivity > PROXY_TIMEOUT_SECONDS;
+}
+
+void ProxyHandler::setTimeout() {
+	if (isFinished()) {
+		return;
+	}
+	std::cerr << "WARNING: Upstream " << _upstream->describe(_peer) << " did not respond within " << PROXY_TIMEOUT_SECONDS << "s." << std::endl;
+	_upstream->markFailed(_peer);
+	_errorStatus = 504;
+	_state = ProxyState::TIMEOUT;
+}
+
+// Closes a socket still held (request failed, timed out or abandoned by the client).
+void ProxyHandler::cleanup() {
+	if (_fd == -1) {
+		return;
+	}
+	_server->unregisterProxyFd(_fd);
+	_upstream->release(_peer, _fd, false);
+	_fd = -1;
+}
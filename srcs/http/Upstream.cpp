@@ -0,0 +1,293 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   Upstream.cpp                                       :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: bvieilhe <bvieilhe@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 17:04:31 by bvieilhe          #+#    #+#             */
+/*   Updated: 2026/10/18 17:04:31 by bvieilhe         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "../../includes/http/Upstream.hpp"
+#include "../../includes/http/CGICache.hpp"
+#include "../../includes/http/FastCGI.hpp"
+#include "../../includes/utils/StringUtils.hpp"
+
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+
+std::map<std::string, Upstream*>	Upstream::_upstreams;
+std::vector<Upstream*>				Upstream::_retiredGroups;
+
+namespace {
+	// FNV-1a: cheap and well spread for short keys, which is all the ring needs.
+	unsigned int hashKey(const std::string& key) {
+		unsigned int hash = 2166136261u;
+		for (size_t i = 0; i < key.size(); ++i) {
+			hash ^= static_cast<unsigned char>(key[i]);
+			hash *= 16777619u;
+		}
+		return hash;
+	}
+
+	bool sameConfig(const UpstreamConfig& a, const UpstreamConfig& b) {
+		if (a.balance != b.balance || a.hashKey != b.hashKey || a.keepalive != b.keepalive
+			|| a.servers.size() != b.servers.size()) {
+			return false;
+		}
+		for (size_t i = 0; i < a.servers.size(); ++i) {
+			if (a.servers[i].host != b.servers[i].host || a.servers[i].port != b.servers[i].port
+				|| a.servers[i].weight != b.servers[i].weight) {
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+Upstream::Upstream(const UpstreamConfig& config) : _config(config), _next(0), _retired(false) {
+	for (size_t i = 0; i < config.servers.size(); ++i) {
+		Peer peer;
+		peer.config = config.servers[i];
+		peer.addrLen = 0;
+		peer.active = 0;
+		peer.currentWeight = 0;
+		peer.failedAt = 0;
+		_peers.push_back(peer);
+
+		// Each server gets points in proportion to its weight, so adding or removing one server
+		// only moves the keys that land next to its points.
+		if (config.balance == "hash") {
+			std::string base = peer.config.host + ":" + StringUtils::longToString(peer.config.port) + "-";
+			for (int point = 0; point < peer.config.weight * UPSTREAM_HASH_POINTS; ++point) {
+				_ring.push_back(std::make_pair(hashKey(base + StringUtils::longToString(point)), i));
+			}
+		}
+	}
+	std::sort(_ring.begin(), _ring.end());
+}
+
+void Upstream::configure(const std::map<std::string, UpstreamConfig>& configs) {
+	for (size_t i = 0; i < _retiredGroups.size(); ) {
+		if (_retiredGroups[i]->_inUse()) {
+			++i;
+			continue;
+		}
+		delete _retiredGroups[i];
+		_retiredGroups.erase(_retiredGroups.begin() + i);
+	}
+
+	for (std::map<std::string, Upstream*>::iterator it = _upstreams.begin(); it != _upstreams.end(); ) {
+		std::map<std::string, UpstreamConfig>::const_iterator updated = configs.find(it->first);
+		if (updated != configs.end() && sameConfig(updated->second, it->second->_config)) {
+			++it;
+			continue;
+		}
+		it->second->_retire();
+		_upstreams.erase(it++);
+	}
+	for (std::map<std::string, UpstreamConfig>::const_iterator it = configs.begin(); it != configs.end(); ++it) {
+		if (_upstreams.count(it->first) == 0) {
+			_upstreams[it->first] = new Upstream(it->second);
+		}
+	}
+}
+
+// Closes the idle connections and frees the group now if no request uses it, else parks it in _retiredGroups.
+void Upstream::_retire() {
+	_retired = true;
+	for (size_t i = 0; i < _peers.size(); ++i) {
+		for (size_t c = 0; c < _peers[i].idle.size(); ++c) {
+			close(_peers[i].idle[c]);
+		}
+		_peers[i].idle.clear();
+	}
+	if (_inUse()) {
+		_retiredGroups.push_back(this);
+	} else {
+		delete this;
+	}
+}
+
+bool Upstream::_inUse() const {
+	for (size_t i = 0; i < _peers.size(); ++i) {
+		if (_peers[i].active > 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+Upstream::~Upstream() {}
+
+Upstream* Upstream::find(const std::string& name) {
+	std::map<std::string, Upstream*>::iterator it = _upstreams.find(name);
+	return it == _upstreams.end() ? NULL : it->second;
+}
+
+int Upstream::acquire(const HttpRequest& request, size_t& server, bool& reused) {
+	server = _pick(request, time(NULL));
+	Peer& peer = _peers[server];
+
+	while (!peer.idle.empty()) {
+		int fd = peer.idle.back();
+		peer.idle.pop_back();
+
+		if (!FastCGI::isIdleAlive(fd)) {
+			close(fd);
+			continue;
+		}
+		reused = true;
+		++peer.active;
+		return fd;
+	}
+	reused = false;
+	int fd = _connect(peer);
+	if (fd == -1) {
+		markFailed(server);
+		return -1;
+	}
+	++peer.active;
+	return fd;
+}
+
+void Upstream::release(size_t server, int fd, bool reusable) {
+	Peer& peer = _peers[server];
+
+	if (peer.active > 0) {
+		--peer.active;
+	}
+	if (!reusable || _retired || static_cast<int>(peer.idle.size()) >= _config.keepalive) {
+		close(fd);
+		return;
+	}
+	peer.failedAt = 0;
+	peer.idle.push_back(fd);
+}
+
+void Upstream::markFailed(size_t server) {
+	_peers[server].failedAt = time(NULL);
+}
+
+size_t Upstream::size() const {
+	return _peers.size();
+}
+
+const std::string& Upstream::getName() const {
+	return _config.name;
+}
+
+std::string Upstream::describe(size_t server) const {
+	return _config.name + " (" + _peers[server].config.host + ":" + StringUtils::longToString(_peers[server].config.port) + ")";
+}
+
+bool Upstream::keepsConnections() const {
+	return _config.keepalive > 0;
+}
+
+bool Upstream::_isAvailable(const Peer& peer, time_t now) const {
+	return peer.failedAt == 0 || now - peer.failedAt >= UPSTREAM_FAIL_TIMEOUT;
+}
+
+// Picks among the available servers; when all of them failed recently, among all of them.
+size_t Upstream::_pick(const HttpRequest& request, time_t now) {
+	bool anyAvailable = false;
+	for (size_t i = 0; i < _peers.size() && !anyAvailable; ++i) {
+		anyAvailable = _isAvailable(_peers[i], now);
+	}
+	if (!anyAvailable) {
+		// Every server failed recently: try them all again rather than refusing outright.
+		for (size_t i = 0; i < _peers.size(); ++i) {
+			_peers[i].failedAt = 0;
+		}
+	}
+	if (_config.balance == "least_conn") {
+		return _pickLeastConn(now);
+	}
+	if (_config.balance == "hash") {
+		return _pickHash(request, now);
+	}
+	return _pickRoundRobin(now);
+}
+
+// Smooth weighted round-robin: every server gains its weight, the one ahead is picked and pays back
+// the total. Weights 2:1 give A A B spread as A B A rather than in bursts.
+size_t Upstream::_pickRoundRobin(time_t now) {
+	size_t best = _peers.size();
+	int total = 0;
+
+	for (size_t i = 0; i < _peers.size(); ++i) {
+		Peer& peer = _peers[i];
+		if (!_isAvailable(peer, now)) {
+			continue;
+		}
+		peer.currentWeight += peer.config.weight;
+		total += peer.config.weight;
+		if (best == _peers.size() || peer.currentWeight > _peers[best].currentWeight) {
+			best = i;
+		}
+	}
+	_peers[best].currentWeight -= total;
+	return best;
+}
+
+// Fewest requests in flight relative to weight. The scan starts one past the last pick, so ties
+// rotate instead of always going to the first server.
+size_t Upstream::_pickLeastConn(time_t now) {
+	size_t best = _peers.size();
+
+	for (size_t n = 0; n < _peers.size(); ++n) {
+		size_t i = (_next + n) % _peers.size();
+		const Peer& peer = _peers[i];
+		if (!_isAvailable(peer, now)) {
+			continue;
+		}
+		// active_i / weight_i < active_best / weight_best, without division.
+		if (best == _peers.size()
+			|| peer.active * _peers[best].config.weight < _peers[best].active * peer.config.weight) {
+			best = i;
+		}
+	}
+	_next = (best + 1) % _peers.size();
+	return best;
+}
+
+// Consistent hash of the request key: the first ring point at or after the key's hash, moving on
+// along the ring past servers that are down.
+size_t Upstream::_pickHash(const HttpRequest& request, time_t now) {
+	unsigned int hash = hashKey(CGICache::buildKey(_config.hashKey, request));
+	std::vector<std::pair<unsigned int, size_t> >::const_iterator it
+		= std::lower_bound(_ring.begin(), _ring.end(), std::make_pair(hash, static_cast<size_t>(0)));
+
+	for (size_t n = 0; n < _ring.size(); ++n, ++it) {
+		if (it == _ring.end()) {
+			it = _ring.begin();
+		}
+		if (_isAvailable(_peers[it->second], now)) {
+			return it->second;
+		}
+	}
+	return 0;
+}
+
+int Upstream::_connect(Peer& peer) {
+	std::string address = peer.config.host + ":" + StringUtils::longToString(peer.config.port);
+
+	// Resolved on first use and kept: names in the configuration are not looked up per request.
+	if (peer.addrLen == 0 && !FastCGI::parseAddress(address, peer.addr, peer.addrLen)) {
+		std::cerr << "ERROR: Upstream '" << _config.name << "': cannot resolve server '" << address << "'." << std::endl;
+		peer.addrLen = 0;
+		return -1;
+	}
+
+	int fd = FastCGI::connectNonBlocking(peer.addr, peer.addrLen);
+	if (fd == -1) {
+		std::cerr << "ERROR: Upstream '" << _config.name << "': cannot connect to server '" << address << "': " << strerror(errno) << std::endl;
+	}
+	return fd;
+}
@@ -1,69 +1,79 @@
 #include "webserv.hpp"
-#include "config/Lexer.hpp"
-#include "config/Parser.hpp"
 #include "config/ConfigLoader.hpp"
+#include "config/ConfigImage.hpp"
 #include "config/ServerStructures.hpp"
 #include "server/Server.hpp"
-#include <fstream>
-#include <sstream>
 #include <vector>
 #include <csignal>
 
 volatile sig_atomic_t stopSig = 0;
+volatile sig_atomic_t reloadSig = 0;
+volatile sig_atomic_t upgradeSig = 0;
+volatile sig_atomic_t drainSig = 0;
 
 void handle_signal(int signal) {
     if (signal == SIGINT) {
         std::cout << "Signal SIGINT reçu, arrêt du serveur..." << std::endl;
         stopSig = 1; // Mettre à jour la variable pour indiquer l'arrêt
+    } else if (signal == SIGHUP) {
+        reloadSig = 1; // Configuration reloaded by the server loop (Server::_reload)
+    } else if (signal == SIGUSR2) {
+        upgradeSig = 1; // New binary started with the listening sockets (Server::_upgrade)
+    } else if (signal == SIGQUIT) {
+        drainSig = 1; // Graceful stop: open connections are served first (Server::_startDraining)
     }
 }
 
+// Reads "[configuration_file]" or "-c configuration_file [-o image_file]". Returns false on a usage error.
+static bool parseArguments(int argc, char **argv, std::string& configPath, std::string& imagePath) {
+    if (argc <= 2) {
+        if (argc == 2) {
+            configPath = argv[1];
+        }
+        return argc < 2 || configPath[0] != '-';
+    }
+    for (int i = 1; i < argc; i += 2) {
+        std::string flag = argv[i];
+        if (i + 1 >= argc || (flag != "-c" && flag != "-o")) {
+            return false;
+        }
+        (flag == "-c" ? configPath : imagePath) = argv[i + 1];
+    }
+    return true;
+}
+
 // Main function: Parses configuration and starts the webserv server.
 int main(int argc, char **argv) {
     // Enregistrement du gestionnaire de signal
     std::signal(SIGINT, handle_signal);
+    std::signal(SIGHUP, handle_signal);
+    std::signal(SIGUSR2, handle_signal);
+    std::signal(SIGQUIT, handle_signal);
+    // A CGI or pooled worker dying mid-write must surface as a write error, not kill the server.
+    std::signal(SIGPIPE, SIG_IGN);
     // Validate command line arguments.
-    if (argc > 2) {
+    std::string config_path = "configs/default.conf";
+    std::string image_path;
+    if (!parseArguments(argc, argv, config_path, image_path)) {
         std::cerr << "Usage: ./webserv [configuration_file]" << std::endl;
+        std::cerr << "       ./webserv -c configuration_file [-o image_file]" << std::endl;
         return 1;
     }
-
-    std::string config_path = (argc == 2) ? argv[1] : "configs/default.conf";
     std::vector<ServerConfig> serverConfigs;
 
     try {
-        // Read configuration file content.
-        std::ifstream file(config_path.c_str());
-        if (!file.is_open()) {
-            throw std::runtime_error("Could not open configuration file: " + config_path);
-        }
-        std::stringstream buffer;
-        buffer << file.rdbuf();
-        std::string fileContent = buffer.str();
-
-        // Tokenize the configuration file content.
-        Lexer lexer(fileContent);
-        lexer.lexConf();
-        std::vector<token> tokens = lexer.getTokens();
-
-        // Parse the tokens into an Abstract Syntax Tree (AST).
-        Parser parser(tokens);
-        std::vector<ASTnode*> ast = parser.parse();
-
-        // Load server configurations from the AST.
+        // Read, parse and load the configuration (text or compiled image).
         ConfigLoader loader;
-        serverConfigs = loader.loadConfig(ast);
-
-        // Clean up AST nodes to prevent memory leaks.
-        for (size_t i = 0; i < ast.size(); ++i) {
-            delete ast[i];
+        loader.loadFile(config_path).swap(serverConfigs);
+        // '-o': save it as an image for a faster start, and stop there.
+        if (!image_path.empty()) {
+            size_t size = ConfigImage::write(image_path, serverConfigs, loader.getMimeTypes(),
+                                             loader.getUpstreams(), loader.getCachePaths());
+            std::cout << "Configuration image written to " << image_path << " (" << size << " bytes)" << std::endl;
+            return 0;
         }
-
-        // Ensure at least one server configuration is loaded.
-        if (serverConfigs.empty()) {
-            throw std::runtime_error("No server configurations loaded.");
-        }
-
+        // Set up what the servers share.
+        Server::applySharedConfig(loader, serverConfigs);
     } catch (const std::exception& e) {
         std::cerr << "Configuration error: " << e.what() << std::endl;
         return 1;
@@ -71,7 +81,7 @@ int main(int argc, char **argv) {
 
     try {
         // Initialize and run the server with the loaded configurations.
-        Server server(serverConfigs);
+        Server server(serverConfigs, config_path, argv[0]);
         server.run();
     } catch (const std::exception& e) {
         std::cerr << "Server runtime error: " << e.what() << std::endl;
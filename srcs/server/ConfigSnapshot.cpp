@@ -0,0 +1,65 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   ConfigSnapshot.cpp                                 :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: bvieilhe <bvieilhe@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 18:12:40 by bvieilhe          #+#    #+#             */
+/*   Updated: 2026/10/18 18:12:40 by bvieilhe         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "../../includes/server/ConfigSnapshot.hpp"
+#include "../../includes/http/CGILimiter.hpp"
+
+// Takes over the server blocks, then builds what points into them: location matchers and virtual hosts.
+ConfigSnapshot::ConfigSnapshot(std::vector<ServerConfig>& servers) : _refs(0) {
+	_servers.swap(servers);
+	for (size_t i = 0; i < _servers.size(); ++i) {
+		_servers[i].locationMatcher.compile(_servers[i].locations);
+		_virtualHosts[ListenAddress(_servers[i].host, _servers[i].port)].add(&_servers[i]);
+	}
+	_sharedAddresses = (getListenAddresses().size() != _virtualHosts.size());
+}
+
+// Per-location state kept elsewhere is keyed by the LocationConfig address, which a later
+// configuration may reuse.
+ConfigSnapshot::~ConfigSnapshot() {
+	for (size_t i = 0; i < _servers.size(); ++i) {
+		CGILimiter::forget(_servers[i].locations);
+	}
+}
+
+void ConfigSnapshot::acquire() {
+	++_refs;
+}
+
+void ConfigSnapshot::release() {
+	if (--_refs <= 0) {
+		delete this;
+	}
+}
+
+const std::vector<ServerConfig>& ConfigSnapshot::getServers() const {
+	return _servers;
+}
+
+const VirtualHosts* ConfigSnapshot::getVirtualHosts(const ListenAddress& address) const {
+	std::map<ListenAddress, VirtualHosts>::const_iterator it = _virtualHosts.find(address);
+	return it == _virtualHosts.end() ? NULL : &it->second;
+}
+
+std::vector<ListenAddress> ConfigSnapshot::getListenAddresses() const {
+	std::vector<ListenAddress> addresses;
+	for (std::map<ListenAddress, VirtualHosts>::const_iterator it = _virtualHosts.begin(); it != _virtualHosts.end(); ++it) {
+		if (it->first.first == "0.0.0.0" || !_virtualHosts.count(ListenAddress("0.0.0.0", it->first.second))) {
+			addresses.push_back(it->first);
+		}
+	}
+	return addresses;
+}
+
+bool ConfigSnapshot::hasSharedAddresses() const {
+	return _sharedAddresses;
+}
@@ -5,6 +5,7 @@
 #include "../../includes/http/RequestDispatcher.hpp"
 #include "../../includes/http/HttpRequestHandler.hpp"
 #include "../../includes/http/CGIHandler.hpp" // Added for CGIHandler usage
+#include "../../includes/utils/StringUtils.hpp"
 
 
 #include <unistd.h> // For read, write, close, waitpid, kill
@@ -19,8 +20,12 @@
 
 // Constructor: Initializes a new connection.
 Connection::Connection(Server* server)
-	: _state(READING), _server(server), _cgiHandler(NULL), _isCgiRequest(false),
-	  _bytesSentFromRawResponse(0)
+	: _state(READING), _server(server), _config(NULL), _cgiHandler(NULL), _isCgiRequest(false), _proxyHandler(NULL),
+	  _location(NULL), _locationMatched(false),
+	  _bytesSentFromRawResponse(0), _bodySource(NULL), _responseStarted(false), _cgiOutputPaused(false),
+	  _requestsServed(0), _keepAlive(false), _lastActivity(time(NULL)), _streaming(false),
+	  _receivingCgiBody(false), _cgiInputPaused(false), _cache(NULL), _cacheFiller(false), _cacheValid(0), _waitingForCache(false),
+	  _cacheWaitSince(0), _diskCache(NULL), _diskCacheValid(0), _diskFill(NULL)
 {
 	_parser.reset();
 	
@@ -28,6 +33,10 @@ Connection::Connection(Server* server)
 
 // Destructor: Cleans up the CGI handler if it exists.
 Connection::~Connection() {
+	delete _bodySource;
+	delete _proxyHandler;
+	_endCacheFill(FILL_ABANDONED);
+	_endDiskCacheFill(false);
 	if (_cgiHandler) {
 		std::cerr << "WARNING: CGIHandler still exists in Connection destructor for FD: " << getSocketFD() << ". Force-deleting and attempting FD cleanup." << std::endl;
 		// The cleanup method of CGIHandler should handle unregistering FDs and closing pipes.
@@ -35,6 +44,9 @@ Connection::~Connection() {
 		delete _cgiHandler;
 		_cgiHandler = NULL;
 	}
+	if (_config) {
+		_config->release(); // Last, as the cleanup above may still use the request's locations.
+	}
 	// The client socket FD is closed by Server::_reapClosedConnections()
 	// or when this Connection object is destroyed if not explicitly closed before.
 	std::cout << "SOCKET " << getSocketFD() << " CLOSED (Connection dtor finished)" << std::endl;
@@ -47,9 +59,19 @@ void Connection::handleRead() {
 	ssize_t bytes_read = recv(getSocketFD(), buffer, BUFF_SIZE - 1, 0); // Use recv for sockets
 
 	if (bytes_read > 0) {
+		if (_parser.isIdle()) {
+			_adoptCurrentConfig(); // A new request starts: it runs on the current configuration.
+		}
 		_parser.appendData(buffer, bytes_read); // Pass data to parser
+		_lastActivity = time(NULL);
 	} else if (bytes_read == 0) { // Client closed connection
-		if (!_parser.isComplete()) {
+		if (_parser.isIdle()) {
+			// Clean close between requests (e.g., end of a keep-alive session): nothing to answer.
+			setState(CLOSING);
+		} else if (_receivingCgiBody) {
+			std::cerr << "WARNING: Client closed connection on FD " << getSocketFD() << " before the end of the CGI request body." << std::endl;
+			abortCGI();
+		} else if (!_parser.isComplete()) {
 			std::cerr << "WARNING: Client closed connection on FD " << getSocketFD() << ", but request was incomplete. Sending 400 Bad Request." << std::endl;
 			HttpRequestHandler handler;
 			_response = handler._generateErrorResponse(400, this->getServerBlock(), NULL); // Bad Request
@@ -66,11 +88,32 @@ void Connection::handleRead() {
 	}
 
 	// Always attempt to parse after receiving data or if connection closed
+	bool hadHeaders = _parser.hasHeaders();
 	_parser.parse(); // Call parse() here
 
-	if (_parser.isComplete()) {
+	if (_receivingCgiBody) {
+		if (_parser.hasError()) {
+			std::cerr << "ERROR: Request body parsing error for FD: " << getSocketFD() << " while feeding the CGI." << std::endl;
+			_abortCgiBody();
+			return;
+		}
+		_feedCgiBody();
+	} else if (_parser.isComplete()) {
 		_request = _parser.getRequest();
+		_selectServer();
 		_processRequest();
+	} else if (!hadHeaders && _parser.hasHeaders() && _parser.expectsBody()) {
+		// Headers are in but the body is still coming: a CGI target is started right away and fed
+		// the body as it arrives. Other targets wait for the complete request.
+		_request = _parser.getRequest();
+		_request.body.clear(); // Delivered through _feedCgiBody() instead.
+		_selectServer();
+		const ServerConfig* serverConfig = this->getServerBlock();
+		_sendContinue();
+		if (serverConfig && _routesToCgi(_matchLocation())) {
+			_receivingCgiBody = true;
+			_processRequest();
+		}
 	} else if (_parser.hasError()) {
 		std::cerr << "ERROR: Request parsing error for FD: " << getSocketFD() << ". Closing connection." << std::endl;
 		HttpRequestHandler handler;
@@ -80,15 +123,25 @@ void Connection::handleRead() {
 }
 
 // Handles writing data to the client socket.
+// Only a window of the body (SEND_WINDOW_SIZE) is held in memory; it is refilled from the
+// body source each time the socket is writable. File bodies skip the window: once the headers
+// are out, they go from the file to the socket with sendfile().
 void Connection::handleWrite() {
-	if (_bytesSentFromRawResponse == 0) {
-		_rawResponseToSend = _response.toString();
+	if (!_responseStarted && !_beginResponse()) {
+		return;
+	}
+	if (_sendsBodyDirect() && _bytesSentFromRawResponse >= _rawResponseToSend.length()) {
+		_sendBodyDirect();
+		return;
+	}
+	if (!_fillSendWindow()) {
+		return;
 	}
 
 	size_t remaining_to_send = _rawResponseToSend.length() - _bytesSentFromRawResponse;
 	if (remaining_to_send == 0) {
-		_resetForNextRequest(); // Prepare for next request if keep-alive, else close.
-		return; // Early exit, state transition handled by reset.
+		_onSendBufferDrained();
+		return; // Early exit, state transition handled by _onSendBufferDrained.
 	}
 
 	// Use send for sockets
@@ -103,13 +156,83 @@ void Connection::handleWrite() {
 		// Do nothing, just return. The poll loop will re-poll for POLLOUT.
 	} else {
 		_bytesSentFromRawResponse += bytes_sent;
-		if (static_cast<size_t>(bytes_sent) == remaining_to_send || _bytesSentFromRawResponse >= _rawResponseToSend.length()) {
-			std::cout << "Response sent completely on FD: " << getSocketFD() << std::endl;
-			_resetForNextRequest(); // Response fully sent, prepare for next request
-		} else {
-			std::cout << "Partial write on FD: " << getSocketFD() << ". Sent " << bytes_sent << " of " << remaining_to_send << " remaining. Total sent: " << _bytesSentFromRawResponse << "/" << _rawResponseToSend.length() << std::endl;
+		if (_bytesSentFromRawResponse >= _rawResponseToSend.length() && !_bodySource) {
+			_onSendBufferDrained();
+		} else if (_cgiOutputPaused && _rawResponseToSend.length() - _bytesSentFromRawResponse < SEND_WINDOW_SIZE / 2) {
+			_resumeCgiOutput();
+		}
+	}
+}
+
+// Serializes the headers and takes over the body as a source to be pulled from while sending.
+bool Connection::_beginResponse() {
+	_applyConnectionHeaders();
+	_rawResponseToSend = _response.headersToString();
+	_bytesSentFromRawResponse = 0;
+	_bodySource = _response.releaseBodySource();
+	_responseStarted = true;
+	if (!_bodySource && _response.hasFileBody()) {
+		std::cerr << "ERROR: Body file for FD " << getSocketFD() << " could not be opened. Closing connection." << std::endl;
+		setState(CLOSING);
+		return false;
+	}
+	return true;
+}
+
+// Tops the send buffer up to SEND_WINDOW_SIZE from the body source. Returns false if the source failed.
+bool Connection::_fillSendWindow() {
+	if (!_bodySource || _sendsBodyDirect()) {
+		return true;
+	}
+	if (_bytesSentFromRawResponse > 0) {
+		_rawResponseToSend.erase(0, _bytesSentFromRawResponse);
+		_bytesSentFromRawResponse = 0;
+	}
+	while (_rawResponseToSend.length() < SEND_WINDOW_SIZE && !_bodySource->isExhausted()) {
+		if (_response.isChunked()) {
+			std::string piece;
+			if (_bodySource->readInto(piece, SEND_WINDOW_SIZE - _rawResponseToSend.length()) < 0) {
+				break;
+			}
+			HttpResponse::appendChunk(_rawResponseToSend, piece.data(), piece.size());
+		} else if (_bodySource->readInto(_rawResponseToSend, SEND_WINDOW_SIZE - _rawResponseToSend.length()) < 0) {
+			break;
 		}
 	}
+	if (!_bodySource->isExhausted()) {
+		if (_rawResponseToSend.length() - _bytesSentFromRawResponse > 0) {
+			return true;
+		}
+		// Headers (and Content-Length) are already out: a short body can only be signalled by closing.
+		std::cerr << "ERROR: Reading response body failed for FD: " << getSocketFD() << ". Closing connection." << std::endl;
+		setState(CLOSING);
+		return false;
+	}
+	if (_response.isChunked()) {
+		HttpResponse::appendLastChunk(_rawResponseToSend);
+	}
+	delete _bodySource;
+	_bodySource = NULL;
+	return true;
+}
+
+// Tells whether the rest of the body is sent by the source itself (a file range, unless it must be chunked).
+bool Connection::_sendsBodyDirect() const {
+	return _bodySource && !_response.isChunked() && _bodySource->canSendDirect();
+}
+
+// Sends the next part of a file body with sendfile(), as much as the socket takes.
+void Connection::_sendBodyDirect() {
+	if (_bodySource->sendTo(getSocketFD(), SENDFILE_CHUNK_SIZE) < 0) {
+		std::cerr << "Error sending response body on socket FD: " << getSocketFD() << ". Closing connection." << std::endl;
+		setState(CLOSING);
+		return;
+	}
+	if (_bodySource->isExhausted()) {
+		delete _bodySource;
+		_bodySource = NULL;
+		_onSendBufferDrained();
+	}
 }
 
 // Processes the parsed HTTP request.
@@ -130,35 +253,23 @@ void Connection::_processRequest() {
 	MatchedConfig matchedConfig;
 	matchedConfig.server_config = currentServerConfig;
 
-	matchedConfig.location_config = RequestDispatcher::findMatchingLocation(_request, *currentServerConfig);
+	matchedConfig.location_config = _matchLocation();
 
-	const LocationConfig* location = matchedConfig.location_config;
-
-	if (location && !location->cgiExecutables.empty()) {
-		size_t dot_pos = _request.path.rfind('.');
-		if (dot_pos != std::string::npos) {
-			std::string file_extension = _request.path.substr(dot_pos);
-			// Check if the exact extension is configured for CGI in this location
-			if (location->cgiExecutables.count(file_extension)) {
-				_isCgiRequest = true;
-				setState(HANDLING_CGI); // Transition to a CGI specific state
-				executeCGI();
-			} else {
-				// Not a matching CGI extension, handle as non-CGI
-				_isCgiRequest = false;
-				HttpRequestHandler handler;
-				_response = handler.handleRequest(_request, matchedConfig);
-				setState(WRITING);
-				std::cout << "Request processed (non-CGI, but CGI configured location, no matching extension), transitioning to WRITING on FD: " << getSocketFD() << std::endl;
-			}
-		} else {
-			// No file extension, handle as non-CGI
-			_isCgiRequest = false;
-			HttpRequestHandler handler;
-			_response = handler.handleRequest(_request, matchedConfig);
-			setState(WRITING);
-			std::cout << "Request processed (non-CGI, no extension), transitioning to WRITING on FD: " << getSocketFD() << std::endl;
+	if (matchedConfig.location_config && !matchedConfig.location_config->proxyPass.empty()) {
+		_isCgiRequest = false;
+		if (_lookupDiskCache(matchedConfig.location_config)) {
+			return;
+		}
+		_startProxy(matchedConfig);
+	} else if (_routesToCgi(matchedConfig.location_config)) {
+		_isCgiRequest = true;
+		setState(HANDLING_CGI); // Transition to a CGI specific state
+		// The disk cache, when configured, takes the place of the CGI microcache.
+		if (_lookupDiskCache(matchedConfig.location_config)
+			|| (!_diskCache && _lookupCgiCache(matchedConfig.location_config))) {
+			return;
 		}
+		executeCGI();
 	} else {
 		// No CGI configured for this location or no location matched, handle as non-CGI
 		_isCgiRequest = false;
@@ -170,6 +281,161 @@ void Connection::_processRequest() {
 	}
 }
 
+// Picks the server block of the current request from its Host header, among those of the listening address.
+void Connection::_selectServer() {
+	if (getVirtualHosts()) {
+		setServerBlock(RequestDispatcher::findMatchingServer(_request, *getVirtualHosts()));
+	}
+}
+
+// Moves the connection to the server's current configuration, if a reload replaced it. Only called
+// between requests: the one in progress keeps pointers into the configuration it started on. A
+// connection whose address is no longer listened on stays on its own until it closes.
+void Connection::_adoptCurrentConfig() {
+	ConfigSnapshot* current = _server->getConfigSnapshot();
+	if (current == _config) {
+		return;
+	}
+	const VirtualHosts* vhosts = current->getVirtualHosts(_listenAddress);
+	if (!vhosts) {
+		return;
+	}
+	current->acquire();
+	_config->release();
+	_config = current;
+	setVirtualHosts(vhosts);
+	setServerBlock(vhosts->defaultServer());
+}
+
+// Location of the current request: matched once, then reused by the later steps (CGI start, queue resume).
+const LocationConfig* Connection::_matchLocation() {
+	if (!_locationMatched) {
+		const ServerConfig* serverConfig = this->getServerBlock();
+		_location = serverConfig ? RequestDispatcher::findMatchingLocation(_request, *serverConfig) : NULL;
+		_locationMatched = true;
+	}
+	return _location;
+}
+
+// Answers 'Expect: 100-continue' with an interim response, so the client sends the body right away
+// instead of waiting for its own timeout. It is the first thing written on the socket for this
+// request and fits any fresh send buffer, so a plain send() suffices.
+void Connection::_sendContinue() {
+	std::string expect = _request.getHeader("expect");
+	StringUtils::toLower(expect);
+	if (expect != "100-continue" || _request.protocolVersion != "HTTP/1.1") {
+		return;
+	}
+	static const char continueLine[] = "HTTP/1.1 100 Continue\r\n\r\n";
+	if (send(getSocketFD(), continueLine, sizeof(continueLine) - 1, MSG_NOSIGNAL) != static_cast<ssize_t>(sizeof(continueLine) - 1)) {
+		std::cerr << "WARNING: Could not send 100 Continue on FD: " << getSocketFD() << std::endl;
+	}
+}
+
+// Tells whether requests for _request.path under 'location' are served by a CGI: everything under a
+// 'fastcgi_pass' location, or a path whose extension is configured with 'cgi' ('proxy_pass' comes first).
+bool Connection::_routesToCgi(const LocationConfig* location) const {
+	if (!location || !location->proxyPass.empty()) {
+		return false;
+	}
+	if (!location->fastcgiPass.empty()) {
+		return true;
+	}
+	size_t dot_pos = _request.path.rfind('.');
+	return dot_pos != std::string::npos && location->cgiExecutables.count(_request.path.substr(dot_pos)) != 0;
+}
+
+// Looks a GET request up in the location's CGI cache. Returns true when it is answered from the cache
+// or waits for the request filling the same key; false when the script has to run (on a miss, as the
+// key's filler).
+bool Connection::_lookupCgiCache(const LocationConfig* location) {
+	if (!_waitingForCache) {
+		_cache = (_request.method == "GET" && !_receivingCgiBody) ? CGICache::forLocation(location) : NULL;
+		if (!_cache) {
+			return false;
+		}
+		_cacheKey = CGICache::buildKey(location->cgiCacheKey, _request);
+		_cacheValid = location->cgiCacheValid;
+	}
+	CGICache::Status status = _cache->lookup(_cacheKey, location->cgiCacheValid, location->cgiCacheStale, _response);
+	if (status == CGICache::FILLING) {
+		if (!_waitingForCache) {
+			// Parked in the CGI wait queue; the Server looks again as requests finish.
+			_waitingForCache = true;
+			_cacheWaitSince = time(NULL);
+			_server->queueCgiRequest(getSocketFD());
+		}
+		return true;
+	}
+	_waitingForCache = false;
+	if (status == CGICache::MISS) {
+		_cacheFiller = true;
+		return false;
+	}
+	if (status == CGICache::PASS) {
+		_cache = NULL;
+		return false;
+	}
+	setState(WRITING);
+	return true;
+}
+
+// Ends this request's fill of _cacheKey: stores a cacheable answer; an answer that can't be stored
+// makes the key pass (run uncached) for the 'valid' window; without an answer the next lookup fills.
+void Connection::_endCacheFill(CacheFillEnd how) {
+	if (!_cacheFiller) {
+		return;
+	}
+	_cacheFiller = false;
+	if (how == FILL_ANSWERED && CGICache::isCacheable(_response)) {
+		_cache->store(_cacheKey, _response);
+		_response.addHeader("X-Cache-Status", "MISS");
+	} else if (how == FILL_ABANDONED) {
+		_cache->abandon(_cacheKey);
+	} else {
+		_cache->pass(_cacheKey, _cacheValid);
+	}
+}
+
+// Looks a GET request up in the location's disk cache ('proxy_cache'). Returns true when it is answered
+// from the cache; on a miss the zone and key are kept, so the response is stored while it is sent.
+bool Connection::_lookupDiskCache(const LocationConfig* location) {
+	_diskCache = (_request.method == "GET" && !_receivingCgiBody) ? DiskCache::forLocation(location) : NULL;
+	if (!_diskCache) {
+		return false;
+	}
+	_diskCacheKey = CGICache::buildKey(location->proxyCacheKey, _request);
+	_diskCacheValid = location->proxyCacheValid;
+	if (!_diskCache->lookup(_diskCacheKey, _response)) {
+		return false;
+	}
+	setState(WRITING);
+	return true;
+}
+
+// Starts storing the response whose headers are in _response, if it was a disk cache miss and the
+// response allows it (status, Cache-Control, Expires). One that is not stored is sent as a BYPASS.
+void Connection::_beginDiskCacheFill() {
+	if (!_diskCache || _diskFill) {
+		return;
+	}
+	_diskFill = _diskCache->beginFill(_diskCacheKey, _response, _diskCacheValid);
+	_response.addHeader("X-Cache-Status", _diskFill ? "MISS" : "BYPASS");
+}
+
+// Publishes the stored response once it is complete, or drops it.
+void Connection::_endDiskCacheFill(bool commit) {
+	if (!_diskFill) {
+		return;
+	}
+	if (commit) {
+		_diskCache->commit(_diskFill);
+	} else {
+		_diskCache->abandon(_diskFill);
+	}
+	_diskFill = NULL;
+}
+
 // Initiates the CGI process for the current request.
 void Connection::executeCGI() {
 	// Fix: Declared as const ServerConfig* to match getServerBlock() return type
@@ -178,13 +444,14 @@ void Connection::executeCGI() {
 		std::cerr << "ERROR: Connection::executeCGI: currentServerConfig is NULL for FD: " << getSocketFD() << ". Cannot execute CGI." << std::endl;
 		HttpRequestHandler handler;
 		_response = handler._generateErrorResponse(500, NULL, NULL);
+		_endCacheFill(FILL_ANSWERED);
 		setState(WRITING);
 		return;
 	}
 
 	MatchedConfig matchedConfig;
 	matchedConfig.server_config = currentServerConfig;
-	matchedConfig.location_config = RequestDispatcher::findMatchingLocation(_request, *currentServerConfig);
+	matchedConfig.location_config = _matchLocation();
 
 	// Fix: Pass _server (Server*) to CGIHandler constructor
 	_cgiHandler = new CGIHandler(_request, matchedConfig.server_config, matchedConfig.location_config, _server);
@@ -193,28 +460,167 @@ void Connection::executeCGI() {
 		std::cerr << "ERROR: CGIHandler failed to initialize (e.g., pipes, fork setup) for FD: " << getSocketFD() << std::endl;
 		HttpRequestHandler handler;
 		_response = handler._generateErrorResponse(500, matchedConfig.server_config, matchedConfig.location_config);
+		_endCacheFill(FILL_ANSWERED);
 		setState(WRITING);
 		delete _cgiHandler; // Clean up the failed handler
 		_cgiHandler = NULL;
 		return;
 	}
 
-	// The start() method will create pipes, fork, and execve.
+	if (_receivingCgiBody) {
+		// Whatever part of the body came with the headers is queued before start(), so a body that is
+		// already complete still reaches the script with its CONTENT_LENGTH.
+		_cgiHandler->setStreamingInput();
+		_feedCgiBody();
+	}
+	_launchCGI(matchedConfig);
+}
+
+// Hands the body bytes parsed so far to the CGI, and closes its input once the body is complete.
+void Connection::_feedCgiBody() {
+	if (!_cgiHandler) {
+		return;
+	}
+	_parser.drainBody(_cgiBodyChunk);
+	if (!_cgiBodyChunk.empty()) {
+		_cgiHandler->appendInput(&_cgiBodyChunk[0], _cgiBodyChunk.size());
+	}
+	if (_parser.isComplete()) {
+		_cgiHandler->endInput();
+		_receivingCgiBody = false;
+		if (_cgiHandler->getState() == CGIState::SPOOLING_INPUT) {
+			// The body was collected into a memfd: the script can start now.
+			MatchedConfig matchedConfig;
+			matchedConfig.server_config = this->getServerBlock();
+			matchedConfig.location_config = _matchLocation();
+			_launchCGI(matchedConfig);
+			return;
+		}
+	}
+	if (_state == HANDLING_CGI) {
+		_updateCgiSocketEvents();
+	}
+}
+
+// The request body broke off (client gone, or malformed chunking) while the CGI was being fed.
+// Before any response byte is out the client gets a 400; otherwise the streamed response is cut short.
+void Connection::_abortCgiBody() {
+	_receivingCgiBody = false;
+	if (!_cgiHandler) {
+		return;
+	}
+	if (_streaming) {
+		_cgiHandler->setState(CGIState::CGI_PROCESS_ERROR);
+		finalizeCGI();
+		return;
+	}
+	_cgiHandler->cleanup();
+	delete _cgiHandler;
+	_cgiHandler = NULL;
+	HttpRequestHandler handler;
+	_response = handler._generateErrorResponse(400, this->getServerBlock(), NULL); // Bad Request
+	setState(WRITING);
+}
+
+// Client socket events while the CGI runs (hangup is always watched): read while the request body is still needed and the CGI
+// input window has room (so a script that reads slowly throttles the upload), write while response
+// bytes are queued.
+void Connection::_updateCgiSocketEvents() {
+	short events = POLLRDHUP;
+	_cgiInputPaused = _receivingCgiBody && _cgiHandler && _cgiHandler->getPendingInputSize() >= CGI_INPUT_WINDOW_SIZE;
+	if (_receivingCgiBody && !_cgiInputPaused) {
+		events |= POLLIN;
+	}
+	if (_streaming && _rawResponseToSend.length() > _bytesSentFromRawResponse) {
+		events |= POLLOUT;
+	}
+	_server->updateFdEvents(getSocketFD(), events);
+}
+
+// Reads from the client again once the CGI has consumed half of a full input window.
+void Connection::pumpCgiInput() {
+	if (_cgiInputPaused && _state == HANDLING_CGI && _cgiHandler
+		&& _cgiHandler->getPendingInputSize() < CGI_INPUT_WINDOW_SIZE / 2) {
+		_updateCgiSocketEvents();
+	}
+}
+
+// The client disconnected while its CGI request was queued or running: nobody will read the answer,
+// so the script is stopped now instead of being left to run to completion.
+void Connection::abortCGI() {
+	_endCacheFill(FILL_ABANDONED);
+	_endDiskCacheFill(false);
+	_waitingForCache = false;
+	if (_cgiHandler) {
+		_cgiHandler->abort();
+		delete _cgiHandler;
+		_cgiHandler = NULL;
+	}
+	_receivingCgiBody = false;
+	_cgiInputPaused = false;
+	setState(CLOSING);
+}
+
+// Retries a request that was queued for a pooled CGI worker, a concurrency slot or another request's
+// cache fill. Returns false while it is still waiting.
+bool Connection::resumeQueuedCGI() {
+	if (!isWaitingForCgiWorker()) {
+		return true;
+	}
+	MatchedConfig matchedConfig;
+	matchedConfig.server_config = this->getServerBlock();
+	matchedConfig.location_config = _matchLocation();
+
+	if (_waitingForCache) {
+		if (time(NULL) - _cacheWaitSince < CGI_TIMEOUT_SECONDS && _lookupCgiCache(matchedConfig.location_config)) {
+			return !_waitingForCache;
+		}
+		// The fill was abandoned (this request now fills the key) or takes too long (run uncached).
+		if (_waitingForCache) {
+			_waitingForCache = false;
+			_cache = NULL;
+		}
+		executeCGI(); // Queues itself anew if it has to wait for a worker or slot
+		return true;
+	}
+
+	_launchCGI(matchedConfig);
+	return !isWaitingForCgiWorker();
+}
+
+// Starts the CGI (spawned process, FastCGI backend or pooled worker) and registers its fds with the poll loop.
+void Connection::_launchCGI(const MatchedConfig& matchedConfig) {
+	bool wasQueued = isWaitingForCgiWorker();
+
+	// The start() method will create pipes and spawn the CGI process.
 	// It should also set pipe FDs to non-blocking.
 	if (!_cgiHandler->start()) {
-		std::cerr << "ERROR: CGI process failed to start (fork/pipe error) for FD: " << getSocketFD() << std::endl;
-		HttpRequestHandler handler;
-		_response = handler._generateErrorResponse(500, matchedConfig.server_config, matchedConfig.location_config);
+		std::cerr << "ERROR: CGI process failed to start (spawn/pipe error or no capacity) for FD: " << getSocketFD() << std::endl;
+		_setCgiErrorResponse(matchedConfig.server_config, matchedConfig.location_config);
+		_endCacheFill(FILL_ANSWERED);
 		setState(WRITING);
 		delete _cgiHandler;
 		_cgiHandler = NULL;
 	} else {
-		// Immediately update client socket to stop polling for its events while CGI runs
-		_server->updateFdEvents(getSocketFD(), 0); // Stop polling client FD
+		if (_cgiHandler->getState() == CGIState::QUEUED) {
+			// All pooled workers or concurrency slots are busy: the Server starts it when one is released.
+			if (!wasQueued) {
+				_updateCgiSocketEvents();
+				_server->queueCgiRequest(getSocketFD());
+			}
+			return;
+		}
+		if (_cgiHandler->getState() == CGIState::SPOOLING_INPUT) {
+			_updateCgiSocketEvents(); // Only the client socket, for the rest of the body.
+			return;
+		}
+
+		// The client socket is only polled while CGI runs to read a streamed request body
+		_updateCgiSocketEvents();
 
 		int cgiReadFd = _cgiHandler->getReadFd();
 		if (cgiReadFd != -1) {
-			_server->registerCgiFd(cgiReadFd, this, POLLIN); // Register CGI stdout (read end) for reading
+			_server->registerCgiFd(cgiReadFd, this, _cgiHandler->getReadEvents()); // Register CGI stdout (read end) for reading
 		} else {
 			std::cerr << "ERROR: CGI Read FD is invalid (start() succeeded but getReadFd() returned -1). Generating 500." << std::endl;
 			_cgiHandler->setState(CGIState::CGI_PROCESS_ERROR); // Mark CGI as errored
@@ -225,6 +631,11 @@ void Connection::executeCGI() {
 			return;
 		}
 
+		// The pidfd wakes the loop as soon as the spawned script exits.
+		if (_cgiHandler->getProcessFd() != -1) {
+			_server->registerCgiFd(_cgiHandler->getProcessFd(), this, POLLIN);
+		}
+
 		// Only register write pipe if there's a body to send (POST/PUT requests)
 		// CGIHandler's state should indicate if it's expecting to write input
 		if (_cgiHandler->getState() == CGIState::WRITING_INPUT) {
@@ -244,17 +655,219 @@ void Connection::executeCGI() {
 	}
 }
 
+// Forwards the request to the location's upstream. The response is streamed back as it arrives.
+void Connection::_startProxy(const MatchedConfig& matchedConfig) {
+	_proxyHandler = new ProxyHandler(_request, matchedConfig.location_config, _server, this);
+	setState(PROXYING);
+	if (!_proxyHandler->start()) {
+		finalizeProxy(); // No server could be reached: 502.
+	}
+}
+
+// Drives the proxied request on upstream socket events: the response headers go out as soon as they
+// are parsed, then body bytes as they arrive.
+void Connection::handleProxyEvent(short revents) {
+	_proxyHandler->handleEvent(revents);
+	if (!_streaming && _proxyHandler->hasParsedHeaders()) {
+		_response = _proxyHandler->getHttpResponse();
+		_streamResponseHeaders();
+	}
+	if (_streaming) {
+		_queueBody(_proxyHandler->getBodyBuffer());
+	}
+	if (_proxyHandler->isFinished()) {
+		finalizeProxy();
+	}
+}
+
+// Ends the proxied request. Before any response byte is out a failure becomes an error response
+// (502, or 504 on timeout); past that point it can only cut the response short.
+void Connection::finalizeProxy() {
+	if (_streaming) {
+		if (_proxyHandler->getState() == ProxyState::COMPLETE) {
+			_queueBody(_proxyHandler->getBodyBuffer());
+			if (_response.isChunked()) {
+				HttpResponse::appendLastChunk(_rawResponseToSend);
+			}
+		} else {
+			std::cerr << "ERROR: Proxied response for FD " << getSocketFD() << " failed mid-stream. Closing after sent data." << std::endl;
+			_keepAlive = false;
+		}
+	} else {
+		HttpRequestHandler handler;
+		_response = handler._generateErrorResponse(_proxyHandler->getErrorStatus(), this->getServerBlock(), NULL);
+	}
+	_endDiskCacheFill(_streaming && _proxyHandler->getState() == ProxyState::COMPLETE);
+	delete _proxyHandler; // Pools or closes the upstream socket.
+	_proxyHandler = NULL;
+	_cgiOutputPaused = false;
+	setState(WRITING);
+}
+
+// The client disconnected while its request was proxied: the upstream connection is closed, as the
+// rest of the response would go nowhere.
+void Connection::abortProxy() {
+	_endDiskCacheFill(false);
+	delete _proxyHandler;
+	_proxyHandler = NULL;
+	setState(CLOSING);
+}
+
+// Called when everything queued so far has been sent.
+void Connection::_onSendBufferDrained() {
+	if (_streaming && (_state == HANDLING_CGI || _state == PROXYING)) {
+		// The CGI or upstream is still producing: stop polling for POLLOUT until more body data is queued.
+		_rawResponseToSend.clear();
+		_bytesSentFromRawResponse = 0;
+		_updateCgiSocketEvents();
+		_resumeCgiOutput();
+		return;
+	}
+	std::cout << "Response sent completely on FD: " << getSocketFD() << std::endl;
+	_resetForNextRequest(); // Response fully sent, prepare for next request
+}
+
+// Forwards CGI output that arrived since the last call. Streaming starts as soon as the headers are
+// known and the script is still producing, so its first bytes reach the client without waiting for exit.
+// Output already complete is left to finalizeCGI() and sent with a Content-Length.
+void Connection::pumpCgiOutput() {
+	if (!_cgiHandler || !_cgiHandler->hasParsedHeaders() || _cgiHandler->getState() == CGIState::CGI_PROCESS_ERROR) {
+		return;
+	}
+	if (!_streaming) {
+		if (_cgiHandler->isOutputComplete()) {
+			return;
+		}
+		// A cache fill keeps the whole response for storing, unless it grows past what an entry may hold.
+		if (_cacheFiller && _cgiHandler->getBodyBuffer().size() <= _cache->maxEntrySize()) {
+			return;
+		}
+		_endCacheFill(FILL_UNCACHEABLE);
+		_startStreaming();
+	}
+	_queueBody(_cgiHandler->getBodyBuffer());
+}
+
+// Sends the CGI response headers ahead of the body.
+void Connection::_startStreaming() {
+	_cgiHandler->setStreaming();
+	_response = _cgiHandler->getHttpResponse();
+	_streamResponseHeaders();
+}
+
+// Queues the headers of a response whose body follows as it is produced. Without a Content-Length,
+// HTTP/1.1 clients get a chunked body; HTTP/1.0 clients get the raw body delimited by connection close.
+void Connection::_streamResponseHeaders() {
+	_beginDiskCacheFill();
+	if (!_response.hasHeader("Content-Length") && _request.protocolVersion == "HTTP/1.1") {
+		_response.setChunked();
+	}
+	_applyConnectionHeaders();
+	_rawResponseToSend = _response.headersToString();
+	_bytesSentFromRawResponse = 0;
+	_responseStarted = true;
+	_streaming = true;
+	_updateCgiSocketEvents();
+}
+
+// Moves the body bytes received so far (CGI output or upstream response) into the send buffer, framed
+// as a chunk if needed.
+void Connection::_queueBody(std::vector<char>& body) {
+	if (body.empty()) {
+		return;
+	}
+	if (_diskFill) {
+		_diskCache->append(_diskFill, &body[0], body.size());
+	}
+	if (_bytesSentFromRawResponse > 0) {
+		_rawResponseToSend.erase(0, _bytesSentFromRawResponse);
+		_bytesSentFromRawResponse = 0;
+	}
+	if (_response.isChunked()) {
+		HttpResponse::appendChunk(_rawResponseToSend, &body[0], body.size());
+	} else {
+		_rawResponseToSend.append(body.begin(), body.end());
+	}
+	body.clear();
+	if (_state == HANDLING_CGI || _state == PROXYING) {
+		_updateCgiSocketEvents();
+	}
+	if (_rawResponseToSend.length() - _bytesSentFromRawResponse >= SEND_WINDOW_SIZE) {
+		_pauseCgiOutput();
+	}
+}
+
+// Backpressure: stop reading CGI stdout (or the upstream socket) while the client is slower than the
+// producer. The script then blocks on its full pipe, the upstream on its full socket, instead of
+// growing our buffers.
+void Connection::_pauseCgiOutput() {
+	if (!_cgiOutputPaused && _proxyHandler && _proxyHandler->getFd() != -1) {
+		_server->suspendFd(_proxyHandler->getFd());
+		_proxyHandler->setOutputPaused(true);
+		_cgiOutputPaused = true;
+		return;
+	}
+	if (_cgiOutputPaused || !_cgiHandler || _cgiHandler->getReadFd() == -1) {
+		return;
+	}
+	_server->suspendFd(_cgiHandler->getReadFd());
+	_cgiHandler->setOutputPaused(true);
+	_cgiOutputPaused = true;
+}
+
+// Resumes reading CGI stdout (or the upstream socket) once the send window has drained.
+void Connection::_resumeCgiOutput() {
+	if (!_cgiOutputPaused) {
+		return;
+	}
+	_cgiOutputPaused = false;
+	if (_proxyHandler && _proxyHandler->getFd() != -1) {
+		_server->resumeFd(_proxyHandler->getFd(), POLLIN);
+		_proxyHandler->setOutputPaused(false);
+	}
+	if (_cgiHandler && _cgiHandler->getReadFd() != -1) {
+		_server->resumeFd(_cgiHandler->getReadFd(), _cgiHandler->getReadEvents());
+		_cgiHandler->setOutputPaused(false);
+	}
+}
+
 // Finalizes CGI handling and prepares the response.
 void Connection::finalizeCGI() {
+	if (_cgiHandler && _streaming) {
+		if (_cgiHandler->getState() == CGIState::COMPLETE) {
+			_queueBody(_cgiHandler->getBodyBuffer());
+			if (_response.isChunked()) {
+				HttpResponse::appendLastChunk(_rawResponseToSend);
+			}
+		} else {
+			// Headers are already out, so the failure can only be signalled by cutting the body short.
+			std::cerr << "ERROR: CGI for FD " << getSocketFD() << " failed mid-stream (state: " << _cgiHandler->getState() << "). Closing after sent data." << std::endl;
+			_keepAlive = false;
+		}
+		_endDiskCacheFill(_cgiHandler->getState() == CGIState::COMPLETE);
+		_cgiHandler->cleanup();
+		delete _cgiHandler;
+		_cgiHandler = NULL;
+		setState(WRITING);
+		return;
+	}
 	if (_cgiHandler) {
 		// Get the response generated by the CGIHandler (includes parsing CGI headers)
 		_response = _cgiHandler->getHttpResponse();
 
 		if (_cgiHandler->getState() != CGIState::COMPLETE) {
-			std::cerr << "ERROR: CGI for FD " << getSocketFD() << " did not finish successfully (state: " << _cgiHandler->getState() << "). Generating 500 response." << std::endl;
-			HttpRequestHandler handler;
+			std::cerr << "ERROR: CGI for FD " << getSocketFD() << " did not finish successfully (state: " << _cgiHandler->getState() << "). Generating " << _cgiHandler->getErrorStatus() << " response." << std::endl;
 			// Use _server_block (which is `const ServerConfig*`) for error response
-			_response = handler._generateErrorResponse(500, this->getServerBlock(), NULL);
+			_setCgiErrorResponse(this->getServerBlock(), NULL);
+		}
+		_endCacheFill(FILL_ANSWERED);
+		if (_cgiHandler->getState() == CGIState::COMPLETE && _diskCache) {
+			// The output was complete before streaming started: stored in one go.
+			_beginDiskCacheFill();
+			if (_diskFill && !_response.getBody().empty()) {
+				_diskCache->append(_diskFill, &_response.getBody()[0], _response.getBody().size());
+			}
+			_endDiskCacheFill(true);
 		}
 
 		_cgiHandler->cleanup(); // CGIHandler's cleanup method handles process reaping and FD closure
@@ -273,6 +886,43 @@ void Connection::finalizeCGI() {
 	}
 }
 
+// Error response for a CGI that failed or could not run. A 503 (no worker or slot within the
+// queue limits) tells the client when to retry.
+void Connection::_setCgiErrorResponse(const ServerConfig* serverConfig, const LocationConfig* locationConfig) {
+	HttpRequestHandler handler;
+	int status = _cgiHandler->getErrorStatus();
+	_response = handler._generateErrorResponse(status, serverConfig, locationConfig);
+	if (status == 503) {
+		_response.addHeader("Retry-After", StringUtils::longToString(_cgiHandler->getRetryAfter()));
+	}
+}
+
+// Decides whether the connection persists after this response and sets the matching headers.
+// Keep-alive requires a fully parsed request asking for it and room left under 'keepalive_requests', outside a graceful stop.
+void Connection::_applyConnectionHeaders() {
+	const ServerConfig* serverConfig = this->getServerBlock();
+
+	_keepAlive = _parser.isComplete() && _request.wantsKeepAlive() && serverConfig
+		&& serverConfig->keepaliveTimeout > 0 && _requestsServed + 1 < serverConfig->keepaliveRequests
+		&& !_server->isDraining();
+
+	// A body that is neither chunked nor length-delimited ends when the connection closes.
+	if (!_response.isChunked() && !_response.hasHeader("Content-Length")) {
+		_keepAlive = false;
+	}
+
+	if (!_keepAlive) {
+		_response.addHeader("Connection", "close");
+		return;
+	}
+	_response.addHeader("Connection", "keep-alive");
+	if (_request.protocolVersion == "HTTP/1.0") {
+		// HTTP/1.0 clients only learn the persistence limits through this header.
+		_response.addHeader("Keep-Alive", "timeout=" + StringUtils::longToString(serverConfig->keepaliveTimeout)
+			+ ", max=" + StringUtils::longToString(serverConfig->keepaliveRequests - _requestsServed - 1));
+	}
+}
+
 // Reset connection for a new request (e.g., for keep-alive)
 void Connection::_resetForNextRequest() {
 	_parser.reset();
@@ -282,11 +932,37 @@ void Connection::_resetForNextRequest() {
 	_rawResponseToSend.clear(); // Clear raw response
 	_bytesSentFromRawResponse = 0; // Reset byte counter
 	_isCgiRequest = false;
+	_location = NULL;
+	_locationMatched = false;
+	_streaming = false;
+	_receivingCgiBody = false;
+	_cgiInputPaused = false;
+	_endCacheFill(FILL_ABANDONED);
+	_waitingForCache = false;
+	_cache = NULL;
+	_endDiskCacheFill(false);
+	_diskCache = NULL;
+	delete _bodySource;
+	_bodySource = NULL;
+	delete _proxyHandler;
+	_proxyHandler = NULL;
+	_responseStarted = false;
+	_cgiOutputPaused = false;
 	if (_cgiHandler) { // Double check, if for some reason it's not NULL (e.g., error path)
 		_cgiHandler->cleanup(); // Ensure FDs are cleaned up if not already
 		delete _cgiHandler;
 		_cgiHandler = NULL;
 	}
+	_adoptCurrentConfig();
+	if (getVirtualHosts()) {
+		setServerBlock(getVirtualHosts()->defaultServer()); // Until the next Host header is in.
+	}
+	++_requestsServed;
+	_lastActivity = time(NULL);
+	if (!_keepAlive) {
+		setState(CLOSING); // Client asked to close, HTTP/1.0 without keep-alive, or request limit reached.
+		return;
+	}
 	setState(READING); // Transition back to reading
 }
 
@@ -307,6 +983,15 @@ Connection::ConnectionState Connection::getState() const {
 	return _state;
 }
 
+// Binds a new connection to 'config', for the server blocks listening on 'address'.
+void Connection::attachConfig(ConfigSnapshot* config, const ListenAddress& address) {
+	config->acquire();
+	_config = config;
+	_listenAddress = address;
+	setVirtualHosts(config->getVirtualHosts(address));
+	setServerBlock(getVirtualHosts()->defaultServer());
+}
+
 // Sets the state of the connection.
 void Connection::setState(ConnectionState state) {
 	_state = state;
@@ -316,7 +1001,9 @@ void Connection::setState(ConnectionState state) {
 		events = POLLIN;
 	} else if (state == WRITING) {
 		events = POLLOUT;
-	} else if (state == CLOSING || state == HANDLING_CGI) {
+	} else if (state == HANDLING_CGI || state == PROXYING) {
+		events = POLLRDHUP; // Only watch for the client going away while the CGI or upstream runs
+	} else if (state == CLOSING) {
 		events = 0;
 	}
 	// Update poll events for the client socket FD
@@ -333,6 +1020,51 @@ CGIHandler* Connection::getCgiHandler() const {
 	return _cgiHandler;
 }
 
+// Returns the handler of the proxied request, NULL when none is in progress.
+ProxyHandler* Connection::getProxyHandler() const {
+	return _proxyHandler;
+}
+
+// Checks if the connection has been waiting for a new request longer than the server allows.
+bool Connection::isIdleExpired(time_t now) {
+	if (!isIdle()) {
+		return false;
+	}
+	const ServerConfig* serverConfig = this->getServerBlock();
+	long timeout = (serverConfig && serverConfig->keepaliveTimeout > 0) ? serverConfig->keepaliveTimeout : CLIENT_IDLE_TIMEOUT_SECONDS;
+	return now - _lastActivity >= timeout;
+}
+
+// Checks if a request started arriving, then stalled for as long as an idle connection is allowed.
+bool Connection::isRequestExpired(time_t now) {
+	if (_state != READING || _parser.isIdle() || _parser.isComplete()) {
+		return false;
+	}
+	const ServerConfig* serverConfig = this->getServerBlock();
+	long timeout = (serverConfig && serverConfig->keepaliveTimeout > 0) ? serverConfig->keepaliveTimeout : CLIENT_IDLE_TIMEOUT_SECONDS;
+	return now - _lastActivity >= timeout;
+}
+
+// Checks if the connection waits for a next request, none of which has arrived yet.
+bool Connection::isIdle() const {
+	return _state == READING && _parser.isIdle();
+}
+
+// Checks if a CGI response is being forwarded while the script still runs.
+bool Connection::isStreaming() const {
+	return _streaming;
+}
+
+// Tells whether the client socket is still read for a request body that is fed to a running CGI.
+bool Connection::isReceivingRequestBody() const {
+	return _receivingCgiBody && _state == HANDLING_CGI;
+}
+
 bool Connection::hasActiveCGI() const {
 	return _cgiHandler != NULL && !_cgiHandler->isFinished();
 }
+
+// Tells whether the current CGI request is queued for a pooled worker, a concurrency slot or a cache fill.
+bool Connection::isWaitingForCgiWorker() const {
+	return _waitingForCache || (_cgiHandler != NULL && _cgiHandler->getState() == CGIState::QUEUED);
+}
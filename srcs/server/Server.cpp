@@ -3,19 +3,41 @@
 #include "../../includes/server/Connection.hpp"
 #include "../../includes/webserv.hpp" // For POLL_TIMEOUT_MS, BUFF_SIZE, etc.
 #include "../../includes/http/HttpRequestHandler.hpp" // For error responses
+#include "../../includes/http/DiskCache.hpp" // For the cache manager pass
+#include "../../includes/http/MimeTypes.hpp"
+#include "../../includes/http/CGICache.hpp"
+#include "../../includes/http/Upstream.hpp"
 #include "../../includes/utils/StringUtils.hpp" // For StringUtils::longToString
 
 #include <iostream> // For std::cerr, std::cout
 #include <unistd.h> // For close()
 #include <algorithm> // For std::find, std::remove
 #include <cstring> // For strerror
-
-// Constructor: Initializes the server with configurations.
-Server::Server(const std::vector<ServerConfig>& configs)
-	: _serverConfigs(configs),
+#include <ctime> // For time() (keep-alive idle tracking)
+#include <cerrno> // For EINTR
+#include <cstdlib> // For getenv, unsetenv
+#include <csignal> // For kill
+#include <fcntl.h> // For fcntl (binary upgrade)
+#include <spawn.h> // For posix_spawnp (binary upgrade)
+#include <sys/wait.h> // For waitpid
+
+extern char**	environ;
+
+// Constructor: Initializes the server with configurations (taken over, left empty).
+Server::Server(std::vector<ServerConfig>& configs, const std::string& configPath, const std::string& executable)
+	: _executable(executable),
+	  _configPath(configPath),
+	  _config(new ConfigSnapshot(configs)),
 	  _running(false),
-	  _timeout_ms(POLL_TIMEOUT_MS)
-{}
+	  _timeout_ms(POLL_TIMEOUT_MS),
+	  _dispatching(false),
+	  _pollListHasHoles(false),
+	  _upgradePid(0),
+	  _previousPid(0),
+	  _draining(false), _drainDeadline(0)
+{
+	_config->acquire();
+}
 
 // Destructor: Cleans up all connections and poll file descriptors.
 Server::~Server() {
@@ -34,43 +56,311 @@ Server::~Server() {
 		delete it->second;
 	}
 	_listenSockets.clear();
+	_listenAddresses.clear();
 
 	_pfds.clear();
 	_cgiFdsToConnection.clear();
+	_proxyFdsToConnection.clear();
+	_config->release(); // After the connections, which held it too.
+}
+
+// Applies the process-wide parts of a loaded configuration: the disk cache zones, the MIME types and
+// the upstream groups. The cache zones go first, as they are the only part that can fail (throws).
+void Server::applySharedConfig(const ConfigLoader& loader, const std::vector<ServerConfig>& servers) {
+	DiskCache::configure(loader.getCachePaths());
+	if (!loader.getMimeTypes().empty()) {
+		MimeTypes::instance().load(loader.getMimeTypes());
+	} else {
+		MimeTypes::instance().loadDefaults();
+	}
+	Upstream::configure(loader.getUpstreams());
+	CGICache::configure(servers);
 }
 
-// Sets up listener sockets based on server configurations.
+// Sets up one listening socket per (address, port) of the server blocks. An address of a port that
+// also has a wildcard ("0.0.0.0") listener cannot be bound next to it: it shares the wildcard socket,
+// and its connections are told apart by their local address (see _listenAddressFor).
+// Sockets handed over by a previous binary or a service manager are used as they are, not bound again.
 bool Server::_setupListeners() {
 	bool success = true;
-	for (std::vector<ServerConfig>::const_iterator it = _serverConfigs.begin(); it != _serverConfigs.end(); ++it) {
-		bool port_already_listening = false;
-		// Check if this port is already being listened on by another server block
-		for (std::map<int, Socket*>::const_iterator ls_it = _listenSockets.begin(); ls_it != _listenSockets.end(); ++ls_it) {
-			// Compare by port number, assuming unique listener per port
-			if (ls_it->second->getPort() == static_cast<int>(it->port)) { // Cast to int for comparison
-				port_already_listening = true;
-				break;
-			}
+	std::map<ListenAddress, Socket*> inherited = _inheritedListeners();
+	std::vector<ListenAddress> addresses = _config->getListenAddresses();
+	for (size_t i = 0; i < addresses.size(); ++i) {
+		std::map<ListenAddress, Socket*>::iterator it = inherited.find(addresses[i]);
+		if (it != inherited.end()) {
+			_addListener(it->second, addresses[i]);
+			inherited.erase(it);
+		} else if (_openListener(addresses[i]) < 0) {
+			success = false;
 		}
+	}
+	// Addresses the configuration no longer listens on.
+	for (std::map<ListenAddress, Socket*>::iterator it = inherited.begin(); it != inherited.end(); ++it) {
+		delete it->second;
+	}
+	return success;
+}
 
-		if (port_already_listening) {
-			continue;
+// Listening sockets handed over at startup, by address: by the previous binary on an upgrade (fds
+// listed in WEBSERV_LISTEN_FDS, see _upgrade), or by a service manager doing socket activation
+// (LISTEN_FDS sockets from fd 3, when LISTEN_PID is this process). The variables are cleared so that
+// nothing started later takes them for its own.
+std::map<ListenAddress, Socket*> Server::_inheritedListeners() {
+	std::vector<int> fds;
+	const char* upgrade = getenv("WEBSERV_LISTEN_FDS");
+	const char* count = getenv("LISTEN_FDS");
+	const char* pid = getenv("LISTEN_PID");
+	if (upgrade) {
+		for (const char* p = upgrade; *p; ++p) {
+			if (std::isdigit(static_cast<unsigned char>(*p)) && (p == upgrade || p[-1] == ';')) {
+				fds.push_back(std::atoi(p));
+			}
+		}
+		_previousPid = getppid();
+	} else if (count && pid && std::atol(pid) == static_cast<long>(getpid())) {
+		for (int i = 0; i < std::atoi(count); ++i) {
+			fds.push_back(LISTEN_FDS_START + i);
 		}
+	}
+	unsetenv("WEBSERV_LISTEN_FDS");
+	unsetenv("LISTEN_FDS");
+	unsetenv("LISTEN_PID");
+	unsetenv("LISTEN_FDNAMES");
 
+	std::map<ListenAddress, Socket*> sockets;
+	for (size_t i = 0; i < fds.size(); ++i) {
 		Socket* listenSocket = new Socket();
-		// initListenSocket returns true on success, false on failure
-		if (!listenSocket->initListenSocket(StringUtils::longToString(it->port).c_str())) {
-			std::cerr << "Failed to initialize listen socket on port " << it->port << std::endl;
+		ListenAddress address;
+		if (!listenSocket->adoptListenSocket(fds[i])) {
+			std::cerr << "Inherited fd " << fds[i] << " is not a listening socket. Ignored." << std::endl;
+			delete listenSocket;
+			continue;
+		}
+		if (!Socket::localAddress(fds[i], address.first, address.second) || sockets.count(address)) {
 			delete listenSocket;
-			success = false;
 			continue;
 		}
-		listenSocket->setServerBlock(&(*it)); // This line is correct now due to const correctness fix
-		_listenSockets[listenSocket->getSocketFD()] = listenSocket;
-		_addFdToPoll(listenSocket->getSocketFD(), POLLIN);
-		std::cout << "listen socket : " << listenSocket->getSocketFD() << std::endl;
+		sockets[address] = listenSocket;
+	}
+	return sockets;
+}
+
+// Binds a listening socket for 'address' and starts polling it. Returns its fd, -1 on failure.
+int Server::_openListener(const ListenAddress& address) {
+	bool wildcard = (address.first == "0.0.0.0");
+	Socket* listenSocket = new Socket();
+	// initListenSocket returns true on success, false on failure
+	if (!listenSocket->initListenSocket(StringUtils::longToString(address.second).c_str(), wildcard ? NULL : address.first.c_str())) {
+		std::cerr << "Failed to initialize listen socket on " << address.first << ":" << address.second << std::endl;
+		delete listenSocket;
+		return -1;
+	}
+	return _addListener(listenSocket, address);
+}
+
+// Accepts connections for 'address' on a listening socket (which the server now owns). Returns its fd.
+int Server::_addListener(Socket* listenSocket, const ListenAddress& address) {
+	_listenSockets[listenSocket->getSocketFD()] = listenSocket;
+	_listenAddresses[listenSocket->getSocketFD()] = address;
+	_addFdToPoll(listenSocket->getSocketFD(), POLLIN);
+	std::cout << "listen socket : " << listenSocket->getSocketFD() << std::endl;
+	return listenSocket->getSocketFD();
+}
+
+// Stops listening on 'listen_fd'. Connections it accepted are not affected.
+void Server::_closeListener(int listen_fd) {
+	std::map<int, Socket*>::iterator it = _listenSockets.find(listen_fd);
+	if (it == _listenSockets.end()) {
+		return;
+	}
+	std::cout << "Closing listen socket FD: " << listen_fd << std::endl;
+	_removeFdFromPoll(listen_fd);
+	delete it->second;
+	_listenSockets.erase(it);
+	_listenAddresses.erase(listen_fd);
+}
+
+// Re-reads the configuration file (SIGHUP). A file that no longer loads, or listeners that cannot be
+// bound, leave the current configuration in place, listeners included. Otherwise the new one becomes current: listeners
+// it dropped are closed and new ones opened. Requests in progress finish on the configuration they
+// started on; each connection moves to the new one at its next request (see Connection::handleRead).
+void Server::_reload() {
+	if (_upgradePid > 0 || _draining) {
+		std::cerr << "Reload ignored: a binary upgrade is in progress." << std::endl;
+		return;
+	}
+	std::cout << "Reloading configuration from " << _configPath << std::endl;
+	ConfigSnapshot* next = NULL;
+	ConfigLoader loader;
+	try {
+		std::vector<ServerConfig> servers = loader.loadFile(_configPath);
+		next = new ConfigSnapshot(servers);
+	} catch (const std::exception& e) {
+		std::cerr << "Reload failed, keeping the current configuration: " << e.what() << std::endl;
+		return;
+	}
+	next->acquire();
+
+	// Listeners to close: those the new configuration no longer has.
+	std::vector<ListenAddress> addresses = next->getListenAddresses();
+	std::vector<int> dropped;
+	for (std::map<int, ListenAddress>::iterator it = _listenAddresses.begin(); it != _listenAddresses.end(); ++it) {
+		if (std::find(addresses.begin(), addresses.end(), it->second) == addresses.end()) {
+			dropped.push_back(it->first);
+		}
+	}
+	// Listeners to open. A new address may conflict with one being dropped on the same port (a specific
+	// address replaced by the wildcard, say). Those are opened last, once every other bind succeeded,
+	// by closing the dropped listeners of their port first; if the reload fails after all, the closed
+	// listeners are opened again.
+	std::vector<int> opened;
+	std::vector<ListenAddress> conflicting;
+	std::vector<ListenAddress> closedEarly;
+	bool failed = false;
+	for (size_t i = 0; i < addresses.size() && !failed; ++i) {
+		bool listening = false;
+		bool droppedOnPort = false;
+		for (std::map<int, ListenAddress>::iterator it = _listenAddresses.begin(); it != _listenAddresses.end(); ++it) {
+			listening = listening || it->second == addresses[i];
+			droppedOnPort = droppedOnPort || (it->second.second == addresses[i].second
+				&& std::find(dropped.begin(), dropped.end(), it->first) != dropped.end());
+		}
+		if (listening) {
+			continue;
+		}
+		int fd = _openListener(addresses[i]);
+		if (fd >= 0) {
+			opened.push_back(fd);
+		} else if (droppedOnPort) {
+			conflicting.push_back(addresses[i]);
+		} else {
+			failed = true;
+		}
+	}
+	for (size_t i = 0; i < conflicting.size() && !failed; ++i) {
+		// Closed fds leave 'dropped' right away: the new listener may be given the same number.
+		for (size_t j = 0; j < dropped.size(); ) {
+			if (_listenAddresses[dropped[j]].second == conflicting[i].second) {
+				closedEarly.push_back(_listenAddresses[dropped[j]]);
+				_closeListener(dropped[j]);
+				dropped.erase(dropped.begin() + j);
+			} else {
+				++j;
+			}
+		}
+		int fd = _openListener(conflicting[i]);
+		if (fd < 0) {
+			failed = true;
+		} else {
+			opened.push_back(fd);
+		}
+	}
+	if (!failed) {
+		try {
+			applySharedConfig(loader, next->getServers());
+		} catch (const std::exception& e) {
+			std::cerr << e.what() << std::endl;
+			failed = true;
+		}
+	}
+	if (failed) {
+		std::cerr << "Reload failed, keeping the current configuration." << std::endl;
+		for (size_t i = 0; i < opened.size(); ++i) {
+			_closeListener(opened[i]);
+		}
+		for (size_t i = 0; i < closedEarly.size(); ++i) {
+			if (_openListener(closedEarly[i]) < 0) {
+				std::cerr << "Could not listen on " << closedEarly[i].first << ":" << closedEarly[i].second
+					<< " again after the failed reload." << std::endl;
+			}
+		}
+		next->release();
+		return;
+	}
+
+	for (size_t i = 0; i < dropped.size(); ++i) {
+		_closeListener(dropped[i]);
+	}
+	_config->release();
+	_config = next;
+	std::cout << "Configuration reloaded." << std::endl;
+}
+
+// Starts the binary again (SIGUSR2), handing it the listening sockets: their fds stay open across the
+// exec and are listed in WEBSERV_LISTEN_FDS. Meanwhile this process stops accepting, so connections
+// wait in the listen backlog instead of being refused. The new binary sends SIGQUIT once it listens,
+// and this process drains (_startDraining); if it exits first, accepting resumes (_checkUpgrade).
+void Server::_upgrade() {
+	if (_upgradePid > 0 || _draining) {
+		std::cerr << "Binary upgrade ignored: one is already in progress." << std::endl;
+		return;
+	}
+	std::string variable = "WEBSERV_LISTEN_FDS=";
+	for (std::map<int, Socket*>::iterator it = _listenSockets.begin(); it != _listenSockets.end(); ++it) {
+		variable += StringUtils::longToString(it->first) + ";";
+	}
+	std::vector<char*> envp;
+	for (char** env = environ; *env; ++env) {
+		if (std::strncmp(*env, "WEBSERV_LISTEN_FDS=", 19) != 0) {
+			envp.push_back(*env);
+		}
+	}
+	envp.push_back(const_cast<char*>(variable.c_str()));
+	envp.push_back(NULL);
+	char* argv[3];
+	argv[0] = const_cast<char*>(_executable.c_str());
+	argv[1] = const_cast<char*>(_configPath.c_str());
+	argv[2] = NULL;
+
+	// The listeners are close-on-exec, so that CGI scripts don't get them: lifted for this spawn only.
+	for (std::map<int, Socket*>::iterator it = _listenSockets.begin(); it != _listenSockets.end(); ++it) {
+		fcntl(it->first, F_SETFD, 0);
+	}
+	pid_t pid = -1;
+	int spawn_res = posix_spawnp(&pid, _executable.c_str(), NULL, NULL, argv, &envp[0]);
+	for (std::map<int, Socket*>::iterator it = _listenSockets.begin(); it != _listenSockets.end(); ++it) {
+		fcntl(it->first, F_SETFD, FD_CLOEXEC);
+	}
+	if (spawn_res != 0) {
+		std::cerr << "Binary upgrade: cannot start " << _executable << ": " << strerror(spawn_res) << std::endl;
+		return;
+	}
+	std::cout << "Binary upgrade: started " << _executable << " (pid " << pid << ")." << std::endl;
+	_upgradePid = pid;
+	for (std::map<int, Socket*>::iterator it = _listenSockets.begin(); it != _listenSockets.end(); ++it) {
+		suspendFd(it->first);
+	}
+}
+
+// Reaps the new binary of an upgrade. Exiting before it took over (bad configuration, address it
+// could not bind...) means the upgrade failed: this process accepts again.
+void Server::_checkUpgrade() {
+	if (_upgradePid <= 0 || waitpid(_upgradePid, NULL, WNOHANG) != _upgradePid) {
+		return;
+	}
+	_upgradePid = 0;
+	if (_draining) {
+		return;
+	}
+	std::cerr << "Binary upgrade failed: the new binary exited. Accepting connections again." << std::endl;
+	for (std::map<int, Socket*>::iterator it = _listenSockets.begin(); it != _listenSockets.end(); ++it) {
+		resumeFd(it->first, POLLIN);
+	}
+}
+
+// Stops accepting (SIGQUIT, sent by the new binary of an upgrade once it listens): the listeners are
+// closed, idle keep-alive connections too, and the others after their current response or at the
+// DRAIN_TIMEOUT_SECONDS deadline. run() returns once none is left.
+void Server::_startDraining() {
+	if (_draining) {
+		return;
+	}
+	std::cout << "Draining: no longer accepting, " << _connections.size() << " connection(s) left." << std::endl;
+	_draining = true;
+	_drainDeadline = time(NULL) + DRAIN_TIMEOUT_SECONDS;
+	while (!_listenSockets.empty()) {
+		_closeListener(_listenSockets.begin()->first);
 	}
-	return success;
 }
 
 // Adds a file descriptor to the pollfd list.
@@ -98,7 +388,7 @@ void Server::_addFdToPoll(int fd, short events) {
 // Updates the events for an existing file descriptor in the pollfd list.
 void Server::updateFdEvents(int fd, short new_events) {
 	for (size_t i = 0; i < _pfds.size(); ++i) {
-		if (_pfds[i].fd == fd) {
+		if (_pfds[i].fd == fd || _pfds[i].fd == -fd - 1) { // Suspended entries keep their new events for resumeFd()
 			if (_pfds[i].events != new_events) {
 				_pfds[i].events = new_events;
 			}
@@ -108,17 +398,62 @@ void Server::updateFdEvents(int fd, short new_events) {
 	std::cerr << "WARNING: updateFdEvents: Attempted to update events for non-existent FD: " << fd << std::endl;
 }
 
-// Removes a file descriptor from the pollfd list.
+// Stops polling an fd without dropping it. Clearing its events is not enough: poll() always reports
+// POLLHUP/POLLERR, so a paused pipe whose writer exited would wake the loop continuously.
+// A negative fd makes poll() skip the entry.
+void Server::suspendFd(int fd) {
+	for (size_t i = 0; i < _pfds.size(); ++i) {
+		if (_pfds[i].fd == fd) {
+			_pfds[i].fd = -fd - 1;
+			_pfds[i].revents = 0;
+			return;
+		}
+	}
+}
+
+// Polls a suspended fd again, for 'events'.
+void Server::resumeFd(int fd, short events) {
+	for (size_t i = 0; i < _pfds.size(); ++i) {
+		if (_pfds[i].fd == -fd - 1 || _pfds[i].fd == fd) {
+			_pfds[i].fd = fd;
+			_pfds[i].events = events;
+			return;
+		}
+	}
+}
+
+// Removes a file descriptor from the pollfd list. While poll results are being dispatched the entry
+// is only blanked (and its pending revents dropped): erasing would shift the entries not yet visited,
+// and a closed fd number reused within the same round must not inherit the old fd's events.
 void Server::_removeFdFromPoll(int fd) {
 	for (std::vector<pollfd>::iterator it = _pfds.begin(); it != _pfds.end(); ++it) {
-		if (it->fd == fd) {
-			_pfds.erase(it);
+		if (it->fd == fd || it->fd == -fd - 1) {
+			if (_dispatching) {
+				it->fd = -1;
+				it->events = 0;
+				it->revents = 0;
+				_pollListHasHoles = true;
+			} else {
+				_pfds.erase(it);
+			}
 			return;
 		}
 	}
 	std::cerr << "WARNING: _removeFdFromPoll: Attempted to remove non-existent FD: " << fd << std::endl;
 }
 
+// Drops the entries blanked by _removeFdFromPoll() during a dispatch round.
+void Server::_compactPollList() {
+	size_t kept = 0;
+	for (size_t i = 0; i < _pfds.size(); ++i) {
+		if (_pfds[i].fd != -1) {
+			_pfds[kept++] = _pfds[i];
+		}
+	}
+	_pfds.resize(kept);
+	_pollListHasHoles = false;
+}
+
 // Registers a CGI file descriptor with its associated connection.
 void Server::registerCgiFd(int cgi_fd, Connection* conn, short events) {
 	if (cgi_fd == -1) {
@@ -133,13 +468,13 @@ void Server::registerCgiFd(int cgi_fd, Connection* conn, short events) {
 	}
 }
 
-// Unregisters a CGI file descriptor.
-void Server::unregisterCgiFd(int cgi_fd) {
+// Unregisters a CGI file descriptor. 'closeFd' is false when the fd outlives the request (pooled FastCGI socket).
+void Server::unregisterCgiFd(int cgi_fd, bool closeFd) {
 	if (_cgiFdsToConnection.count(cgi_fd)) {
 		_cgiFdsToConnection.erase(cgi_fd);
 		_removeFdFromPoll(cgi_fd);
 		// It's crucial to close the CGI FD here if it was opened by the server
-		if (cgi_fd != -1) {
+		if (cgi_fd != -1 && closeFd) {
 			int close_res = close(cgi_fd);
 			if (close_res < 0) {
 				perror("Error closing unregistered CGI FD");
@@ -150,23 +485,36 @@ void Server::unregisterCgiFd(int cgi_fd) {
 	}
 }
 
+// Registers the upstream socket of a proxied request with its connection.
+void Server::registerProxyFd(int proxy_fd, Connection* conn, short events) {
+	_proxyFdsToConnection[proxy_fd] = conn;
+	_addFdToPoll(proxy_fd, events);
+}
+
+// Stops polling an upstream socket. It is not closed here: the upstream pools or closes it.
+void Server::unregisterProxyFd(int proxy_fd) {
+	if (_proxyFdsToConnection.erase(proxy_fd)) {
+		_removeFdFromPoll(proxy_fd);
+	} else {
+		std::cerr << "WARNING: unregisterProxyFd: Attempted to unregister non-existent proxy FD " << proxy_fd << std::endl;
+	}
+}
+
 // Accepts a new client connection.
 void Server::_acceptNewConnection(int listen_fd) {
-	ServerConfig* associatedConfig = NULL;
-	// Find the associated ServerConfig for this listening socket
-	if (_listenSockets.count(listen_fd)) {
-		associatedConfig = const_cast<ServerConfig*>(_listenSockets[listen_fd]->getServerBlock()); // Remove constness for now if ServerConfig* is expected elsewhere
-	} else {
+	if (!_listenSockets.count(listen_fd)) {
 		std::cerr << "ERROR: _acceptNewConnection: Listen FD " << listen_fd << " not found in _listenSockets map. Cannot get config." << std::endl;
 		return; // Cannot proceed without config
 	}
+	Socket* listener = _listenSockets[listen_fd];
 
 	// acceptConnection returns a new client_fd or -1 on error
-	int client_fd = _listenSockets[listen_fd]->acceptConnection(listen_fd);
+	int client_fd = listener->acceptConnection(listen_fd);
 	if (client_fd > 0) {
+		// The server block is picked from the Host header of each request; the default one answers until then.
 		Connection* newConnection = new Connection(this);
 		newConnection->setSocketFD(client_fd);
-		newConnection->setServerBlock(associatedConfig);
+		newConnection->attachConfig(_config, _listenAddressFor(client_fd, listen_fd));
 		_connections[client_fd] = newConnection;
 		_addFdToPoll(client_fd, POLLIN); // Start polling for reads on the new connection
 	} else if (client_fd == -1) { // Error accepting (e.g., EINTR, EAGAIN/EWOULDBLOCK if non-blocking and no connections)
@@ -175,6 +523,21 @@ void Server::_acceptNewConnection(int listen_fd) {
 	}
 }
 
+// Listening address whose server blocks serve a new connection: that of its listener, unless it came
+// in on the wildcard socket through an address that has server blocks of its own.
+ListenAddress Server::_listenAddressFor(int client_fd, int listen_fd) const {
+	const ListenAddress& listened = _listenAddresses.find(listen_fd)->second;
+	if (!_config->hasSharedAddresses()) {
+		return listened; // Every address has its own socket.
+	}
+	ListenAddress local;
+	if (!Socket::localAddress(client_fd, local.first, local.second)) {
+		return listened;
+	}
+	local.second = listened.second;
+	return _config->getVirtualHosts(local) ? local : listened;
+}
+
 // Handles events on client sockets.
 void Server::_handleClientEvent(int client_fd, short revents) {
 	if (_connections.count(client_fd) == 0) {
@@ -186,19 +549,62 @@ void Server::_handleClientEvent(int client_fd, short revents) {
 
 	Connection* conn = _connections[client_fd];
 
+	// A client gone while its request is proxied frees the upstream connection right away.
+	if (conn->getState() == Connection::PROXYING && (revents & (POLLHUP | POLLERR | POLLNVAL | POLLRDHUP))) {
+		std::cout << "Client FD " << client_fd << " disconnected during proxying. Aborting it." << std::endl;
+		conn->abortProxy();
+		return;
+	}
+
+	// A client gone during CGI aborts it. A half-close with request body still unread is read first:
+	// the body may be complete, and a cut-short body is answered by handleRead().
+	if (conn->getState() == Connection::HANDLING_CGI
+		&& ((revents & (POLLHUP | POLLERR | POLLNVAL))
+			|| ((revents & POLLRDHUP) && !((revents & POLLIN) && conn->isReceivingRequestBody())))) {
+		std::cout << "Client FD " << client_fd << " disconnected during CGI. Aborting it." << std::endl;
+		conn->abortCGI();
+		return;
+	}
+
 	if (revents & POLLHUP) {
 		std::cout << "Client FD " << client_fd << " hung up. Marking for CLOSING." << std::endl;
 		conn->setState(Connection::CLOSING);
 	} else if (revents & (POLLERR | POLLNVAL)) { // POLLNVAL for invalid FD
 		std::cerr << "Error or invalid FD on client FD " << client_fd << ". Revents: " << revents << ". Marking for CLOSING." << std::endl;
 		conn->setState(Connection::CLOSING);
-	} else if (revents & POLLIN && conn->getState() == Connection::READING) {
-		conn->handleRead();
-	} else if (revents & POLLOUT && conn->getState() == Connection::WRITING) {
-		conn->handleWrite();
+	} else {
+		// A CGI fed a streamed request body may be read from and written to in the same iteration.
+		if (revents & POLLIN && (conn->getState() == Connection::READING || conn->isReceivingRequestBody())) {
+			conn->handleRead();
+		}
+		if (revents & POLLOUT && (conn->getState() == Connection::WRITING || conn->isStreaming())) {
+			conn->handleWrite();
+		}
 	}
 }
 
+// Queues a client whose CGI request waits for a pooled worker.
+void Server::queueCgiRequest(int client_fd) {
+	_cgiWaitQueue.push_back(client_fd);
+}
+
+// Starts queued CGI requests in arrival order as pooled workers or concurrency slots free up.
+// A request that still has to wait keeps its place without holding up the ones behind it, which may
+// target another location or pool. Entries whose connection closed or gave up waiting (timeout) are dropped.
+void Server::_dispatchQueuedCgi() {
+	size_t kept = 0;
+	for (size_t i = 0; i < _cgiWaitQueue.size(); ++i) {
+		std::map<int, Connection*>::iterator it = _connections.find(_cgiWaitQueue[i]);
+		if (it == _connections.end() || !it->second->isWaitingForCgiWorker()) {
+			continue;
+		}
+		if (!it->second->resumeQueuedCGI()) {
+			_cgiWaitQueue[kept++] = _cgiWaitQueue[i];
+		}
+	}
+	_cgiWaitQueue.resize(kept);
+}
+
 // Handles events on CGI pipes.
 void Server::_handleCgiEvent(int cgi_fd, short revents) {
 	if (_cgiFdsToConnection.count(cgi_fd) == 0) {
@@ -236,7 +642,9 @@ void Server::_handleCgiEvent(int cgi_fd, short revents) {
 		return;
 	}
 
-	if (revents & POLLIN) {
+	if (cgi_fd == cgiHandler->getProcessFd()) {
+		// The script exited: pollCGIProcess() below reaps it.
+	} else if (revents & (POLLIN | POLLHUP)) { // A hang-up without data still needs the read that reports EOF
 		cgiHandler->handleRead();
 	}
 	if (revents & POLLOUT) {
@@ -250,11 +658,48 @@ void Server::_handleCgiEvent(int cgi_fd, short revents) {
 	// Call pollCGIProcess to manage child process status (waitpid) and state transitions
 	cgiHandler->pollCGIProcess();
 
+	// Forward body data to the client as it arrives instead of waiting for the script to exit,
+	// and read more of the request body once the script has consumed what was buffered.
+	conn->pumpCgiOutput();
+	conn->pumpCgiInput();
+
 	if (cgiHandler->isFinished()) {
 		conn->finalizeCGI(); // This should transition connection state and potentially trigger response sending
 	}
 }
 
+// Handles events on upstream sockets of proxied requests.
+void Server::_handleProxyEvent(int proxy_fd, short revents) {
+	Connection* conn = _proxyFdsToConnection[proxy_fd];
+	if (!conn || _connections.count(conn->getSocketFD()) == 0 || conn->getProxyHandler() == NULL) {
+		std::cerr << "ERROR: Proxy FD " << proxy_fd << " has no active proxied request. Removing from poll and closing." << std::endl;
+		_proxyFdsToConnection.erase(proxy_fd);
+		_removeFdFromPoll(proxy_fd);
+		close(proxy_fd);
+		return;
+	}
+	conn->handleProxyEvent(revents);
+}
+
+// Marks for closing the connections that sat idle past their keep-alive timeout, those whose request
+// stopped arriving for as long, and, once a drain reaches its deadline, all that are left.
+void Server::_closeIdleConnections() {
+	time_t now = time(NULL);
+	bool drainExpired = _draining && now >= _drainDeadline;
+	for (std::map<int, Connection*>::iterator it = _connections.begin(); it != _connections.end(); ++it) {
+		if (it->second->isIdleExpired(now) || (_draining && it->second->isIdle())) {
+			std::cout << "Client FD " << it->first << " idle past keep-alive timeout. Marking for CLOSING." << std::endl;
+			it->second->setState(Connection::CLOSING);
+		} else if (it->second->isRequestExpired(now)) {
+			std::cout << "Client FD " << it->first << " stalled in the middle of a request. Marking for CLOSING." << std::endl;
+			it->second->setState(Connection::CLOSING);
+		} else if (drainExpired && it->second->getState() != Connection::CLOSING) {
+			std::cout << "Client FD " << it->first << " still open at the drain deadline. Marking for CLOSING." << std::endl;
+			it->second->setState(Connection::CLOSING);
+		}
+	}
+}
+
 // Reaps connections marked for closing.
 void Server::_reapClosedConnections() {
 	std::vector<int> fds_to_reap;
@@ -309,8 +754,12 @@ void Server::run() {
 
 	_running = true;
 	std::cout << "Server running and listening..." << std::endl;
+	if (_previousPid > 0) {
+		std::cout << "Binary upgrade: listening, telling process " << _previousPid << " to drain." << std::endl;
+		kill(_previousPid, SIGQUIT);
+	}
 
-	while (_running && !stopSig) {
+	while (_running && !stopSig && !(_draining && _connections.empty())) {
 		// Make sure _pfds is not empty before calling poll
 		if (_pfds.empty()) {
 			std::cout << "INFO: No active file descriptors to poll. Server will idle or exit." << std::endl;
@@ -318,30 +767,41 @@ void Server::run() {
 			break; // Exit if no FDs to poll
 		}
 
-		int num_events = poll(_pfds.data(), _pfds.size(), _timeout_ms);
+		// Also short while a new binary starts: its exit, which resumes accepting, produces no event.
+		int timeout_ms = (_connections.empty() && _upgradePid <= 0) ? _timeout_ms : std::min(_timeout_ms, IDLE_SWEEP_MS);
+		int num_events = poll(_pfds.data(), _pfds.size(), timeout_ms);
 
+		if (num_events < 0 && errno == EINTR) {
+			num_events = 0; // A signal (SIGHUP is handled at the end of the round): nothing to dispatch.
+		}
 		if (num_events < 0) {
 			std::cerr << "Poll error. Server shutting down." << std::endl;
 			_running = false;
 			break;
 		}
 
+		// Check for CGI timeouts (also on a quiet loop: a stuck script or a queued request produces no event)
+		for (std::map<int, Connection*>::iterator it = _connections.begin(); it != _connections.end(); ++it) {
+			Connection* conn = it->second;
+			if (conn->hasActiveCGI()) {
+				CGIHandler* cgiHandler = conn->getCgiHandler();
+				if (cgiHandler->checkTimeout()) {
+					std::cerr << "WARNING: CGI timeout detected for client FD " << conn->getSocketFD() << "." << std::endl;
+					cgiHandler->setTimeout();
+					conn->finalizeCGI(); // Finalize the connection's CGI handling
+				}
+			} else if (conn->getProxyHandler() && conn->getProxyHandler()->checkTimeout()) {
+				conn->getProxyHandler()->setTimeout();
+				conn->finalizeProxy();
+			}
+		}
+
 		if (num_events == 0) {
 			// Poll timeout. No events.
 		} else {
-			// Check for CGI timeouts
-			for (std::map<int, Connection*>::iterator it = _connections.begin(); it != _connections.end(); ++it) {
-				Connection* conn = it->second;
-				if (conn->hasActiveCGI()) {
-					CGIHandler* cgiHandler = conn->getCgiHandler();
-					if (cgiHandler->checkTimeout()) {
-						std::cerr << "WARNING: CGI timeout detected for client FD " << conn->getSocketFD() << "." << std::endl;
-						cgiHandler->setTimeout();
-						conn->finalizeCGI(); // Finalize the connection's CGI handling
-					}
-				}
-			}
-			// Iterate backwards to safely remove elements during iteration
+			// Entries removed meanwhile are blanked rather than erased (see _removeFdFromPoll), and fds
+			// added meanwhile are appended with no revents, so the indices stay valid throughout.
+			_dispatching = true;
 			for (long i = _pfds.size() - 1; i >= 0; --i) {
 				int current_fd = _pfds[i].fd;
 				short revents = _pfds[i].revents;
@@ -362,6 +822,9 @@ void Server::run() {
 				else if (_cgiFdsToConnection.count(current_fd)) {
 					_handleCgiEvent(current_fd, revents);
 				}
+				else if (_proxyFdsToConnection.count(current_fd)) {
+					_handleProxyEvent(current_fd, revents);
+				}
 				else {
 					// This case indicates an FD in _pfds that isn't managed by our maps.
 					// This can happen if an FD was removed from _connections or _cgiFdsToConnection
@@ -376,12 +839,42 @@ void Server::run() {
 					}
 				}
 			}
+			_dispatching = false;
+			if (_pollListHasHoles) {
+				_compactPollList();
+			}
+		}
+		_dispatchQueuedCgi(); // Hand workers released during this iteration to queued CGI requests
+		_closeIdleConnections(); // Recycle keep-alive sockets past their timeout
+		DiskCache::runManager(time(NULL)); // Evict inactive and least recently used disk cache entries
+		if (reloadSig) {
+			reloadSig = 0;
+			_reload(); // Between poll rounds, so no event handler sees the configuration change
+		}
+		if (upgradeSig) {
+			upgradeSig = 0;
+			_upgrade();
+		}
+		if (drainSig) {
+			drainSig = 0;
+			_startDraining();
 		}
+		_checkUpgrade();
 		_reapClosedConnections(); // Clean up connections marked for closing
 	}
 }
 
 // Public method to get server configurations.
 const std::vector<ServerConfig>& Server::getConfigs() const {
-	return _serverConfigs;
-}
\ No newline at end of file
+	return _config->getServers();
+}
+
+// Whether the server is shutting down gracefully: connections are not kept alive.
+bool Server::isDraining() const {
+	return _draining;
+}
+
+// The current configuration, which new requests start on.
+ConfigSnapshot* Server::getConfigSnapshot() const {
+	return _config;
+}
@@ -6,13 +6,15 @@
 #include <arpa/inet.h>
 #include <netdb.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <cstring>
 #include <iostream> // For std::cerr, std::cout
 #include <stdexcept> // For std::runtime_error
 #include <cstdio>   // Removed, as perror is no longer used
+#include <sstream>  // For the port string of an adopted socket
 
 // Constructor: Initializes a new Socket object.
-Socket::Socket() : _sockfd(-1), _sin_size(0), _port("") {
+Socket::Socket() : _sockfd(-1), _sin_size(0), _port(""), _server_block(NULL), _virtual_hosts(NULL) {
 }
 
 // Destructor: Cleans up Socket resources.
@@ -29,6 +31,7 @@ Socket::Socket(const Socket &cpy) {
     this->_addr = cpy._addr;
     this->_port = cpy._port;
     this->_server_block = cpy._server_block;
+    this->_virtual_hosts = cpy._virtual_hosts;
 }
 
 // Assignment Operator: Assigns socket file descriptor and size from another Socket.
@@ -42,6 +45,7 @@ Socket& Socket::operator=(const Socket  &src) {
         this->_addr = src._addr;
         this->_port = src._port;
         this->_server_block = src._server_block;
+        this->_virtual_hosts = src._virtual_hosts;
     }
     return (*this);
 }
@@ -63,6 +67,9 @@ void    Socket::createSocket(int ai_family, int ai_socktype, int ai_protocol) {
     // Allow reuse of local addresses.
     if (setsockopt(_sockfd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(int)) < 0)
         throw std::runtime_error("error with socket opt");
+    // Not inherited by CGI scripts (a binary upgrade hands listeners over explicitly).
+    if (fcntl(_sockfd, F_SETFD, FD_CLOEXEC) < 0)
+        throw std::runtime_error("error with socket opt");
 }
 
 // Binds the socket to a specified IP address and port.
@@ -85,6 +92,7 @@ int     Socket::acceptConnection(int listenSock) {
     if (client_fd < 0) {
         throw std::runtime_error("error with accept socket");
     }
+    fcntl(client_fd, F_SETFD, FD_CLOEXEC); // Not inherited by CGI scripts or a new binary.
     return client_fd;
 }
 
@@ -96,8 +104,8 @@ void    Socket::printConnection(void) {
     std::cout << "server received connection from: " << s << std::endl;
 }
 
-// Initializes a listening socket by creating, binding, and listening.
-bool    Socket::initListenSocket(const char* port) {
+// Initializes a listening socket by creating, binding, and listening. A NULL host binds every address.
+bool    Socket::initListenSocket(const char* port, const char* host) {
     struct addrinfo base;
     struct addrinfo *ai;
     struct addrinfo *p;
@@ -109,8 +117,8 @@ bool    Socket::initListenSocket(const char* port) {
     this->_port = port;
 
     // Get address information for the given port.
-    if (getaddrinfo(NULL, port, &base, &ai) != 0) {
-        std::cerr << "error with getaddrinfo for port " << port << std::endl;
+    if (getaddrinfo(host, port, &base, &ai) != 0) {
+        std::cerr << "error with getaddrinfo for " << (host ? host : "*") << ":" << port << std::endl;
         return false;
     }
     // Loop through all results and try to create and bind a socket.
@@ -142,6 +150,56 @@ bool    Socket::initListenSocket(const char* port) {
     return true;
 }
 
+// Takes over a listening socket bound by another process (binary upgrade, socket activation), without
+// binding it again. Fails if 'fd' is not a listening stream socket.
+bool    Socket::adoptListenSocket(int fd) {
+    int type = 0;
+    int listening = 0;
+    socklen_t len = sizeof(type);
+    if (getsockopt(fd, SOL_SOCKET, SO_TYPE, &type, &len) < 0 || type != SOCK_STREAM) {
+        return false;
+    }
+    len = sizeof(listening);
+    if (getsockopt(fd, SOL_SOCKET, SO_ACCEPTCONN, &listening, &len) < 0 || !listening) {
+        return false;
+    }
+    std::string host;
+    int port;
+    if (!localAddress(fd, host, port)) {
+        return false;
+    }
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    std::ostringstream oss;
+    oss << port;
+    this->_sockfd = fd;
+    this->_port = oss.str();
+    std::cout << "listen socket : " << _sockfd << " (inherited)" << std::endl;
+    return true;
+}
+
+// Local address of a socket, as written in a 'listen' directive: a numeric host, "0.0.0.0" for any
+// address (IPv4 or IPv6), and IPv4 clients of a dual-stack socket without their "::ffff:" prefix.
+bool    Socket::localAddress(int fd, std::string& host, int& port) {
+    struct sockaddr_storage local;
+    socklen_t len = sizeof(local);
+    char addr[INET6_ADDRSTRLEN];
+
+    if (getsockname(fd, reinterpret_cast<struct sockaddr*>(&local), &len) < 0
+        || (local.ss_family != AF_INET && local.ss_family != AF_INET6)
+        || !inet_ntop(local.ss_family, get_in_addr(reinterpret_cast<struct sockaddr*>(&local)), addr, sizeof(addr))) {
+        return false;
+    }
+    host = addr;
+    if (host.compare(0, 7, "::ffff:") == 0) {
+        host.erase(0, 7);
+    } else if (host == "::") {
+        host = "0.0.0.0";
+    }
+    port = ntohs(local.ss_family == AF_INET ? reinterpret_cast<struct sockaddr_in*>(&local)->sin_port
+                                            : reinterpret_cast<struct sockaddr_in6*>(&local)->sin6_port);
+    return true;
+}
+
 // Closes the socket file descriptor.
 void    Socket::closeSocket(void) {
     if (_sockfd != -1) {
@@ -184,4 +242,14 @@ void    Socket::setPortFD(std::string port) {
 // Sets the associated ServerConfig block.
 void    Socket::setServerBlock(const ServerConfig* sb) {
     this->_server_block = sb;
-}
\ No newline at end of file
+}
+
+// Returns the server blocks of the listening address.
+const VirtualHosts* Socket::getVirtualHosts(void) const {
+    return (_virtual_hosts);
+}
+
+// Sets the server blocks of the listening address.
+void    Socket::setVirtualHosts(const VirtualHosts* vhosts) {
+    this->_virtual_hosts = vhosts;
+}
@@ -0,0 +1,187 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   VirtualHosts.cpp                                   :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: bvieilhe <bvieilhe@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 17:05:12 by bvieilhe          #+#    #+#             */
+/*   Updated: 2026/10/18 17:05:12 by bvieilhe         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "../../includes/server/VirtualHosts.hpp"
+
+#include <cctype>
+#include <cstring>
+
+// FNV-1a over the (already lowercased) name bytes.
+static unsigned int hashName(const char* name, size_t len) {
+	unsigned int h = 2166136261u;
+	for (size_t i = 0; i < len; ++i) {
+		h ^= static_cast<unsigned char>(name[i]);
+		h *= 16777619u;
+	}
+	return h;
+}
+
+VirtualHosts::NameTable::NameTable() : _count(0) {}
+
+// Doubles the capacity (16 slots at first) and re-inserts every entry.
+void VirtualHosts::NameTable::_grow() {
+	std::vector<Slot> old;
+	old.swap(_slots);
+	_slots.assign(old.empty() ? 16 : old.size() * 2, Slot());
+
+	size_t mask = _slots.size() - 1;
+	for (size_t i = 0; i < old.size(); ++i) {
+		if (!old[i].server) {
+			continue;
+		}
+		size_t j = old[i].hash & mask;
+		while (_slots[j].server) {
+			j = (j + 1) & mask;
+		}
+		_slots[j] = old[i];
+	}
+}
+
+void VirtualHosts::NameTable::insert(const std::string& name, const ServerConfig* server) {
+	if ((_count + 1) * 2 > _slots.size()) {
+		_grow();
+	}
+	unsigned int h = hashName(name.data(), name.size());
+	size_t mask = _slots.size() - 1;
+	size_t i = h & mask;
+
+	while (_slots[i].server) {
+		if (_slots[i].hash == h && _slots[i].name == name) {
+			return; // Claimed by an earlier server block.
+		}
+		i = (i + 1) & mask;
+	}
+	_slots[i].hash = h;
+	_slots[i].server = server;
+	_slots[i].name = name;
+	++_count;
+}
+
+const ServerConfig* VirtualHosts::NameTable::find(const char* name, size_t len) const {
+	if (_count == 0) {
+		return NULL;
+	}
+	unsigned int h = hashName(name, len);
+	size_t mask = _slots.size() - 1;
+	for (size_t i = h & mask; _slots[i].server; i = (i + 1) & mask) {
+		const Slot& slot = _slots[i];
+		if (slot.hash == h && slot.name.size() == len && std::memcmp(slot.name.data(), name, len) == 0) {
+			return slot.server;
+		}
+	}
+	return NULL;
+}
+
+bool VirtualHosts::NameTable::empty() const {
+	return _count == 0;
+}
+
+VirtualHosts::VirtualHosts() : _default(NULL), _explicitDefault(false) {}
+
+// A name is plain, or has one wildcard: a leading "*." or ".", or a trailing ".*".
+bool VirtualHosts::isValidName(const std::string& name) {
+	if (name.size() >= VHOST_MAX_NAME_LEN) {
+		return false;
+	}
+	size_t star = name.find('*');
+	if (star == std::string::npos) {
+		return name != ".";
+	}
+	if (name.find('*', star + 1) != std::string::npos || name.size() < 3) {
+		return false;
+	}
+	if (star == 0) {
+		return name[1] == '.' && name[name.size() - 1] != '.';
+	}
+	return star == name.size() - 1 && name[star - 1] == '.' && name[0] != '.';
+}
+
+// Registers a server block listening on this address and files its names by kind.
+void VirtualHosts::add(const ServerConfig* server) {
+	if (!_default || (server->defaultServer && !_explicitDefault)) {
+		_default = server;
+		_explicitDefault = server->defaultServer;
+	}
+	for (size_t i = 0; i < server->serverNames.size(); ++i) {
+		std::string name = server->serverNames[i];
+		for (size_t j = 0; j < name.size(); ++j) {
+			name[j] = static_cast<char>(std::tolower(static_cast<unsigned char>(name[j])));
+		}
+		if (name.size() > 1 && name[name.size() - 1] == '.') {
+			name.erase(name.size() - 1);
+		}
+
+		if (name.compare(0, 2, "*.") == 0) {
+			_suffixes.insert(name.substr(1), server);
+		} else if (!name.empty() && name[0] == '.') {
+			_suffixes.insert(name, server);
+			_exact.insert(name.substr(1), server); // ".example.com" also covers "example.com".
+		} else if (name.size() > 2 && name.compare(name.size() - 2, 2, ".*") == 0) {
+			_prefixes.insert(name.substr(0, name.size() - 1), server);
+		} else {
+			_exact.insert(name, server);
+		}
+	}
+}
+
+// Picks the server block for a Host header value: an exact name, then the longest leading wildcard,
+// then the longest trailing wildcard, then the default server. Allocation-free: the name is lowercased
+// into a stack buffer, and a known name costs a single hash probe.
+const ServerConfig* VirtualHosts::select(const std::string& host) const {
+	size_t end = host.size();
+	if (!host.empty() && host[0] == '[') { // IPv6 literal, "[::1]:8080"
+		size_t bracket = host.find(']');
+		if (bracket != std::string::npos) {
+			end = bracket + 1;
+		}
+	} else {
+		size_t colon = host.find(':');
+		if (colon != std::string::npos) {
+			end = colon;
+		}
+	}
+	if (end > 1 && host[end - 1] == '.') {
+		--end;
+	}
+	if (end >= VHOST_MAX_NAME_LEN) {
+		return _default;
+	}
+
+	char name[VHOST_MAX_NAME_LEN];
+	for (size_t i = 0; i < end; ++i) {
+		name[i] = static_cast<char>(std::tolower(static_cast<unsigned char>(host[i])));
+	}
+
+	const ServerConfig* server = _exact.find(name, end);
+	if (server) {
+		return server;
+	}
+	if (!_suffixes.empty()) {
+		for (size_t i = 1; i < end; ++i) {
+			if (name[i] == '.' && (server = _suffixes.find(name + i, end - i)) != NULL) {
+				return server;
+			}
+		}
+	}
+	if (!_prefixes.empty()) {
+		for (size_t i = end; i-- > 1; ) {
+			if (name[i] == '.' && i + 1 < end && (server = _prefixes.find(name, i + 1)) != NULL) {
+				return server;
+			}
+		}
+	}
+	return _default;
+}
+
+const ServerConfig* VirtualHosts::defaultServer() const {
+	return _default;
+}
@@ -147,4 +147,12 @@ namespace StringUtils {
         return oss.str();
     }
 
+    // Appends one "NAME=value" entry, NUL-terminated, to a CGI environment block.
+    void appendEnvEntry(std::string& env, const char* name, const std::string& value) {
+        env.append(name);
+        env.push_back('=');
+        env.append(value);
+        env.push_back('\0');
+    }
+
 } // namespace StringUtils
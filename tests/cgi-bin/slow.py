@@ -0,0 +1,18 @@
+#!/usr/bin/env python3
+# Takes a second, then answers according to ?mode=: "cookie" (Set-Cookie), "nostore"
+# (Cache-Control: no-store), "missing" (404) or anything else (a cacheable 200).
+import os
+import sys
+import time
+
+time.sleep(1)
+mode = os.environ.get("QUERY_STRING", "").partition("mode=")[2].partition("&")[0]
+headers = "Content-Type: text/plain\r\n"
+if mode == "cookie":
+    headers += "Set-Cookie: session=%d; Path=/\r\n" % os.getpid()
+elif mode == "nostore":
+    headers += "Cache-Control: no-store\r\n"
+elif mode == "missing":
+    headers = "Status: 404 Not Found\r\n" + headers
+sys.stdout.write(headers + "\r\n" + "pid %d\n" % os.getpid())
+sys.stdout.flush()
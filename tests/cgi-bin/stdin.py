@@ -0,0 +1,12 @@
+#!/usr/bin/env python3
+# Reports how the request body reached the script: "file" (memfd) or "pipe", its length and SHA-1.
+import hashlib
+import os
+import stat
+import sys
+
+kind = "file" if stat.S_ISREG(os.fstat(0).st_mode) else "pipe"
+body = sys.stdin.buffer.read()
+sys.stdout.write("Content-Type: text/plain\r\n\r\n")
+sys.stdout.write("%s %d %s\n" % (kind, len(body), hashlib.sha1(body).hexdigest()))
+sys.stdout.flush()
@@ -0,0 +1,52 @@
+#!/bin/sh
+# CGI cache under concurrent identical requests (run from the repository root: 'make test').
+# The script takes a second. A cacheable answer is run once and shared; one that can't be stored
+# (Set-Cookie, no-store, 404) must not make the waiting requests run the script one after another.
+
+PORT=8089
+URL="http://127.0.0.1:$PORT/cgi-bin/slow.py"
+TMP=$(mktemp -d)
+FAILED=0
+
+./webserv tests/cgi_cache.conf > "$TMP/webserv.log" 2>&1 &
+SERVER=$!
+trap 'kill $SERVER 2>/dev/null; rm -rf "$TMP"' EXIT
+sleep 0.5
+
+# Sends 4 identical requests at once; prints the seconds they took together.
+burst() {
+	start=$(date +%s%N)
+	for i in 1 2 3 4; do
+		curl -s -D "$TMP/headers.$i" -o "$TMP/body.$i" "$URL?mode=$1" &
+	done
+	wait
+	echo $(( ($(date +%s%N) - start) / 1000000 ))
+}
+
+check() {
+	if [ "$2" = yes ]; then
+		echo "ok   - $1"
+	else
+		echo "FAIL - $1"
+		FAILED=1
+	fi
+}
+
+# The first burst waits for the first answer, then runs the rest at once; within the 'valid'
+# window that follows, the key is known to be uncacheable and nobody waits.
+for mode in cookie nostore missing; do
+	ms=$(burst $mode)
+	runs=$(cat "$TMP"/body.* | sort -u | wc -l)
+	check "$mode: 4 concurrent requests finish in two rounds at most (${ms} ms)" $( [ "$ms" -lt 2500 ] && echo yes )
+	check "$mode: every request ran the script ($runs runs)" $( [ "$runs" -eq 4 ] && echo yes )
+	ms=$(burst $mode)
+	check "$mode: 4 more concurrent requests run at once (${ms} ms)" $( [ "$ms" -lt 1500 ] && echo yes )
+done
+
+ms=$(burst cacheable)
+runs=$(cat "$TMP"/body.* | sort -u | wc -l)
+misses=$(cat "$TMP"/headers.* | grep -c "X-Cache-Status: MISS")
+check "cacheable: 4 concurrent requests finish together (${ms} ms)" $( [ "$ms" -lt 2500 ] && echo yes )
+check "cacheable: the script ran once ($runs runs, $misses MISS)" $( [ "$runs" -eq 1 ] && [ "$misses" -eq 1 ] && echo yes )
+
+exit $FAILED
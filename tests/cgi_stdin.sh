@@ -0,0 +1,54 @@
+#!/bin/sh
+# How a CGI request body reaches the script (run from the repository root: 'make test').
+# Bodies announced by a Content-Length of at least 64 KB are collected into a memfd while they
+# arrive and the script reads a regular file; smaller and chunked ones go through the stdin pipe.
+
+PORT=8093
+URL="http://127.0.0.1:$PORT/cgi-bin/stdin.py"
+TMP=$(mktemp -d)
+FAILED=0
+
+./webserv tests/cgi_stdin.conf > "$TMP/webserv.log" 2>&1 &
+SERVER=$!
+trap 'kill $SERVER 2>/dev/null; rm -rf "$TMP"' EXIT
+sleep 0.5
+
+check() {
+	if [ "$2" = yes ]; then
+		echo "ok   - $1"
+	else
+		echo "FAIL - $1"
+		FAILED=1
+	fi
+}
+
+# Posts a body of $1 bytes (extra curl options follow); checks the script got it whole, through $2.
+post() {
+	size=$1
+	expected=$2
+	shift 2
+	options="$*"
+	head -c "$size" /dev/urandom > "$TMP/body"
+	sum=$(sha1sum "$TMP/body" | cut -d' ' -f1)
+	got=$(curl -s --data-binary @"$TMP/body" -H "Content-Type: application/octet-stream" "$@" "$URL")
+	check "$size bytes${options:+ ($options)} reach the script through a $expected: $got" \
+		$( [ "$got" = "$expected $size $sum" ] && echo yes )
+}
+
+post 1024 pipe
+post 102400 file
+post 1048576 file --limit-rate 512k
+post 1048576 pipe -H "Transfer-Encoding: chunked"
+
+# A client that stops in the middle of a spooled body gets a 408 once the CGI timeout passes.
+status=$(python3 - "$PORT" <<'PY'
+import socket, sys
+s = socket.create_connection(("127.0.0.1", int(sys.argv[1])))
+s.sendall(b"POST /cgi-bin/stdin.py HTTP/1.1\r\nHost: x\r\nContent-Length: 100000\r\n\r\n" + b"a" * 70000)
+s.settimeout(15)
+print(s.recv(64).split(b"\r\n")[0].decode())
+PY
+)
+check "a stalled spooled upload is answered ($status)" $( [ "$status" = "HTTP/1.1 408 Request Timeout" ] && echo yes )
+
+exit $FAILED
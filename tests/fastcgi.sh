@@ -0,0 +1,46 @@
+#!/bin/sh
+# fastcgi_pass to the sample responder, over a unix socket and over TCP (run from the repository
+# root: 'make test'). The responder echoes the request method, query string and a SHA-1 of the body.
+
+PORT=8096
+URL="http://127.0.0.1:$PORT"
+SOCKET=/tmp/webserv_test_fcgi.sock
+TMP=$(mktemp -d)
+FAILED=0
+
+python3 www/fastcgi/fcgi_app.py "unix:$SOCKET" &
+BACKEND_UNIX=$!
+python3 www/fastcgi/fcgi_app.py 127.0.0.1:9098 &
+BACKEND_TCP=$!
+./webserv tests/fastcgi.conf > "$TMP/webserv.log" 2>&1 &
+SERVER=$!
+trap 'kill $SERVER $BACKEND_UNIX $BACKEND_TCP 2>/dev/null; rm -rf "$TMP" "$SOCKET"' EXIT
+sleep 0.5
+
+check() {
+	if [ "$2" = yes ]; then
+		echo "ok   - $1"
+	else
+		echo "FAIL - $1"
+		FAILED=1
+	fi
+}
+
+head -c 1048576 /dev/urandom > "$TMP/body"
+sum=$(sha1sum "$TMP/body" | cut -d' ' -f1)
+
+for transport in unix tcp; do
+	curl -s "$URL/$transport/app?x=1" > "$TMP/get"
+	check "$transport: GET reaches the responder" \
+		$( grep -q '^REQUEST_METHOD=GET$' "$TMP/get" && grep -q '^QUERY_STRING=x=1$' "$TMP/get" && echo yes )
+
+	curl -s --data-binary @"$TMP/body" "$URL/$transport/app" > "$TMP/post"
+	check "$transport: a 1 MB POST arrives whole" \
+		$( grep -q '^CONTENT_LENGTH=1048576$' "$TMP/post" && grep -q "^body sha1=$sum$" "$TMP/post" && echo yes )
+
+	curl -s --data-binary @"$TMP/body" -H "Transfer-Encoding: chunked" "$URL/$transport/app" > "$TMP/chunked"
+	check "$transport: a chunked 1 MB POST arrives whole" \
+		$( grep -q '^body bytes=1048576$' "$TMP/chunked" && grep -q "^body sha1=$sum$" "$TMP/chunked" && echo yes )
+done
+
+exit $FAILED
@@ -0,0 +1,70 @@
+#!/bin/sh
+# proxy_pass against stand-in backends (run from the repository root: 'make test').
+# tests/upstream.py plays the upstream servers on 9095 ("a") and 9096 ("b"); nothing listens on 9097.
+
+PORT=8095
+URL="http://127.0.0.1:$PORT"
+TMP=$(mktemp -d)
+CACHE=/tmp/webserv_test_cache
+FAILED=0
+
+rm -rf "$CACHE"
+python3 tests/upstream.py 9095 a &
+BACKEND_A=$!
+python3 tests/upstream.py 9096 b &
+BACKEND_B=$!
+./webserv tests/proxy.conf > "$TMP/webserv.log" 2>&1 &
+SERVER=$!
+trap 'kill $SERVER $BACKEND_A $BACKEND_B 2>/dev/null; rm -rf "$TMP" "$CACHE"' EXIT
+sleep 0.5
+
+check() {
+	if [ "$2" = yes ]; then
+		echo "ok   - $1"
+	else
+		echo "FAIL - $1"
+		FAILED=1
+	fi
+}
+
+# Weights 3:1 over 8 requests.
+for i in 1 2 3 4 5 6 7 8; do
+	curl -s "$URL/weighted/whoami"
+done > "$TMP/split"
+a=$(grep -c '^a$' "$TMP/split")
+b=$(grep -c '^b$' "$TMP/split")
+check "weighted round-robin splits 3:1 ($a to a, $b to b)" $( [ "$a" -eq 6 ] && [ "$b" -eq 2 ] && echo yes )
+
+cookies=$(curl -s -D - -o /dev/null "$URL/single/cookie" | grep -c '^Set-Cookie: [ab]=[12]; Path=/')
+check "each upstream Set-Cookie is relayed as its own line ($cookies lines)" $( [ "$cookies" -eq 2 ] && echo yes )
+
+curl -s "$URL/single/chunked" > "$TMP/chunked"
+seq 0 99 | sed 's/^/line /' > "$TMP/expected"
+check "a chunked upstream body is relayed whole" $( cmp -s "$TMP/chunked" "$TMP/expected" && echo yes )
+
+status=$(curl -s -o /dev/null -w '%{http_code}' "$URL/down/whoami")
+check "a server that is down gives 502 ($status)" $( [ "$status" = 502 ] && echo yes )
+
+# The second request reuses the pooled connection; once the backend dropped it, a new one is opened.
+first=$(curl -s "$URL/single/conn")
+second=$(curl -s "$URL/single/conn")
+check "an idle upstream connection is reused (connections $first, $second)" $( [ "$first" = "$second" ] && echo yes )
+dropped=$(curl -s "$URL/single/close")
+sleep 0.5
+status=$(curl -s -o "$TMP/after" -w '%{http_code}' "$URL/single/conn")
+after=$(cat "$TMP/after")
+check "a connection the backend closed is not reused (connection $dropped, then $status on $after)" \
+	$( [ "$status" = 200 ] && [ "$after" -gt "$dropped" ] && echo yes )
+
+# proxy_cache: stored on the first request, served from disk on the next; Set-Cookie is never stored.
+cache_status() {
+	curl -s -D - -o /dev/null "$URL/cached/$1" | tr -d '\r' | sed -n 's/^X-Cache-Status: //p'
+}
+s1=$(cache_status whoami)
+s2=$(cache_status whoami)
+check "proxy_cache stores a response, then serves it ($s1, $s2)" $( [ "$s1" = MISS ] && [ "$s2" = HIT ] && echo yes )
+s1=$(cache_status cookie)
+s2=$(cache_status cookie)
+check "proxy_cache bypasses a response with Set-Cookie ($s1, $s2)" $( [ "$s1" = BYPASS ] && [ "$s2" = BYPASS ] && echo yes )
+
+exit $FAILED
@@ -0,0 +1,59 @@
+#!/usr/bin/env python3
+# Stand-in HTTP/1.1 keep-alive backend for tests/proxy.sh: upstream.py PORT NAME. The request URI is
+# relayed unchanged, so only its last segment is looked at:
+#   /whoami   answers NAME
+#   /conn     answers the number of the connection it came on (1 for the first accepted, ...)
+#   /close    same, then closes the connection shortly after, as a server dropping an idle one
+#   /cookie   answers NAME with two Set-Cookie header lines
+#   /chunked  answers 100 numbered lines with Transfer-Encoding: chunked
+import socket
+import sys
+import threading
+import time
+
+port, name = int(sys.argv[1]), sys.argv[2]
+server = socket.socket()
+server.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+server.bind(("127.0.0.1", port))
+server.listen(64)
+accepted = [0]
+
+
+def answer(conn, body, extra=""):
+    conn.sendall(("HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nContent-Length: %d\r\n%s\r\n"
+                  % (len(body), extra)).encode() + body.encode())
+
+
+def serve(conn, number):
+    buf = b""
+    while True:
+        while b"\r\n\r\n" not in buf:
+            data = conn.recv(4096)
+            if not data:
+                conn.close()
+                return
+            buf += data
+        head, buf = buf.split(b"\r\n\r\n", 1)
+        path = "/" + head.split(b" ")[1].decode().split("?")[0].rsplit("/", 1)[-1]
+        if path == "/cookie":
+            answer(conn, name + "\n", "Set-Cookie: a=1; Path=/\r\nSet-Cookie: b=2; Path=/\r\n")
+        elif path == "/chunked":
+            conn.sendall(b"HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nTransfer-Encoding: chunked\r\n\r\n")
+            for i in range(100):
+                line = ("line %d\n" % i).encode()
+                conn.sendall(b"%x\r\n%s\r\n" % (len(line), line))
+            conn.sendall(b"0\r\n\r\n")
+        elif path in ("/conn", "/close"):
+            answer(conn, "%d\n" % number)
+            if path == "/close":
+                time.sleep(0.1)
+                conn.close()
+                return
+        else:
+            answer(conn, name + "\n")
+
+
+while True:
+    conn, _ = server.accept()
+    accepted[0] += 1
+    threading.Thread(target=serve, args=(conn, accepted[0]), daemon=True).start()
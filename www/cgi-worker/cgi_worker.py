@@ -0,0 +1,148 @@
+#!/usr/bin/env python3
+# Warm CGI worker for 'cgi_pool'. webserv starts it as '<cgi_path> cgi_worker.py' and sends one
+# request at a time as FastCGI records over stdin; each script runs in this process (imports stay
+# cached) with its output sent back as FastCGI STDOUT records over the original stdout.
+import io
+import os
+import runpy
+import struct
+import sys
+import traceback
+
+BEGIN_REQUEST, END_REQUEST, PARAMS, STDIN, STDOUT, STDERR = 1, 3, 4, 5, 6, 7
+
+# Keep the protocol channel private: stray writes to fd 1 (os.system, C extensions) land in the log.
+CHANNEL_IN = os.fdopen(os.dup(0), "rb", buffering=0)
+CHANNEL_OUT = os.dup(1)
+os.dup2(2, 1)
+devnull = os.open(os.devnull, os.O_RDONLY)
+os.dup2(devnull, 0)
+os.close(devnull)
+
+BASE_ENV = dict(os.environ)
+BASE_CWD = os.getcwd()
+
+
+def read_exact(n):
+    data = b""
+    while len(data) < n:
+        chunk = CHANNEL_IN.read(n - len(data))
+        if not chunk:
+            return None
+        data += chunk
+    return data
+
+
+def read_record():
+    header = read_exact(8)
+    if header is None:
+        return None
+    _, rtype, req_id, clen, plen, _ = struct.unpack("!BBHHBB", header)
+    content = read_exact(clen + plen)
+    if content is None:
+        return None
+    return rtype, req_id, content[:clen]
+
+
+def write_record(rtype, data):
+    view = memoryview(data)
+    while True:
+        part = view[:65535]
+        header = struct.pack("!BBHHBB", 1, rtype, 1, len(part), 0, 0)
+        os.write(CHANNEL_OUT, header)
+        sent = 0
+        while sent < len(part):
+            sent += os.write(CHANNEL_OUT, part[sent:])
+        view = view[65535:]
+        if not view:
+            return
+
+
+def decode_length(buf, pos):
+    if buf[pos] < 128:
+        return buf[pos], pos + 1
+    return struct.unpack("!I", buf[pos:pos + 4])[0] & 0x7FFFFFFF, pos + 4
+
+
+def decode_params(buf):
+    params, pos = {}, 0
+    while pos < len(buf):
+        nlen, pos = decode_length(buf, pos)
+        vlen, pos = decode_length(buf, pos)
+        name = buf[pos:pos + nlen].decode("latin-1")
+        pos += nlen
+        params[name] = buf[pos:pos + vlen].decode("latin-1")
+        pos += vlen
+    return params
+
+
+class RecordWriter(io.RawIOBase):
+    """Raw stream turning every flushed write into a STDOUT record."""
+
+    def __init__(self):
+        super().__init__()
+        self.written = 0
+
+    def writable(self):
+        return True
+
+    def write(self, data):
+        if data:
+            write_record(STDOUT, bytes(data))
+            self.written += len(data)
+        return len(data)
+
+
+def run_script(params, body):
+    script = params.get("SCRIPT_FILENAME", "")
+    raw = RecordWriter()
+    out = io.TextIOWrapper(io.BufferedWriter(raw, 65536), encoding="utf-8", newline="")
+    saved = sys.stdin, sys.stdout, sys.argv
+    os.environ.clear()
+    os.environ.update(BASE_ENV)
+    os.environ.update(params)
+    status = 0
+    try:
+        os.chdir(params.get("DOCUMENT_ROOT") or BASE_CWD)
+        sys.stdin = io.TextIOWrapper(io.BytesIO(body), encoding="utf-8")
+        sys.stdout = out
+        sys.argv = [script]
+        runpy.run_path(script, run_name="__main__")
+    except SystemExit as e:
+        status = e.code if isinstance(e.code, int) else (0 if e.code is None else 1)
+    except BaseException:
+        status = 1
+        write_record(STDERR, traceback.format_exc().encode())
+    finally:
+        try:
+            out.flush()
+        except Exception:
+            pass
+        sys.stdin, sys.stdout, sys.argv = saved
+        os.chdir(BASE_CWD)
+    if status != 0 and raw.written == 0:
+        write_record(STDOUT, b"Status: 500\r\nContent-Type: text/plain\r\n\r\nCGI script failed.\n")
+    return status
+
+
+def main():
+    while True:
+        params_buf, body = b"", b""
+        while True:
+            record = read_record()
+            if record is None:
+                return  # webserv closed the pipe: retire.
+            rtype, _, content = record
+            if rtype == PARAMS:
+                params_buf += content
+            elif rtype == STDIN:
+                if not content:
+                    break
+                body += content
+        status = run_script(decode_params(params_buf), body)
+        write_record(STDOUT, b"")
+        write_record(END_REQUEST, struct.pack("!IB3x", status & 0xFFFFFFFF, 0))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,114 @@
+#!/usr/bin/env python3
+# Minimal FastCGI responder used to exercise 'fastcgi_pass'.
+# Usage: fcgi_app.py unix:/tmp/webserv_fcgi.sock | fcgi_app.py 127.0.0.1:9000
+import hashlib
+import os
+import socket
+import struct
+import sys
+import threading
+
+BEGIN_REQUEST, END_REQUEST, PARAMS, STDIN, STDOUT, STDERR = 1, 3, 4, 5, 6, 7
+KEEP_CONN = 1
+
+
+def read_exact(conn, n):
+    data = b""
+    while len(data) < n:
+        chunk = conn.recv(n - len(data))
+        if not chunk:
+            return None
+        data += chunk
+    return data
+
+
+def read_record(conn):
+    header = read_exact(conn, 8)
+    if header is None:
+        return None
+    _, rtype, req_id, clen, plen, _ = struct.unpack("!BBHHBB", header)
+    content = read_exact(conn, clen + plen)
+    if content is None:
+        return None
+    return rtype, req_id, content[:clen]
+
+
+def write_record(conn, rtype, req_id, data):
+    for i in range(0, max(len(data), 1), 65535):
+        part = data[i:i + 65535]
+        conn.sendall(struct.pack("!BBHHBB", 1, rtype, req_id, len(part), 0, 0) + part)
+
+
+def decode_length(buf, pos):
+    if buf[pos] < 128:
+        return buf[pos], pos + 1
+    return struct.unpack("!I", buf[pos:pos + 4])[0] & 0x7FFFFFFF, pos + 4
+
+
+def decode_params(buf):
+    params, pos = {}, 0
+    while pos < len(buf):
+        nlen, pos = decode_length(buf, pos)
+        vlen, pos = decode_length(buf, pos)
+        name = buf[pos:pos + nlen].decode("latin-1")
+        pos += nlen
+        params[name] = buf[pos:pos + vlen].decode("latin-1")
+        pos += vlen
+    return params
+
+
+def respond(params, body):
+    lines = ["FastCGI pid %d" % os.getpid()]
+    for key in ("REQUEST_METHOD", "SCRIPT_FILENAME", "QUERY_STRING", "CONTENT_LENGTH"):
+        lines.append("%s=%s" % (key, params.get(key, "")))
+    lines.append("body bytes=%d" % len(body))
+    lines.append("body sha1=%s" % hashlib.sha1(body).hexdigest())
+    text = ("\n".join(lines) + "\n").encode()
+    return b"Content-Type: text/plain\r\n\r\n" + text
+
+
+def serve(conn):
+    with conn:
+        while True:
+            params_buf, body, keep_conn, req_id = b"", b"", False, 0
+            while True:
+                record = read_record(conn)
+                if record is None:
+                    return
+                rtype, req_id, content = record
+                if rtype == BEGIN_REQUEST:
+                    keep_conn = bool(content[2] & KEEP_CONN)
+                elif rtype == PARAMS:
+                    params_buf += content
+                elif rtype == STDIN:
+                    if not content:
+                        break
+                    body += content
+            write_record(conn, STDOUT, req_id, respond(decode_params(params_buf), body))
+            write_record(conn, STDOUT, req_id, b"")
+            write_record(conn, END_REQUEST, req_id, struct.pack("!IB3x", 0, 0))
+            if not keep_conn:
+                return
+
+
+def main():
+    address = sys.argv[1] if len(sys.argv) > 1 else "unix:/tmp/webserv_fcgi.sock"
+    if address.startswith("unix:"):
+        path = address[5:]
+        if os.path.exists(path):
+            os.unlink(path)
+        listener = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        listener.bind(path)
+    else:
+        host, port = address.rsplit(":", 1)
+        listener = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        listener.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        listener.bind((host, int(port)))
+    listener.listen(64)
+    while True:
+        conn, _ = listener.accept()
+        threading.Thread(target=serve, args=(conn,), daemon=True).start()
+
+
+if __name__ == "__main__":
+    main()